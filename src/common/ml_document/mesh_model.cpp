@@ -27,14 +27,35 @@
 
 #include "mesh_model.h"
 #include "../utilities/load_save.h"
+#include "../utilities/parallel_reductions.h"
 
 #include <wrap/gl/math.h>
 
 #include <QDir>
+#include <QBuffer>
+#include <QFile>
+#include <QImageReader>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <utility>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace vcg;
 
+namespace {
+// shared among all the meshes: a cached generation never matches the one of another mesh
+std::atomic<unsigned int> globalAttributeGeneration(0);
+
+bool lazyTextureDecodingEnabled = false;
+
+// guards the lazy decoding of the textures, that can be triggered by const accessors
+std::mutex lazyTexturesMutex;
+}
+
 MeshModel::MeshModel(int id, const QString& fullFileName, const QString& labelName) :
 	visible(true)
 {
@@ -57,15 +78,14 @@ void MeshModel::clear()
 	cm.Tr.SetIdentity();
 	cm.sfn=0;
 	cm.svn=0;
+	markAttributesChanged(MM_ALL);
 }
 
 void MeshModel::updateBoxAndNormals()
 {
-	tri::UpdateBounding<CMeshO>::Box(cm);
-	if(cm.fn>0) {
-		tri::UpdateNormal<CMeshO>::PerFaceNormalized(cm);
-		tri::UpdateNormal<CMeshO>::PerVertexAngleWeighted(cm);
-	}
+	// same as UpdateBounding::Box, UpdateNormal::PerFaceNormalized and
+	// UpdateNormal::PerVertexAngleWeighted, fused in parallel passes
+	meshlab::updateBoxAndNormals(cm);
 }
 
 QString MeshModel::relativePathName(const QString& path) const
@@ -89,6 +109,10 @@ QString MeshModel::relativePathName(const QString& path) const
  *
  * When a texture is not found, a dummy texture will be used (":/resources/images/dummy.png").
  *
+ * The textures are decoded concurrently. With lazy texture decoding enabled
+ * (see setLazyTextureDecoding), the files of the formats natively supported
+ * by Qt are only read, and decoded at their first access.
+ *
  * Returns the list of non-loaded textures that have been modified with
  * ":/img/dummy.png" in the contained mesh.
  */
@@ -96,55 +120,331 @@ std::list<std::string> MeshModel::loadTextures(
 		GLLogStream* log,
 		vcg::CallBackPos* cb)
 {
-	std::list<std::string> unloadedTextures;
-	for (std::string& textName : cm.textures){
-		if (textures.find(textName) == textures.end()){
-			QImage img(":/resources/images/dummy.png");
+	// a texture to be loaded, with its two candidate paths: as given (absolute
+	// or relative to the current dir) and relative to the meshmodel. Paths are
+	// resolved here, since the current dir could change while decoding
+	struct TextureJob {
+		std::string origName;
+		QString     paths[2];
+		std::string names[2];
+		int         loaded = -1; // index of the path that has been loaded
+		QImage      img;
+		QByteArray  data; // lazy decoding: compressed file content
+		QByteArray  format;
+	};
+
+	const bool lazy = lazyTextureDecoding();
+	const QList<QByteArray> lazyFormats = QImageReader::supportedImageFormats();
+	std::vector<TextureJob> jobs;
+	std::map<std::string, int> jobIndex;
+	for (const std::string& textName : cm.textures){
+		if (!hasTexture(textName) && jobIndex.find(textName) == jobIndex.end()){
 			QFileInfo finfo(QString::fromStdString(textName));
-			try {
-				img = meshlab::loadImage(finfo.absoluteFilePath(), log, cb);
-				textName = finfo.fileName().toStdString();
-			} catch (const MLException& e) {
-				try { //could be relative to the meshmodel
-					QFileInfo mfi(fullName());
-					QString fn2 = mfi.absolutePath() + "/" + finfo.filePath();
-					img = meshlab::loadImage(fn2, log, cb);
-					textName = finfo.filePath().toStdString();
-				} catch (const MLException& e) {
-					if (log){
-						log->log(
-							GLLogStream::WARNING, "Failed loading " + textName +
-							"; using a dummy texture");
-					}
-					else {
-						std::cerr <<
-							"Failed loading " + textName + "; using a dummy texture\n";
+			QFileInfo mfi(fullName());
+			TextureJob j;
+			j.origName = textName;
+			j.paths[0] = finfo.absoluteFilePath();
+			j.names[0] = finfo.fileName().toStdString();
+			j.paths[1] = mfi.absolutePath() + "/" + finfo.filePath();
+			j.names[1] = finfo.filePath().toStdString();
+			j.format = finfo.suffix().toLower().toLatin1();
+			jobIndex[textName] = jobs.size();
+			jobs.push_back(j);
+		}
+	}
+
+	// decode (or just read, if lazy) the textures concurrently
+	std::atomic<int> done(0);
+	#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < (int) jobs.size(); ++i) {
+		TextureJob& j = jobs[i];
+		const bool readOnly = lazy && lazyFormats.contains(j.format);
+		for (int p = 0; p < 2 && j.loaded < 0; ++p) {
+			if (readOnly) {
+				QFile f(j.paths[p]);
+				if (f.open(QIODevice::ReadOnly)) {
+					j.data = f.readAll();
+					QBuffer buffer(&j.data);
+					QImageReader reader(&buffer, j.format);
+					if (reader.canRead()) { // just a header check
+						j.loaded = p;
+						break;
 					}
-					unloadedTextures.push_back(textName);
-					textName = "dummy.png";
+					j.data.clear();
 				}
 			}
-			textures[textName] = img;
+			try {
+				j.img = meshlab::decodeImage(j.paths[p]);
+				j.loaded = p;
+			} catch (const MLException&) {
+			}
+		}
+		int d = ++done;
+#ifdef _OPENMP
+		if (omp_get_thread_num() == 0)
+#endif
+		if (cb)
+			cb(100 * d / jobs.size(), "Loading textures...");
+	}
+
+	std::list<std::string> unloadedTextures;
+	for (TextureJob& j : jobs){
+		if (j.loaded < 0){
+			if (log){
+				log->log(
+					GLLogStream::WARNING, "Failed loading " + j.origName +
+					"; using a dummy texture");
+			}
+			else {
+				std::cerr <<
+					"Failed loading " + j.origName + "; using a dummy texture\n";
+			}
+			unloadedTextures.push_back(j.origName);
+			textures["dummy.png"] = QImage(":/resources/images/dummy.png");
+		}
+		else {
+			const std::string& name = j.names[j.loaded];
+			TextureFile& tf = textureFiles[name];
+			tf.path = QFileInfo(j.paths[j.loaded]).absoluteFilePath();
+			tf.format = j.format;
+			tf.lastModified = QFileInfo(tf.path).lastModified();
+			if (!j.data.isEmpty()){
+				lazyTextures[name] = std::make_pair(j.data, j.format);
+				tf.cacheKey = 0;
+			}
+			else {
+				textures[name] = j.img;
+				tf.cacheKey = j.img.cacheKey();
+			}
+		}
+	}
+
+	// rename the textures in the mesh with the name used in the map
+	for (std::string& textName : cm.textures){
+		auto it = jobIndex.find(textName);
+		if (it != jobIndex.end()){
+			const TextureJob& j = jobs[it->second];
+			textName = j.loaded < 0 ? std::string("dummy.png") : j.names[j.loaded];
 		}
 	}
 	return unloadedTextures;
 }
 
+void MeshModel::setLazyTextureDecoding(bool lazy)
+{
+	lazyTextureDecodingEnabled = lazy;
+}
+
+bool MeshModel::lazyTextureDecoding()
+{
+	return lazyTextureDecodingEnabled;
+}
+
+bool MeshModel::hasTexture(const std::string& tn) const
+{
+	return textures.find(tn) != textures.end() || lazyTextures.find(tn) != lazyTextures.end();
+}
+
+/**
+ * @brief Decodes the texture tn (or all of them, if tn is null) whose
+ * decoding has been postponed by the lazy texture decoding.
+ */
+void MeshModel::decodeLazyTextures(const std::string* tn) const
+{
+	std::lock_guard<std::mutex> lock(lazyTexturesMutex);
+	std::vector<std::string> names;
+	if (tn != nullptr) {
+		if (lazyTextures.find(*tn) != lazyTextures.end())
+			names.push_back(*tn);
+	}
+	else {
+		for (const auto& p : lazyTextures)
+			names.push_back(p.first);
+	}
+	if (names.empty())
+		return;
+
+	std::vector<QImage> images(names.size());
+	#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < (int) names.size(); ++i) {
+		const auto& data = lazyTextures.at(names[i]);
+		images[i] = QImage::fromData(data.first, data.second.constData());
+	}
+
+	for (unsigned int i = 0; i < names.size(); ++i) {
+		if (images[i].isNull()) {
+			std::cerr << "Failed decoding " + names[i] + "; using a dummy texture\n";
+			images[i] = QImage(":/resources/images/dummy.png");
+		}
+		textures[names[i]] = images[i];
+		lazyTextures.erase(names[i]);
+		auto tf = textureFiles.find(names[i]);
+		if (tf != textureFiles.end())
+			tf->second.cacheKey = images[i].cacheKey();
+	}
+}
+
+/**
+ * @brief Returns true if the texture is known to be identical to the content
+ * of the file it has been loaded from or last saved to.
+ */
+bool MeshModel::textureUnchanged(const std::string& tn) const
+{
+	auto tf = textureFiles.find(tn);
+	if (tf == textureFiles.end())
+		return false;
+	if (lazyTextures.find(tn) != lazyTextures.end())
+		return true;
+	auto it = textures.find(tn);
+	return it != textures.end() && tf->second.cacheKey != 0 &&
+		   it->second.cacheKey() == tf->second.cacheKey;
+}
+
+namespace {
+QByteArray normalizedImageFormat(const QString& suffix)
+{
+	QByteArray f = suffix.toLower().toLatin1();
+	if (f == "jpeg")
+		return "jpg";
+	if (f == "tiff")
+		return "tif";
+	return f;
+}
+}
+
+/**
+ * @brief Saves the textures of the mesh in basePath, encoding them
+ * concurrently.
+ *
+ * When quality is -1 (default encoding), or if skipUnchanged is true, the
+ * textures that did not change since they have been loaded (or last saved)
+ * are not encoded again: they are skipped if the destination is the file they
+ * come from, or their original file content is copied if it has the same
+ * format of the destination and the original file did not change on disk.
+ * Otherwise every texture is encoded with the given quality.
+ */
 void MeshModel::saveTextures(
 		const QString& basePath,
 		int quality,
 		GLLogStream* log,
-		CallBackPos* cb)
+		CallBackPos* cb,
+		bool skipUnchanged)
 {
+	struct SaveJob {
+		std::string name;
+		QString     path;
+		bool        copy = false; // write the original file content
+		QByteArray  data;
+		QImage      img;
+		QString     error;
+	};
+
+	const bool reuseUnchanged = quality == -1 || skipUnchanged;
+	std::vector<SaveJob> jobs;
+	int skipped = 0;
 	for (const std::string& tname : cm.textures){
-		meshlab::saveImage(
-				basePath + "/" + QString::fromStdString(tname),
-				textures.at(tname), quality, log, cb);
+		QString path = basePath + "/" + QString::fromStdString(tname);
+		QFileInfo fi(path);
+		bool duplicate = false;
+		for (const SaveJob& j : jobs)
+			duplicate = duplicate || j.name == tname;
+		if (duplicate)
+			continue;
+
+		if (!fi.path().isEmpty() && !QDir(fi.path()).exists())
+			QDir().mkdir(fi.path());
+
+		SaveJob j;
+		j.name = tname;
+		j.path = fi.absoluteFilePath();
+		if (reuseUnchanged && textureUnchanged(tname)){
+			const TextureFile& tf = textureFiles.at(tname);
+			if (tf.path == j.path && fi.exists() && fi.lastModified() == tf.lastModified){
+				skipped++;
+				continue;
+			}
+			if (normalizedImageFormat(fi.suffix()) == normalizedImageFormat(tf.format)){
+				j.copy = true;
+				auto lt = lazyTextures.find(tname);
+				if (lt != lazyTextures.end())
+					j.data = lt->second.first;
+				else if (tf.path == j.path) // the file changed on disk, encode
+					j.copy = false;
+				else if (QFileInfo(tf.path).lastModified() != tf.lastModified)
+					j.copy = false; // the source file is not the one loaded (or saved) anymore
+			}
+		}
+		if (!j.copy){
+			decodeLazyTextures(&tname);
+			j.img = textures.at(tname);
+		}
+		jobs.push_back(j);
+	}
+
+	std::atomic<int> done(0);
+	#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < (int) jobs.size(); ++i) {
+		SaveJob& j = jobs[i];
+		if (j.copy) {
+			if (j.data.isEmpty()) {
+				QFile src(textureFiles.at(j.name).path);
+				if (src.open(QIODevice::ReadOnly))
+					j.data = src.readAll();
+			}
+			QFile dst(j.path);
+			if (j.data.isEmpty() || !dst.open(QIODevice::WriteOnly) ||
+				dst.write(j.data) != j.data.size()) {
+				// fallback: encode the texture
+				j.copy = false;
+			}
+			j.data.clear();
+		}
+		if (!j.copy) {
+			try {
+				if (j.img.isNull())
+					j.img = getTexture(j.name);
+				meshlab::encodeImage(j.path, j.img, quality);
+			}
+			catch (const MLException& e) {
+				j.error = e.what();
+			}
+		}
+		int d = ++done;
+#ifdef _OPENMP
+		if (omp_get_thread_num() == 0)
+#endif
+		if (cb)
+			cb(100 * d / jobs.size(), "Saving textures...");
+	}
+
+	int copied = 0;
+	for (const SaveJob& j : jobs){
+		if (!j.error.isEmpty())
+			throw MLException(j.error);
+		// the saved file is now the reference for the next saves
+		TextureFile& tf = textureFiles[j.name];
+		if (j.copy){
+			copied++;
+		}
+		else {
+			auto it = textures.find(j.name);
+			tf.cacheKey = it != textures.end() ? it->second.cacheKey() : 0;
+		}
+		tf.path = j.path;
+		tf.format = normalizedImageFormat(QFileInfo(j.path).suffix());
+		tf.lastModified = QFileInfo(j.path).lastModified();
+	}
+	if (log && (skipped > 0 || copied > 0)){
+		log->logf(
+			GLLogStream::SYSTEM, "%i unchanged textures not encoded again (%i already saved, %i copied)",
+			skipped + copied, skipped, copied);
 	}
 }
 
 QImage MeshModel::getTexture(const std::string& tn) const
 {
+	decodeLazyTextures(&tn);
+	std::lock_guard<std::mutex> lock(lazyTexturesMutex);
 	auto it = textures.find(tn);
 	if (it != textures.end())
 		return it->second;
@@ -154,18 +454,21 @@ QImage MeshModel::getTexture(const std::string& tn) const
 
 const std::map<std::string, QImage>& MeshModel::getTextures() const
 {
+	decodeLazyTextures();
 	return textures;
 }
 
 void MeshModel::clearTextures()
 {
 	textures.clear();
+	lazyTextures.clear();
+	textureFiles.clear();
 	cm.textures.clear();
 }
 
 void MeshModel::addTexture(std::string name, const QImage& txt)
 {
-	if (textures.find(name) == textures.end()){
+	if (!hasTexture(name)){
 		// just to be sure to not make duplicates in the contained mesh list of textures
 		if (std::find(cm.textures.begin(), cm.textures.end(), name) == cm.textures.end())
 			cm.textures.push_back(name);
@@ -175,6 +478,7 @@ void MeshModel::addTexture(std::string name, const QImage& txt)
 
 void MeshModel::setTexture(std::string name, const QImage& txt)
 {
+	decodeLazyTextures(&name);
 	auto it = textures.find(name);
 	if (it != textures.end())
 		it->second = txt;
@@ -185,6 +489,7 @@ void MeshModel::changeTextureName(
 		std::string newName)
 {
 	if (oldName != newName) {
+		decodeLazyTextures(&oldName);
 		auto mit = textures.find(oldName);
 		auto tit = std::find(cm.textures.begin(), cm.textures.end(), oldName);
 		if (mit != textures.end() && tit != cm.textures.end()){
@@ -192,6 +497,12 @@ void MeshModel::changeTextureName(
 
 			textures[newName] = mit->second;
 			textures.erase(mit);
+
+			auto fit = textureFiles.find(oldName);
+			if (fit != textureFiles.end()) {
+				textureFiles[newName] = fit->second;
+				textureFiles.erase(fit);
+			}
 		}
 	}
 }
@@ -396,3 +707,32 @@ int MeshModel::dataMask() const
 {
 	return currentDataMask;
 }
+
+
+/**
+ * @brief Bumps the generation counter of all the attributes in the given mask.
+ * It should be called every time one or more attributes of the mesh are
+ * changed, so that data derived from them (e.g. statistics shown by
+ * decorations) can be lazily recomputed.
+ */
+void MeshModel::markAttributesChanged(int meshElementMask)
+{
+	unsigned int gen = ++globalAttributeGeneration;
+	for (unsigned int bit = 0; bit < 32; ++bit)
+		if (meshElementMask & (1u << bit))
+			attributeGenerations[bit] = gen;
+}
+
+/**
+ * @brief Returns the most recent generation among the attributes in the given
+ * mask: if it did not change since the last query, none of the attributes in
+ * the mask has been modified.
+ */
+unsigned int MeshModel::attributeGeneration(int meshElementMask) const
+{
+	unsigned int gen = 0;
+	for (unsigned int bit = 0; bit < 32; ++bit)
+		if (meshElementMask & (1u << bit))
+			gen = std::max(gen, attributeGenerations[bit]);
+	return gen;
+}
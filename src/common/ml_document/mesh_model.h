@@ -47,6 +47,7 @@
 #include <wrap/io_trimesh/io_mask.h>
 #include <wrap/io_trimesh/additionalinfo.h>
 
+#include <QDateTime>
 #include <QList>
 #include <QString>
 #include <QStringList>
@@ -168,7 +169,12 @@ public:
 	void setVisible(bool vis = true) { visible = vis;}
 
 	std::list<std::string> loadTextures(GLLogStream* log = nullptr, vcg::CallBackPos* cb = nullptr);
-	void saveTextures(const QString& basePath, int quality = -1, GLLogStream* log = nullptr, vcg::CallBackPos* cb = nullptr);
+	void saveTextures(const QString& basePath, int quality = -1, GLLogStream* log = nullptr, vcg::CallBackPos* cb = nullptr, bool skipUnchanged = false);
+
+	// when enabled, loadTextures only reads the (compressed) texture files,
+	// that are decoded the first time their pixels are accessed
+	static void setLazyTextureDecoding(bool lazy);
+	static bool lazyTextureDecoding();
 
 	QImage getTexture(const std::string& tn) const;
 	const std::map<std::string, QImage>& getTextures() const;
@@ -199,6 +205,11 @@ public:
 
 	bool meshModified() const;
 	void setMeshModified(bool b = true);
+
+	// generation counters of the attributes, to be used to validate caches of derived data
+	void markAttributesChanged(int meshElementMask);
+	unsigned int attributeGeneration(int meshElementMask) const;
+
 	static int io2mm(int single_iobit);
 
 	CMeshO cm;
@@ -217,7 +228,26 @@ private:
 	int idInsideFile = -1;
 
 	//textures associated to mesh
-	std::map<std::string, QImage> textures;
+	mutable std::map<std::string, QImage> textures;
+
+	// textures not decoded yet (lazy texture decoding): compressed data and format
+	mutable std::map<std::string, std::pair<QByteArray, QByteArray>> lazyTextures;
+	// file each texture has been loaded from or last saved to, used to avoid
+	// re-encoding textures that did not change
+	struct TextureFile {
+		QString    path;
+		QByteArray format;
+		qint64     cacheKey = 0; // QImage::cacheKey of the texture, 0 if still not decoded
+		QDateTime  lastModified;
+	};
+	mutable std::map<std::string, TextureFile> textureFiles;
+	bool textureUnchanged(const std::string& tn) const;
+
+	bool hasTexture(const std::string& tn) const;
+	void decodeLazyTextures(const std::string* tn = nullptr) const;
+
+	// one counter for each MeshElement bit
+	unsigned int attributeGenerations[32];
 };// end class MeshModel
 
 #endif
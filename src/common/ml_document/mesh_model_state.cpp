@@ -177,6 +177,7 @@ bool MeshModelState::apply(MeshModel *_m)
 	if(changeMask & MeshModel::MM_CAMERA)
 		m->cm.shot = this->shot;
 	
+	m->markAttributesChanged(changeMask);
 	return true;
 }
 
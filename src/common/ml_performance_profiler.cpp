@@ -0,0 +1,459 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "ml_performance_profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "psapi.lib")
+#endif
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#include <sys/resource.h>
+#else
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+unsigned long long currentThreadId()
+{
+	return (unsigned long long) std::hash<std::thread::id>()(std::this_thread::get_id());
+}
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+/* reads a "<key>: <value> kB" line of /proc/self/status; returns bytes */
+std::size_t readProcStatusField(const char* key)
+{
+	FILE* f = std::fopen("/proc/self/status", "r");
+	if (f == nullptr)
+		return 0;
+	char line[256];
+	std::size_t res = 0;
+	std::size_t keyLen = std::strlen(key);
+	while (std::fgets(line, sizeof(line), f) != nullptr) {
+		if (std::strncmp(line, key, keyLen) == 0 && line[keyLen] == ':') {
+			unsigned long long kb = 0;
+			if (std::sscanf(line + keyLen + 1, "%llu", &kb) == 1)
+				res = (std::size_t) kb * 1024;
+			break;
+		}
+	}
+	std::fclose(f);
+	return res;
+}
+#endif
+
+} // namespace
+
+MLPerformanceProfiler::ScopedTimer::ScopedTimer(
+	MLPerformanceProfiler* profiler,
+	const std::string&     name,
+	const std::string&     category) :
+		profiler(profiler), name(name), category(category), startUs(0)
+{
+	if (this->profiler != nullptr && this->profiler->isEnabled())
+		startUs = this->profiler->elapsedUs();
+	else
+		this->profiler = nullptr;
+}
+
+MLPerformanceProfiler::ScopedTimer::ScopedTimer(ScopedTimer&& other) :
+		profiler(other.profiler),
+		name(std::move(other.name)),
+		category(std::move(other.category)),
+		startUs(other.startUs)
+{
+	other.profiler = nullptr;
+}
+
+MLPerformanceProfiler::ScopedTimer::~ScopedTimer()
+{
+	stop();
+}
+
+void MLPerformanceProfiler::ScopedTimer::stop()
+{
+	if (profiler != nullptr) {
+		profiler->addEvent(name, category, startUs, profiler->elapsedUs() - startUs);
+		profiler = nullptr;
+	}
+}
+
+MLPerformanceProfiler::MLPerformanceProfiler() :
+		enabled(false),
+		running(false),
+		totalUs(0),
+		startRSS(0),
+		endRSS(0),
+		peakRSS(0),
+		startOSPeak(0),
+		osPeakValid(false)
+{
+	timer.start();
+}
+
+void MLPerformanceProfiler::setEnabled(bool enabled)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	this->enabled = enabled;
+}
+
+bool MLPerformanceProfiler::isEnabled() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return enabled;
+}
+
+/**
+ * @brief Clears all the data collected by a previous run and starts a new one.
+ * Where supported by the OS (Linux), the process resident high-water mark is
+ * reset, so that the peak reported at the end of the run refers only to it.
+ * Elsewhere the high-water mark is recorded, and it is used at the end of the
+ * run only if the run raised it.
+ */
+void MLPerformanceProfiler::start(const std::string& runName)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	this->runName = runName;
+	eventList.clear();
+	counterMap.clear();
+	totalUs = 0;
+	running = enabled;
+	if (!enabled)
+		return;
+	osPeakValid = false;
+	startOSPeak = resetPeakResidentMemory() ? 0 : peakResidentMemory();
+	startRSS = currentResidentMemory();
+	endRSS = startRSS;
+	peakRSS = startRSS;
+	timer.restart();
+}
+
+void MLPerformanceProfiler::stop()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!running)
+		return;
+	totalUs = timer.nsecsElapsed() / 1000;
+	sampleMemory();
+	endRSS = currentResidentMemory();
+	// a high-water mark higher than the one at the start was reached in this run
+	std::size_t osPeak = peakResidentMemory();
+	osPeakValid = osPeak > startOSPeak;
+	if (osPeakValid)
+		peakRSS = std::max(peakRSS, osPeak);
+	running = false;
+}
+
+MLPerformanceProfiler::ScopedTimer
+MLPerformanceProfiler::scopedTimer(const std::string& name, const std::string& category)
+{
+	return ScopedTimer(this, name, category);
+}
+
+void MLPerformanceProfiler::addEvent(
+	const std::string& name,
+	const std::string& category,
+	long long          startUs,
+	long long          durationUs)
+{
+	std::size_t rss = currentResidentMemory();
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!enabled)
+		return;
+	peakRSS = std::max(peakRSS, rss);
+	eventList.push_back(Event {name, category, startUs, durationUs, currentThreadId(), rss});
+}
+
+void MLPerformanceProfiler::addCounter(const std::string& name, double value)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (enabled)
+		counterMap[name] += value;
+}
+
+void MLPerformanceProfiler::setCounter(const std::string& name, double value)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (enabled)
+		counterMap[name] = value;
+}
+
+long long MLPerformanceProfiler::elapsedUs() const
+{
+	return timer.nsecsElapsed() / 1000;
+}
+
+std::vector<MLPerformanceProfiler::Event> MLPerformanceProfiler::events() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return eventList;
+}
+
+std::map<std::string, double> MLPerformanceProfiler::counters() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return counterMap;
+}
+
+std::size_t MLPerformanceProfiler::peakResidentMemoryDuringRun() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return peakRSS;
+}
+
+/**
+ * @brief Returns a one line, human readable, summary of the last run, with the
+ * total time of each event name (sorted by time) and the memory figures.
+ */
+QString MLPerformanceProfiler::summary() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::map<std::string, long long> totals;
+	for (const Event& e : eventList)
+		totals[e.name] += e.durationUs;
+	std::vector<std::pair<std::string, long long>> sorted(totals.begin(), totals.end());
+	std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+		return a.second > b.second;
+	});
+
+	QString res = QString::fromStdString(runName) + ": " + QString::number(totalUs / 1000.0, 'f', 1) + " ms";
+	for (const auto& p : sorted)
+		res += QString(", %1 %2 ms").arg(QString::fromStdString(p.first)).arg(p.second / 1000.0, 0, 'f', 1);
+	for (const auto& c : counterMap)
+		res += QString(", %1 = %2").arg(QString::fromStdString(c.first)).arg(c.second);
+	const double mb = 1024.0 * 1024.0;
+	res += QString(" | RSS %1 -> %2 MB, peak %3 MB")
+			   .arg(startRSS / mb, 0, 'f', 1)
+			   .arg(endRSS / mb, 0, 'f', 1)
+			   .arg(peakRSS / mb, 0, 'f', 1);
+	return res;
+}
+
+QJsonObject MLPerformanceProfiler::toJson() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	QJsonObject obj;
+	obj["name"] = QString::fromStdString(runName);
+	obj["totalUs"] = (double) totalUs;
+
+	QJsonObject mem;
+	mem["startRSS"] = (double) startRSS;
+	mem["endRSS"] = (double) endRSS;
+	mem["peakRSS"] = (double) peakRSS;
+	mem["peakFromOS"] = osPeakValid;
+	obj["memory"] = mem;
+
+	std::map<std::string, std::pair<long long, int>> totals;
+	for (const Event& e : eventList) {
+		totals[e.name].first += e.durationUs;
+		totals[e.name].second++;
+	}
+	QJsonObject timers;
+	for (const auto& p : totals) {
+		QJsonObject t;
+		t["totalUs"] = (double) p.second.first;
+		t["count"] = p.second.second;
+		timers[QString::fromStdString(p.first)] = t;
+	}
+	obj["timers"] = timers;
+
+	QJsonObject cnt;
+	for (const auto& c : counterMap)
+		cnt[QString::fromStdString(c.first)] = c.second;
+	obj["counters"] = cnt;
+	return obj;
+}
+
+/**
+ * @brief Returns the collected events in the Chrome Trace Event format:
+ * each timer is a complete ("X") event, and the resident memory sampled at the
+ * end of each timer is exported as a counter ("C") track.
+ */
+QJsonObject MLPerformanceProfiler::toChromeTrace() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	QJsonArray traceEvents;
+	for (const Event& e : eventList) {
+		QJsonObject ev;
+		ev["name"] = QString::fromStdString(e.name);
+		ev["cat"] = QString::fromStdString(e.category);
+		ev["ph"] = "X";
+		ev["ts"] = (double) e.startUs;
+		ev["dur"] = (double) e.durationUs;
+		ev["pid"] = 1;
+		ev["tid"] = (double) (e.threadId & 0xFFFFFFFF);
+		traceEvents.append(ev);
+
+		QJsonObject mem;
+		mem["name"] = "memory";
+		mem["ph"] = "C";
+		mem["ts"] = (double) (e.startUs + e.durationUs);
+		mem["pid"] = 1;
+		QJsonObject args;
+		args["RSS (MB)"] = e.residentMemory / (1024.0 * 1024.0);
+		mem["args"] = args;
+		traceEvents.append(mem);
+	}
+	for (const auto& c : counterMap) {
+		QJsonObject ev;
+		ev["name"] = QString::fromStdString(c.first);
+		ev["ph"] = "C";
+		ev["ts"] = (double) totalUs;
+		ev["pid"] = 1;
+		QJsonObject args;
+		args["value"] = c.second;
+		ev["args"] = args;
+		traceEvents.append(ev);
+	}
+	QJsonObject obj;
+	obj["traceEvents"] = traceEvents;
+	obj["displayTimeUnit"] = "ms";
+	QJsonObject meta;
+	meta["name"] = QString::fromStdString(runName);
+	meta["peakRSS"] = (double) peakRSS;
+	obj["otherData"] = meta;
+	return obj;
+}
+
+bool MLPerformanceProfiler::saveJson(const QString& fileName) const
+{
+	QFile f(fileName);
+	if (!f.open(QIODevice::WriteOnly))
+		return false;
+	f.write(QJsonDocument(toJson()).toJson());
+	return true;
+}
+
+bool MLPerformanceProfiler::saveChromeTrace(const QString& fileName) const
+{
+	QFile f(fileName);
+	if (!f.open(QIODevice::WriteOnly))
+		return false;
+	f.write(QJsonDocument(toChromeTrace()).toJson(QJsonDocument::Compact));
+	return true;
+}
+
+/**
+ * @brief Returns the current resident set size of the process, in bytes.
+ * Returns 0 if the information is not available.
+ */
+std::size_t MLPerformanceProfiler::currentResidentMemory()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		return (std::size_t) pmc.WorkingSetSize;
+	return 0;
+#elif defined(__APPLE__)
+	mach_task_basic_info info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+	if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) == KERN_SUCCESS)
+		return (std::size_t) info.resident_size;
+	return 0;
+#else
+	// called at the end of every timer: the file is opened once and re-read
+	// from the start, it is closed by the OS at exit
+	static const int statm = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+	static const std::size_t pageSize = (std::size_t) sysconf(_SC_PAGESIZE);
+	if (statm < 0)
+		return 0;
+	char buf[128];
+	ssize_t len = pread(statm, buf, sizeof(buf) - 1, 0);
+	if (len <= 0)
+		return 0;
+	buf[len] = '\0';
+	unsigned long long pages = 0, rss = 0;
+	if (std::sscanf(buf, "%llu %llu", &pages, &rss) != 2)
+		return 0;
+	return (std::size_t) rss * pageSize;
+#endif
+}
+
+/**
+ * @brief Returns the resident high-water mark of the process, in bytes.
+ */
+std::size_t MLPerformanceProfiler::peakResidentMemory()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		return (std::size_t) pmc.PeakWorkingSetSize;
+	return 0;
+#elif defined(__APPLE__)
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		return (std::size_t) usage.ru_maxrss; // bytes on macOS
+	return 0;
+#else
+	std::size_t hwm = readProcStatusField("VmHWM");
+	if (hwm == 0) {
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) == 0)
+			hwm = (std::size_t) usage.ru_maxrss * 1024; // kilobytes on Linux
+	}
+	return hwm;
+#endif
+}
+
+/**
+ * @brief Resets the resident high-water mark of the process, when the OS
+ * allows it (Linux >= 4.0). Returns false when the peak cannot be reset
+ * (Windows, macOS): in that case the peak of a run is the high-water mark of
+ * the process if the run raised it, otherwise it is estimated by sampling the
+ * resident memory at the end of each timer.
+ */
+bool MLPerformanceProfiler::resetPeakResidentMemory()
+{
+#if defined(_WIN32) || defined(__APPLE__)
+	return false;
+#else
+	FILE* f = std::fopen("/proc/self/clear_refs", "w");
+	if (f == nullptr)
+		return false;
+	bool ok = std::fputs("5", f) >= 0;
+	ok = (std::fclose(f) == 0) && ok;
+	return ok;
+#endif
+}
+
+/* must be called with the mutex locked */
+void MLPerformanceProfiler::sampleMemory()
+{
+	peakRSS = std::max(peakRSS, currentResidentMemory());
+}
@@ -0,0 +1,133 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef ML_PERFORMANCE_PROFILER_H
+#define ML_PERFORMANCE_PROFILER_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QString>
+
+/**
+ * @brief The MLPerformanceProfiler class collects timings, counters and
+ * resident memory samples during a single run (typically the execution of a
+ * filter).
+ *
+ * Timings are recorded through the RAII MLPerformanceProfiler::ScopedTimer
+ * class, that can be safely used also from OpenMP worker threads.
+ * The collected data can be exported as a plain JSON summary or as a Chrome
+ * trace (loadable in chrome://tracing or https://ui.perfetto.dev).
+ *
+ * When the profiler is disabled, timers and counters do nothing.
+ */
+class MLPerformanceProfiler
+{
+public:
+	struct Event
+	{
+		std::string        name;
+		std::string        category;
+		long long          startUs;
+		long long          durationUs;
+		unsigned long long threadId;
+		std::size_t        residentMemory;
+	};
+
+	class ScopedTimer
+	{
+	public:
+		ScopedTimer(
+			MLPerformanceProfiler* profiler,
+			const std::string&     name,
+			const std::string&     category = "filter");
+		ScopedTimer(ScopedTimer&& other);
+		~ScopedTimer();
+
+		void stop();
+
+	private:
+		ScopedTimer(const ScopedTimer&) = delete;
+		ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+		MLPerformanceProfiler* profiler;
+		std::string            name;
+		std::string            category;
+		long long              startUs;
+	};
+
+	MLPerformanceProfiler();
+
+	void setEnabled(bool enabled);
+	bool isEnabled() const;
+
+	void start(const std::string& runName);
+	void stop();
+
+	ScopedTimer scopedTimer(const std::string& name, const std::string& category = "filter");
+	void addEvent(
+		const std::string& name,
+		const std::string& category,
+		long long          startUs,
+		long long          durationUs);
+	void addCounter(const std::string& name, double value);
+	void setCounter(const std::string& name, double value);
+
+	long long elapsedUs() const;
+	std::vector<Event> events() const;
+	std::map<std::string, double> counters() const;
+	std::size_t peakResidentMemoryDuringRun() const;
+
+	QString summary() const;
+	QJsonObject toJson() const;
+	QJsonObject toChromeTrace() const;
+	bool saveJson(const QString& fileName) const;
+	bool saveChromeTrace(const QString& fileName) const;
+
+	static std::size_t currentResidentMemory();
+	static std::size_t peakResidentMemory();
+	static bool resetPeakResidentMemory();
+
+private:
+	void sampleMemory();
+
+	mutable std::mutex            mutex;
+	bool                          enabled;
+	bool                          running;
+	std::string                   runName;
+	QElapsedTimer                 timer;
+	long long                     totalUs;
+	std::vector<Event>            eventList;
+	std::map<std::string, double> counterMap;
+	std::size_t                   startRSS;
+	std::size_t                   endRSS;
+	std::size_t                   peakRSS;
+	std::size_t                   startOSPeak;
+	bool                          osPeakValid;
+};
+
+#endif // ML_PERFORMANCE_PROFILER_H
@@ -0,0 +1,325 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "ml_mesh_lod_proxy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+namespace {
+
+// number of vertices processed between two checks of the cancel flag
+const size_t CANCEL_CHECK_STEP = 64 * 1024;
+
+struct CellAccumulator
+{
+	vcg::Point3d pos = vcg::Point3d(0, 0, 0);
+	vcg::Point3d nrm = vcg::Point3d(0, 0, 0);
+	double col[4] = {0, 0, 0, 0};
+	size_t count = 0;
+	int cluster = 0;
+};
+
+// c = a * b, column-major
+void multMatrix(const float a[16], const float b[16], float c[16])
+{
+	for (int col = 0; col < 4; ++col)
+		for (int row = 0; row < 4; ++row) {
+			float s = 0;
+			for (int k = 0; k < 4; ++k)
+				s += a[k * 4 + row] * b[col * 4 + k];
+			c[col * 4 + row] = s;
+		}
+}
+
+void toColumnMajor(const Matrix44m& m, float res[16])
+{
+	for (int row = 0; row < 4; ++row)
+		for (int col = 0; col < 4; ++col)
+			res[col * 4 + row] = (float) m.ElementAt(row, col);
+}
+
+} // namespace
+
+MLMeshLODProxy::MLMeshLODProxy()
+{
+	clear();
+}
+
+void MLMeshLODProxy::clear()
+{
+	clusters.clear();
+	for (int l = 0; l < LEVEL_NUM; ++l) {
+		levels[l].cellSize = 0;
+		levels[l].pos.clear();
+		levels[l].nrm.clear();
+		levels[l].col.clear();
+	}
+	bbox.SetNull();
+}
+
+bool MLMeshLODProxy::isValid() const
+{
+	return !clusters.empty();
+}
+
+size_t MLMeshLODProxy::finestLevelSize() const
+{
+	return levels[LEVEL_NUM - 1].pos.size();
+}
+
+/**
+ * @brief Copies the attributes of the non deleted vertices of the mesh used
+ * by the proxy, so that it can be built while the mesh is modified.
+ */
+MLMeshLODProxy::Source MLMeshLODProxy::snapshot(const CMeshO& m)
+{
+	Source src;
+	src.pos.reserve(m.vn);
+	src.nrm.reserve(m.vn);
+	src.col.reserve(m.vn);
+	for (CMeshO::ConstVertexIterator vi = m.vert.begin(); vi != m.vert.end(); ++vi) {
+		if (!vi->IsD()) {
+			src.pos.push_back(vi->cP());
+			src.nrm.push_back(vi->cN());
+			src.col.push_back(vi->cC());
+		}
+	}
+	return src;
+}
+
+/**
+ * @brief Builds the cluster hierarchy of the given vertices, with a single
+ * pass on them per level. If canceled is set during the build, the proxy is
+ * cleared and false is returned.
+ */
+bool MLMeshLODProxy::build(const Source& src, const std::atomic<bool>* canceled)
+{
+	auto isCanceled = [canceled]() { return canceled != nullptr && canceled->load(); };
+	clear();
+	const size_t n = src.pos.size();
+	for (size_t i = 0; i < n; ++i)
+		bbox.Add(vcg::Point3f::Construct(src.pos[i]));
+	if (bbox.IsNull())
+		return true;
+
+	const vcg::Point3f dim = bbox.Dim();
+	float side = std::max(dim[0], std::max(dim[1], dim[2]));
+	if (side <= 0)
+		side = 1;
+	const int levelRes[LEVEL_NUM] = {64, 256, 1024};
+
+	auto cellCoord = [&](const vcg::Point3f& p, int res, int k) {
+		int c = int((p[k] - bbox.min[k]) / side * res);
+		return std::max(0, std::min(c, res - 1));
+	};
+
+	std::unordered_map<int, int> clusterIndex;
+	for (size_t i = 0; i < n; ++i) {
+		vcg::Point3f p = vcg::Point3f::Construct(src.pos[i]);
+		int key =
+			cellCoord(p, CLUSTER_GRID_SIZE, 0) +
+			cellCoord(p, CLUSTER_GRID_SIZE, 1) * CLUSTER_GRID_SIZE +
+			cellCoord(p, CLUSTER_GRID_SIZE, 2) * CLUSTER_GRID_SIZE * CLUSTER_GRID_SIZE;
+		auto it = clusterIndex.find(key);
+		if (it == clusterIndex.end()) {
+			it = clusterIndex.insert(std::make_pair(key, (int) clusters.size())).first;
+			clusters.push_back(Cluster());
+			clusters.back().box.SetNull();
+		}
+		clusters[it->second].box.Add(p);
+	}
+
+	for (int l = 0; l < LEVEL_NUM; ++l) {
+		const int res = levelRes[l];
+		Level& level = levels[l];
+		level.cellSize = side / res;
+
+		std::unordered_map<uint64_t, CellAccumulator> cells;
+		for (size_t i = 0; i < n; ++i) {
+			if (i % CANCEL_CHECK_STEP == 0 && isCanceled()) {
+				clear();
+				return false;
+			}
+			vcg::Point3f p = vcg::Point3f::Construct(src.pos[i]);
+			uint64_t key =
+				uint64_t(cellCoord(p, res, 0)) |
+				(uint64_t(cellCoord(p, res, 1)) << 21) |
+				(uint64_t(cellCoord(p, res, 2)) << 42);
+			CellAccumulator& acc = cells[key];
+			if (acc.count == 0) {
+				int ckey =
+					cellCoord(p, CLUSTER_GRID_SIZE, 0) +
+					cellCoord(p, CLUSTER_GRID_SIZE, 1) * CLUSTER_GRID_SIZE +
+					cellCoord(p, CLUSTER_GRID_SIZE, 2) * CLUSTER_GRID_SIZE * CLUSTER_GRID_SIZE;
+				acc.cluster = clusterIndex[ckey];
+			}
+			acc.pos += vcg::Point3d::Construct(src.pos[i]);
+			acc.nrm += vcg::Point3d::Construct(src.nrm[i]);
+			for (int k = 0; k < 4; ++k)
+				acc.col[k] += src.col[i][k];
+			++acc.count;
+		}
+
+		// group the cells per cluster, so that each cluster owns a contiguous range
+		std::vector<const CellAccumulator*> sorted;
+		sorted.reserve(cells.size());
+		for (const auto& c : cells)
+			sorted.push_back(&c.second);
+		std::sort(sorted.begin(), sorted.end(), [](const CellAccumulator* a, const CellAccumulator* b) {
+			return a->cluster < b->cluster;
+		});
+
+		level.pos.resize(sorted.size());
+		level.nrm.resize(sorted.size());
+		level.col.resize(sorted.size());
+		for (Cluster& c : clusters)
+			c.begin[l] = c.end[l] = 0;
+		for (size_t i = 0; i < sorted.size(); ++i) {
+			const CellAccumulator& acc = *sorted[i];
+			level.pos[i] = vcg::Point3f::Construct(acc.pos / double(acc.count));
+			vcg::Point3d n = acc.nrm;
+			if (n.Norm() > 0)
+				n.Normalize();
+			level.nrm[i] = vcg::Point3f::Construct(n);
+			for (int k = 0; k < 4; ++k)
+				level.col[i][k] = (unsigned char) (acc.col[k] / double(acc.count) + 0.5);
+
+			Cluster& c = clusters[acc.cluster];
+			if (i == 0 || sorted[i - 1]->cluster != acc.cluster)
+				c.begin[l] = i;
+			c.end[l] = i + 1;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Draws the visible clusters of the proxy in the current GL context,
+ * with the given mesh transformation matrix applied.
+ * For each cluster, the coarsest level with cells projecting to less than
+ * pixelError pixels is chosen (the finest one if none is enough).
+ */
+size_t MLMeshLODProxy::draw(const Matrix44m& tr, float pixelError) const
+{
+	if (!isValid())
+		return 0;
+
+	float mvp[16];
+	currentModelViewProjection(tr, mvp);
+
+	float mv[16], trcm[16], mvtr[16], proj[16];
+	glGetFloatv(GL_MODELVIEW_MATRIX, mv);
+	glGetFloatv(GL_PROJECTION_MATRIX, proj);
+	toColumnMajor(tr, trcm);
+	multMatrix(mv, trcm, mvtr);
+	GLint vp[4];
+	glGetIntegerv(GL_VIEWPORT, vp);
+
+	// uniform scale factor of the model view transformation
+	const float scale = std::sqrt(mvtr[0] * mvtr[0] + mvtr[1] * mvtr[1] + mvtr[2] * mvtr[2]);
+	const float pixelsPerUnit = scale * proj[5] * vp[3] * 0.5f;
+
+	glPushAttrib(GL_ENABLE_BIT | GL_POINT_BIT | GL_LIGHTING_BIT);
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glMultMatrixf(trcm);
+
+	glEnable(GL_COLOR_MATERIAL);
+	glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	size_t drawn = 0;
+	for (const Cluster& c : clusters) {
+		if (isBoxOutsideFrustum(Box3m::Construct(c.box), mvp))
+			continue;
+		const vcg::Point3f cen = c.box.Center();
+		float w = mvp[3] * cen[0] + mvp[7] * cen[1] + mvp[11] * cen[2] + mvp[15];
+		w = std::max(w, 1e-6f);
+
+		int l = 0;
+		float pixels = 0;
+		for (; l < LEVEL_NUM; ++l) {
+			pixels = levels[l].cellSize * pixelsPerUnit / w;
+			if (pixels <= pixelError)
+				break;
+		}
+		l = std::min(l, LEVEL_NUM - 1);
+		const Level& level = levels[l];
+		const size_t count = c.end[l] - c.begin[l];
+		if (count == 0)
+			continue;
+
+		glPointSize(std::max(1.0f, std::min(pixels, pixelError)));
+		glVertexPointer(3, GL_FLOAT, 0, level.pos.data());
+		glNormalPointer(GL_FLOAT, 0, level.nrm.data());
+		glColorPointer(4, GL_UNSIGNED_BYTE, 0, level.col.data());
+		glDrawArrays(GL_POINTS, (GLint) c.begin[l], (GLsizei) count);
+		drawn += count;
+	}
+
+	glPopMatrix();
+	glPopClientAttrib();
+	glPopAttrib();
+	return drawn;
+}
+
+/**
+ * @brief Returns true if all the corners of the box lie outside the same
+ * clipping plane of the given (column-major) model view projection matrix.
+ */
+bool MLMeshLODProxy::isBoxOutsideFrustum(const Box3m& box, const float mvp[16])
+{
+	if (box.IsNull())
+		return true;
+	int outside[6] = {0, 0, 0, 0, 0, 0};
+	for (int i = 0; i < 8; ++i) {
+		Point3m p = box.P(i);
+		float clip[4];
+		for (int r = 0; r < 4; ++r)
+			clip[r] = mvp[r] * p[0] + mvp[4 + r] * p[1] + mvp[8 + r] * p[2] + mvp[12 + r];
+		for (int k = 0; k < 3; ++k) {
+			if (clip[k] < -clip[3]) ++outside[2 * k];
+			if (clip[k] >  clip[3]) ++outside[2 * k + 1];
+		}
+	}
+	for (int i = 0; i < 6; ++i)
+		if (outside[i] == 8)
+			return true;
+	return false;
+}
+
+void MLMeshLODProxy::currentModelViewProjection(const Matrix44m& tr, float mvp[16])
+{
+	float mv[16], proj[16], trcm[16], mvtr[16];
+	glGetFloatv(GL_MODELVIEW_MATRIX, mv);
+	glGetFloatv(GL_PROJECTION_MATRIX, proj);
+	toColumnMajor(tr, trcm);
+	multMatrix(mv, trcm, mvtr);
+	multMatrix(proj, mvtr, mvp);
+}
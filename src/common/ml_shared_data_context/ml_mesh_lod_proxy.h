@@ -0,0 +1,98 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef ML_MESH_LOD_PROXY_H
+#define ML_MESH_LOD_PROXY_H
+
+#include <GL/glew.h>
+#include <atomic>
+#include <vector>
+
+#include "../ml_document/cmesh.h"
+
+/*
+A view-dependent, level of detail proxy of a mesh, used to keep the navigation
+interactive on huge meshes.
+
+The bounding box of the mesh is split in a coarse grid of clusters; inside each
+cluster the vertices are collapsed on uniform grids of increasing resolution
+(one per level), each cell becoming a single lit point with averaged position,
+normal and color. At draw time the clusters outside the view frustum are culled
+and for each visible cluster the coarsest level whose cells project on the screen
+smaller than the requested error (in pixels) is drawn.
+
+The proxy can be built from a Source, a copy of the vertex attributes of the
+mesh, on a thread other than the one owning the mesh.
+
+All the matrices are OpenGL column-major float[16].
+*/
+class MLMeshLODProxy
+{
+public:
+	// copy of the attributes of the non deleted vertices used by the proxy
+	struct Source
+	{
+		std::vector<Point3m> pos;
+		std::vector<Point3m> nrm;
+		std::vector<vcg::Color4b> col;
+	};
+
+	MLMeshLODProxy();
+
+	static Source snapshot(const CMeshO& m);
+	bool build(const Source& src, const std::atomic<bool>* canceled = nullptr);
+	void clear();
+	bool isValid() const;
+	size_t finestLevelSize() const;
+
+	// returns the number of points drawn
+	size_t draw(const Matrix44m& tr, float pixelError) const;
+
+	static bool isBoxOutsideFrustum(const Box3m& box, const float mvp[16]);
+	static void currentModelViewProjection(const Matrix44m& tr, float mvp[16]);
+
+	static const int LEVEL_NUM = 3;
+	static const int CLUSTER_GRID_SIZE = 16;
+
+private:
+	struct Cluster
+	{
+		vcg::Box3f box;
+		size_t begin[LEVEL_NUM];
+		size_t end[LEVEL_NUM];
+	};
+
+	struct Level
+	{
+		float cellSize;
+		std::vector<vcg::Point3f> pos;
+		std::vector<vcg::Point3f> nrm;
+		std::vector<vcg::Color4b> col;
+	};
+
+	std::vector<Cluster> clusters;
+	Level levels[LEVEL_NUM];
+	vcg::Box3f bbox;
+};
+
+#endif // ML_MESH_LOD_PROXY_H
@@ -25,6 +25,8 @@
 #include "../ml_document/mesh_document.h"
 #include "../GLExtensionsManager.h"
 
+#include <chrono>
+
 
 MLSceneGLSharedDataContext::MLSceneGLSharedDataContext(MeshDocument& md,vcg::QtThreadSafeMemoryInfo& gpumeminfo,bool highprecision,size_t perbatchtriangles, size_t minfacespersmoothrendering)
 	:QGLWidget(),_md(md),_gpumeminfo(gpumeminfo),_perbatchtriangles(perbatchtriangles), _minfacessmoothrendering(minfacespersmoothrendering),_highprecision(highprecision),_timer(this)
@@ -65,6 +67,11 @@ MLSceneGLSharedDataContext::MLSceneGLSharedDataContext(MeshDocument& md,vcg::QtT
 
 MLSceneGLSharedDataContext::~MLSceneGLSharedDataContext()
 {
+	//the pending builds are stopped (the futures wait for them when destroyed)
+	for (auto& p : _lodproxies)
+		if (p.second.canceled)
+			*p.second.canceled = true;
+	_lodproxies.clear();
 	for (auto& p : _meshboman)
 		delete p.second;
 }
@@ -241,6 +248,7 @@ void MLSceneGLSharedDataContext::meshRemoved(int mmid)
 		delete man;
 	}
 	_meshboman.erase(it);
+	cancelLODBuild(mmid, true);
 }
 
 void MLSceneGLSharedDataContext::setMeshTransformationMatrix( int mmid,const Matrix44m& m )
@@ -269,6 +277,75 @@ void MLSceneGLSharedDataContext::draw( int mmid,QGLContext* viewid ) const
 		man->draw(viewid);
 }
 
+/**
+ * @brief Draws the view dependent level of detail proxy of the mesh, as lit
+ * point splats. The proxy is built on a worker thread: until it is ready the
+ * mesh is drawn at full resolution in the given view. Returns the number of
+ * drawn points (0 if the full resolution mesh has been drawn).
+ */
+size_t MLSceneGLSharedDataContext::drawLOD(int mmid, QGLContext* viewid, float pixelerror)
+{
+	MeshModel* mm = _md.getMesh(mmid);
+	if (mm == NULL)
+		return 0;
+	LODProxyEntry& entry = _lodproxies[mmid];
+	if (entry.canceled && entry.building.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		std::shared_ptr<MLMeshLODProxy> proxy = entry.building.get();
+		if (!*entry.canceled)
+			entry.ready = proxy;
+		entry.canceled.reset();
+	}
+	if (!entry.ready && !entry.canceled) {
+		//the vertices are copied here, so that the mesh can be modified during the build
+		std::shared_ptr<std::atomic<bool>> canceled = std::make_shared<std::atomic<bool>>(false);
+		std::shared_ptr<MLMeshLODProxy::Source> src =
+			std::make_shared<MLMeshLODProxy::Source>(MLMeshLODProxy::snapshot(mm->cm));
+		entry.canceled = canceled;
+		entry.building = std::async(std::launch::async, [src, canceled]() {
+			std::shared_ptr<MLMeshLODProxy> proxy = std::make_shared<MLMeshLODProxy>();
+			proxy->build(*src, canceled.get());
+			return proxy;
+		});
+	}
+	if (entry.ready)
+		return entry.ready->draw(mm->cm.Tr, pixelerror);
+	draw(mmid, viewid);
+	return 0;
+}
+
+/**
+ * @brief Invalidates the level of detail proxy of the mesh and stops its
+ * build, if running. If remove is true the entry of the mesh is erased.
+ */
+void MLSceneGLSharedDataContext::cancelLODBuild(int mmid, bool remove)
+{
+	auto it = _lodproxies.find(mmid);
+	if (it == _lodproxies.end())
+		return;
+	LODProxyEntry& entry = it->second;
+	entry.ready.reset();
+	if (entry.canceled)
+		*entry.canceled = true;
+	//the result of a canceled build is discarded when it is collected in drawLOD
+	if (remove)
+		_lodproxies.erase(it);
+}
+
+/**
+ * @brief Returns true if the bounding box of the mesh, with its transformation
+ * matrix applied, is completely outside the frustum defined by the current
+ * GL modelview and projection matrices.
+ */
+bool MLSceneGLSharedDataContext::isMeshOutsideViewFrustum(int mmid) const
+{
+	const MeshModel* mm = _md.getMesh(mmid);
+	if (mm == NULL)
+		return true;
+	float mvp[16];
+	MLMeshLODProxy::currentModelViewProjection(mm->cm.Tr, mvp);
+	return MLMeshLODProxy::isBoxOutsideFrustum(mm->cm.bbox, mvp);
+}
+
 void MLSceneGLSharedDataContext::drawAllocatedAttributesSubset(int mmid, QGLContext * viewid, const MLRenderingData & dt)
 {
 	PerMeshMultiViewManager* man = meshAttributesMultiViewerManager(mmid);
@@ -339,6 +416,32 @@ void MLSceneGLSharedDataContext::meshAttributesUpdated(int mmid,bool conntectivi
 	PerMeshMultiViewManager* man = meshAttributesMultiViewerManager(mmid);
 	if (man != NULL)
 		man->meshAttributesUpdated(conntectivitychanged,atts);
+	cancelLODBuild(mmid, false);
+
+	//keep the attribute generations of the mesh in sync, e.g. for the changes done by the editing tools
+	if (conntectivitychanged) {
+		mm->markAttributesChanged(MeshModel::MM_ALL);
+	}
+	else {
+		MLRenderingData::RendAtts upd(atts);
+		int mask = MeshModel::MM_NONE;
+		if (upd[MLRenderingData::ATT_NAMES::ATT_VERTPOSITION])
+			mask |= MeshModel::MM_VERTCOORD;
+		if (upd[MLRenderingData::ATT_NAMES::ATT_VERTNORMAL])
+			mask |= MeshModel::MM_VERTNORMAL;
+		if (upd[MLRenderingData::ATT_NAMES::ATT_FACENORMAL])
+			mask |= MeshModel::MM_FACENORMAL;
+		if (upd[MLRenderingData::ATT_NAMES::ATT_VERTCOLOR])
+			mask |= MeshModel::MM_VERTCOLOR;
+		if (upd[MLRenderingData::ATT_NAMES::ATT_FACECOLOR])
+			mask |= MeshModel::MM_FACECOLOR;
+		if (upd[MLRenderingData::ATT_NAMES::ATT_VERTTEXTURE])
+			mask |= MeshModel::MM_VERTTEXCOORD;
+		if (upd[MLRenderingData::ATT_NAMES::ATT_WEDGETEXTURE])
+			mask |= MeshModel::MM_WEDGTEXCOORD;
+		if (mask != MeshModel::MM_NONE)
+			mm->markAttributesChanged(mask);
+	}
 }
 
 void MLSceneGLSharedDataContext::meshDeallocated( int /*mmid*/ )
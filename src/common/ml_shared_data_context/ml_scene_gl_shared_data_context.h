@@ -25,6 +25,10 @@
 #define ML_SCENE_GL_SHARED_DATA_CONTEXT_H
 
 #include "ml_shared_data_context.h"
+#include "ml_mesh_lod_proxy.h"
+
+#include <future>
+#include <memory>
 
 class MLSceneGLSharedDataContext : public QGLWidget
 {
@@ -58,6 +62,8 @@ public:
 	void deAllocateGPUSharedData();
 
 	void draw(int mmid, QGLContext* viewid) const;
+	size_t drawLOD(int mmid, QGLContext* viewid, float pixelerror);
+	bool isMeshOutsideViewFrustum(int mmid) const;
 	void drawAllocatedAttributesSubset(int mmid, QGLContext* viewid, const MLRenderingData& dt);
 	void setSceneTransformationMatrix(const Matrix44m& m);
 	void setMeshTransformationMatrix(int mmid, const Matrix44m& m);
@@ -114,6 +120,17 @@ private:
 	MeshDocument& _md;
 	typedef std::map<int, PerMeshMultiViewManager*> MeshIDManMap;
 	MeshIDManMap _meshboman;
+	//view dependent proxies used for the interactive navigation of huge meshes, built on demand
+	//on a worker thread from a copy of the vertices; the mesh is drawn at full resolution until
+	//the proxy matching its current state is ready
+	struct LODProxyEntry
+	{
+		std::shared_ptr<MLMeshLODProxy> ready;
+		std::future<std::shared_ptr<MLMeshLODProxy>> building;
+		std::shared_ptr<std::atomic<bool>> canceled;
+	};
+	std::map<int, LODProxyEntry> _lodproxies;
+	void cancelLODBuild(int mmid, bool remove);
 	vcg::QtThreadSafeMemoryInfo& _gpumeminfo;
 	size_t _perbatchtriangles;
 	size_t _minfacessmoothrendering;
@@ -1,7 +1,7 @@
 #include "meshlab_plugin_logger.h"
 
 MeshLabPluginLogger::MeshLabPluginLogger() :
-    logstream(nullptr)
+    logstream(nullptr), prof(nullptr)
 {
 }
 
@@ -10,6 +10,28 @@ void MeshLabPluginLogger::setLog(GLLogStream* log)
 	this->logstream = log;
 }
 
+void MeshLabPluginLogger::setProfiler(MLPerformanceProfiler* profiler)
+{
+	this->prof = profiler;
+}
+
+MLPerformanceProfiler* MeshLabPluginLogger::profiler() const
+{
+	return prof;
+}
+
+MLPerformanceProfiler::ScopedTimer MeshLabPluginLogger::profileScope(const std::string& name) const
+{
+	return MLPerformanceProfiler::ScopedTimer(prof, name, "plugin");
+}
+
+void MeshLabPluginLogger::profileCounter(const std::string& name, double value) const
+{
+	if (prof != nullptr) {
+		prof->addCounter(name, value);
+	}
+}
+
 void MeshLabPluginLogger::log(const char* s) const
 {
 	if(logstream != nullptr) {
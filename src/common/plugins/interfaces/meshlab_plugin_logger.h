@@ -28,6 +28,7 @@
 
 #include "meshlab_plugin.h"
 #include "../../GLLogStream.h"
+#include "../../ml_performance_profiler.h"
 #include "../../parameters/rich_parameter_list.h"
 #include "../../globals.h"
 
@@ -49,6 +50,8 @@ public:
 
 	/// Standard stuff that usually should not be redefined.
 	void setLog(GLLogStream* log);
+	void setProfiler(MLPerformanceProfiler* profiler);
+	MLPerformanceProfiler* profiler() const;
 
 	// This function must be used to communicate useful information collected in the parsing/saving of the files.
 	// NEVER EVER use a msgbox to say something to the user.
@@ -72,8 +75,14 @@ public:
 	template <typename... Ts>
 	void realTimeLog(QString Id, const QString &meshName, const char * f, Ts&&... ts ) const;
 
+	// Timers and counters collected by the profiler set by MeshLab (if any) for
+	// the current run. They do nothing when profiling is disabled.
+	MLPerformanceProfiler::ScopedTimer profileScope(const std::string& name) const;
+	void profileCounter(const std::string& name, double value) const;
+
 private:
 	mutable GLLogStream *logstream;
+	MLPerformanceProfiler* prof;
 };
 
 /************************
@@ -0,0 +1,454 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#include "ascii_point_cloud_reader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#include <QFile>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace meshlab {
+
+namespace {
+
+// size of the chunks in which the file is split for the parallel parsing
+const std::size_t CHUNK_SIZE = 8 * 1024 * 1024;
+const unsigned int MAX_FIELDS = 32;
+
+inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+inline bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+inline unsigned char toColorComponent(double v)
+{
+	return (unsigned char) std::min(255.0, std::max(0.0, v));
+}
+
+} // namespace
+
+struct AsciiPointCloudReader::Chunk
+{
+	const char* begin = nullptr;
+	const char* end = nullptr;
+	std::size_t lines = 0;
+	std::size_t offset = 0;
+	std::size_t written = 0;
+	std::size_t skipped = 0;
+	std::size_t complete = 0;
+	bool error = false;
+};
+
+AsciiPointCloudReader::AsciiPointCloudReader(const std::vector<Field>& fields) :
+		fields(fields),
+		separators(" \t\r\v\f"),
+		rowsToSkip(0),
+		minFields(0),
+		strict(false),
+		colorScale(1.0f),
+		policy(SKIP_LINE)
+{
+	if (this->fields.size() > MAX_FIELDS)
+		this->fields.resize(MAX_FIELDS);
+	minFields = this->fields.size();
+}
+
+/**
+ * @brief Sets the characters that separate the values of a line. Whitespace
+ * always separates the values as well. Default: whitespace.
+ */
+void AsciiPointCloudReader::setSeparators(const std::string& separators)
+{
+	this->separators = separators;
+}
+
+/**
+ * @brief Sets the number of header lines that are skipped at the beginning of the file.
+ */
+void AsciiPointCloudReader::setRowsToSkip(unsigned int rows)
+{
+	rowsToSkip = rows;
+}
+
+/**
+ * @brief Sets the minimum number of values that a line must contain to be
+ * valid. By default, all the fields are required. The fields that are missing
+ * in a valid line are set to zero.
+ */
+void AsciiPointCloudReader::setMinimumFieldNumber(unsigned int minFields)
+{
+	this->minFields = std::min<unsigned int>(minFields, fields.size());
+}
+
+/**
+ * @brief If strict, a line is valid only if it contains exactly the minimum
+ * number of values or exactly all the fields; otherwise additional values at
+ * the end of the line are ignored.
+ */
+void AsciiPointCloudReader::setStrictFieldNumber(bool strict)
+{
+	this->strict = strict;
+}
+
+/**
+ * @brief Sets the factor applied to the color values (e.g. 255 for colors in [0.0-1.0]).
+ */
+void AsciiPointCloudReader::setColorScale(float scale)
+{
+	colorScale = scale;
+}
+
+void AsciiPointCloudReader::setErrorPolicy(ErrorPolicy policy)
+{
+	this->policy = policy;
+}
+
+/**
+ * @brief Reads the points of the file and appends them to the vertices of m.
+ * Result::opened is false if the file cannot be opened or if it is shorter
+ * than the number of rows to skip.
+ */
+AsciiPointCloudReader::Result
+AsciiPointCloudReader::read(const QString& fileName, CMeshO& m, vcg::CallBackPos* cb) const
+{
+	Result res;
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+		return res;
+
+	const qint64 fileSize = file.size();
+	QByteArray content;
+	const char* data = nullptr;
+	if (fileSize > 0) {
+		data = (const char*) file.map(0, fileSize);
+		if (data == nullptr) { // mapping not supported: fall back to a plain read
+			content = file.readAll();
+			data = content.constData();
+		}
+	}
+	const char* p = data;
+	const char* fileEnd = data + fileSize;
+
+	// header rows
+	for (unsigned int r = 0; r < rowsToSkip; ++r) {
+		if (p == nullptr || p >= fileEnd)
+			return res;
+		const char* nl = (const char*) std::memchr(p, '\n', fileEnd - p);
+		p = nl != nullptr ? nl + 1 : fileEnd;
+	}
+	res.opened = true;
+	if (p == nullptr || p >= fileEnd)
+		return res;
+
+	// line-aligned chunks
+	const std::size_t bodySize = fileEnd - p;
+	const std::size_t chunkNumber = bodySize / CHUNK_SIZE + 1;
+	std::vector<Chunk> chunks(chunkNumber);
+	const char* chunkBegin = p;
+	for (std::size_t c = 0; c < chunkNumber; ++c) {
+		const char* chunkEnd = fileEnd;
+		if (c + 1 < chunkNumber) {
+			chunkEnd = std::max(chunkBegin, p + (bodySize / chunkNumber) * (c + 1));
+			const char* nl = (const char*) std::memchr(chunkEnd, '\n', fileEnd - chunkEnd);
+			chunkEnd = nl != nullptr ? nl + 1 : fileEnd;
+		}
+		chunks[c].begin = chunkBegin;
+		chunks[c].end = chunkEnd;
+		chunkBegin = chunkEnd;
+	}
+
+	const int chunkCount = (int) chunks.size();
+
+	// first pass: count the lines of each chunk
+	#pragma omp parallel for schedule(dynamic)
+	for (int c = 0; c < chunkCount; ++c) {
+		Chunk& ch = chunks[c];
+		std::size_t lines = 0;
+		for (const char* q = ch.begin; q < ch.end; ++lines) {
+			const char* nl = (const char*) std::memchr(q, '\n', ch.end - q);
+			q = nl != nullptr ? nl + 1 : ch.end;
+		}
+		ch.lines = lines;
+	}
+
+	std::size_t totalLines = 0;
+	for (Chunk& ch : chunks) {
+		ch.offset = totalLines;
+		totalLines += ch.lines;
+	}
+	if (cb != nullptr)
+		cb(10, "Reading points...");
+
+	const std::size_t base = m.vert.size();
+	if (totalLines > 0)
+		vcg::tri::Allocator<CMeshO>::AddVertices(m, totalLines);
+
+	// index of each attribute in the list of fields (-1 if absent)
+	int idx[IGNORED];
+	std::fill(idx, idx + IGNORED, -1);
+	for (unsigned int i = 0; i < fields.size(); ++i)
+		if (fields[i] != IGNORED && idx[fields[i]] < 0)
+			idx[fields[i]] = i;
+	const bool hasNormal = idx[NX] >= 0 && idx[NY] >= 0 && idx[NZ] >= 0;
+	const bool hasColor = idx[RED] >= 0 && idx[GREEN] >= 0 && idx[BLUE] >= 0;
+	const bool hasQuality = idx[QUALITY] >= 0;
+
+	std::atomic<int> chunksDone(0);
+
+	// second pass: parse the lines and write the points in the range of the chunk
+	#pragma omp parallel for schedule(dynamic)
+	for (int c = 0; c < chunkCount; ++c) {
+		Chunk& ch = chunks[c];
+		double values[MAX_FIELDS];
+		CMeshO::VertexIterator vi = m.vert.begin() + base + ch.offset;
+		for (const char* q = ch.begin; q < ch.end;) {
+			const char* nl = (const char*) std::memchr(q, '\n', ch.end - q);
+			const char* lineEnd = nl != nullptr ? nl : ch.end;
+			unsigned int tokens = 0;
+			if (parseLine(q, lineEnd, values, tokens)) {
+				CVertexO& v = *vi;
+				v.P() = Point3m(values[idx[X]], values[idx[Y]], values[idx[Z]]);
+				if (hasNormal)
+					v.N() = Point3m(values[idx[NX]], values[idx[NY]], values[idx[NZ]]);
+				if (hasQuality)
+					v.Q() = values[idx[QUALITY]];
+				if (hasColor)
+					v.C() = vcg::Color4b(
+						toColorComponent(values[idx[RED]] * colorScale),
+						toColorComponent(values[idx[GREEN]] * colorScale),
+						toColorComponent(values[idx[BLUE]] * colorScale),
+						255);
+				++vi;
+				++ch.written;
+				if (tokens >= fields.size())
+					++ch.complete;
+			}
+			else {
+				++ch.skipped;
+				if (policy == STOP) {
+					ch.error = true;
+					break;
+				}
+			}
+			q = nl != nullptr ? nl + 1 : ch.end;
+		}
+
+		int done = ++chunksDone;
+#ifdef _OPENMP
+		if (omp_get_thread_num() == 0)
+#endif
+		if (cb != nullptr)
+			cb(10 + (85 * done) / chunkCount, "Reading points...");
+	}
+
+	// when stopping on errors, the points after the first wrong line are discarded
+	std::size_t usedChunks = chunks.size();
+	for (std::size_t c = 0; c < chunks.size(); ++c) {
+		if (chunks[c].error) {
+			usedChunks = c + 1;
+			res.stoppedOnError = true;
+			break;
+		}
+	}
+
+	// make the points of the chunks contiguous
+	std::size_t dest = base;
+	for (std::size_t c = 0; c < usedChunks; ++c) {
+		const Chunk& ch = chunks[c];
+		const std::size_t src = base + ch.offset;
+		if (src != dest) {
+			for (std::size_t k = 0; k < ch.written; ++k) {
+				CVertexO& dv = m.vert[dest + k];
+				const CVertexO& sv = m.vert[src + k];
+				dv.P() = sv.P();
+				dv.N() = sv.N();
+				dv.C() = sv.C();
+				dv.Q() = sv.Q();
+			}
+		}
+		dest += ch.written;
+		res.pointNumber += ch.written;
+		res.skippedLines += ch.skipped;
+		res.completeLines += ch.complete;
+	}
+
+	// remove the vertices that were allocated for lines that have not been read
+	if (dest < base + totalLines) {
+		for (std::size_t i = dest; i < base + totalLines; ++i)
+			vcg::tri::Allocator<CMeshO>::DeleteVertex(m, m.vert[i]);
+		vcg::tri::Allocator<CMeshO>::CompactVertexVector(m);
+	}
+
+	if (cb != nullptr)
+		cb(100, "Done");
+	return res;
+}
+
+/**
+ * @brief Parses a number in [begin, end), that must not contain anything else.
+ * Decimal numbers that can be represented exactly are converted without any
+ * allocation (Clinger's fast path); the others fall back to strtod.
+ */
+bool AsciiPointCloudReader::parseNumber(const char* begin, const char* end, double& value)
+{
+	static const double pow10[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+	const char* p = begin;
+	bool negative = false;
+	if (p < end && (*p == '+' || *p == '-')) {
+		negative = *p == '-';
+		++p;
+	}
+
+	unsigned long long mantissa = 0;
+	int digits = 0;
+	int exp10 = 0;
+	bool anyDigit = false;
+	bool fastPath = true;
+	for (; p < end && isDigit(*p); ++p) {
+		anyDigit = true;
+		if (mantissa == 0 && *p == '0')
+			continue;
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			++digits;
+		}
+		else {
+			fastPath = false;
+		}
+	}
+	if (p < end && *p == '.') {
+		++p;
+		for (; p < end && isDigit(*p); ++p) {
+			anyDigit = true;
+			if (mantissa == 0 && *p == '0') {
+				--exp10;
+				continue;
+			}
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				++digits;
+				--exp10;
+			}
+			else {
+				fastPath = false;
+			}
+		}
+	}
+	if (anyDigit && p < end && (*p == 'e' || *p == 'E')) {
+		++p;
+		bool negExp = false;
+		if (p < end && (*p == '+' || *p == '-')) {
+			negExp = *p == '-';
+			++p;
+		}
+		int e = 0;
+		bool expDigit = false;
+		for (; p < end && isDigit(*p); ++p) {
+			expDigit = true;
+			if (e < 100000)
+				e = e * 10 + (*p - '0');
+		}
+		if (!expDigit)
+			fastPath = false;
+		exp10 += negExp ? -e : e;
+	}
+
+	if (fastPath && anyDigit && p == end && mantissa < (1ULL << 53) && exp10 >= -22 && exp10 <= 22) {
+		double v = (double) mantissa;
+		v = exp10 >= 0 ? v * pow10[exp10] : v / pow10[-exp10];
+		value = negative ? -v : v;
+		return true;
+	}
+
+	// fallback: long mantissas, large exponents, inf, nan...
+	const std::ptrdiff_t len = end - begin;
+	if (len <= 0 || len >= 64)
+		return false;
+	char buf[64];
+	std::memcpy(buf, begin, len);
+	buf[len] = '\0';
+	char* parsedEnd = nullptr;
+	value = std::strtod(buf, &parsedEnd);
+	return parsedEnd == buf + len;
+}
+
+bool AsciiPointCloudReader::isSeparator(char c) const
+{
+	return separators.find(c) != std::string::npos;
+}
+
+/**
+ * @brief Splits and parses a line; returns true if the line is valid. Values
+ * are delimited by any run of separators and whitespace. Only the
+ * first fields.size() values are parsed; the missing fields are set to zero.
+ */
+bool AsciiPointCloudReader::parseLine(
+	const char*   begin,
+	const char*   end,
+	double*       values,
+	unsigned int& tokens) const
+{
+	const unsigned int fieldNumber = fields.size();
+	std::fill(values, values + fieldNumber, 0.0);
+	tokens = 0;
+	const char* p = begin;
+	while (true) {
+		while (p < end && (isSpace(*p) || isSeparator(*p)))
+			++p;
+		if (p >= end)
+			break;
+		const char* tokenBegin = p;
+		while (p < end && !isSpace(*p) && !isSeparator(*p))
+			++p;
+		if (tokens < fieldNumber && fields[tokens] != IGNORED) {
+			if (!parseNumber(tokenBegin, p, values[tokens]))
+				return false;
+		}
+		++tokens;
+		if (!strict && tokens >= fieldNumber)
+			break;
+	}
+	if (tokens < minFields)
+		return false;
+	if (strict && tokens != minFields && tokens != fieldNumber)
+		return false;
+	return true;
+}
+
+} // namespace meshlab
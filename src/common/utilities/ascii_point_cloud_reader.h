@@ -0,0 +1,98 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#ifndef MESHLAB_ASCII_POINT_CLOUD_READER_H
+#define MESHLAB_ASCII_POINT_CLOUD_READER_H
+
+#include "../ml_document/cmesh.h"
+
+#include <QString>
+#include <string>
+#include <vector>
+
+namespace meshlab {
+
+/**
+ * @brief The AsciiPointCloudReader class reads ASCII point lists (one point
+ * per line, TXT/XYZ/ASC files) directly into the vertices of a CMeshO.
+ *
+ * The file is memory mapped and split in line-aligned chunks that are parsed
+ * in parallel, without allocations, by a locale independent number parser.
+ * A first pass counts the lines of each chunk, so that the vertex container is
+ * allocated once and each chunk writes its points in its own range.
+ *
+ * Values of a line are separated by any of the separator characters and/or
+ * by whitespace; consecutive separators are collapsed. The meaning of each
+ * value is given by the list of fields.
+ */
+class AsciiPointCloudReader
+{
+public:
+	enum Field { X, Y, Z, NX, NY, NZ, RED, GREEN, BLUE, QUALITY, IGNORED };
+
+	enum ErrorPolicy {
+		SKIP_LINE, // lines that cannot be parsed are skipped
+		STOP       // reading stops at the first line that cannot be parsed
+	};
+
+	struct Result
+	{
+		bool        opened          = false;
+		std::size_t pointNumber     = 0; // number of points read
+		std::size_t skippedLines    = 0; // lines that were not parsed
+		std::size_t completeLines   = 0; // lines containing all the fields
+		bool        stoppedOnError  = false;
+	};
+
+	AsciiPointCloudReader(const std::vector<Field>& fields);
+
+	void setSeparators(const std::string& separators);
+	void setRowsToSkip(unsigned int rows);
+	void setMinimumFieldNumber(unsigned int minFields);
+	void setStrictFieldNumber(bool strict);
+	void setColorScale(float scale);
+	void setErrorPolicy(ErrorPolicy policy);
+
+	Result read(const QString& fileName, CMeshO& m, vcg::CallBackPos* cb = nullptr) const;
+
+	static bool parseNumber(const char* begin, const char* end, double& value);
+
+private:
+	struct Chunk;
+
+	bool parseLine(const char* begin, const char* end, double* values, unsigned int& tokens) const;
+	bool isSeparator(char c) const;
+
+	std::vector<Field> fields;
+	std::string        separators;
+	unsigned int       rowsToSkip;
+	unsigned int       minFields;
+	bool               strict;
+	float              colorScale;
+	ErrorPolicy        policy;
+};
+
+} // namespace meshlab
+
+#endif // MESHLAB_ASCII_POINT_CLOUD_READER_H
@@ -0,0 +1,202 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#include "connected_components.h"
+
+#include "../mlexception.h"
+
+#include <atomic>
+#include <utility>
+
+namespace meshlab {
+
+namespace {
+
+typedef std::vector<std::atomic<int>> ParentVector;
+
+// Links are always from the larger to the smaller index, so parent[x] <= x
+// and the root of a set is its smallest face index. Path halving and links
+// only move a face towards its root, so concurrent finds are always valid.
+int findRoot(ParentVector& parent, int x)
+{
+	int p = parent[x].load(std::memory_order_relaxed);
+	while (p != x) {
+		int gp = parent[p].load(std::memory_order_relaxed);
+		if (gp != p)
+			parent[x].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+		x = gp;
+		p = parent[x].load(std::memory_order_relaxed);
+	}
+	return x;
+}
+
+void unite(ParentVector& parent, int a, int b)
+{
+	for (;;) {
+		a = findRoot(parent, a);
+		b = findRoot(parent, b);
+		if (a == b)
+			return;
+		if (a < b)
+			std::swap(a, b);
+		// a must still be a root when it is linked, otherwise retry
+		int expected = a;
+		if (parent[a].compare_exchange_strong(expected, b))
+			return;
+	}
+}
+
+} // namespace
+
+ConnectedComponents::ConnectedComponents()
+{
+}
+
+ConnectedComponents::ConnectedComponents(const CMeshO& mesh)
+{
+	compute(mesh);
+}
+
+/**
+ * @brief Computes the connected components of the non deleted faces of the
+ * mesh, that must have FF adjacency (otherwise a
+ * vcg::MissingComponentException is thrown).
+ */
+void ConnectedComponents::compute(const CMeshO& mesh)
+{
+	vcg::tri::RequireFFAdjacency(mesh);
+	const int fn = (int) mesh.face.size();
+
+	ParentVector parent(fn);
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < fn; ++i)
+		parent[i].store(i, std::memory_order_relaxed);
+
+	// every adjacency is followed (not only towards smaller indices): on non
+	// manifold edges FF is a cycle over the incident faces. Deleted faces are
+	// never united, so that they cannot become the root of a live face
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < fn; ++i) {
+		const CFaceO& f = mesh.face[i];
+		if (f.IsD())
+			continue;
+		for (int j = 0; j < 3; ++j) {
+			const CFaceO* adj = f.FFp(j);
+			if (adj != &f && !adj->IsD())
+				unite(parent, i, (int) vcg::tri::Index(mesh, adj));
+		}
+	}
+
+	faceComp.resize(fn);
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < fn; ++i)
+		faceComp[i] = mesh.face[i].IsD() ? -1 : findRoot(parent, i);
+
+	// roots precede the other faces of their component: number them in order
+	components.clear();
+	std::vector<int> count;
+	for (int i = 0; i < fn; ++i) {
+		const int root = faceComp[i];
+		if (root < 0)
+			continue;
+		if (root == i) {
+			faceComp[i] = (int) components.size();
+			Component c;
+			c.seed = i;
+			components.push_back(c);
+			count.push_back(0);
+		}
+		else {
+			faceComp[i] = faceComp[root];
+		}
+		++count[faceComp[i]];
+	}
+
+	const int cn = (int) components.size();
+	offsets.resize(cn + 1);
+	offsets[0] = 0;
+	for (int c = 0; c < cn; ++c)
+		offsets[c + 1] = offsets[c] + count[c];
+	faces.resize(offsets[cn]);
+	for (int c = 0; c < cn; ++c)
+		count[c] = offsets[c];
+	for (int i = 0; i < fn; ++i)
+		if (faceComp[i] >= 0)
+			faces[count[faceComp[i]]++] = i;
+
+	// one giant component and many small ones are common: dynamic schedule
+#pragma omp parallel for schedule(dynamic, 64)
+	for (int c = 0; c < cn; ++c) {
+		Component& comp = components[c];
+		comp.faceNum = offsets[c + 1] - offsets[c];
+		comp.area = 0;
+		comp.bbox.SetNull();
+		for (const int* fi = facesBegin(c); fi != facesEnd(c); ++fi) {
+			const CFaceO& f = mesh.face[*fi];
+			comp.area += vcg::DoubleArea(f) * 0.5;
+			for (int k = 0; k < 3; ++k)
+				comp.bbox.Add(f.cP(k));
+		}
+	}
+}
+
+/**
+ * @brief Stores the component of each face in a custom per face attribute of
+ * integers with the given name (-1 for deleted faces). The mesh must be the
+ * one the components were computed on, with the same faces.
+ */
+void ConnectedComponents::storeFaceAttribute(CMeshO& mesh, const std::string& attributeName) const
+{
+	if (mesh.face.size() != faceComp.size())
+		throw MLException("The faces of the mesh changed after computing its connected components.");
+	auto h = vcg::tri::Allocator<CMeshO>::GetPerFaceAttribute<int>(mesh, attributeName);
+	for (size_t i = 0; i < faceComp.size(); ++i)
+		h[i] = faceComp[i];
+}
+
+/**
+ * @brief Deletes the faces of all the components for which toDelete returns
+ * true, and returns the number of deleted components. As in
+ * vcg::tri::Clean::RemoveSmallConnectedComponentsSize, the vertices are not
+ * deleted.
+ */
+int ConnectedComponents::deleteComponents(
+	CMeshO&                                       mesh,
+	const std::function<bool(const Component&)>& toDelete) const
+{
+	if (mesh.face.size() != faceComp.size())
+		throw MLException("The faces of the mesh changed after computing its connected components.");
+	int deleted = 0;
+	for (int c = 0; c < size(); ++c) {
+		if (toDelete(components[c])) {
+			++deleted;
+			for (const int* fi = facesBegin(c); fi != facesEnd(c); ++fi)
+				if (!mesh.face[*fi].IsD())
+					vcg::tri::Allocator<CMeshO>::DeleteFace(mesh, mesh.face[*fi]);
+		}
+	}
+	return deleted;
+}
+
+} // namespace meshlab
@@ -0,0 +1,88 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#ifndef MESHLAB_CONNECTED_COMPONENTS_H
+#define MESHLAB_CONNECTED_COMPONENTS_H
+
+#include "../ml_document/cmesh.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace meshlab {
+
+/**
+ * Connected components of the faces of a CMeshO, where two faces are
+ * connected if they share an edge (FF adjacency), as in
+ * vcg::tri::Clean::ConnectedComponents.
+ *
+ * The faces are labelled with a lock-free union-find, in parallel, and then
+ * grouped by component: the face count, area and bounding box of every
+ * component are computed in the same pass, so that filters that select
+ * components by size do not need a flood fill for each of them.
+ *
+ * Components are numbered in the order of their first face, that is the
+ * same order of the components returned by vcg::tri::Clean.
+ */
+class ConnectedComponents
+{
+public:
+	struct Component
+	{
+		int     seed;    // index of the first face of the component
+		int     faceNum;
+		Scalarm area;
+		Box3m   bbox;    // of the vertices of the faces of the component
+	};
+
+	ConnectedComponents();
+	ConnectedComponents(const CMeshO& mesh);
+
+	void compute(const CMeshO& mesh);
+
+	int size() const { return (int) components.size(); }
+	const Component& operator[](int i) const { return components[i]; }
+
+	// component of the face of index f, -1 for deleted faces
+	int faceComponent(int f) const { return faceComp[f]; }
+	const std::vector<int>& faceComponents() const { return faceComp; }
+
+	// indices of the faces of component i, in increasing order
+	const int* facesBegin(int i) const { return faces.data() + offsets[i]; }
+	const int* facesEnd(int i) const { return faces.data() + offsets[i + 1]; }
+
+	void storeFaceAttribute(CMeshO& mesh, const std::string& attributeName) const;
+	int  deleteComponents(CMeshO& mesh, const std::function<bool(const Component&)>& toDelete) const;
+
+private:
+	std::vector<int>       faceComp;
+	std::vector<Component> components;
+	std::vector<int>       offsets; // size() + 1 offsets in faces
+	std::vector<int>       faces;   // face indices, grouped by component
+};
+
+} // namespace meshlab
+
+#endif // MESHLAB_CONNECTED_COMPONENTS_H
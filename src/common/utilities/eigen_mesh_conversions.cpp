@@ -70,6 +70,24 @@ class PolyMesh :
 {
 };
 
+namespace {
+
+/**
+ * @brief Returns the distance, in number of T values, between the same
+ * component of two consecutive elements of type E stored in a contiguous array.
+ * It is the stride used by the zero-copy views on the CMeshO containers.
+ */
+template<typename T, typename E>
+Eigen::Index elementStride()
+{
+	static_assert(
+		sizeof(E) % sizeof(T) == 0,
+		"The size of the mesh element must be a multiple of the size of its component type");
+	return sizeof(E) / sizeof(T);
+}
+
+} // namespace
+
 /**
  * @brief Creates a CMeshO mesh from the data contained in the given matrices.
  * The only matrix required to be non-empty is the 'vertices' matrix.
@@ -136,9 +154,14 @@ CMeshO meshlab::meshFromMatrices(
 			}
 			m.vert.EnableTexCoord();
 		}
-		CMeshO::VertexIterator vi = vcg::tri::Allocator<CMeshO>::AddVertices(m, vertices.rows());
-		for (unsigned int i = 0; i < vertices.rows(); ++i, ++vi) {
-			ivp[i]  = &*vi;
+		// the mesh is empty: the new vertices are m.vert[0 .. #V-1], and can be
+		// filled independently
+		vcg::tri::Allocator<CMeshO>::AddVertices(m, vertices.rows());
+		const int nv = (int) vertices.rows();
+		#pragma omp parallel for
+		for (int i = 0; i < nv; ++i) {
+			CMeshO::VertexPointer vi = &m.vert[i];
+			ivp[i]  = vi;
 			vi->P() = CMeshO::CoordType(vertices(i, 0), vertices(i, 1), vertices(i, 2));
 			if (hasVNormals) {
 				vi->N() = CMeshO::CoordType(
@@ -197,8 +220,8 @@ CMeshO meshlab::meshFromMatrices(
 			}
 			m.face.EnableWedgeTexCoord();
 		}
-		CMeshO::FaceIterator fi = vcg::tri::Allocator<CMeshO>::AddFaces(m, faces.rows());
-		for (unsigned int i = 0; i < faces.rows(); ++i, ++fi) {
+		// check all the indices before filling the faces in parallel
+		for (unsigned int i = 0; i < faces.rows(); ++i) {
 			for (unsigned int j = 0; j < 3; j++) {
 				if ((unsigned int) faces(i, j) >= ivp.size()) {
 					throw MLException(
@@ -207,6 +230,12 @@ CMeshO meshlab::meshFromMatrices(
 						"; vertex " + QString::number(j) + ".");
 				}
 			}
+		}
+		vcg::tri::Allocator<CMeshO>::AddFaces(m, faces.rows());
+		const int nf = (int) faces.rows();
+		#pragma omp parallel for
+		for (int i = 0; i < nf; ++i) {
+			CMeshO::FacePointer fi = &m.face[i];
 			fi->V(0) = ivp[faces(i, 0)];
 			fi->V(1) = ivp[faces(i, 1)];
 			fi->V(2) = ivp[faces(i, 2)];
@@ -592,6 +621,7 @@ EigenMatrixX3m meshlab::vertexMatrix(const CMeshO& mesh)
 	EigenMatrixX3m vert(mesh.VN(), 3);
 
 	// copy vertices
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.VN(); i++) {
 		for (int j = 0; j < 3; j++) {
 			vert(i, j) = mesh.vert[i].P()[j];
@@ -618,6 +648,7 @@ EigenMatrixX3m meshlab::transformedVertexMatrix(const CMeshO &mesh)
 	EigenMatrixX3m vert(mesh.VN(), 3);
 
 	   // copy vertices
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.VN(); i++) {
 		CMeshO::CoordType p = mesh.Tr * mesh.vert[i].P();
 		for (int j = 0; j < 3; j++) {
@@ -645,6 +676,7 @@ Eigen::MatrixX3i meshlab::faceMatrix(const CMeshO& mesh)
 	Eigen::MatrixXi faces(mesh.FN(), 3);
 
 	// copy faces
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.FN(); i++) {
 		for (int j = 0; j < 3; j++) {
 			faces(i, j) = (int) vcg::tri::Index(mesh, mesh.face[i].V(j));
@@ -671,6 +703,7 @@ Eigen::MatrixX2i meshlab::edgeMatrix(const CMeshO& mesh)
 	Eigen::MatrixXi edges(mesh.EN(), 2);
 
 	// copy faces
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.EN(); i++) {
 		for (int j = 0; j < 2; j++) {
 			edges(i, j) = (int) vcg::tri::Index(mesh, mesh.edge[i].V(j));
@@ -725,6 +758,7 @@ EigenMatrixX3m meshlab::vertexNormalMatrix(const CMeshO& mesh)
 	EigenMatrixX3m vertexNormals(mesh.VN(), 3);
 
 	// per vertices normals
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.VN(); i++) {
 		for (int j = 0; j < 3; j++) {
 			vertexNormals(i, j) = mesh.vert[i].N()[j];
@@ -760,6 +794,7 @@ EigenMatrixX3m meshlab::transformedVertexNormalMatrix(const CMeshO &mesh)
 	EigenMatrixX3m vertexNormals(mesh.VN(), 3);
 
 	// per vertices normals
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.VN(); i++) {
 		CMeshO::CoordType n = mat33 * mesh.vert[i].N();
 		for (int j = 0; j < 3; j++) {
@@ -796,6 +831,7 @@ EigenMatrixX3m meshlab::faceNormalMatrix(const CMeshO& mesh)
 	EigenMatrixX3m faceNormals(mesh.FN(), 3);
 
 	// per face normals
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.FN(); i++) {
 		CMeshO::CoordType n = mat33 * mesh.face[i].N();
 		for (int j = 0; j < 3; j++) {
@@ -823,6 +859,7 @@ EigenMatrixX3m meshlab::transformedFaceNormalMatrix(const CMeshO &mesh)
 	EigenMatrixX3m faceNormals(mesh.FN(), 3);
 
 	// per face normals
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.FN(); i++) {
 		for (int j = 0; j < 3; j++) {
 			faceNormals(i, j) = mesh.face[i].N()[j];
@@ -847,6 +884,7 @@ EigenMatrixX4m meshlab::vertexColorMatrix(const CMeshO& mesh)
 	vcg::tri::RequireVertexCompactness(mesh);
 	EigenMatrixX4m vertexColors(mesh.VN(), 4);
 
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.VN(); i++) {
 		for (int j = 0; j < 4; j++) {
 			vertexColors(i, j) = mesh.vert[i].C()[j] / 255.0;
@@ -872,6 +910,7 @@ EigenMatrixX4m meshlab::faceColorMatrix(const CMeshO& mesh)
 
 	EigenMatrixX4m faceColors(mesh.FN(), 4);
 
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.FN(); i++) {
 		for (int j = 0; j < 4; j++) {
 			faceColors(i, j) = mesh.face[i].C()[j] / 255.0;
@@ -896,6 +935,7 @@ EigenVectorXui meshlab::vertexColorArray(const CMeshO& mesh)
 	vcg::tri::RequireVertexCompactness(mesh);
 	EigenVectorXui vertexColors(mesh.VN());
 
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.VN(); i++) {
 		vertexColors(i) = vcg::Color4<unsigned char>::ToUnsignedA8R8G8B8(mesh.vert[i].C());
 	}
@@ -920,6 +960,7 @@ EigenVectorXui meshlab::faceColorArray(const CMeshO& mesh)
 
 	EigenVectorXui faceColors(mesh.FN());
 
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.FN(); i++) {
 		faceColors(i) = vcg::Color4<unsigned char>::ToUnsignedA8R8G8B8(mesh.face[i].C());
 	}
@@ -942,6 +983,7 @@ EigenVectorXm meshlab::vertexQualityArray(const CMeshO& mesh)
 	vcg::tri::RequirePerVertexQuality(mesh);
 
 	EigenVectorXm qv(mesh.VN());
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.VN(); i++) {
 		qv(i) = mesh.vert[i].Q();
 	}
@@ -963,6 +1005,7 @@ EigenVectorXm meshlab::faceQualityArray(const CMeshO& mesh)
 	vcg::tri::RequirePerFaceQuality(mesh);
 
 	EigenVectorXm qf(mesh.FN());
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.FN(); i++) {
 		qf(i) = mesh.face[i].Q();
 	}
@@ -986,6 +1029,7 @@ EigenMatrixX2m meshlab::vertexTexCoordMatrix(const CMeshO& mesh)
 	EigenMatrixX2m uv(mesh.VN(), 2);
 
 	// per vertices uv
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.VN(); i++) {
 		uv(i, 0) = mesh.vert[i].T().U();
 		uv(i, 1) = mesh.vert[i].T().V();
@@ -1010,6 +1054,7 @@ EigenMatrixX2m meshlab::wedgeTexCoordMatrix(const CMeshO& mesh)
 	vcg::tri::RequirePerFaceWedgeTexCoord(mesh);
 	EigenMatrixX2m m(mesh.FN() * 3, 2);
 
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.FN(); i++) {
 		int base = i * 3;
 		for (int j = 0; j < 3; j++) {
@@ -1036,6 +1081,7 @@ EigenVectorXb meshlab::vertexSelectionArray(const CMeshO& mesh)
 	EigenVectorXb sel(mesh.VN());
 
 	// per vertex selection
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.VN(); i++) {
 		sel(i) = mesh.vert[i].IsS();
 	}
@@ -1059,6 +1105,7 @@ EigenVectorXb meshlab::faceSelectionArray(const CMeshO& mesh)
 	EigenVectorXb sel(mesh.FN());
 
 	// per face selection
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.FN(); i++) {
 		sel(i) = mesh.face[i].IsS();
 	}
@@ -1084,6 +1131,7 @@ EigenMatrixX3m meshlab::vertexCurvaturePD1Matrix(const CMeshO& mesh)
 	EigenMatrixX3m vertexCurv(mesh.VN(), 3);
 
 	// per vertices min curvature dir
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.VN(); i++) {
 		for (int j = 0; j < 3; j++) {
 			vertexCurv(i, j) = mesh.vert[i].PD1()[j];
@@ -1111,6 +1159,7 @@ EigenMatrixX3m meshlab::vertexCurvaturePD2Matrix(const CMeshO& mesh)
 	EigenMatrixX3m vertexCurv(mesh.VN(), 3);
 
 	// per vertices min curvature dir
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.VN(); i++) {
 		for (int j = 0; j < 3; j++) {
 			vertexCurv(i, j) = mesh.vert[i].PD2()[j];
@@ -1138,6 +1187,7 @@ EigenMatrixX3m meshlab::faceCurvaturePD1Matrix(const CMeshO& mesh)
 	EigenMatrixX3m faceCurv(mesh.FN(), 3);
 
 	// per face min curvature dir
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.FN(); i++) {
 		for (int j = 0; j < 3; j++) {
 			faceCurv(i, j) = mesh.face[i].PD1()[j];
@@ -1165,6 +1215,7 @@ EigenMatrixX3m meshlab::faceCurvaturePD2Matrix(const CMeshO& mesh)
 	EigenMatrixX3m faceCurv(mesh.FN(), 3);
 
 	// per face min curvature dir
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.FN(); i++) {
 		for (int j = 0; j < 3; j++) {
 			faceCurv(i, j) = mesh.face[i].PD2()[j];
@@ -1190,6 +1241,7 @@ Eigen::MatrixX3i meshlab::faceFaceAdjacencyMatrix(const CMeshO& mesh)
 
 	Eigen::MatrixX3i faceFaceMatrix(mesh.FN(), 3);
 
+	#pragma omp parallel for
 	for (int i = 0; i < mesh.FN(); i++) {
 		for (int j = 0; j < 3; j++) {
 			auto AdjF = mesh.face[i].FFp(j);
@@ -1205,6 +1257,184 @@ Eigen::MatrixX3i meshlab::faceFaceAdjacencyMatrix(const CMeshO& mesh)
 	return faceFaceMatrix;
 }
 
+/**
+ * @brief Get a #V*3 Eigen map that views, without copying them, the coordinates
+ * of the vertices of a CMeshO.
+ * The vertices in the mesh must be compact (no deleted vertices).
+ * If the mesh is not compact, a vcg::MissingCompactnessException will be thrown.
+ *
+ * The view refers to the vertex container of the mesh: it is invalidated by
+ * any operation that adds, removes or reallocates the vertices of the mesh.
+ *
+ * @param mesh: input mesh
+ * @return #V*3 strided map of scalars (vertex coordinates)
+ */
+EigenConstMapX3m meshlab::vertexView(const CMeshO& mesh)
+{
+	vcg::tri::RequireVertexCompactness(mesh);
+	const Scalarm* data = mesh.vert.empty() ? nullptr : &mesh.vert[0].P()[0];
+	return EigenConstMapX3m(
+		data, mesh.VN(), 3, Eigen::OuterStride<>(elementStride<Scalarm, CVertexO>()));
+}
+
+/**
+ * @brief Get a #V*3 Eigen map that views, without copying them, the coordinates
+ * of the vertices of a CMeshO. Writing in the map modifies the mesh.
+ * The vertices in the mesh must be compact (no deleted vertices).
+ * If the mesh is not compact, a vcg::MissingCompactnessException will be thrown.
+ *
+ * @param mesh: input mesh
+ * @return #V*3 strided map of scalars (vertex coordinates)
+ */
+EigenMapX3m meshlab::vertexView(CMeshO& mesh)
+{
+	vcg::tri::RequireVertexCompactness(mesh);
+	Scalarm* data = mesh.vert.empty() ? nullptr : &mesh.vert[0].P()[0];
+	return EigenMapX3m(
+		data, mesh.VN(), 3, Eigen::OuterStride<>(elementStride<Scalarm, CVertexO>()));
+}
+
+/**
+ * @brief Get a #V*3 Eigen map that views, without copying them, the normals
+ * of the vertices of a CMeshO.
+ * The vertices in the mesh must be compact (no deleted vertices).
+ * If the mesh is not compact, a vcg::MissingCompactnessException will be thrown.
+ *
+ * @param mesh: input mesh
+ * @return #V*3 strided map of scalars (vertex normals)
+ */
+EigenConstMapX3m meshlab::vertexNormalView(const CMeshO& mesh)
+{
+	vcg::tri::RequireVertexCompactness(mesh);
+	const Scalarm* data = mesh.vert.empty() ? nullptr : &mesh.vert[0].N()[0];
+	return EigenConstMapX3m(
+		data, mesh.VN(), 3, Eigen::OuterStride<>(elementStride<Scalarm, CVertexO>()));
+}
+
+/**
+ * @brief Get a #V*3 Eigen map that views, without copying them, the normals
+ * of the vertices of a CMeshO. Writing in the map modifies the mesh.
+ * The vertices in the mesh must be compact (no deleted vertices).
+ * If the mesh is not compact, a vcg::MissingCompactnessException will be thrown.
+ *
+ * @param mesh: input mesh
+ * @return #V*3 strided map of scalars (vertex normals)
+ */
+EigenMapX3m meshlab::vertexNormalView(CMeshO& mesh)
+{
+	vcg::tri::RequireVertexCompactness(mesh);
+	Scalarm* data = mesh.vert.empty() ? nullptr : &mesh.vert[0].N()[0];
+	return EigenMapX3m(
+		data, mesh.VN(), 3, Eigen::OuterStride<>(elementStride<Scalarm, CVertexO>()));
+}
+
+/**
+ * @brief Get a #V Eigen map that views, without copying them, the quality
+ * values of the vertices of a CMeshO.
+ * The vertices in the mesh must be compact (no deleted vertices).
+ * If the mesh is not compact, a vcg::MissingCompactnessException will be thrown.
+ *
+ * @param mesh: input mesh
+ * @return #V strided map of scalars (vertex quality)
+ */
+EigenConstMapXm meshlab::vertexQualityView(const CMeshO& mesh)
+{
+	vcg::tri::RequireVertexCompactness(mesh);
+	vcg::tri::RequirePerVertexQuality(mesh);
+	const Scalarm* data = mesh.vert.empty() ? nullptr : &mesh.vert[0].Q();
+	return EigenConstMapXm(
+		data, mesh.VN(), Eigen::InnerStride<>(elementStride<Scalarm, CVertexO>()));
+}
+
+/**
+ * @brief Get a #V Eigen map that views, without copying them, the quality
+ * values of the vertices of a CMeshO. Writing in the map modifies the mesh.
+ * The vertices in the mesh must be compact (no deleted vertices).
+ * If the mesh is not compact, a vcg::MissingCompactnessException will be thrown.
+ *
+ * @param mesh: input mesh
+ * @return #V strided map of scalars (vertex quality)
+ */
+EigenMapXm meshlab::vertexQualityView(CMeshO& mesh)
+{
+	vcg::tri::RequireVertexCompactness(mesh);
+	vcg::tri::RequirePerVertexQuality(mesh);
+	Scalarm* data = mesh.vert.empty() ? nullptr : &mesh.vert[0].Q();
+	return EigenMapXm(data, mesh.VN(), Eigen::InnerStride<>(elementStride<Scalarm, CVertexO>()));
+}
+
+/**
+ * @brief Get a #V*4 Eigen map that views, without copying them, the RGBA
+ * colors of the vertices of a CMeshO, each component in the interval [0, 255].
+ * The vertices in the mesh must be compact (no deleted vertices).
+ * If the mesh is not compact, a vcg::MissingCompactnessException will be thrown.
+ *
+ * @param mesh: input mesh
+ * @return #V*4 strided map of unsigned chars (vertex colors)
+ */
+EigenConstMapX4uc meshlab::vertexColorView(const CMeshO& mesh)
+{
+	vcg::tri::RequireVertexCompactness(mesh);
+	const unsigned char* data = mesh.vert.empty() ? nullptr : &mesh.vert[0].C()[0];
+	return EigenConstMapX4uc(
+		data, mesh.VN(), 4, Eigen::OuterStride<>(elementStride<unsigned char, CVertexO>()));
+}
+
+/**
+ * @brief Get a #V*4 Eigen map that views, without copying them, the RGBA
+ * colors of the vertices of a CMeshO, each component in the interval [0, 255].
+ * Writing in the map modifies the mesh.
+ * The vertices in the mesh must be compact (no deleted vertices).
+ * If the mesh is not compact, a vcg::MissingCompactnessException will be thrown.
+ *
+ * @param mesh: input mesh
+ * @return #V*4 strided map of unsigned chars (vertex colors)
+ */
+EigenMapX4uc meshlab::vertexColorView(CMeshO& mesh)
+{
+	vcg::tri::RequireVertexCompactness(mesh);
+	unsigned char* data = mesh.vert.empty() ? nullptr : &mesh.vert[0].C()[0];
+	return EigenMapX4uc(
+		data, mesh.VN(), 4, Eigen::OuterStride<>(elementStride<unsigned char, CVertexO>()));
+}
+
+/**
+ * @brief Get a #F*3 Eigen map that views, without copying them, the normals
+ * of the faces of a CMeshO.
+ * The faces in the mesh must be compact (no deleted faces).
+ * If the mesh is not compact, a vcg::MissingCompactnessException will be thrown.
+ *
+ * Vertex indices of the faces cannot be viewed, since faces store pointers to
+ * their vertices: use faceMatrix to get them.
+ *
+ * @param mesh: input mesh
+ * @return #F*3 strided map of scalars (face normals)
+ */
+EigenConstMapX3m meshlab::faceNormalView(const CMeshO& mesh)
+{
+	vcg::tri::RequireFaceCompactness(mesh);
+	const Scalarm* data = mesh.face.empty() ? nullptr : &mesh.face[0].N()[0];
+	return EigenConstMapX3m(
+		data, mesh.FN(), 3, Eigen::OuterStride<>(elementStride<Scalarm, CFaceO>()));
+}
+
+/**
+ * @brief Get a #F*3 Eigen map that views, without copying them, the normals
+ * of the faces of a CMeshO. Writing in the map modifies the mesh.
+ * The faces in the mesh must be compact (no deleted faces).
+ * If the mesh is not compact, a vcg::MissingCompactnessException will be thrown.
+ *
+ * @param mesh: input mesh
+ * @return #F*3 strided map of scalars (face normals)
+ */
+EigenMapX3m meshlab::faceNormalView(CMeshO& mesh)
+{
+	vcg::tri::RequireFaceCompactness(mesh);
+	Scalarm* data = mesh.face.empty() ? nullptr : &mesh.face[0].N()[0];
+	return EigenMapX3m(
+		data, mesh.FN(), 3, Eigen::OuterStride<>(elementStride<Scalarm, CFaceO>()));
+}
+
 /**
  * @brief Get a #V Eigen vector of scalars containing the values of the
  * custom per-vertex attribute having the given name.
@@ -1222,7 +1452,8 @@ meshlab::vertexScalarAttributeArray(const CMeshO& mesh, const std::string& attri
 		vcg::tri::Allocator<CMeshO>::GetPerVertexAttribute<Scalarm>(mesh, attributeName);
 	if (vcg::tri::Allocator<CMeshO>::IsValidHandle(mesh, attributeHandle)) {
 		EigenVectorXm attrVector(mesh.VN());
-		for (unsigned int i = 0; i < (unsigned int) mesh.VN(); ++i) {
+		#pragma omp parallel for
+		for (int i = 0; i < mesh.VN(); ++i) {
 			attrVector[i] = attributeHandle[i];
 		}
 		return attrVector;
@@ -1251,7 +1482,8 @@ meshlab::vertexVectorAttributeMatrix(const CMeshO& mesh, const std::string& attr
 		vcg::tri::Allocator<CMeshO>::GetPerVertexAttribute<Point3m>(mesh, attributeName);
 	if (vcg::tri::Allocator<CMeshO>::IsValidHandle(mesh, attributeHandle)) {
 		EigenMatrixX3m attrMatrix(mesh.VN(), 3);
-		for (unsigned int i = 0; i < (unsigned int) mesh.VN(); ++i) {
+		#pragma omp parallel for
+		for (int i = 0; i < mesh.VN(); ++i) {
 			attrMatrix(i, 0) = attributeHandle[i][0];
 			attrMatrix(i, 1) = attributeHandle[i][1];
 			attrMatrix(i, 2) = attributeHandle[i][2];
@@ -1282,7 +1514,8 @@ meshlab::faceScalarAttributeArray(const CMeshO& mesh, const std::string& attribu
 		vcg::tri::Allocator<CMeshO>::GetPerFaceAttribute<Scalarm>(mesh, attributeName);
 	if (vcg::tri::Allocator<CMeshO>::IsValidHandle(mesh, attributeHandle)) {
 		EigenVectorXm attrMatrix(mesh.FN());
-		for (unsigned int i = 0; i < (unsigned int) mesh.FN(); ++i) {
+		#pragma omp parallel for
+		for (int i = 0; i < mesh.FN(); ++i) {
 			attrMatrix[i] = attributeHandle[i];
 		}
 		return attrMatrix;
@@ -1311,7 +1544,8 @@ meshlab::faceVectorAttributeMatrix(const CMeshO& mesh, const std::string& attrib
 		vcg::tri::Allocator<CMeshO>::GetPerFaceAttribute<Point3m>(mesh, attributeName);
 	if (vcg::tri::Allocator<CMeshO>::IsValidHandle(mesh, attributeHandle)) {
 		EigenMatrixX3m attrMatrix(mesh.FN(), 3);
-		for (unsigned int i = 0; i < (unsigned int) mesh.FN(); ++i) {
+		#pragma omp parallel for
+		for (int i = 0; i < mesh.FN(); ++i) {
 			attrMatrix(i, 0) = attributeHandle[i][0];
 			attrMatrix(i, 1) = attributeHandle[i][1];
 			attrMatrix(i, 2) = attributeHandle[i][2];
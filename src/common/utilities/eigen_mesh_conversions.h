@@ -38,6 +38,19 @@ typedef Eigen::Matrix<Scalarm, Eigen::Dynamic, 4> EigenMatrixX4m;
 
 typedef Eigen::Matrix<Scalarm, Eigen::Dynamic, Eigen::Dynamic> EigenMatrixXm;
 
+typedef Eigen::Matrix<Scalarm, Eigen::Dynamic, 3, Eigen::RowMajor>       EigenRowMatrixX3m;
+typedef Eigen::Matrix<unsigned char, Eigen::Dynamic, 4, Eigen::RowMajor> EigenRowMatrixX4uc;
+
+// strided views over the per element components of a compact CMeshO
+typedef Eigen::Map<EigenRowMatrixX3m, Eigen::Unaligned, Eigen::OuterStride<>> EigenMapX3m;
+typedef Eigen::Map<const EigenRowMatrixX3m, Eigen::Unaligned, Eigen::OuterStride<>>
+	EigenConstMapX3m;
+typedef Eigen::Map<EigenVectorXm, Eigen::Unaligned, Eigen::InnerStride<>>       EigenMapXm;
+typedef Eigen::Map<const EigenVectorXm, Eigen::Unaligned, Eigen::InnerStride<>> EigenConstMapXm;
+typedef Eigen::Map<EigenRowMatrixX4uc, Eigen::Unaligned, Eigen::OuterStride<>>  EigenMapX4uc;
+typedef Eigen::Map<const EigenRowMatrixX4uc, Eigen::Unaligned, Eigen::OuterStride<>>
+	EigenConstMapX4uc;
+
 namespace meshlab {
 
 // From eigen to CMeshO
@@ -113,6 +126,18 @@ EigenMatrixX3m            faceCurvaturePD2Matrix(const CMeshO& mesh);
 
 Eigen::MatrixX3i faceFaceAdjacencyMatrix(const CMeshO& mesh);
 
+// Zero-copy views on CMeshO (valid until the mesh containers are reallocated)
+EigenConstMapX3m  vertexView(const CMeshO& mesh);
+EigenMapX3m       vertexView(CMeshO& mesh);
+EigenConstMapX3m  vertexNormalView(const CMeshO& mesh);
+EigenMapX3m       vertexNormalView(CMeshO& mesh);
+EigenConstMapXm   vertexQualityView(const CMeshO& mesh);
+EigenMapXm        vertexQualityView(CMeshO& mesh);
+EigenConstMapX4uc vertexColorView(const CMeshO& mesh);
+EigenMapX4uc      vertexColorView(CMeshO& mesh);
+EigenConstMapX3m  faceNormalView(const CMeshO& mesh);
+EigenMapX3m       faceNormalView(CMeshO& mesh);
+
 EigenVectorXm  vertexScalarAttributeArray(const CMeshO& mesh, const std::string& attributeName);
 EigenMatrixX3m vertexVectorAttributeMatrix(const CMeshO& mesh, const std::string& attributeName);
 EigenVectorXm  faceScalarAttributeArray(const CMeshO& mesh, const std::string& attributeName);
@@ -333,6 +333,33 @@ QImage loadImage(const QString& filename, GLLogStream* log, vcg::CallBackPos* cb
 	}
 }
 
+/**
+ * @brief Same as loadImage, but without log and callback: it does not touch
+ * any shared state of the image plugins, so it can be called concurrently
+ * from several threads (e.g. to decode many textures in parallel).
+ */
+QImage decodeImage(const QString& filename)
+{
+	QFileInfo fi(filename);
+	QString   extension = fi.suffix();
+	IOPlugin* ioPlugin  = meshlab::pluginManagerInstance().inputImagePlugin(extension);
+
+	if (ioPlugin != nullptr) {
+		return ioPlugin->openImage(extension, filename, nullptr);
+	}
+	else {
+		QImage img(filename);
+		if (img.isNull()) {
+			throw MLException(
+				"Image " + filename +
+				" cannot be opened. Your MeshLab version "
+				"has not plugin to read " +
+				extension + " file format.");
+		}
+		return img;
+	}
+}
+
 QImage getDummyTexture(int imageSize, int checkSize, bool gridFlag)
 {
 	QImage image(imageSize, imageSize, QImage::Format_RGB32);
@@ -397,6 +424,27 @@ void saveImage(
 	ioPlugin->saveImage(extension, filename, image, quality, cb);
 }
 
+/**
+ * @brief Same as saveImage, but without log and callback and without creating
+ * the destination directory: it can be called concurrently from several
+ * threads (e.g. to encode many textures in parallel).
+ */
+void encodeImage(const QString& filename, const QImage& image, int quality)
+{
+	QFileInfo fi(filename);
+	QString   extension = fi.suffix();
+	IOPlugin* ioPlugin  = meshlab::pluginManagerInstance().outputImagePlugin(extension);
+
+	if (ioPlugin == nullptr)
+		throw MLException(
+			"Image " + filename +
+			" cannot be saved. Your MeshLab version "
+			"has not plugin to save " +
+			extension + " file format.");
+
+	ioPlugin->saveImage(extension, filename, image, quality, nullptr);
+}
+
 void loadRaster(const QString& filename, RasterModel& rm, GLLogStream* log, vcg::CallBackPos* cb)
 {
 	QImage loadedImage = loadImage(filename, log, cb);
@@ -70,6 +70,8 @@ void saveAllMeshes(
 QImage
 loadImage(const QString& filename, GLLogStream* log = nullptr, vcg::CallBackPos* cb = nullptr);
 
+QImage decodeImage(const QString& filename);
+
 QImage getDummyTexture(int size=512, int checkNum=8, bool gridFlag=false);
 
 void saveImage(
@@ -79,6 +81,8 @@ void saveImage(
 	GLLogStream*      log     = nullptr,
 	vcg::CallBackPos* cb      = nullptr);
 
+void encodeImage(const QString& filename, const QImage& image, int quality = -1);
+
 void loadRaster(
 	const QString&    filename,
 	RasterModel&      rm,
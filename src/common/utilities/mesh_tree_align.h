@@ -0,0 +1,275 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#ifndef MESHLAB_MESH_TREE_ALIGN_H
+#define MESHLAB_MESH_TREE_ALIGN_H
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <vcg/complex/algorithms/align_pair.h>
+#include <vcg/complex/algorithms/meshtree.h>
+
+#include "../ml_document/mesh_model.h"
+
+namespace meshlab {
+
+/**
+ * Parallel global alignment of the glued meshes of a MeshTree.
+ *
+ * Same steps of vcg::MeshTree::Process: the overlapping arcs are found with an
+ * occupancy grid, the pairwise ICP is run on the arcs that have to be
+ * (re)computed and then the global alignment is relaxed on the arc graph.
+ *
+ * Differently from MeshTree::Process, the pairwise alignments are executed
+ * concurrently with all the state kept per arc:
+ * - arcs are grouped by fixed mesh; the fixed mesh and its search grid are
+ *   built once per group and reused by all its arcs. A group is processed by a
+ *   single thread, because grid queries update the face marks of the fixed
+ *   mesh;
+ * - each arc has its own aligner and moving samples, and writes its result in
+ *   its own slot;
+ * - results are merged in the tree in the order of the arcs (independent from
+ *   the scheduling of the threads) before the global relaxation.
+ *
+ * Similarity (non rigid) matching relies on the static data of
+ * vcg::PointMatchingScale, therefore in that case the ICP steps of different
+ * arcs are serialized.
+ *
+ * The callback of the tree is called only outside of the parallel section.
+ */
+inline void processMeshTree(
+	vcg::MeshTree<MeshModel, Scalarm>&        tree,
+	vcg::AlignPair::Param&                    ap,
+	vcg::MeshTree<MeshModel, Scalarm>::Param& mtp)
+{
+	typedef vcg::AlignPair::Result Result;
+
+	auto log = [&](const std::string& msg) {
+		if (tree.cb)
+			tree.cb(0, msg.c_str());
+	};
+
+	/******* Occupancy Grid Computation *************/
+	Box3m gluedBox;
+	int   gluedNum = 0;
+	for (const auto& ni : tree.nodeMap) {
+		if (ni.second->glued) {
+			gluedBox.Add(ni.second->m->cm.trBB());
+			++gluedNum;
+		}
+	}
+	log("Starting processing of " + std::to_string(gluedNum) + " glued meshes out of " +
+		std::to_string(tree.nodeMap.size()) + " meshes\n");
+	log("Computing overlaps...\n");
+
+	vcg::OccupancyGrid<CMeshO, Scalarm> og;
+	og.Init(static_cast<int>(tree.nodeMap.size()), gluedBox, mtp.OGSize);
+	for (const auto& ni : tree.nodeMap) {
+		if (ni.second->glued)
+			og.AddMesh(ni.second->m->cm, ni.second->m->cm.Tr, ni.second->m->id());
+	}
+	og.Compute();
+
+	/*************** Arc selection *************/
+	// the worst recalcThreshold fraction of the existing arcs is recomputed,
+	// the other ones are preserved
+	std::vector<double> errors;
+	for (const Result& r : tree.resultList) {
+		if (r.isValid())
+			errors.push_back(r.err);
+	}
+	double preserveThr = -1;
+	if (!errors.empty()) {
+		std::sort(errors.begin(), errors.end());
+		std::size_t k = static_cast<std::size_t>(errors.size() * (1.0 - mtp.recalcThreshold));
+		preserveThr = errors[std::min(k, errors.size() - 1)];
+	}
+	auto findResult = [&](int fix, int mov) -> const Result* {
+		for (const Result& r : tree.resultList) {
+			if ((r.FixName == fix && r.MovName == mov) || (r.FixName == mov && r.MovName == fix))
+				return &r;
+		}
+		return nullptr;
+	};
+
+	// the s and t of the occupancy grid arcs are the fixed and the moving mesh
+	struct Arc
+	{
+		int        fix, mov;
+		MeshModel* fixMesh;
+		MeshModel* movMesh;
+		double     area;
+	};
+	std::vector<Arc> arcs;
+	int preservedNum = 0;
+	for (const auto& a : og.SVA) {
+		if (a.norm_area <= mtp.arcThreshold)
+			continue;
+		const Result* old = findResult(a.s, a.t);
+		if (old != nullptr && old->isValid() && old->err < preserveThr) {
+			++preservedNum;
+			continue;
+		}
+		arcs.push_back(Arc {
+			static_cast<int>(a.s),
+			static_cast<int>(a.t),
+			tree.nodeMap.at(a.s)->m,
+			tree.nodeMap.at(a.t)->m,
+			static_cast<double>(a.norm_area)});
+	}
+	if (arcs.empty() && preservedNum == 0) {
+		log("\n Failure. There are no overlapping meshes?\n No candidate alignment arcs. Nothing Done.\n");
+		return;
+	}
+	log("Computing " + std::to_string(arcs.size()) + " alignments (" +
+		std::to_string(preservedNum) + " arcs preserved)\n");
+
+	/*************** The Arc Computation *************/
+	for (const Arc& arc : arcs) {
+		arc.fixMesh->updateDataMask(MeshModel::MM_FACEMARK);
+		arc.movMesh->updateDataMask(MeshModel::MM_FACEMARK);
+	}
+
+	// groups of arcs sharing the fixed mesh, biggest first
+	std::map<int, std::vector<std::size_t>> fixGroups;
+	for (std::size_t i = 0; i < arcs.size(); ++i)
+		fixGroups[arcs[i].fix].push_back(i);
+	std::vector<const std::vector<std::size_t>*> groups;
+	for (const auto& g : fixGroups)
+		groups.push_back(&g.second);
+	std::stable_sort(
+		groups.begin(),
+		groups.end(),
+		[](const std::vector<std::size_t>* a, const std::vector<std::size_t>* b) {
+			return a->size() > b->size();
+		});
+
+	const bool rigid = ap.MatchMode == vcg::AlignPair::Param::MMRigid;
+	std::mutex similarityMutex;
+	std::vector<Result> results(arcs.size());
+
+#pragma omp parallel for schedule(dynamic)
+	for (int g = 0; g < (int) groups.size(); ++g) {
+		const std::vector<std::size_t>& group = *groups[g];
+		MeshModel* fixMesh = arcs[group.front()].fixMesh;
+
+		// 1) Convert fixed mesh and put it into the grid.
+		vcg::AlignPair            converter;
+		vcg::AlignPair::A2Mesh    fix;
+		vcg::AlignPair::A2Grid    UG;
+		vcg::AlignPair::A2GridVert VG;
+		converter.convertMesh<CMeshO>(fixMesh->cm, fix);
+		if (fixMesh->cm.fn == 0 || ap.UseVertexOnly) {
+			fix.initVert(vcg::Matrix44d::Identity());
+			vcg::AlignPair::InitFixVert(&fix, ap, VG);
+		}
+		else {
+			fix.init(vcg::Matrix44d::Identity());
+			vcg::AlignPair::initFix(&fix, ap, UG);
+		}
+
+		for (std::size_t ai : group) {
+			const Arc& arc = arcs[ai];
+			// the moving mesh is aligned in the reference system of the fixed one
+			vcg::Matrix44d movToFix =
+				vcg::Inverse(vcg::Matrix44d::Construct(arc.fixMesh->cm.Tr)) *
+				vcg::Matrix44d::Construct(arc.movMesh->cm.Tr);
+
+			// 2) Convert the moving mesh and sample <ap.SampleNum> points on it.
+			vcg::AlignPair                        aligner;
+			std::vector<vcg::AlignPair::A2Vertex> movVert;
+			aligner.convertVertex(arc.movMesh->cm.vert, movVert);
+			aligner.sampleMovVert(movVert, ap.SampleNum, ap.SampleMode);
+			aligner.mov = &movVert;
+			aligner.fix = &fix;
+			aligner.ap  = ap;
+
+			// 3) Execute the ICP algorithm
+			Result& result = results[ai];
+			if (rigid) {
+				aligner.align(movToFix, UG, VG, result);
+			}
+			else {
+				std::lock_guard<std::mutex> lock(similarityMutex);
+				aligner.align(movToFix, UG, VG, result);
+			}
+			result.FixName = arc.fix;
+			result.MovName = arc.mov;
+			result.area    = arc.area;
+		}
+	}
+
+	/*************** Merge of the results *************/
+	std::set<std::pair<int, int>> recomputed;
+	for (const Arc& arc : arcs) {
+		recomputed.insert(std::make_pair(arc.fix, arc.mov));
+		recomputed.insert(std::make_pair(arc.mov, arc.fix));
+	}
+	tree.resultList.erase(
+		std::remove_if(
+			tree.resultList.begin(),
+			tree.resultList.end(),
+			[&](const Result& r) {
+				return recomputed.count(std::make_pair(r.FixName, r.MovName)) > 0;
+			}),
+		tree.resultList.end());
+
+	bool hasValidArc = false;
+	for (std::size_t i = 0; i < results.size(); ++i) {
+		const Result& r = results[i];
+		char buf[256];
+		if (r.isValid()) {
+			hasValidArc = true;
+			std::snprintf(
+				buf, sizeof(buf), "%4i -> %4i Area:%5.3f Err:%8.5f\n", r.FixName, r.MovName, r.area, r.err);
+		}
+		else {
+			std::snprintf(
+				buf, sizeof(buf), "%4i -> %4i Area:%5.3f Failed: %s\n", r.FixName, r.MovName, r.area,
+				std::string(vcg::AlignPair::errorMsg(r.status)).c_str());
+		}
+		log(buf);
+		tree.resultList.push_back(r);
+	}
+	hasValidArc |= preservedNum > 0;
+
+	if (!hasValidArc) {
+		log("\n Failure. No successful arc among candidate Alignment arcs. Nothing Done.\n");
+		return;
+	}
+
+	/************** Global alignment *************/
+	tree.ProcessGlobal(ap);
+}
+
+} // namespace meshlab
+
+#endif // MESHLAB_MESH_TREE_ALIGN_H
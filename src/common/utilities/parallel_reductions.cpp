@@ -0,0 +1,249 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#include "parallel_reductions.h"
+
+#include <vcg/complex/algorithms/update/bounding.h>
+#include <vcg/complex/algorithms/update/normal.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace meshlab {
+
+namespace {
+
+// below these sizes the parallel passes cost more than the serial ones
+const int MIN_PARALLEL_ELEMENTS = 32 * 1024;
+
+int maxThreads()
+{
+#ifdef _OPENMP
+	if (omp_in_parallel())
+		return 1;
+	return omp_get_max_threads();
+#else
+	return 1;
+#endif
+}
+
+// block of elements reduced by thread t of nt
+inline int blockBegin(int n, int t, int nt)
+{
+	return (int) ((long long) n * t / nt);
+}
+
+// partial sum of the angle weighted normal of a vertex, in the block of faces of a thread
+struct NormalAccumulator
+{
+	NormalAccumulator() : n(0, 0, 0), referenced(false) {}
+	Point3m n;
+	bool referenced;
+};
+
+template <class ElementContainer>
+std::pair<Scalarm, Scalarm> qualityMinMax(const ElementContainer& elements)
+{
+	const int n = (int) elements.size();
+	const int nt = n < MIN_PARALLEL_ELEMENTS ? 1 : maxThreads();
+	std::vector<std::pair<Scalarm, Scalarm>> partials(
+		nt, std::make_pair(std::numeric_limits<Scalarm>::max(), -std::numeric_limits<Scalarm>::max()));
+#pragma omp parallel for schedule(static, 1) num_threads(nt)
+	for (int t = 0; t < nt; ++t) {
+		std::pair<Scalarm, Scalarm> minmax = partials[t];
+		const int end = blockBegin(n, t + 1, nt);
+		for (int i = blockBegin(n, t, nt); i < end; ++i) {
+			if (!elements[i].IsD()) {
+				const Scalarm q = elements[i].cQ();
+				if (q < minmax.first)  minmax.first  = q;
+				if (q > minmax.second) minmax.second = q;
+			}
+		}
+		partials[t] = minmax;
+	}
+	std::pair<Scalarm, Scalarm> minmax = partials[0];
+	for (int t = 1; t < nt; ++t) {
+		if (partials[t].first < minmax.first)   minmax.first  = partials[t].first;
+		if (partials[t].second > minmax.second) minmax.second = partials[t].second;
+	}
+	return minmax;
+}
+
+} // namespace
+
+/**
+ * @brief Returns the bounding box of the non deleted vertices of the mesh,
+ * as vcg::tri::UpdateBounding::Box does (without storing it in mesh.bbox).
+ */
+Box3m computeBoundingBox(const CMeshO& mesh)
+{
+	const int n = (int) mesh.vert.size();
+	const int nt = n < MIN_PARALLEL_ELEMENTS ? 1 : maxThreads();
+	std::vector<Box3m> partials(nt);
+#pragma omp parallel for schedule(static, 1) num_threads(nt)
+	for (int t = 0; t < nt; ++t) {
+		Box3m box;
+		const int end = blockBegin(n, t + 1, nt);
+		for (int i = blockBegin(n, t, nt); i < end; ++i)
+			if (!mesh.vert[i].IsD())
+				box.Add(mesh.vert[i].cP());
+		partials[t] = box;
+	}
+	Box3m box;
+	for (const Box3m& b : partials)
+		if (!b.IsNull())
+			box.Add(b);
+	return box;
+}
+
+/**
+ * @brief Updates the bounding box, the normalized per face normals and the
+ * angle weighted per vertex normals of the mesh: it gives the same result of
+ * vcg::tri::UpdateBounding::Box, UpdateNormal::PerFaceNormalized and
+ * UpdateNormal::PerVertexAngleWeighted, with two parallel passes over the
+ * faces instead of four serial ones over the whole mesh.
+ *
+ * The vertex normals are accumulated by each thread in a buffer covering the
+ * range of vertex indices referenced by its block of faces, then summed in
+ * thread order: a vertex whose faces are all in one block gets exactly the
+ * serial result. When the face order has little locality the ranges overlap
+ * too much, and the vertex normals are computed serially.
+ */
+void updateBoxAndNormals(CMeshO& mesh)
+{
+	const int vn = (int) mesh.vert.size();
+	const int fn = (int) mesh.face.size();
+	const int nt = fn < MIN_PARALLEL_ELEMENTS ? 1 : maxThreads();
+	if (nt == 1) {
+		vcg::tri::UpdateBounding<CMeshO>::Box(mesh);
+		if (mesh.fn > 0) {
+			vcg::tri::UpdateNormal<CMeshO>::PerFaceNormalized(mesh);
+			vcg::tri::UpdateNormal<CMeshO>::PerVertexAngleWeighted(mesh);
+		}
+		return;
+	}
+
+	mesh.bbox = computeBoundingBox(mesh);
+	if (mesh.fn == 0)
+		return;
+
+	// first pass: face normals and range of the vertices referenced by each block
+	std::vector<int> lo(nt, vn), hi(nt, -1);
+#pragma omp parallel for schedule(static, 1) num_threads(nt)
+	for (int t = 0; t < nt; ++t) {
+		int l = vn, h = -1;
+		const int end = blockBegin(fn, t + 1, nt);
+		for (int i = blockBegin(fn, t, nt); i < end; ++i) {
+			CFaceO& f = mesh.face[i];
+			if (!f.IsD()) {
+				f.N() = vcg::TriangleNormal(f).Normalize();
+				for (int k = 0; k < 3; ++k) {
+					const int vi = (int) vcg::tri::Index(mesh, f.cV(k));
+					l = std::min(l, vi);
+					h = std::max(h, vi);
+				}
+			}
+		}
+		lo[t] = l;
+		hi[t] = h;
+	}
+
+	size_t bufferSize = 0;
+	for (int t = 0; t < nt; ++t)
+		if (hi[t] >= lo[t])
+			bufferSize += hi[t] - lo[t] + 1;
+	if (bufferSize > 2 * (size_t) vn + nt) {
+		vcg::tri::UpdateNormal<CMeshO>::PerVertexAngleWeighted(mesh);
+		return;
+	}
+
+	// second pass: angle weighted sum of the face normals, per block
+	std::vector<std::vector<NormalAccumulator>> partials(nt);
+#pragma omp parallel for schedule(static, 1) num_threads(nt)
+	for (int t = 0; t < nt; ++t) {
+		if (hi[t] < lo[t])
+			continue;
+		std::vector<NormalAccumulator>& acc = partials[t];
+		acc.resize(hi[t] - lo[t] + 1);
+		const int end = blockBegin(fn, t + 1, nt);
+		for (int i = blockBegin(fn, t, nt); i < end; ++i) {
+			const CFaceO& f = mesh.face[i];
+			if (f.IsD())
+				continue;
+			NormalAccumulator* a[3];
+			for (int k = 0; k < 3; ++k) {
+				a[k] = &acc[vcg::tri::Index(mesh, f.cV(k)) - lo[t]];
+				a[k]->referenced = true;
+			}
+			if (!f.IsR())
+				continue;
+			const Point3m& n = f.cN();
+			const Point3m e0 = (f.cP(1) - f.cP(0)).Normalize();
+			const Point3m e1 = (f.cP(2) - f.cP(1)).Normalize();
+			const Point3m e2 = (f.cP(0) - f.cP(2)).Normalize();
+			a[0]->n += n * vcg::AngleN(e0, -e2);
+			a[1]->n += n * vcg::AngleN(-e0, e1);
+			a[2]->n += n * vcg::AngleN(-e1, -e2);
+		}
+	}
+
+	// merge: the normal of the vertices referenced by some face is the sum of the partials
+#pragma omp parallel for schedule(static) num_threads(nt)
+	for (int i = 0; i < vn; ++i) {
+		CVertexO& v = mesh.vert[i];
+		if (v.IsD())
+			continue;
+		Point3m n(0, 0, 0);
+		bool referenced = false;
+		for (int t = 0; t < nt; ++t) {
+			if (i >= lo[t] && i <= hi[t]) {
+				const NormalAccumulator& a = partials[t][i - lo[t]];
+				if (a.referenced) {
+					n += a.n;
+					referenced = true;
+				}
+			}
+		}
+		if (referenced) // as in vcg, the normal of a non writable vertex is not cleared
+			v.N() = v.IsRW() ? n : Point3m(v.cN() + n);
+	}
+}
+
+/**
+ * @brief Same as vcg::tri::Stat::ComputePerVertexQualityMinMax.
+ */
+std::pair<Scalarm, Scalarm> perVertexQualityMinMax(const CMeshO& mesh)
+{
+	return qualityMinMax(mesh.vert);
+}
+
+/**
+ * @brief Same as vcg::tri::Stat::ComputePerFaceQualityMinMax.
+ */
+std::pair<Scalarm, Scalarm> perFaceQualityMinMax(const CMeshO& mesh)
+{
+	return qualityMinMax(mesh.face);
+}
+
+} // namespace meshlab
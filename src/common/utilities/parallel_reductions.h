@@ -0,0 +1,121 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#ifndef MESHLAB_PARALLEL_REDUCTIONS_H
+#define MESHLAB_PARALLEL_REDUCTIONS_H
+
+#include "../ml_document/cmesh.h"
+
+#include <vcg/math/histogram.h>
+
+#include <utility>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/**
+ * Parallel versions of the whole mesh reductions that are recomputed very
+ * often: bounding box and normals (after almost every filter), quality range
+ * and histogram (every time a quality based filter or decoration starts).
+ *
+ * Each thread reduces a contiguous block of elements in a partial result and
+ * the partial results are merged in thread order, so the result does not
+ * depend on the scheduling. Deleted elements are skipped, as done by
+ * vcg::tri::Stat and vcg::tri::UpdateBounding.
+ */
+namespace meshlab {
+
+Box3m computeBoundingBox(const CMeshO& mesh);
+void updateBoxAndNormals(CMeshO& mesh);
+
+std::pair<Scalarm, Scalarm> perVertexQualityMinMax(const CMeshO& mesh);
+std::pair<Scalarm, Scalarm> perFaceQualityMinMax(const CMeshO& mesh);
+
+/**
+ * vcg::Histogram that can accumulate a partial histogram computed with the
+ * same range and number of bins.
+ */
+template <class ScalarType>
+class MergeableHistogram : public vcg::Histogram<ScalarType>
+{
+public:
+	void Merge(const MergeableHistogram<ScalarType>& o)
+	{
+		assert(this->H.size() == o.H.size());
+		for (size_t i = 0; i < this->H.size(); ++i)
+			this->H[i] += o.H[i];
+		if (o.minElem < this->minElem) this->minElem = o.minElem;
+		if (o.maxElem > this->maxElem) this->maxElem = o.maxElem;
+		this->cnt += o.cnt;
+		this->sum += o.sum;
+		this->rms += o.rms;
+	}
+};
+
+/**
+ * @brief Fills the histogram h, set to the range [minv, maxv] with binNum
+ * bins, calling add(partial, i) for i in [0, n). Each thread adds its block
+ * of elements to a partial histogram, that is then merged in h: the
+ * HistogramType must provide SetRange and a Merge member (e.g.
+ * MergeableHistogram). The add function must skip the deleted elements.
+ */
+template <class HistogramType, class ScalarType, class AddFunction>
+void parallelHistogram(
+		HistogramType& h,
+		ScalarType     minv,
+		ScalarType     maxv,
+		int            binNum,
+		int            n,
+		AddFunction    add)
+{
+	h.SetRange(minv, maxv, binNum);
+	std::vector<HistogramType> partials;
+#pragma omp parallel
+	{
+#ifdef _OPENMP
+		const int t = omp_get_thread_num();
+		const int nt = omp_get_num_threads();
+#else
+		const int t = 0;
+		const int nt = 1;
+#endif
+#pragma omp single
+		partials.resize(nt);
+
+		HistogramType& partial = partials[t];
+		partial.SetRange(minv, maxv, binNum);
+		const int begin = (int) ((long long) n * t / nt);
+		const int end   = (int) ((long long) n * (t + 1) / nt);
+		for (int i = begin; i < end; ++i)
+			add(partial, i);
+	}
+	for (const HistogramType& partial : partials)
+		h.Merge(partial);
+}
+
+} // namespace meshlab
+
+#endif // MESHLAB_PARALLEL_REDUCTIONS_H
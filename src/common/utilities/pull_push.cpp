@@ -0,0 +1,354 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#include "pull_push.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESHLAB_PULL_PUSH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace meshlab {
+
+namespace {
+
+template<typename T>
+struct Accumulator
+{
+	typedef int Type;
+};
+
+template<>
+struct Accumulator<float>
+{
+	typedef float Type;
+};
+
+template<typename T>
+inline bool isBackground(const T* p, const T* bk)
+{
+	return p[0] == bk[0] && p[1] == bk[1] && p[2] == bk[2] && p[3] == bk[3];
+}
+
+template<typename T>
+inline void weightedMean(
+	T*       out,
+	const T* p0,
+	int      w0,
+	const T* p1,
+	int      w1,
+	const T* p2,
+	int      w2,
+	const T* p3,
+	int      w3)
+{
+	typedef typename Accumulator<T>::Type Acc;
+	const Acc tw = Acc(w0 + w1 + w2 + w3);
+	for (int c = 0; c < 4; ++c)
+		out[c] = T((Acc(p0[c]) * w0 + Acc(p1[c]) * w1 + Acc(p2[c]) * w2 + Acc(p3[c]) * w3) / tw);
+}
+
+#ifdef MESHLAB_PULL_PUSH_SSE2
+/*
+ * 8 bit pixels: when the sum of the weights is a power of two (up to 256,
+ * that is always the case for the mip averages of 4 pixels and for the inner
+ * pixels in the push phase), the four weighted pixels are accumulated in
+ * 16 bit lanes and divided with a shift. Same result of the scalar version.
+ */
+inline void weightedMean(
+	unsigned char*       out,
+	const unsigned char* p0,
+	int                  w0,
+	const unsigned char* p1,
+	int                  w1,
+	const unsigned char* p2,
+	int                  w2,
+	const unsigned char* p3,
+	int                  w3)
+{
+	const int tw = w0 + w1 + w2 + w3;
+	if (tw > 256 || (tw & (tw - 1)) != 0) {
+		weightedMean<unsigned char>(out, p0, w0, p1, w1, p2, w2, p3, w3);
+		return;
+	}
+	int shift = 0;
+	while ((1 << shift) < tw)
+		++shift;
+
+	int v0, v1, v2, v3;
+	std::memcpy(&v0, p0, 4);
+	std::memcpy(&v1, p1, 4);
+	std::memcpy(&v2, p2, 4);
+	std::memcpy(&v3, p3, 4);
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i a    = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, v1, v0), zero);
+	const __m128i b    = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, v3, v2), zero);
+	const __m128i wa   = _mm_set_epi16(w1, w1, w1, w1, w0, w0, w0, w0);
+	const __m128i wb   = _mm_set_epi16(w3, w3, w3, w3, w2, w2, w2, w2);
+
+	__m128i s = _mm_add_epi16(_mm_mullo_epi16(a, wa), _mm_mullo_epi16(b, wb));
+	s         = _mm_add_epi16(s, _mm_srli_si128(s, 8));
+	s         = _mm_srl_epi16(s, _mm_cvtsi32_si128(shift));
+	s         = _mm_packus_epi16(s, s);
+
+	const int r = _mm_cvtsi128_si32(s);
+	std::memcpy(out, &r, 4);
+}
+#endif
+
+/*
+ * pull: each pixel of the mip is the average of the non background pixels of
+ * the corresponding 2x2 block of the source; background if there are none.
+ */
+template<typename T>
+void pullLevel(
+	const T*    src,
+	std::size_t srcStride,
+	T*          mip,
+	int         mipWidth,
+	int         mipHeight,
+	std::size_t mipStride,
+	const T*    bk)
+{
+	#pragma omp parallel for schedule(static)
+	for (int y = 0; y < mipHeight; ++y) {
+		const T* r0  = src + (2 * y) * srcStride;
+		const T* r1  = r0 + srcStride;
+		T*       out = mip + y * mipStride;
+		for (int x = 0; x < mipWidth; ++x) {
+			const T* a  = r0 + 8 * x;
+			const T* b  = a + 4;
+			const T* c  = r1 + 8 * x;
+			const T* d  = c + 4;
+			const int wa = isBackground(a, bk) ? 0 : 1;
+			const int wb = isBackground(b, bk) ? 0 : 1;
+			const int wc = isBackground(c, bk) ? 0 : 1;
+			const int wd = isBackground(d, bk) ? 0 : 1;
+			if (wa + wb + wc + wd > 0)
+				weightedMean(out + 4 * x, a, wa, b, wb, c, wc, d, wd);
+			else
+				std::memcpy(out + 4 * x, bk, 4 * sizeof(T));
+		}
+	}
+}
+
+/*
+ * push: each background pixel of the image is interpolated from the four
+ * nearest pixels of the mip, with weights 9/16, 3/16, 3/16 and 1/16.
+ */
+template<typename T>
+void pushLevel(
+	T*          img,
+	int         width,
+	int         height,
+	std::size_t stride,
+	const T*    mip,
+	int         mipWidth,
+	int         mipHeight,
+	std::size_t mipStride,
+	const T*    bk)
+{
+	#pragma omp parallel for schedule(static)
+	for (int y = 0; y < mipHeight; ++y) {
+		for (int dy = 0; dy < 2; ++dy) {
+			T*         row  = img + (2 * y + dy) * stride;
+			const int  ny   = dy == 0 ? y - 1 : y + 1;
+			const bool vy   = ny >= 0 && ny < mipHeight;
+			const T*   m0   = mip + y * mipStride;
+			const T*   m1   = vy ? mip + ny * mipStride : m0;
+			for (int x = 0; x < mipWidth; ++x) {
+				for (int dx = 0; dx < 2; ++dx) {
+					T* p = row + 4 * (2 * x + dx);
+					if (!isBackground(p, bk))
+						continue;
+					const int  nx = dx == 0 ? x - 1 : x + 1;
+					const bool vx = nx >= 0 && nx < mipWidth;
+					const T*   c  = m0 + 4 * x;
+					weightedMean(
+						p,
+						c, 144,
+						vx ? m0 + 4 * nx : c, vx ? 48 : 0,
+						vy ? m1 + 4 * x : c, vy ? 48 : 0,
+						(vx && vy) ? m1 + 4 * nx : c, (vx && vy) ? 16 : 0);
+				}
+			}
+		}
+	}
+
+	// avoid background bleeding on odd sized images: the last column and
+	// row are not covered by the mip
+	if (width > 2 * mipWidth) {
+		#pragma omp parallel for schedule(static)
+		for (int y = 0; y < height; ++y) {
+			T* row = img + y * stride;
+			for (int x = std::max(2 * mipWidth, 1); x < width; ++x)
+				if (isBackground(row + 4 * x, bk))
+					std::memcpy(row + 4 * x, row + 4 * (x - 1), 4 * sizeof(T));
+		}
+	}
+	for (int y = std::max(2 * mipHeight, 1); y < height; ++y) {
+		T*       row  = img + y * stride;
+		const T* prev = row - stride;
+		#pragma omp parallel for schedule(static)
+		for (int x = 0; x < width; ++x)
+			if (isBackground(row + 4 * x, bk))
+				std::memcpy(row + 4 * x, prev + 4 * x, 4 * sizeof(T));
+	}
+}
+
+template<typename T>
+void pullPushImpl(T* data, int width, int height, std::size_t stride, const T* bk)
+{
+	if (data == nullptr || width < 2 || height < 2)
+		return;
+
+	struct Level
+	{
+		std::vector<T> pixels;
+		int            width;
+		int            height;
+	};
+	std::vector<Level> mips;
+
+	// pull phase: build the weighted mip pyramid, down to a single row/column
+	const T*    src       = data;
+	std::size_t srcStride = stride;
+	int         w         = width;
+	int         h         = height;
+	while (true) {
+		Level l;
+		l.width  = w / 2;
+		l.height = h / 2;
+		l.pixels.resize(std::size_t(l.width) * l.height * 4);
+		pullLevel(src, srcStride, l.pixels.data(), l.width, l.height, std::size_t(l.width) * 4, bk);
+		mips.push_back(std::move(l));
+
+		const Level& last = mips.back();
+		if (last.width <= 1 || last.height <= 1)
+			break;
+		src       = last.pixels.data();
+		srcStride = std::size_t(last.width) * 4;
+		w         = last.width;
+		h         = last.height;
+	}
+
+	// push phase: refill each level from the coarser one
+	for (int i = (int) mips.size() - 1; i >= 0; --i) {
+		const Level& m = mips[i];
+		if (i > 0) {
+			Level& t = mips[i - 1];
+			pushLevel(
+				t.pixels.data(), t.width, t.height, std::size_t(t.width) * 4,
+				m.pixels.data(), m.width, m.height, std::size_t(m.width) * 4, bk);
+		}
+		else {
+			pushLevel(
+				data, width, height, stride,
+				m.pixels.data(), m.width, m.height, std::size_t(m.width) * 4, bk);
+		}
+	}
+}
+
+} // namespace
+
+void pullPush(QImage& image, QRgb background)
+{
+	if (image.isNull())
+		return;
+
+	switch (image.format()) {
+	case QImage::Format_RGB32:
+		if (qAlpha(background) != 255) // opaque image: there are no background pixels
+			return;
+		// fallthrough
+	case QImage::Format_ARGB32:
+	case QImage::Format_ARGB32_Premultiplied: {
+		const quint32 c = image.format() == QImage::Format_ARGB32_Premultiplied ?
+							  qPremultiply(background) :
+							  background;
+		unsigned char bk[4];
+		std::memcpy(bk, &c, 4);
+		pullPush(image.bits(), image.width(), image.height(), image.bytesPerLine(), bk);
+	} break;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+	case QImage::Format_RGBX64:
+		if (qAlpha(background) != 255)
+			return;
+		// fallthrough
+	case QImage::Format_RGBA64:
+	case QImage::Format_RGBA64_Premultiplied: {
+		QRgba64 c = QRgba64::fromArgb32(background);
+		if (image.format() == QImage::Format_RGBA64_Premultiplied)
+			c = c.premultiplied();
+		const quint64  v = c;
+		unsigned short bk[4];
+		std::memcpy(bk, &v, 8);
+		pullPush(
+			reinterpret_cast<unsigned short*>(image.bits()),
+			image.width(),
+			image.height(),
+			image.bytesPerLine() / sizeof(unsigned short),
+			bk);
+	} break;
+#endif
+	default: {
+		const QImage::Format format = image.format();
+		QImage argb = image.convertToFormat(QImage::Format_ARGB32);
+		pullPush(argb, background);
+		image = argb.convertToFormat(format);
+	}
+	}
+}
+
+void pullPush(
+	unsigned char*      data,
+	int                 width,
+	int                 height,
+	std::size_t         stride,
+	const unsigned char background[4])
+{
+	pullPushImpl(data, width, height, stride, background);
+}
+
+void pullPush(
+	unsigned short*      data,
+	int                  width,
+	int                  height,
+	std::size_t          stride,
+	const unsigned short background[4])
+{
+	pullPushImpl(data, width, height, stride, background);
+}
+
+void pullPush(float* data, int width, int height, std::size_t stride, const float background[4])
+{
+	pullPushImpl(data, width, height, stride, background);
+}
+
+} // namespace meshlab
@@ -0,0 +1,73 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#ifndef MESHLAB_PULL_PUSH_H
+#define MESHLAB_PULL_PUSH_H
+
+#include <cstddef>
+#include <QImage>
+
+namespace meshlab {
+
+/**
+ * Pull-push hole filling.
+ *
+ * All the pixels equal to the background color are filled by interpolating
+ * the surrounding non-background pixels: a weighted mip pyramid of the image
+ * is built ignoring the background pixels (pull) and then the holes of each
+ * level are filled from the coarser one (push).
+ *
+ * The images are processed directly on their scanlines: rows are processed in
+ * parallel and the weighted averages of 8 bit images are computed with SSE2
+ * when available.
+ */
+
+// 8 bit (A)RGB32 images are processed in place, 64 bit RGBA images (Qt >= 5.12)
+// with 16 bit channels, the other formats are converted to ARGB32 and back.
+void pullPush(QImage& image, QRgb background);
+
+// raw buffers of 4 channel pixels; stride is the distance between two rows,
+// expressed in number of channels (not bytes).
+void pullPush(
+	unsigned char*       data,
+	int                  width,
+	int                  height,
+	std::size_t          stride,
+	const unsigned char  background[4]);
+void pullPush(
+	unsigned short*      data,
+	int                  width,
+	int                  height,
+	std::size_t          stride,
+	const unsigned short background[4]);
+void pullPush(
+	float*               data,
+	int                  width,
+	int                  height,
+	std::size_t          stride,
+	const float          background[4]);
+
+} // namespace meshlab
+
+#endif // MESHLAB_PULL_PUSH_H
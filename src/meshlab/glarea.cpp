@@ -64,6 +64,9 @@ GLArea::GLArea(QWidget *parent, MultiViewer_Container *mvcont, RichParameterList
     lastModelEdited = 0;
     cfps=0;
     lastTime=0;
+    lastFullFrameTime=0;
+    lodPixelError=glas.lodPixelError;
+    lodFrame=false;
     hasToPick=false;
     hasToSelectMesh=false;
     hasToGetPickPos=false;
@@ -440,6 +443,7 @@ void GLArea::paintEvent(QPaintEvent* /*event*/)
 
     QElapsedTimer time;
     time.start();
+    lodFrame = false;
 
     /*if(!this->md()->isBusy())
     {
@@ -517,10 +521,17 @@ void GLArea::paintEvent(QPaintEvent* /*event*/)
             if (datacont == NULL)
                 return;
 
+            // while navigating, if the last full resolution frame exceeded the budget, draw the level of detail proxies
+            bool navigating = (QApplication::mouseButtons() != Qt::NoButton) || (animMode != AnimNone);
+            lodFrame = glas.viewDependentLOD && navigating && (lastFullFrameTime > glas.lodFrameBudget);
+
             for(const MeshModel& mp : md()->meshIterator())
             {
                 if (meshVisibilityMap[mp.id()])
                 {
+                    if (glas.viewDependentLOD && datacont->isMeshOutsideViewFrustum(mp.id()))
+                        continue;
+
                     MLRenderingData curr;
                     datacont->getRenderInfoPerMeshView(mp.id(),context(),curr);
                     MLPerViewGLOptions opts;
@@ -535,7 +546,10 @@ void GLArea::paintEvent(QPaintEvent* /*event*/)
                         glDisable(GL_CULL_FACE);
 
                     datacont->setMeshTransformationMatrix(mp.id(),mp.cm.Tr);
-                    datacont->draw(mp.id(),context());
+                    if (lodFrame)
+                        datacont->drawLOD(mp.id(), context(), lodPixelError);
+                    else
+                        datacont->draw(mp.id(),context());
                 }
             }
             for(MeshModel& mp : md()->meshIterator())
@@ -673,9 +687,25 @@ void GLArea::paintEvent(QPaintEvent* /*event*/)
     glFinish();
     painter.endNativePainting();
 
+    updateLODFrameTime(time.elapsed());
     emit currentViewerRefreshed();
 }
 
+// Adapts the screen space error of the level of detail proxies to the frame time budget:
+// the error grows while the proxies are too slow to draw and goes back to the user value otherwise.
+void GLArea::updateLODFrameTime(float frameTime)
+{
+    if (!lodFrame) {
+        lastFullFrameTime = frameTime;
+        lodPixelError = glas.lodPixelError;
+        return;
+    }
+    if (frameTime > glas.lodFrameBudget)
+        lodPixelError = std::min<float>(lodPixelError * 1.5f, 64.0f);
+    else
+        lodPixelError = std::max<float>(lodPixelError / 1.2f, glas.lodPixelError);
+}
+
 void GLArea::displayMatrix(QPainter *painter, QRect areaRect)
 {
 	makeCurrent();
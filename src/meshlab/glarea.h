@@ -506,6 +506,12 @@ private:
     float cfps;
     float lastTime;
 
+    // view dependent level of detail state
+    float lastFullFrameTime;
+    float lodPixelError;
+    bool lodFrame;
+    void updateLODFrameTime(float frameTime);
+
     QImage snapBuffer;
     bool takeSnapTile;
 
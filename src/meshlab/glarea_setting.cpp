@@ -30,6 +30,10 @@ void GLAreaSetting::initGlobalParameterList(RichParameterList& defaultGlobalPara
 	defaultGlobalParamSet.addParam(RichBool(wheelDirectionParam(), false, "Wheel Direction", "If true, inverts the direction of the mouse wheel for zooming in/out in the MeshLab canvas."));
 	defaultGlobalParamSet.addParam(RichBool(showTrackballParam(), true, "Show Trackball", "If true, show the trackball on startup."));
 	defaultGlobalParamSet.addParam(RichInt(matrixDecimalPrecisionParam(), 2, "Rotation Matrix Precision", "Number of decimal values shown in the rotation matrix"));
+
+	defaultGlobalParamSet.addParam(RichBool(viewDependentLODParam(), false, "View Dependent LOD", "If true, meshes outside the view frustum are not drawn and, while navigating, meshes that cannot be drawn within the frame time budget are replaced by a view dependent level of detail proxy."));
+	defaultGlobalParamSet.addParam(RichInt(lodFrameBudgetParam(), 40, "LOD Frame Time Budget", "Time in milliseconds that a frame can take while navigating before switching to the level of detail proxies."));
+	defaultGlobalParamSet.addParam(RichFloat(lodPixelErrorParam(), 2.0, "LOD Pixel Error", "Maximum screen space error, in pixels, of the level of detail proxies. It is automatically increased when the frame time budget is exceeded."));
 }
 
 
@@ -56,5 +60,8 @@ void GLAreaSetting::updateGlobalParameterSet( const RichParameterList& rps )
 	wheelDirection = rps.getBool(this->wheelDirectionParam());
         startupShowTrackball = rps.getBool(showTrackballParam());
 	matrixDecimalPrecision = rps.getInt(this->matrixDecimalPrecisionParam());
+	viewDependentLOD = rps.getBool(this->viewDependentLODParam());
+	lodFrameBudget = rps.getInt(this->lodFrameBudgetParam());
+	lodPixelError = rps.getFloat(this->lodPixelErrorParam());
 	currentGlobalParamSet=&rps;
 }
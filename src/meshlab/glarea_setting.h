@@ -75,6 +75,13 @@ public:
 	int matrixDecimalPrecision;
 	inline static QString matrixDecimalPrecisionParam() {return "MeshLab::Appearance::matrixDecimalPrecision";}
 
+	bool viewDependentLOD;
+	inline static QString viewDependentLODParam() {return "MeshLab::Appearance::viewDependentLOD";}
+	int lodFrameBudget;
+	inline static QString lodFrameBudgetParam() {return "MeshLab::Appearance::lodFrameBudget";}
+	Scalarm lodPixelError;
+	inline static QString lodPixelErrorParam() {return "MeshLab::Appearance::lodPixelError";}
+
 
 	void updateGlobalParameterSet(const RichParameterList& rps );
 	static void initGlobalParameterList(RichParameterList& defaultGlobalParamSet);
@@ -86,6 +86,9 @@ public:
 
 	std::ptrdiff_t maxTextureMemory;
 	inline static QString maxTextureMemoryParam()  {return "MeshLab::System::maxTextureMemory"; }
+
+	bool lazyTextureDecoding;
+	inline static QString lazyTextureDecodingParam() {return "MeshLab::System::lazyTextureDecoding"; }
 	  
 	int startupWindowWidth;
 	inline static QString startupWindowWidthParam() {return "MeshLab::System::startupWindowWidth"; }
@@ -101,6 +104,12 @@ public:
 
 	bool sendAnonymousData;
 	inline static QString sendAnonymousDataParam() {return "MeshLab::System::sendAnonymousData"; }
+
+	bool profileFilters;
+	inline static QString profileFiltersParam() {return "MeshLab::System::profileFilters"; }
+
+	QString profileOutputDirectory;
+	inline static QString profileOutputDirectoryParam() {return "MeshLab::System::profileOutputDirectory"; }
 };
 
 class MainWindow : public QMainWindow
@@ -531,6 +540,8 @@ private:
 	static QString getDecoratedFileName(const QString& name);
 
 	MultiViewer_Container* _currviewcontainer;
+	MLPerformanceProfiler filterProfiler;
+	void finalizeFilterProfile(const QString& filterName);
 };
 
 /// Event filter that is installed to intercept the open events sent directly by the Operative System
@@ -1275,12 +1275,15 @@ void MainWindowSetting::initGlobalParameterList(RichParameterList& gbllist)
 	if (MeshLabScalarTest<Scalarm>::doublePrecision())
 		gbllist.addParam(RichBool(highPrecisionRendering(), false, "High Precision Rendering", "If true all the models in the scene will be rendered at the center of the world"));
 	gbllist.addParam(RichInt(maxTextureMemoryParam(), 256, "Max Texture Memory (in MB)", "The maximum quantity of texture memory allowed to load mesh textures"));
+	gbllist.addParam(RichBool(lazyTextureDecodingParam(), false, "Lazy Texture Decoding", "If true, the texture files (in the formats natively supported by Qt) are only read when a mesh is loaded, and decoded the first time they are used. Meshes with many textures open faster, and unused textures are never decoded."));
 
 	gbllist.addParam(RichInt(startupWindowWidthParam(), 0, "Startup Window Width (in pixels)", "Window width on startup"));
 	gbllist.addParam(RichInt(startupWindowHeightParam(), 0, "Startup Window Height (in pixels)", "Window height on startup"));
 	gbllist.addParam(RichString(meshSetNameParam(), "ms", "Name of the MeshSet object.", "Set the MeshSet name object in the PyMeshLab call copied in the clipboard from the filter dock dialog."));
 	gbllist.addParam(RichBool(checkForUpdateParam(), true, "Automatic online check for updated version of MeshLab", "If true, MeshLab periodically will check online if a new version has been released"));
 	gbllist.addParam(RichBool(sendAnonymousDataParam(), true, "Send anonymous and aggregate statistics", "If true, MeshLab periodically will send a few aggregated statistic of usage (number of opened and saved mesh and total number of vertices loaded)"));
+	gbllist.addParam(RichBool(profileFiltersParam(), false, "Profile filter execution", "If true, after each filter a summary of the time spent in each phase (requirements, filter body, compaction, GPU refresh and the timers set by the plugin) and of the resident memory high-water mark is written in the log."));
+	gbllist.addParam(RichString(profileOutputDirectoryParam(), "", "Filter profile output directory", "If not empty and filter profiling is enabled, a JSON summary and a Chrome trace (chrome://tracing) of each filter execution are saved in this directory."));
 }
 
 void MainWindowSetting::updateGlobalParameterList(const RichParameterList& rpl)
@@ -1292,11 +1295,14 @@ void MainWindowSetting::updateGlobalParameterList(const RichParameterList& rpl)
 	if (MeshLabScalarTest<Scalarm>::doublePrecision())
 		highprecision = rpl.getBool(highPrecisionRendering());
 	maxTextureMemory = (std::ptrdiff_t) rpl.getInt(this->maxTextureMemoryParam()) * (float)(1024 * 1024);
+	lazyTextureDecoding = rpl.getBool(lazyTextureDecodingParam());
 	startupWindowWidth = rpl.getInt(startupWindowWidthParam());
 	startupWindowHeight = rpl.getInt(startupWindowHeightParam());
 	meshSetName = rpl.getString(meshSetNameParam());
 	checkForUpdate = rpl.getBool(checkForUpdateParam());
 	sendAnonymousData = rpl.getBool(sendAnonymousDataParam());
+	profileFilters = rpl.getBool(profileFiltersParam());
+	profileOutputDirectory = rpl.getString(profileOutputDirectoryParam());
 }
 
 void MainWindow::defaultPerViewRenderingData(MLRenderingData& dt) const
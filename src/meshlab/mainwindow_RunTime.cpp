@@ -40,6 +40,7 @@
 #include <QSignalMapper>
 #include <QMessageBox>
 #include <QElapsedTimer>
+#include <QDateTime>
 #include <QMimeData>
 
 #include <common/mlapplication.h>
@@ -103,6 +104,7 @@ void MainWindow::updateRecentProjActions()
 void MainWindow::updateCustomSettings()
 {
 	mwsettings.updateGlobalParameterList(currentGlobalParams);
+	MeshModel::setLazyTextureDecoding(mwsettings.lazyTextureDecoding);
 	emit dispatchCustomSettings(currentGlobalParams);
 }
 
@@ -679,10 +681,16 @@ void MainWindow::runFilterScript()
 			QAction *action = PM.filterAction(filterName);
 			FilterPlugin *iFilter = qobject_cast<FilterPlugin *>(action->parent());
 
+			iFilter->setLog(&meshDoc()->Log);
+			filterProfiler.setEnabled(mwsettings.profileFilters);
+			filterProfiler.start(filterName.toStdString());
+			iFilter->setProfiler(&filterProfiler);
+
 			int req=iFilter->getRequirements(action);
-			if (meshDoc()->mm() != NULL)
+			if (meshDoc()->mm() != NULL) {
+				auto reqTimer = filterProfiler.scopedTimer("updateDataMask", "meshlab");
 				meshDoc()->mm()->updateDataMask(req);
-			iFilter->setLog(&meshDoc()->Log);
+			}
 
 			bool created = false;
 			MLSceneGLSharedDataContext* shar = NULL;
@@ -722,17 +730,24 @@ void MainWindow::runFilterScript()
 			if ((!created) || (!iFilter->glContext->isValid()))
 				throw MLException("A valid GLContext is required by the filter to work.\n");
 			meshDoc()->setBusy(true);
-			iFilter->applyFilter(action, pair.second, *meshDoc(), postCondMask, QCallBack);
+			{
+				auto bodyTimer = filterProfiler.scopedTimer("applyFilter", "meshlab");
+				iFilter->applyFilter(action, pair.second, *meshDoc(), postCondMask, QCallBack);
+			}
 			if (postCondMask == MeshModel::MM_UNKNOWN)
 				postCondMask = iFilter->postCondition(action);
-			for (MeshModel* mm = meshDoc()->nextMesh(); mm != NULL; mm = meshDoc()->nextMesh(mm))
-				vcg::tri::Allocator<CMeshO>::CompactEveryVector(mm->cm);
+			{
+				auto compactTimer = filterProfiler.scopedTimer("compactEveryVector", "meshlab");
+				for (MeshModel* mm = meshDoc()->nextMesh(); mm != NULL; mm = meshDoc()->nextMesh(mm))
+					vcg::tri::Allocator<CMeshO>::CompactEveryVector(mm->cm);
+			}
 			meshDoc()->setBusy(false);
 			if (shar != NULL)
 				shar->removeView(iFilter->glContext);
 			delete iFilter->glContext;
 			classes = int(iFilter->getClass(action));
 
+			auto postMaskTimer = filterProfiler.scopedTimer("updateDataMask (post)", "meshlab");
 			if (meshDoc()->mm() != NULL)
 			{
 				if(classes & FilterPlugin::FaceColoring )
@@ -754,8 +769,13 @@ void MainWindow::runFilterScript()
 			bool newmeshcreated = false;
 			if (classes & FilterPlugin::MeshCreation)
 				newmeshcreated = true;
-			updateSharedContextDataAfterFilterExecution(postCondMask, classes, newmeshcreated);
+			postMaskTimer.stop();
+			{
+				auto gpuTimer = filterProfiler.scopedTimer("GPU refresh", "meshlab");
+				updateSharedContextDataAfterFilterExecution(postCondMask, classes, newmeshcreated);
+			}
 			meshDoc()->meshDocStateData().clear();
+			finalizeFilterProfile(filterName);
 
 			if(classes & FilterPlugin::MeshCreation)
 				GLA()->resetTrackBall();
@@ -912,6 +932,9 @@ void MainWindow::updateSharedContextDataAfterFilterExecution(int postcondmask,in
 						connectivitychanged = true;
 					}
 
+					//0) the caches of data derived from the updated attributes (e.g. decoration statistics) are invalidated
+					mm->markAttributesChanged(connectivitychanged ? int(MeshModel::MM_ALL) : updatemask);
+
 					MLRenderingData::RendAtts dttoupdate;
 					//1) we convert the meshmodel updating mask to a RendAtts structure
 					MLPoliciesStandAloneFunctions::fromMeshModelMaskToMLRenderingAtts(updatemask,dttoupdate);
@@ -1021,14 +1044,19 @@ void MainWindow::executeFilter(
 	FilterPlugin *iFilter = qobject_cast<FilterPlugin *>(action->parent());
 	qb->show();
 	iFilter->setLog(&meshDoc()->Log);
+	filterProfiler.setEnabled(mwsettings.profileFilters && !isPreview);
+	filterProfiler.start(action->text().toStdString());
+	iFilter->setProfiler(&filterProfiler);
 	
 	// Ask for filter requirements (eg a filter can need topology, border flags etc)
 	// and satisfy them
 	qApp->setOverrideCursor(QCursor(Qt::WaitCursor));
 	MainWindow::globalStatusBar()->showMessage("Starting Filter...",5000);
 	int req=iFilter->getRequirements(action);
-	if (!(meshDoc()->meshNumber() == 0))
+	if (!(meshDoc()->meshNumber() == 0)) {
+		auto reqTimer = filterProfiler.scopedTimer("updateDataMask", "meshlab");
 		meshDoc()->mm()->updateDataMask(req);
+	}
 	qApp->restoreOverrideCursor();
 	
 	// (3) save the current filter and its parameters in the history
@@ -1081,11 +1109,17 @@ void MainWindow::executeFilter(
 		meshDoc()->meshDocStateData().clear();
 		meshDoc()->meshDocStateData().create(*meshDoc());
 		unsigned int postCondMask = MeshModel::MM_UNKNOWN;
-		iFilter->applyFilter(action, mergedenvironment, *(meshDoc()), postCondMask, QCallBack);
+		{
+			auto bodyTimer = filterProfiler.scopedTimer("applyFilter", "meshlab");
+			iFilter->applyFilter(action, mergedenvironment, *(meshDoc()), postCondMask, QCallBack);
+		}
 		if (postCondMask == MeshModel::MM_UNKNOWN)
 			postCondMask = iFilter->postCondition(action);
-		for (MeshModel& mm : meshDoc()->meshIterator())
-			vcg::tri::Allocator<CMeshO>::CompactEveryVector(mm.cm);
+		{
+			auto compactTimer = filterProfiler.scopedTimer("compactEveryVector", "meshlab");
+			for (MeshModel& mm : meshDoc()->meshIterator())
+				vcg::tri::Allocator<CMeshO>::CompactEveryVector(mm.cm);
+		}
 		
 		if (shar != NULL) {
 			shar->removeView(iFilter->glContext);
@@ -1148,6 +1182,7 @@ void MainWindow::executeFilter(
 		if(iFilter->getClass(action) & FilterPlugin::MeshCreation )
 			GLA()->resetTrackBall();
 		
+		auto postMaskTimer = filterProfiler.scopedTimer("updateDataMask (post)", "meshlab");
 		for(int jj = 0;jj < tmp.size();++jj) {
 			MeshModel* mm = tmp[jj];
 			if (mm != NULL) {
@@ -1172,8 +1207,13 @@ void MainWindow::executeFilter(
 		int fclasses =	iFilter->getClass(action);
 		//MLSceneGLSharedDataContext* sharedcont = GLA()->getSceneGLSharedContext();
 		
-		updateSharedContextDataAfterFilterExecution(postCondMask,fclasses,newmeshcreated);
+		postMaskTimer.stop();
+		{
+			auto gpuTimer = filterProfiler.scopedTimer("GPU refresh", "meshlab");
+			updateSharedContextDataAfterFilterExecution(postCondMask,fclasses,newmeshcreated);
+		}
 		meshDoc()->meshDocStateData().clear();
+		finalizeFilterProfile(action->text());
 
 		if (saveOnHistory){
 			//Insert the filter to filterHistory
@@ -1215,6 +1255,35 @@ void MainWindow::executeFilter(
 	}
 }
 
+/*
+Closes the current filter profile (if profiling is enabled), writes its summary in the log
+and, if an output directory has been set, saves it as JSON summary and Chrome trace.
+*/
+void MainWindow::finalizeFilterProfile(const QString& filterName)
+{
+	if (!filterProfiler.isEnabled())
+		return;
+	filterProfiler.stop();
+	meshDoc()->Log.log(GLLogStream::SYSTEM, "Profile " + filterProfiler.summary());
+
+	if (mwsettings.profileOutputDirectory.isEmpty())
+		return;
+	QDir dir(mwsettings.profileOutputDirectory);
+	if (!dir.exists() && !dir.mkpath(".")) {
+		meshDoc()->Log.logf(GLLogStream::WARNING, "Unable to create profile directory %s", qUtf8Printable(dir.path()));
+		return;
+	}
+	QString baseName = filterName;
+	baseName.replace(QRegExp("[^A-Za-z0-9_-]+"), "_");
+	baseName += "_" + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss_zzz");
+	QString jsonFile = dir.filePath(baseName + ".json");
+	QString traceFile = dir.filePath(baseName + ".trace.json");
+	if (filterProfiler.saveJson(jsonFile) && filterProfiler.saveChromeTrace(traceFile))
+		meshDoc()->Log.logf(GLLogStream::SYSTEM, "Filter profile saved in %s", qUtf8Printable(traceFile));
+	else
+		meshDoc()->Log.logf(GLLogStream::WARNING, "Unable to save filter profile in %s", qUtf8Printable(dir.path()));
+}
+
 // Edit Mode Management
 // At any point there can be a single editing plugin active.
 // When a plugin is active it intercept the mouse actions.
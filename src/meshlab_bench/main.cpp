@@ -0,0 +1,441 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+/*
+ * meshlab_bench: headless benchmark of a set of representative filters.
+ *
+ * Each benchmark case loads one or more sample meshes, optionally upscales
+ * them with midpoint subdivision, and then applies a filter (through the
+ * PluginManager, exactly as MeshLab does) a given number of times.
+ * Loading and upscaling are not timed. The results (timings, throughput
+ * expressed as input primitives per second, resident memory high-water mark)
+ * are printed in JSON or CSV.
+ */
+
+#include <common/globals.h>
+#include <common/mlapplication.h>
+#include <common/mlexception.h>
+#include <common/ml_performance_profiler.h>
+#include <common/parameters/rich_parameters.h>
+#include <common/plugins/plugin_manager.h>
+#include <common/utilities/load_save.h>
+
+#include <vcg/complex/algorithms/refine.h>
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+
+#include <algorithm>
+#include <clocale>
+#include <iostream>
+#include <numeric>
+
+namespace {
+
+struct BenchCase
+{
+	QString                  name;
+	QString                  filter;   // display or python name of the filter
+	QStringList              meshes;   // sample files, relative to the sample dir
+	int                      upscale;  // number of midpoint subdivision steps
+	std::map<QString, QString> params; // parameter overrides
+};
+
+/* the default set of cases; the upscaled ones are the "synthetic" large inputs */
+std::vector<BenchCase> defaultCases()
+{
+	return {
+		{"quadric_simplification", "Simplification: Quadric Edge Collapse Decimation",
+		 {"bunny70k.ply"}, 1, {{"TargetPerc", "0.1"}}},
+		{"poisson_disk_sampling", "Poisson-disk Sampling",
+		 {"bunny70k.ply"}, 0, {{"SampleNum", "20000"}}},
+		{"hausdorff_distance", "Hausdorff Distance",
+		 {"bunny10k.ply", "bunny70k.ply"}, 0, {{"SampledMesh", "0"}, {"TargetMesh", "1"}}},
+		{"screened_poisson", "Surface Reconstruction: Screened Poisson",
+		 {"bunny70k.ply"}, 0, {{"depth", "8"}}},
+		{"remove_duplicate_vertices", "Remove Duplicate Vertices",
+		 {"Laurana50k.ply"}, 2, {}},
+		{"remove_unreferenced_vertices", "Remove Unreferenced Vertices",
+		 {"Laurana50k.ply"}, 2, {}},
+		{"laplacian_smooth", "Laplacian Smooth",
+		 {"Laurana50k.ply"}, 1, {}},
+		{"taubin_smooth", "Taubin Smooth",
+		 {"Laurana50k.ply"}, 1, {}},
+	};
+}
+
+QAction* findFilter(PluginManager& pm, const QString& name, FilterPlugin*& plugin)
+{
+	QAction* act = pm.filterAction(name);
+	if (act != nullptr) {
+		plugin = pm.getFilterPluginFromAction(act);
+		return act;
+	}
+	for (FilterPlugin* fp : pm.filterPluginIterator()) {
+		for (QAction* a : fp->actions()) {
+			if (fp->pythonFilterName(a) == name) {
+				plugin = fp;
+				return a;
+			}
+		}
+	}
+	plugin = nullptr;
+	return nullptr;
+}
+
+/* sets the value of a parameter from its textual representation, according to its type */
+void setParameterFromString(RichParameterList& params, const QString& name, const QString& value)
+{
+	auto it = params.findParameter(name);
+	if (it == params.end())
+		throw MLException("Unknown parameter " + name);
+	const Value& v = it->value();
+	if (v.isBool())
+		it->setValue(BoolValue(value == "1" || value.toLower() == "true"));
+	else if (v.isInt())
+		it->setValue(IntValue(value.toInt()));
+	else if (v.isFloat())
+		it->setValue(FloatValue(value.toFloat()));
+	else if (v.isString())
+		it->setValue(StringValue(value));
+	else
+		throw MLException("Parameter " + name + " cannot be set from the command line");
+}
+
+void upscaleMesh(MeshModel& m, int steps)
+{
+	if (steps <= 0)
+		return;
+	m.updateDataMask(MeshModel::MM_FACEFACETOPO);
+	for (int i = 0; i < steps; ++i) {
+		vcg::tri::UpdateTopology<CMeshO>::FaceFace(m.cm);
+		vcg::tri::Refine<CMeshO, vcg::tri::MidPoint<CMeshO>>(
+			m.cm, vcg::tri::MidPoint<CMeshO>(&m.cm), 0, false);
+	}
+	vcg::tri::Allocator<CMeshO>::CompactEveryVector(m.cm);
+	m.clearDataMask(MeshModel::MM_FACEFACETOPO);
+	m.updateBoxAndNormals();
+}
+
+QJsonObject runCase(
+	const BenchCase& bc,
+	const QDir&      sampleDir,
+	int              repeat,
+	int              extraUpscale,
+	const QString&   traceDir)
+{
+	QJsonObject res;
+	res["case"] = bc.name;
+	res["filter"] = bc.filter;
+	res["meshes"] = QJsonArray::fromStringList(bc.meshes);
+	res["upscale"] = bc.upscale + extraUpscale;
+
+	PluginManager& pm = meshlab::pluginManagerInstance();
+	FilterPlugin* plugin = nullptr;
+	QAction* action = findFilter(pm, bc.filter, plugin);
+	if (action == nullptr) {
+		res["status"] = "filter not found";
+		return res;
+	}
+	if (plugin->requiresGLContext(action)) {
+		res["status"] = "skipped: requires an OpenGL context";
+		return res;
+	}
+
+	std::vector<double> times;
+	std::size_t peakRSS = 0;
+	long long inputVertices = 0, inputFaces = 0, outputVertices = 0, outputFaces = 0;
+	MLPerformanceProfiler profiler;
+	profiler.setEnabled(true);
+
+	try {
+		for (int r = 0; r < repeat; ++r) {
+			MeshDocument md;
+			std::vector<MeshModel*> meshes;
+			for (const QString& f : bc.meshes) {
+				std::list<MeshModel*> loaded =
+					meshlab::loadMeshWithStandardParameters(sampleDir.filePath(f), md);
+				for (MeshModel* m : loaded) {
+					upscaleMesh(*m, bc.upscale + extraUpscale);
+					meshes.push_back(m);
+				}
+			}
+			if (meshes.empty())
+				throw MLException("No mesh loaded");
+			md.setCurrentMesh(meshes.back()->id());
+
+			inputVertices = inputFaces = 0;
+			for (const MeshModel* m : meshes) {
+				inputVertices += m->cm.vn;
+				inputFaces += m->cm.fn;
+			}
+
+			RichParameterList params = plugin->initParameterList(action, md);
+			for (const auto& p : bc.params) {
+				QString value = p.second;
+				// mesh parameters are given as indices in the list of loaded meshes
+				auto it = params.findParameter(p.first);
+				if (it != params.end() && it->isOfType<RichMesh>()) {
+					int idx = value.toInt();
+					if (idx < 0 || idx >= (int) meshes.size())
+						throw MLException("Invalid mesh index for " + p.first);
+					value = QString::number(meshes[idx]->id());
+				}
+				setParameterFromString(params, p.first, value);
+			}
+			params.join(meshlab::defaultGlobalParameterList());
+
+			md.mm()->updateDataMask(plugin->getRequirements(action));
+			plugin->setLog(&md.Log);
+			plugin->setProfiler(&profiler);
+
+			profiler.start(bc.name.toStdString());
+			unsigned int postCondMask = MeshModel::MM_UNKNOWN;
+			{
+				auto timer = profiler.scopedTimer("applyFilter", "bench");
+				plugin->applyFilter(action, params, md, postCondMask, nullptr);
+			}
+			profiler.stop();
+			plugin->setProfiler(nullptr);
+
+			for (const MLPerformanceProfiler::Event& e : profiler.events())
+				if (e.name == "applyFilter" && e.category == "bench")
+					times.push_back(e.durationUs / 1000.0);
+			peakRSS = std::max(peakRSS, profiler.peakResidentMemoryDuringRun());
+
+			outputVertices = outputFaces = 0;
+			for (const MeshModel& m : md.meshIterator()) {
+				outputVertices += m.cm.vn;
+				outputFaces += m.cm.fn;
+			}
+
+			if (!traceDir.isEmpty() && r == 0)
+				profiler.saveChromeTrace(QDir(traceDir).filePath(bc.name + ".trace.json"));
+		}
+	}
+	catch (const MLException& e) {
+		res["status"] = QString("failed: ") + e.what();
+		return res;
+	}
+	catch (const std::bad_alloc&) {
+		res["status"] = "failed: out of memory";
+		return res;
+	}
+
+	std::sort(times.begin(), times.end());
+	double mean = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+	double median = times.size() % 2 == 1 ?
+		times[times.size() / 2] :
+		(times[times.size() / 2 - 1] + times[times.size() / 2]) / 2;
+
+	res["status"] = "ok";
+	res["runs"] = (int) times.size();
+	res["inputVertices"] = (double) inputVertices;
+	res["inputFaces"] = (double) inputFaces;
+	res["outputVertices"] = (double) outputVertices;
+	res["outputFaces"] = (double) outputFaces;
+	res["msMin"] = times.front();
+	res["msMedian"] = median;
+	res["msMean"] = mean;
+	res["msMax"] = times.back();
+	double primitives = inputFaces > 0 ? inputFaces : inputVertices;
+	res["primitivesPerSecond"] = median > 0 ? primitives / (median / 1000.0) : 0.0;
+	res["peakRSS"] = (double) peakRSS;
+	return res;
+}
+
+QString toCsv(const QJsonArray& results)
+{
+	const QStringList columns = {
+		"case", "filter", "status", "upscale", "runs", "inputVertices", "inputFaces",
+		"outputVertices", "outputFaces", "msMin", "msMedian", "msMean", "msMax",
+		"primitivesPerSecond", "peakRSS"};
+	QString csv = columns.join(",") + "\n";
+	for (const QJsonValue& v : results) {
+		QJsonObject o = v.toObject();
+		QStringList row;
+		for (const QString& c : columns) {
+			QJsonValue cv = o.value(c);
+			if (cv.isString())
+				row << "\"" + cv.toString().replace("\"", "'") + "\"";
+			else if (cv.isDouble())
+				row << QString::number(cv.toDouble(), 'g', 12);
+			else
+				row << "";
+		}
+		csv += row.join(",") + "\n";
+	}
+	return csv;
+}
+
+void printUsage()
+{
+	std::cout
+		<< "Usage:\n"
+		<< "  meshlab_bench [options]\n"
+		<< "Options:\n"
+		<< "  --samples <dir>     directory containing the sample meshes\n"
+		<< "  --plugins <dir>     load the plugins from <dir> instead of the default path\n"
+		<< "  --repeat <n>        number of runs for each case (default 3)\n"
+		<< "  --upscale <n>       additional midpoint subdivision steps for all the cases\n"
+		<< "  --only <text>       run only the cases whose name contains <text>\n"
+		<< "  --case <name>:<filter>:<mesh>[:<param>=<value>...]\n"
+		<< "                      add a custom case (can be repeated); if given, the\n"
+		<< "                      default cases are not run\n"
+		<< "  --format json|csv   output format (default json)\n"
+		<< "  --output <file>     write the results to <file> instead of stdout\n"
+		<< "  --trace-dir <dir>   save a Chrome trace of the first run of each case\n"
+		<< "  --list              list the default cases and exit\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	// run without a display
+	if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+
+	MeshLabApplication app(argc, argv);
+	std::setlocale(LC_ALL, "C");
+	QLocale::setDefault(QLocale::C);
+
+	QString sampleDir = QString(MESHLAB_BENCH_SAMPLE_DIR);
+	QString pluginDir;
+	QString outputFile;
+	QString traceDir;
+	QString format = "json";
+	QString only;
+	int repeat = 3;
+	int upscale = 0;
+	std::vector<BenchCase> cases;
+
+	QStringList args = app.arguments();
+	for (int i = 1; i < args.size(); ++i) {
+		const QString& a = args[i];
+		bool hasNext = i + 1 < args.size();
+		if ((a == "-h" || a == "--help")) {
+			printUsage();
+			return 0;
+		}
+		else if (a == "--list") {
+			for (const BenchCase& bc : defaultCases())
+				std::cout << qUtf8Printable(bc.name) << ": " << qUtf8Printable(bc.filter) << "\n";
+			return 0;
+		}
+		else if (a == "--samples" && hasNext)
+			sampleDir = args[++i];
+		else if (a == "--plugins" && hasNext)
+			pluginDir = args[++i];
+		else if (a == "--repeat" && hasNext)
+			repeat = std::max(1, args[++i].toInt());
+		else if (a == "--upscale" && hasNext)
+			upscale = std::max(0, args[++i].toInt());
+		else if (a == "--only" && hasNext)
+			only = args[++i];
+		else if (a == "--format" && hasNext)
+			format = args[++i].toLower();
+		else if (a == "--output" && hasNext)
+			outputFile = args[++i];
+		else if (a == "--trace-dir" && hasNext)
+			traceDir = args[++i];
+		else if (a == "--case" && hasNext) {
+			QStringList tokens = args[++i].split(':');
+			if (tokens.size() < 3) {
+				std::cerr << "Invalid case: " << qUtf8Printable(args[i]) << "\n";
+				return 1;
+			}
+			BenchCase bc {tokens[0], tokens[1], tokens[2].split(','), 0, {}};
+			for (int t = 3; t < tokens.size(); ++t) {
+				int eq = tokens[t].indexOf('=');
+				if (eq > 0)
+					bc.params[tokens[t].left(eq)] = tokens[t].mid(eq + 1);
+			}
+			cases.push_back(bc);
+		}
+		else {
+			std::cerr << "Unknown option: " << qUtf8Printable(a) << "\n";
+			printUsage();
+			return 1;
+		}
+	}
+	if (cases.empty())
+		cases = defaultCases();
+	if (!traceDir.isEmpty())
+		QDir().mkpath(traceDir);
+
+	PluginManager& pm = meshlab::pluginManagerInstance();
+	try {
+		if (pluginDir.isEmpty())
+			pm.loadPlugins();
+		else
+			pm.loadPlugins(QDir(pluginDir));
+	}
+	catch (const MLException& e) {
+		// the other plugins have been loaded anyway
+		std::cerr << "Warning: " << e.what() << "\n";
+	}
+
+	QJsonArray results;
+	for (const BenchCase& bc : cases) {
+		if (!only.isEmpty() && !bc.name.contains(only))
+			continue;
+		std::cerr << "Running " << qUtf8Printable(bc.name) << "..." << std::endl;
+		results.append(runCase(bc, QDir(sampleDir), repeat, upscale, traceDir));
+	}
+
+	QByteArray out;
+	if (format == "csv") {
+		out = toCsv(results).toUtf8();
+	}
+	else {
+		QJsonObject root;
+		root["meshlabVersion"] = QString::fromStdString(meshlab::meshlabCompleteVersion());
+		root["doublePrecision"] = meshlab::builtWithDoublePrecision();
+		root["threads"] = QThread::idealThreadCount();
+		root["repeat"] = repeat;
+		root["results"] = results;
+		out = QJsonDocument(root).toJson();
+	}
+
+	if (outputFile.isEmpty()) {
+		std::cout << out.constData();
+	}
+	else {
+		QFile f(outputFile);
+		if (!f.open(QIODevice::WriteOnly)) {
+			std::cerr << "Cannot write " << qUtf8Printable(outputFile) << "\n";
+			return 1;
+		}
+		f.write(out);
+	}
+
+	for (const QJsonValue& v : results)
+		if (v.toObject().value("status").toString() != "ok")
+			return 2;
+	return 0;
+}
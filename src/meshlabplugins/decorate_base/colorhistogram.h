@@ -27,6 +27,12 @@ public:
    */
   void Add(ScalarType v,Color4b c,float increment=1.0);
 
+  /**
+   * Accumulate the data of another histogram with the same range and number
+   * of bins (e.g. a partial histogram computed by another thread).
+   */
+  void Merge(const ColorHistogram<ScalarType> &o);
+
   Color4b BinColorAvg(ScalarType v) { return BinColorAvgInd(this->BinIndex(v)); }
 
   Color4b BinColorAvgInd(int index) {
@@ -95,5 +101,21 @@ void ColorHistogram<ScalarType>::Add(ScalarType v,Color4b c,float increment/*=1.
   }
 }
 
+template <class ScalarType>
+void ColorHistogram<ScalarType>::Merge(const ColorHistogram<ScalarType> &o)
+{
+  assert(this->H.size()==o.H.size());
+  for(size_t i=0;i<this->H.size();++i)
+  {
+    this->H[i]+=o.H[i];
+    CV[i]+=o.CV[i];
+  }
+  if(o.minElem<this->minElem) this->minElem=o.minElem;
+  if(o.maxElem>this->maxElem) this->maxElem=o.maxElem;
+  this->cnt+=o.cnt;
+  this->sum+=o.sum;
+  this->rms+=o.rms;
+}
+
 } // end namespace
 #endif // COLORHISTOGRAM_H
@@ -26,12 +26,14 @@
 #include <vcg/complex/algorithms/stat.h>
 #include <vcg/complex/algorithms/bitquad_support.h>
 #include <common/GLExtensionsManager.h>
+#include <common/utilities/parallel_reductions.h>
 #include <meshlab/glarea.h>
 #include <wrap/qt/checkGLError.h>
 #include <wrap/qt/gl_label.h>
 #include <QGLShader>
 #include <meshlab/glarea_setting.h>
 #include <wrap/gl/gl_type_name.h>
+#include <limits>
 using namespace vcg;
 using namespace std;
 
@@ -295,7 +297,7 @@ void DecorateBasePlugin::decorateMesh(const QAction* a, MeshModel &m, const Rich
 		//      glColor4f(1.0f, 1.0f, 1.0f, 0.3f);
 		QGLShaderProgram *glp=this->contourShaderProgramMap[&m];
 		
-		std::pair<float,float> mmqH = vcg::tri::Stat<CMeshO>::ComputePerVertexQualityMinMax(m.cm);
+		std::pair<float,float> mmqH = meshlab::perVertexQualityMinMax(m.cm);
 		this->realTimeLog("Quality Contour", m.label(),
 						  "min Q %f -- max Q %f",mmqH.first,mmqH.second);
 		
@@ -625,17 +627,77 @@ void DecorateBasePlugin::endDecorate(const QAction * action, MeshModel &m, const
 	}
 }
 
+namespace {
+
+// Histograms shown by the decorations, built with the shared parallel
+// reductions: each thread fills a partial histogram, merged at the end.
+
+void parallelPerVertexQualityHistogram(const CMeshO& m, CHist& H, float minv, float maxv, int binNum, bool areaWeighted)
+{
+	if(areaWeighted)
+	{
+		meshlab::parallelHistogram(H, minv, maxv, binNum, (int) m.face.size(), [&m](CHist& partial, int i) {
+			const CFaceO& f = m.face[i];
+			if(f.IsD()) return;
+			float area6=DoubleArea(f)/6.0f;
+			for(int k=0;k<3;++k)
+				partial.Add(f.cV(k)->cQ(),f.cV(k)->cC(),area6);
+		});
+	}
+	else
+	{
+		meshlab::parallelHistogram(H, minv, maxv, binNum, (int) m.vert.size(), [&m](CHist& partial, int i) {
+			if(!m.vert[i].IsD())
+				partial.Add(m.vert[i].cQ(),m.vert[i].cC(),1.0f);
+		});
+	}
+}
+
+void parallelPerFaceQualityHistogram(const CMeshO& m, CHist& H, float minv, float maxv, int binNum, bool areaWeighted)
+{
+	meshlab::parallelHistogram(H, minv, maxv, binNum, (int) m.face.size(), [&m, areaWeighted](CHist& partial, int i) {
+		const CFaceO& f = m.face[i];
+		if(!f.IsD())
+			partial.Add(f.cQ(),f.cC(),areaWeighted ? DoubleArea(f)*0.5f : 1.0f);
+	});
+}
+
+} // namespace
+
+/**
+ * Returns true if the cached statistic of the given mesh must be recomputed,
+ * that is if the per mesh attribute holding it does not exist, if any of the
+ * attributes in attributeMask changed since the last computation or if the
+ * parameters (encoded in key) are different. The cache is updated accordingly.
+ */
+bool DecorateBasePlugin::updateStatCache(QMap<MeshModel *, StatCache>& cache, MeshModel& m, int attributeMask, const QString& key, const std::string& attributeName)
+{
+	unsigned int gen = m.attributeGeneration(attributeMask);
+	StatCache& c = cache[&m];
+	bool valid =
+			vcg::tri::HasPerMeshAttribute(m.cm, attributeName) &&
+			c.generation == gen && c.key == key;
+	c.generation = gen;
+	c.key = key;
+	return !valid;
+}
+
 bool DecorateBasePlugin::startDecorate(const QAction * action, MeshModel &m, const RichParameterList *rm, GLArea *gla)
 {
 	switch(ID(action))
 	{
 	case DP_SHOW_CURVATURE :
 	{
+		float NormalLen=rm->getFloat(CurvatureLength());
+		bool curvScale =rm->getBool(CurvatureScaling());
+		QString key = QString("%1 %2 %3 %4 %5").arg(NormalLen).arg(curvScale)
+				.arg(rm->getBool(ShowPerVertexCurvature())).arg(rm->getBool(ShowPerFaceCurvature())).arg(m.cm.bbox.Diag());
+		int mask = MeshModel::MM_VERTCOORD | MeshModel::MM_VERTCURVDIR | MeshModel::MM_FACEVERT | MeshModel::MM_FACECURVDIR;
+		if (!updateStatCache(curvatureCache, m, mask, key, "CurvatureVector"))
+			break;
 		CMeshO::PerMeshAttributeHandle< vector<PointPC> > cvH = vcg::tri::Allocator<CMeshO>::GetPerMeshAttribute< vector<PointPC> >(m.cm,"CurvatureVector");
 		vector<PointPC> *CVp = &cvH();
 		CVp->clear();
-		float NormalLen=rm->getFloat(CurvatureLength());
-		bool curvScale =rm->getBool(CurvatureScaling());
 		float LineLen = m.cm.bbox.Diag()*NormalLen;
 		float scale1,scale2;
 		if (rm->getBool(this->ShowPerVertexCurvature()) && m.hasDataMask(MeshModel::MM_VERTCURVDIR))
@@ -689,56 +751,62 @@ bool DecorateBasePlugin::startDecorate(const QAction * action, MeshModel &m, con
 	case DP_SHOW_VERT_QUALITY_HISTOGRAM :
 	{
 		if(!(tri::HasPerVertexColor(m.cm)) ) return false;
+		bool fixed = rm->getBool(perVertexHistFixedParam());
+		bool area = rm->getBool(perVertexHistAreaParam());
+		int binNum = rm->getInt(perVertexHistBinNumParam());
+		QString key = QString("%1 %2 %3").arg(binNum).arg(area).arg(fixed);
+		if (fixed)
+			key += QString(" %1 %2").arg(rm->getFloat(perVertexHistFixedMinParam())).arg(rm->getFloat(perVertexHistFixedMaxParam()));
+		int mask = MeshModel::MM_VERTQUALITY | MeshModel::MM_VERTCOLOR | MeshModel::MM_VERTNUMBER;
+		if (area)
+			mask |= MeshModel::MM_VERTCOORD | MeshModel::MM_FACEVERT | MeshModel::MM_FACENUMBER;
+		if (!updateStatCache(vertHistCache, m, mask, key, "VertexQualityHist"))
+			break;
+
 		CMeshO::PerMeshAttributeHandle<CHist > qH = vcg::tri::Allocator<CMeshO>::GetPerMeshAttribute<CHist>(m.cm,"VertexQualityHist");
 		
 		CHist *H = &qH();
 		std::pair<float,float> minmax;
-		minmax = tri::Stat<CMeshO>::ComputePerVertexQualityMinMax(m.cm);
-		if(rm->getBool(perVertexHistFixedParam())) {
+		if(fixed) {
 			minmax.first=rm->getFloat(perVertexHistFixedMinParam());
 			minmax.second=rm->getFloat(perVertexHistFixedMaxParam());
 		}
-		
-		H->SetRange( minmax.first, minmax.second, rm->getInt(perVertexHistBinNumParam()));
-		if(rm->getBool(perVertexHistAreaParam()))
-		{
-			for(CMeshO::FaceIterator fi = m.cm.face.begin(); fi!= m.cm.face.end();++fi) if(!(*fi).IsD())
-			{
-				float area6=DoubleArea(*fi)/6.0f;
-				for(int i=0;i<3;++i)
-					H->Add((*fi).V(i)->Q(),(*fi).V(i)->C(),area6);
-			}
-		} else {
-			for(CMeshO::VertexIterator vi = m.cm.vert.begin(); vi!= m.cm.vert.end();++vi) if(!(*vi).IsD())
-			{
-				H->Add((*vi).Q(),(*vi).C(),1.0f);
-			}
+		else {
+			minmax = meshlab::perVertexQualityMinMax(m.cm);
 		}
+		
+		parallelPerVertexQualityHistogram(m.cm, *H, minmax.first, minmax.second, binNum, area);
 	}
 	break;
 	
 	case DP_SHOW_FACE_QUALITY_HISTOGRAM :
 	{
 		if(!(tri::HasPerFaceColor(m.cm)) ) return false;
+		bool fixed = rm->getBool(perFaceHistFixedParam());
+		bool area = rm->getBool(perFaceHistAreaParam());
+		int binNum = rm->getInt(perFaceHistBinNumParam());
+		QString key = QString("%1 %2 %3").arg(binNum).arg(area).arg(fixed);
+		if (fixed)
+			key += QString(" %1 %2").arg(rm->getFloat(perFaceHistFixedMinParam())).arg(rm->getFloat(perFaceHistFixedMaxParam()));
+		int mask = MeshModel::MM_FACEQUALITY | MeshModel::MM_FACECOLOR | MeshModel::MM_FACENUMBER;
+		if (area)
+			mask |= MeshModel::MM_VERTCOORD | MeshModel::MM_FACEVERT;
+		if (!updateStatCache(faceHistCache, m, mask, key, "FaceQualityHist"))
+			break;
+
 		CMeshO::PerMeshAttributeHandle<CHist > qH = vcg::tri::Allocator<CMeshO>::GetPerMeshAttribute<CHist>(m.cm,"FaceQualityHist");
 		
 		CHist *H = &qH();
 		std::pair<float,float> minmax;
-		minmax = tri::Stat<CMeshO>::ComputePerFaceQualityMinMax(m.cm);
-		if(rm->getBool(perFaceHistFixedParam())) {
+		if(fixed) {
 			minmax.first=rm->getFloat(perFaceHistFixedMinParam());
 			minmax.second=rm->getFloat(perFaceHistFixedMaxParam());
 		}
-		
-		H->SetRange( minmax.first, minmax.second, rm->getInt(perFaceHistBinNumParam()));
-		
-		if(rm->getBool(perFaceHistAreaParam())) {
-			for(CMeshO::FaceIterator fi = m.cm.face.begin(); fi!= m.cm.face.end();++fi) if(!(*fi).IsD())
-				H->Add((*fi).Q(),(*fi).C(),DoubleArea(*fi)*0.5f);
-		} else {
-			for(CMeshO::FaceIterator fi = m.cm.face.begin(); fi!= m.cm.face.end();++fi) if(!(*fi).IsD())
-				H->Add((*fi).Q(),(*fi).C(),1.0f);
+		else {
+			minmax = meshlab::perFaceQualityMinMax(m.cm);
 		}
+		
+		parallelPerFaceQualityHistogram(m.cm, *H, minmax.first, minmax.second, binNum, area);
 	}
 	break;
 	
@@ -196,6 +196,18 @@ private:
 	vcg::Shotf curShot;
 	
 	QMap<MeshModel *, QGLShaderProgram *> contourShaderProgramMap;
+
+	// Statistics shown by the decorations are cached per mesh, and recomputed only when the
+	// attributes they depend on (or the parameters used to compute them) have been changed.
+	struct StatCache
+	{
+		unsigned int generation = 0;
+		QString key;
+	};
+	QMap<MeshModel *, StatCache> vertHistCache;
+	QMap<MeshModel *, StatCache> faceHistCache;
+	QMap<MeshModel *, StatCache> curvatureCache;
+	bool updateStatCache(QMap<MeshModel *, StatCache>& cache, MeshModel& m, int attributeMask, const QString& key, const std::string& attributeName);
 };
 
 #endif
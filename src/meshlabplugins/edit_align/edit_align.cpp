@@ -33,6 +33,7 @@ $Log: meshedit.cpp,v $
 #include "AlignPairWidget.h"
 #include "AlignPairDialog.h"
 #include "align/align_parameter.h"
+#include <common/utilities/mesh_tree_align.h>
 #include <vcg/space/point_matching.h>
 #include <vcg/complex/algorithms/point_matching_scale.h>
 
@@ -460,7 +461,7 @@ void EditAlignPlugin::process()
         return;
     }
     alignDialog->setEnabled(false);
-    meshTree.Process(defaultAP, defaultMTP);
+    meshlab::processMeshTree(meshTree, defaultAP, defaultMTP);
     alignDialog->rebuildTree();
     _gla->update();
     alignDialog->setEnabled(true);
@@ -116,10 +116,9 @@ void applyColorByVertexQuality(MeshModel& mesh, TransferFunction *transferFuncti
 
 void applyColorByVertexQuality(MeshModel& mesh, TransferFunction *transferFunction, float minQuality, float maxQuality, float midHandlePercentilePosition, float brightness)
 {
-	CMeshO::VertexIterator vi;
-	Color4b currentColor;
-
-	for(vi=mesh.cm.vert.begin(); vi!=mesh.cm.vert.end(); ++vi)		
-		if(!(*vi).IsD()) 
-			(*vi).C() = transferFunction->getColorByQuality ((*vi).Q(), minQuality, maxQuality, midHandlePercentilePosition, brightness);
+	// a single pass over the vertices; the transfer function is only read
+#pragma omp parallel for schedule(static)
+	for(int i = 0; i < (int) mesh.cm.vert.size(); i++)
+		if(!mesh.cm.vert[i].IsD())
+			mesh.cm.vert[i].C() = transferFunction->getColorByQuality (mesh.cm.vert[i].Q(), minQuality, maxQuality, midHandlePercentilePosition, brightness);
 }
\ No newline at end of file
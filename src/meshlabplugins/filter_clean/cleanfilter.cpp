@@ -22,6 +22,7 @@
  ****************************************************************************/
 
 #include "cleanfilter.h"
+#include <common/utilities/connected_components.h>
 
 #include <QCoreApplication>
 #include <vcg/complex/algorithms/clean.h>
@@ -440,10 +441,13 @@ std::map<std::string, QVariant> CleanFilter::applyFilter(
 	} break;
 
 	case FP_REMOVE_ISOLATED_DIAMETER: {
-		Scalarm             minCC = par.getAbsPerc("MinComponentDiag");
-		std::pair<int, int> delInfo =
-			tri::Clean<CMeshO>::RemoveSmallConnectedComponentsDiameter(m.cm, minCC);
-		log("Removed %i connected components out of %i", delInfo.second, delInfo.first);
+		Scalarm                      minCC = par.getAbsPerc("MinComponentDiag");
+		meshlab::ConnectedComponents cc(m.cm);
+		int                          delCC =
+			cc.deleteComponents(m.cm, [minCC](const meshlab::ConnectedComponents::Component& c) {
+				return c.bbox.Diag() < minCC;
+			});
+		log("Removed %i connected components out of %i", delCC, cc.size());
 		if (par.getBool("removeUnref")) {
 			int delvert = tri::Clean<CMeshO>::RemoveUnreferencedVertex(m.cm);
 			log("Removed %d unreferenced vertices", delvert);
@@ -451,10 +455,13 @@ std::map<std::string, QVariant> CleanFilter::applyFilter(
 		m.updateBoxAndNormals();
 	} break;
 	case FP_REMOVE_ISOLATED_COMPLEXITY: {
-		int                 minCC = par.getInt("MinComponentSize");
-		std::pair<int, int> delInfo =
-			tri::Clean<CMeshO>::RemoveSmallConnectedComponentsSize(m.cm, minCC);
-		log("Removed %i connected components out of %i", delInfo.second, delInfo.first);
+		int                          minCC = par.getInt("MinComponentSize");
+		meshlab::ConnectedComponents cc(m.cm);
+		int                          delCC =
+			cc.deleteComponents(m.cm, [minCC](const meshlab::ConnectedComponents::Component& c) {
+				return c.faceNum < minCC;
+			});
+		log("Removed %i connected components out of %i", delCC, cc.size());
 		if (par.getBool("removeUnref")) {
 			int delvert = tri::Clean<CMeshO>::RemoveUnreferencedVertex(m.cm);
 			log("Removed %d unreferenced vertices", delvert);
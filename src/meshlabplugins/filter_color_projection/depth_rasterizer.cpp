@@ -0,0 +1,266 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#include "depth_rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int TILE_SIZE = 64;
+
+} // namespace
+
+DepthRasterizer::DepthRasterizer(const CMeshO& mesh) : m(mesh)
+{
+}
+
+floatbuffer* DepthRasterizer::renderDepth(const Shotm& view, float camNear, float camFar) const
+{
+	const int wt = view.Intrinsics.ViewportPx[0];
+	const int ht = view.Intrinsics.ViewportPx[1];
+
+	floatbuffer* depth = new floatbuffer();
+	depth->init(wt, ht);
+	depth->fillwith(0);
+	if (wt <= 0 || ht <= 0)
+		return depth;
+
+	if ((camNear <= 0) || (camFar == 0)) { // if not provided by caller, then evaluate using bbox
+		camNear = 1000000;
+		camFar  = -1000000;
+		for (int i = 0; i < 8; ++i) {
+			float d = view.Depth(m.bbox.P(i));
+			camNear = std::min(camNear, d);
+			camFar  = std::max(camFar, d);
+		}
+		if (camNear <= 0)
+			camNear = 0.01f;
+		if (camFar < camNear)
+			camFar = 1000.0f;
+	}
+
+	// camera space depth and projection of the vertices
+	const int          vertNum = m.vert.size();
+	std::vector<float> vz(vertNum, 0);
+	std::vector<Point2m> vp(vertNum);
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < vertNum; ++i) {
+		if (m.vert[i].IsD())
+			continue;
+		vz[i] = view.Depth(m.vert[i].cP());
+		if (vz[i] >= camNear)
+			vp[i] = view.Project(m.vert[i].cP());
+	}
+
+	float* data = depth->data;
+
+	// point clouds: each visible vertex covers its own pixel
+	if (m.fn == 0) {
+		for (int i = 0; i < vertNum; ++i) {
+			if (m.vert[i].IsD() || vz[i] < camNear || vz[i] > camFar)
+				continue;
+			const int x = std::floor(vp[i][0]);
+			const int y = std::floor(vp[i][1]);
+			if (x < 0 || y < 0 || x >= wt || y >= ht)
+				continue;
+			float& d = data[y * wt + x];
+			if (d == 0 || vz[i] < d)
+				d = vz[i];
+		}
+		return depth;
+	}
+
+	// screen space triangles, clipped against the near plane
+	std::vector<ScreenTriangle> triangles;
+	triangles.reserve(m.fn);
+	for (const CFaceO& f : m.face) {
+		if (f.IsD())
+			continue;
+		Point3m p[3];
+		float   z[3];
+		bool    allIn = true;
+		bool    allOut = true;
+		for (int k = 0; k < 3; ++k) {
+			const int vi = vcg::tri::Index(m, f.cV(k));
+			p[k] = f.cP(k);
+			z[k] = vz[vi];
+			if (z[k] >= camNear)
+				allOut = false;
+			else
+				allIn = false;
+		}
+		if (allOut)
+			continue;
+		if (allIn) {
+			ScreenTriangle t;
+			for (int k = 0; k < 3; ++k) {
+				const Point2m& pp = vp[vcg::tri::Index(m, f.cV(k))];
+				t.x[k] = pp[0];
+				t.y[k] = pp[1];
+				t.invz[k] = 1.0f / z[k];
+			}
+			triangles.push_back(t);
+		}
+		else {
+			addTriangle(view, p, z, camNear, triangles);
+		}
+	}
+
+	// bin the triangles in screen tiles
+	const int tilesX = (wt + TILE_SIZE - 1) / TILE_SIZE;
+	const int tilesY = (ht + TILE_SIZE - 1) / TILE_SIZE;
+	std::vector<std::vector<int>> bins(tilesX * tilesY);
+	for (int i = 0; i < (int) triangles.size(); ++i) {
+		const ScreenTriangle& t = triangles[i];
+		const float minx = std::min(t.x[0], std::min(t.x[1], t.x[2]));
+		const float maxx = std::max(t.x[0], std::max(t.x[1], t.x[2]));
+		const float miny = std::min(t.y[0], std::min(t.y[1], t.y[2]));
+		const float maxy = std::max(t.y[0], std::max(t.y[1], t.y[2]));
+		if (maxx < 0 || maxy < 0 || minx >= wt || miny >= ht)
+			continue;
+		const int tx0 = std::max(0, (int) std::floor(minx) / TILE_SIZE);
+		const int ty0 = std::max(0, (int) std::floor(miny) / TILE_SIZE);
+		const int tx1 = std::min(tilesX - 1, (int) std::floor(maxx) / TILE_SIZE);
+		const int ty1 = std::min(tilesY - 1, (int) std::floor(maxy) / TILE_SIZE);
+		for (int ty = ty0; ty <= ty1; ++ty)
+			for (int tx = tx0; tx <= tx1; ++tx)
+				bins[ty * tilesX + tx].push_back(i);
+	}
+
+	// each tile owns its own pixels
+#pragma omp parallel for schedule(dynamic)
+	for (int b = 0; b < (int) bins.size(); ++b) {
+		const int x0 = (b % tilesX) * TILE_SIZE;
+		const int y0 = (b / tilesX) * TILE_SIZE;
+		const int x1 = std::min(x0 + TILE_SIZE, wt);
+		const int y1 = std::min(y0 + TILE_SIZE, ht);
+		for (int i : bins[b])
+			rasterize(triangles[i], x0, y0, x1, y1, wt, camNear, camFar, data);
+	}
+
+	return depth;
+}
+
+/*
+ * Sutherland-Hodgman clipping of a triangle that crosses the near plane:
+ * the resulting polygon (3 or 4 vertices) is projected and split in triangles.
+ */
+void DepthRasterizer::addTriangle(
+	const Shotm&                 view,
+	const Point3m                p[3],
+	const float                  z[3],
+	float                        camNear,
+	std::vector<ScreenTriangle>& triangles) const
+{
+	Point3m poly[4];
+	float   polyz[4];
+	int     n = 0;
+	for (int k = 0; k < 3; ++k) {
+		const int  k1  = (k + 1) % 3;
+		const bool in  = z[k] >= camNear;
+		const bool in1 = z[k1] >= camNear;
+		if (in) {
+			poly[n]  = p[k];
+			polyz[n] = z[k];
+			++n;
+		}
+		if (in != in1) {
+			const float t = (camNear - z[k]) / (z[k1] - z[k]);
+			poly[n]  = p[k] + (p[k1] - p[k]) * t;
+			polyz[n] = camNear;
+			++n;
+		}
+	}
+	if (n < 3)
+		return;
+
+	Point2m pp[4];
+	for (int k = 0; k < n; ++k)
+		pp[k] = view.Project(poly[k]);
+	for (int k = 1; k + 1 < n; ++k) {
+		const int      idx[3] = {0, k, k + 1};
+		ScreenTriangle t;
+		for (int j = 0; j < 3; ++j) {
+			t.x[j]    = pp[idx[j]][0];
+			t.y[j]    = pp[idx[j]][1];
+			t.invz[j] = 1.0f / polyz[idx[j]];
+		}
+		triangles.push_back(t);
+	}
+}
+
+/*
+ * Rasterizes the part of the triangle inside the [x0,x1)x[y0,y1) tile,
+ * sampling at pixel centers; depth is interpolated perspective-correctly
+ * (1/z is linear in screen space) and both faces are rendered, as in GL.
+ */
+void DepthRasterizer::rasterize(
+	const ScreenTriangle& t,
+	int                   x0,
+	int                   y0,
+	int                   x1,
+	int                   y1,
+	int                   width,
+	float                 camNear,
+	float                 camFar,
+	float*                depth) const
+{
+	const double ax = t.x[0], ay = t.y[0];
+	const double bx = t.x[1], by = t.y[1];
+	const double cx = t.x[2], cy = t.y[2];
+
+	const double area = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+	if (std::abs(area) < 1e-12)
+		return;
+	const double invArea = 1.0 / area;
+
+	const int minx = std::max(x0, (int) std::floor(std::min(ax, std::min(bx, cx))));
+	const int maxx = std::min(x1 - 1, (int) std::ceil(std::max(ax, std::max(bx, cx))));
+	const int miny = std::max(y0, (int) std::floor(std::min(ay, std::min(by, cy))));
+	const int maxy = std::min(y1 - 1, (int) std::ceil(std::max(ay, std::max(by, cy))));
+
+	for (int y = miny; y <= maxy; ++y) {
+		const double py  = y + 0.5;
+		float*       row = depth + y * width;
+		for (int x = minx; x <= maxx; ++x) {
+			const double px = x + 0.5;
+			// normalized barycentric coordinates (sign independent from the winding)
+			const double w0 = ((cx - bx) * (py - by) - (cy - by) * (px - bx)) * invArea;
+			const double w1 = ((ax - cx) * (py - cy) - (ay - cy) * (px - cx)) * invArea;
+			const double w2 = 1.0 - w0 - w1;
+			if (w0 < 0 || w1 < 0 || w2 < 0)
+				continue;
+			const double invz = w0 * t.invz[0] + w1 * t.invz[1] + w2 * t.invz[2];
+			if (invz <= 0)
+				continue;
+			const float z = 1.0 / invz;
+			if (z < camNear || z > camFar)
+				continue;
+			if (row[x] == 0 || z < row[x])
+				row[x] = z;
+		}
+	}
+}
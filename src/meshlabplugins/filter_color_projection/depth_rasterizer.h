@@ -0,0 +1,80 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#ifndef DEPTH_RASTERIZER_H
+#define DEPTH_RASTERIZER_H
+
+#include <vector>
+
+#include <common/ml_document/cmesh.h>
+
+#include "floatbuffer.h"
+
+/*
+ * CPU replacement of RenderHelper::renderScene for the depth buffer.
+ *
+ * The mesh is rasterized from a shot with the same conventions of the OpenGL
+ * readback: ViewportPx sized buffer with bottom-up rows, depth expressed in
+ * camera space (as Shot::Depth) and 0 where no surface is visible.
+ * Triangles are clipped against the near plane, binned in screen tiles and
+ * the tiles are rasterized in parallel. No GL context is needed, so depth
+ * maps of different rasters can also be computed at the same time.
+ */
+class DepthRasterizer
+{
+public:
+	DepthRasterizer(const CMeshO& mesh);
+
+	// the returned buffer is owned by the caller
+	floatbuffer* renderDepth(const Shotm& view, float camNear = 0, float camFar = 0) const;
+
+private:
+	struct ScreenTriangle
+	{
+		float x[3];
+		float y[3];
+		float invz[3];
+	};
+
+	void addTriangle(
+		const Shotm&                 view,
+		const Point3m                p[3],
+		const float                  z[3],
+		float                        camNear,
+		std::vector<ScreenTriangle>& triangles) const;
+	void rasterize(
+		const ScreenTriangle& t,
+		int                   x0,
+		int                   y0,
+		int                   x1,
+		int                   y1,
+		int                   width,
+		float                 camNear,
+		float                 camFar,
+		float*                depth) const;
+
+	const CMeshO& m;
+};
+
+#endif // DEPTH_RASTERIZER_H
@@ -35,9 +35,14 @@
 
 #include "render_helper.cpp"
 
-#include "pushpull.h"
+#include "depth_rasterizer.h"
 #include "rastering.h"
 #include <vcg/complex/algorithms/update/texture.h>
+#include <common/utilities/pull_push.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 using namespace vcg;
@@ -55,6 +60,211 @@ static QString extractFilenameWOExt(const MeshModel* mm)
 	QFileInfo fi(mm->fullName());
 	return fi.baseName();
 }
+
+namespace {
+
+// per-raster data needed by the multi-image projections
+struct RasterProjection
+{
+	const RasterModel* raster     = nullptr;
+	int                cam_ind    = 0; // index in md.rasterIterator(), for near/far
+	floatbuffer*       depth      = nullptr;
+	floatbuffer*       silhouette = nullptr;
+	float              maxsildist = 0;
+};
+
+// parameters of the per-sample weighting of the multi-image projections
+struct ProjectionWeighting
+{
+	Scalarm eta;
+	bool    useangle;
+	bool    usedistance;
+	bool    useborders;
+	bool    usesilhouettes;
+	bool    usealphamask;
+	float   allcammindepth;
+	float   allcammaxdepth;
+};
+
+// If should be used silhouette weighting, it is needed to compute depth discontinuities and
+// per-pixel distance from detected borders on the entire image; the weight is then applied
+// later, per-sample, when needed
+void computeSilhouette(RasterProjection& rp, bool usesilhouettes)
+{
+	rp.maxsildist = rp.depth->sx + rp.depth->sy;
+	if (usesilhouettes) {
+		rp.silhouette = new floatbuffer();
+		rp.silhouette->init(rp.depth->sx, rp.depth->sy);
+		rp.silhouette->applysobel(rp.depth);
+		rp.silhouette->initborder(rp.depth);
+		rp.maxsildist = rp.silhouette->distancefield();
+	}
+}
+
+void releaseBuffers(RasterProjection& rp)
+{
+	delete rp.depth;
+	delete rp.silhouette;
+	rp.depth      = nullptr;
+	rp.silhouette = nullptr;
+}
+
+/*
+ * Projects the point p (with normal n) on the raster; returns false if it falls outside the
+ * image or it is occluded, otherwise the image color and its weight.
+ * Only reads the raster buffers, so it can be called concurrently.
+ */
+bool projectSample(
+	const RasterProjection&    rp,
+	const ProjectionWeighting& pw,
+	const Point3m&             p,
+	const Point3m&             n,
+	QRgb&                      pcolor,
+	double&                    pweight)
+{
+	const Shotm& shot = rp.raster->shot;
+	// pp is the projected point in image space
+	Point2m pp = shot.Project(p);
+	// pray is the vector from the point-to-be-colored to the camera center
+	Point3m pray = (shot.GetViewPoint() - p).Normalize();
+
+	// if inside image; pixel row/column 0 is valid (the old texture projection skipped it
+	// with a strict pp > 0 test, while the vertex projection already accepted it)
+	if (!(pp[0] >= 0 && pp[1] >= 0 && pp[0] < shot.Intrinsics.ViewportPx[0] &&
+		  pp[1] < shot.Intrinsics.ViewportPx[1]))
+		return false;
+	if ((pray.dot(-shot.Axis(2))) > 0.0)
+		return false;
+
+	Scalarm depth  = shot.Depth(p);
+	Scalarm pdepth = rp.depth->getval(int(pp[0]), int(pp[1]));
+	if (depth > (pdepth + pw.eta))
+		return false;
+
+	// determine color
+	pcolor = rp.raster->currentPlane->image.pixel(pp[0], shot.Intrinsics.ViewportPx[1] - pp[1]);
+	// determine weight
+	pweight = 1.0;
+
+	if (pw.useangle) {
+		Point3m pixnorm  = n;
+		Point3m viewaxis = shot.GetViewPoint() - p;
+		pixnorm.Normalize();
+		viewaxis.Normalize();
+
+		float ang = std::abs(pixnorm * viewaxis);
+		ang       = std::min(1.0f, ang);
+
+		pweight *= ang;
+	}
+
+	if (pw.usedistance) {
+		float distw = depth;
+		distw       = 1.0 - (distw - (pw.allcammindepth * 0.99)) /
+						  ((pw.allcammaxdepth * 1.01) - (pw.allcammindepth * 0.99));
+
+		pweight *= distw;
+		pweight *= distw;
+	}
+
+	if (pw.useborders) {
+		double xdist = 1.0 - (std::abs(pp[0] - (shot.Intrinsics.ViewportPx[0] / 2.0)) /
+							  (shot.Intrinsics.ViewportPx[0] / 2.0));
+		double ydist = 1.0 - (std::abs(pp[1] - (shot.Intrinsics.ViewportPx[1] / 2.0)) /
+							  (shot.Intrinsics.ViewportPx[1] / 2.0));
+		double borderw = std::min(xdist, ydist);
+
+		pweight *= borderw;
+	}
+
+	if (pw.usesilhouettes) {
+		// here the silhouette weight is applied, but it is calculated before, on a per-image
+		// basis
+		float silw = rp.silhouette->getval(int(pp[0]), int(pp[1])) / rp.maxsildist;
+		pweight *= silw;
+	}
+
+	if (pw.usealphamask) { // alpha channel of image is an additional mask
+		pweight *= (qAlpha(pcolor) / 255.0);
+	}
+	return true;
+}
+
+/*
+ * Computes the depth (and silhouette) buffers of all the rasters and calls
+ * accumulate(rp) for each of them, in raster order.
+ * With the CPU depth backend the buffers of a batch of rasters (one per thread) are computed
+ * at the same time; the GL backend renders one raster at a time through renderGL.
+ */
+template<class RenderGL, class Accumulate>
+void projectRasters(
+	std::vector<RasterProjection>& rasters,
+	const CMeshO&                  m,
+	const std::vector<float>&      my_near,
+	const std::vector<float>&      my_far,
+	bool                           usecpudepth,
+	bool                           usesilhouettes,
+	RenderGL                       renderGL,
+	Accumulate                     accumulate,
+	vcg::CallBackPos*              cb,
+	int                            start,
+	int                            offset)
+{
+	int batchSize = 1;
+#ifdef _OPENMP
+	if (usecpudepth)
+		batchSize = std::max(1, omp_get_max_threads());
+#endif
+	const int       rasterNum = rasters.size();
+	DepthRasterizer rasterizer(m);
+	for (int b = 0; b < rasterNum; b += batchSize) {
+		const int batchEnd = std::min(b + batchSize, rasterNum);
+		if (cb)
+			cb(start + offset * b / rasterNum, "Computing depth maps...");
+		if (usecpudepth) {
+			// a lone raster keeps the threads for the tiles of its own depth map
+#pragma omp parallel for schedule(dynamic) if (batchEnd - b > 1)
+			for (int i = b; i < batchEnd; ++i) {
+				RasterProjection& rp = rasters[i];
+				rp.depth = rasterizer.renderDepth(
+					rp.raster->shot, my_near[rp.cam_ind] * 0.5, my_far[rp.cam_ind] * 1.25);
+				computeSilhouette(rp, usesilhouettes);
+			}
+		}
+		else {
+			for (int i = b; i < batchEnd; ++i) {
+				rasters[i].depth = renderGL(rasters[i]);
+				computeSilhouette(rasters[i], usesilhouettes);
+			}
+		}
+
+		for (int i = b; i < batchEnd; ++i) {
+			if (cb)
+				cb(start + offset * i / rasterNum, "Projecting rasters...");
+			accumulate(rasters[i]);
+			releaseBuffers(rasters[i]);
+		}
+	}
+}
+
+// visible rasters with a valid camera, in document order
+std::vector<RasterProjection> projectableRasters(const MeshDocument& md)
+{
+	std::vector<RasterProjection> rasters;
+	int                           cam_ind = 0;
+	for (const RasterModel& raster : md.rasterIterator()) {
+		if (raster.isVisible() && raster.shot.IsValid()) {
+			RasterProjection rp;
+			rp.raster  = &raster;
+			rp.cam_ind = cam_ind;
+			rasters.push_back(rp);
+		}
+		cam_ind++;
+	}
+	return rasters;
+}
+
+} // namespace
 //-----------------------------------------
 
 // Constructor
@@ -129,10 +339,12 @@ int FilterColorProjectionPlugin::getRequirements(const QAction* action)
 
 bool FilterColorProjectionPlugin::requiresGLContext(const QAction* action) const
 {
+	// the multi-image projections need GL only when "usecpudepth" is disabled,
+	// in that case applyFilter checks for the context
 	switch (ID(action)) {
-	case FP_SINGLEIMAGEPROJ:
+	case FP_SINGLEIMAGEPROJ: return true;
 	case FP_MULTIIMAGETRIVIALPROJ:
-	case FP_MULTIIMAGETRIVIALPROJTEXTURE: return true;
+	case FP_MULTIIMAGETRIVIALPROJTEXTURE: return false;
 	default: assert(0);
 	}
 	return false;
@@ -175,6 +387,13 @@ FilterColorProjectionPlugin::initParameterList(const QAction* action, const Mesh
 			0.5,
 			"depth threshold",
 			"threshold value for depth buffer projection (shadow buffer)"));
+		parlst.addParam(RichBool(
+			"usecpudepth",
+			true,
+			"Compute depth maps on CPU",
+			"If true, the per-raster depth maps are computed by a multithreaded software "
+			"rasterizer, without requiring an OpenGL context; otherwise they are rendered with "
+			"OpenGL, one raster at a time"));
 		parlst.addParam(RichBool(
 			"onselection",
 			false,
@@ -240,6 +459,13 @@ FilterColorProjectionPlugin::initParameterList(const QAction* action, const Mesh
 			0.5,
 			"depth threshold",
 			"threshold value for depth buffer projection (shadow buffer)"));
+		parlst.addParam(RichBool(
+			"usecpudepth",
+			true,
+			"Compute depth maps on CPU",
+			"If true, the per-raster depth maps are computed by a multithreaded software "
+			"rasterizer, without requiring an OpenGL context; otherwise they are rendered with "
+			"OpenGL, one raster at a time"));
 		parlst.addParam(RichBool(
 			"onselection",
 			false,
@@ -289,7 +515,12 @@ std::map<std::string, QVariant> FilterColorProjectionPlugin::applyFilter(
 	unsigned int& /*postConditionMask*/,
 	vcg::CallBackPos* cb)
 {
-	if (glContext != nullptr) {
+	// the multi-image projections can compute their depth maps without GL
+	bool needsGL = true;
+	if (ID(filter) != FP_SINGLEIMAGEPROJ)
+		needsGL = !par.getBool("usecpudepth");
+
+	if (glContext != nullptr || !needsGL) {
 		// CMeshO::FaceIterator fi;
 		CMeshO::VertexIterator vi;
 
@@ -395,292 +626,108 @@ std::map<std::string, QVariant> FilterColorProjectionPlugin::applyFilter(
 			////--------------------------- project multi trivial ----------------------------------
 
 		case FP_MULTIIMAGETRIVIALPROJ: {
-			bool    onselection    = par.getBool("onselection");
-			Scalarm eta            = par.getFloat("deptheta");
-			bool    useangle       = par.getBool("useangle");
-			bool    usedistance    = par.getBool("usedistance");
-			bool    useborders     = par.getBool("useborders");
-			bool    usesilhouettes = par.getBool("usesilhouettes");
-			bool    usealphamask   = par.getBool("usealpha");
-			QColor  blank          = par.getColor("blankColor");
-
-			Scalarm    depth  = 0; // depth of point (distance from camera)
-			Scalarm    pdepth = 0; // depth value of projected point (from depth map)
-			double     pweight;    // pixel weight
-			MeshModel* model;
-			bool       do_project;
-			int        cam_ind;
-
-			// min max depth for depth weight normalization
-			float allcammaxdepth;
-			float allcammindepth;
-
-			// max image size for border weight normalization
-			float allcammaximagesize;
-
-			// accumulation buffers for colors and weights
-			int     buff_ind;
-			double* weights;
-			double* acc_red;
-			double* acc_grn;
-			double* acc_blu;
+			bool    onselection = par.getBool("onselection");
+			bool    usecpudepth = par.getBool("usecpudepth");
+			QColor  blank       = par.getColor("blankColor");
+			ProjectionWeighting pw;
+			pw.eta            = par.getFloat("deptheta");
+			pw.useangle       = par.getBool("useangle");
+			pw.usedistance    = par.getBool("usedistance");
+			pw.useborders     = par.getBool("useborders");
+			pw.usesilhouettes = par.getBool("usesilhouettes");
+			pw.usealphamask   = par.getBool("usealpha");
 
 			// get current model
-			model = md.mm();
+			MeshModel* model = md.mm();
 
 			// the mesh has to be correctly transformed before mapping
 			tri::UpdatePosition<CMeshO>::Matrix(model->cm, model->cm.Tr, true);
 			tri::UpdateBounding<CMeshO>::Box(model->cm);
 
-			// init accumulation buffers for colors and weights
+			// init accumulation buffers for colors and weights, indexed as model->cm.vert
 			log("init color accumulation buffers");
-			weights = new double[model->cm.vn];
-			acc_red = new double[model->cm.vn];
-			acc_grn = new double[model->cm.vn];
-			acc_blu = new double[model->cm.vn];
-			for (int buff_ind = 0; buff_ind < model->cm.vn; buff_ind++) {
-				weights[buff_ind] = 0.0;
-				acc_red[buff_ind] = 0.0;
-				acc_grn[buff_ind] = 0.0;
-				acc_blu[buff_ind] = 0.0;
-			}
+			const int           vertNum = model->cm.vert.size();
+			std::vector<double> weights(vertNum, 0.0);
+			std::vector<double> acc_red(vertNum, 0.0);
+			std::vector<double> acc_grn(vertNum, 0.0);
+			std::vector<double> acc_blu(vertNum, 0.0);
 
 			// calculate accuratenear/far for all cameras
 			std::vector<float> my_near;
 			std::vector<float> my_far;
 			calculateNearFarAccurate(md, &my_near, &my_far);
 
-			allcammaxdepth     = -1000000;
-			allcammindepth     = 1000000;
-			allcammaximagesize = -1000000;
-			cam_ind            = 0;
-			for (const RasterModel& rm : md.rasterIterator()) {
-				if (my_far[cam_ind] > allcammaxdepth)
-					allcammaxdepth = my_far[cam_ind];
-				if (my_near[cam_ind] < allcammindepth)
-					allcammindepth = my_near[cam_ind];
-
-				float imgdiag = sqrt(
-					double(rm.shot.Intrinsics.ViewportPx[0] * rm.shot.Intrinsics.ViewportPx[1]));
-				if (imgdiag > allcammaximagesize)
-					allcammaximagesize = imgdiag;
-				cam_ind++;
+			pw.allcammaxdepth = -1000000;
+			pw.allcammindepth = 1000000;
+			for (size_t cam_ind = 0; cam_ind < my_near.size(); cam_ind++) {
+				if (my_far[cam_ind] > pw.allcammaxdepth)
+					pw.allcammaxdepth = my_far[cam_ind];
+				if (my_near[cam_ind] < pw.allcammindepth)
+					pw.allcammindepth = my_near[cam_ind];
 			}
 
 			//-- cycle all cameras
-			cam_ind = 0;
-			for (const RasterModel& raster : md.rasterIterator()) {
-				if (raster.isVisible()) {
-					do_project = true;
-
-					// no drawing if camera not valid
-					if (!raster.shot.IsValid())
-						do_project = false;
-
-					// no drawing if raster is not active
-					// if(!raster->shot.IsValid())
-					//  do_project = false;
-
-					if (do_project) {
-						// making context current
-						glContext->makeCurrent();
-
-						// delete & reinit rendermanager
-						if (rendermanager != NULL)
-							delete rendermanager;
-						rendermanager = new RenderHelper();
-						if (rendermanager->initializeGL(cb) != 0) {
-							delete rendermanager;
-							throw MLException("Failed on initializing GL rendermanager.");
-						}
-						log("init GL");
-						/*if( rendermanager->initializeMeshBuffers(model, cb) != 0 )
-							return false;
-						Log("init Buffers");*/
-
-						// render normal & depth
-						rendermanager->renderScene(
-							raster.shot,
-							model,
-							RenderHelper::NORMAL,
-							glContext,
-							my_near[cam_ind] * 0.5,
-							my_far[cam_ind] * 1.25);
-
-						// unmaking context current
-						glContext->doneCurrent();
-
-						buff_ind = 0;
-
-						// If should be used silhouette weighting, it is needed to compute depth
-						// discontinuities and per-pixel distance from detected borders on the
-						// entire image here the weight is then applied later, per-vertex, when
-						// needed
-						floatbuffer* silhouette_buff = NULL;
-						float maxsildist = rendermanager->depth->sx + rendermanager->depth->sy;
-						if (usesilhouettes) {
-							silhouette_buff = new floatbuffer();
-							silhouette_buff->init(
-								rendermanager->depth->sx, rendermanager->depth->sy);
-
-							silhouette_buff->applysobel(rendermanager->depth);
-							// sprintf(dumpFileName,"Abord%i.pfm",cam_ind);
-							// silhouette_buff->dumppfm(dumpFileName);
-
-							silhouette_buff->initborder(rendermanager->depth);
-							// sprintf(dumpFileName,"Bbord%i.pfm",cam_ind);
-							// silhouette_buff->dumppfm(dumpFileName);
-
-							maxsildist = silhouette_buff->distancefield();
-							// sprintf(dumpFileName,"Cbord%i.pfm",cam_ind);
-							// silhouette_buff->dumppfm(dumpFileName);
-						}
-
-						for (vi = model->cm.vert.begin(); vi != model->cm.vert.end(); ++vi) {
-							if (!(*vi).IsD() && (!onselection || (*vi).IsS())) {
-								// pp is the projected point in image space
-								Point2m pp = raster.shot.Project((*vi).P());
-								// pray is the vector from the point-to-be-colored to the camera
-								// center
-								Point3m pray = (raster.shot.GetViewPoint() - (*vi).P()).Normalize();
-
-								// if inside image
-								if (pp[0] >= 0 && pp[1] >= 0 &&
-									pp[0] < raster.shot.Intrinsics.ViewportPx[0] &&
-									pp[1] < raster.shot.Intrinsics.ViewportPx[1]) {
-									if ((pray.dot(-raster.shot.Axis(2))) <= 0.0) {
-										depth  = raster.shot.Depth((*vi).P());
-										pdepth = rendermanager->depth->getval(
-											int(pp[0]),
-											int(pp[1])); //  rendermanager->depth[(int(pp[1]) *
-														 //  raster->shot.Intrinsics.ViewportPx[0])
-														 //  + int(pp[0])];
-
-										if (depth <= (pdepth + eta)) {
-											// determine color
-											QRgb pcolor = raster.currentPlane->image.pixel(
-												pp[0],
-												raster.shot.Intrinsics.ViewportPx[1] - pp[1]);
-											// determine weight
-											pweight = 1.0;
-
-											if (useangle) {
-												Point3m pixnorm = (*vi).N();
-												Point3m viewaxis =
-													raster.shot.GetViewPoint() - (*vi).P();
-												pixnorm.Normalize();
-												viewaxis.Normalize();
-
-												float ang = abs(pixnorm * viewaxis);
-												ang       = min(1.0f, ang);
-
-												pweight *= ang;
-											}
-
-											if (usedistance) {
-												float distw = depth;
-												distw = 1.0 - (distw - (allcammindepth * 0.99)) /
-																  ((allcammaxdepth * 1.01) -
-																   (allcammindepth * 0.99));
-
-												pweight *= distw;
-												pweight *= distw;
-											}
-
-											if (useborders) {
-												double xdist =
-													1.0 -
-													(abs(pp[0] -
-														 (raster.shot.Intrinsics.ViewportPx[0] /
-														  2.0)) /
-													 (raster.shot.Intrinsics.ViewportPx[0] / 2.0));
-												double ydist =
-													1.0 -
-													(abs(pp[1] -
-														 (raster.shot.Intrinsics.ViewportPx[1] /
-														  2.0)) /
-													 (raster.shot.Intrinsics.ViewportPx[1] / 2.0));
-												double borderw = min(xdist, ydist);
-												// borderw = min(1.0,borderw); //debug debug
-												// borderw = max(0.0,borderw); //debug debug
-
-												pweight *= borderw;
-											}
-
-											if (usesilhouettes) {
-												// here the silhouette weight is applied, but it is
-												// calculated before, on a per-image basis
-												float silw = 1.0;
-												silw       = silhouette_buff->getval(
-                                                           int(pp[0]), int(pp[1])) /
-													   maxsildist;
-												// silw = min(1.0f,silw); //debug debug
-												// silw = max(0.0f,silw); //debug debug
-
-												pweight *= silw;
-											}
-
-											if (usealphamask) { // alpha channel of image is an
-																// additional mask
-												pweight *= (qAlpha(pcolor) / 255.0);
-											}
-
-											weights[buff_ind] += pweight;
-											acc_red[buff_ind] += (qRed(pcolor) * pweight / 255.0);
-											acc_grn[buff_ind] += (qGreen(pcolor) * pweight / 255.0);
-											acc_blu[buff_ind] += (qBlue(pcolor) * pweight / 255.0);
-										}
-									}
-								}
-							}
-							buff_ind++;
-						}
-						cam_ind++;
-
-						if (usesilhouettes) {
-							delete silhouette_buff;
+			std::vector<RasterProjection> rasters = projectableRasters(md);
+			CMeshO&                       m       = model->cm;
+			projectRasters(
+				rasters,
+				m,
+				my_near,
+				my_far,
+				usecpudepth,
+				pw.usesilhouettes,
+				[&](const RasterProjection& rp) {
+					return renderDepthGL(
+						rp.raster->shot,
+						model,
+						my_near[rp.cam_ind] * 0.5,
+						my_far[rp.cam_ind] * 1.25,
+						cb);
+				},
+				[&](const RasterProjection& rp) {
+					// each vertex only touches its own accumulators
+#pragma omp parallel for schedule(static)
+					for (int i = 0; i < vertNum; ++i) {
+						const CVertexO& v = m.vert[i];
+						if (v.IsD() || (onselection && !v.IsS()))
+							continue;
+						QRgb   pcolor;
+						double pweight;
+						if (projectSample(rp, pw, v.cP(), v.cN(), pcolor, pweight)) {
+							weights[i] += pweight;
+							acc_red[i] += (qRed(pcolor) * pweight / 255.0);
+							acc_grn[i] += (qGreen(pcolor) * pweight / 255.0);
+							acc_blu[i] += (qBlue(pcolor) * pweight / 255.0);
 						}
-
-					} // end foreach camera
-				}     // end foreach camera
-			}
-
-			buff_ind = 0;
-			for (vi = model->cm.vert.begin(); vi != model->cm.vert.end(); ++vi) {
-				if (!(*vi).IsD() && (!onselection || (*vi).IsS())) {
-					if (weights[buff_ind] !=
-						0) // if 0, it has not found any valid projection on any camera
+					}
+				},
+				cb,
+				0,
+				95);
+
+			for (int i = 0; i < vertNum; ++i) {
+				CVertexO& v = m.vert[i];
+				if (!v.IsD() && (!onselection || v.IsS())) {
+					if (weights[i] != 0) // if 0, it has not found any valid projection on any camera
 					{
-						(*vi).C() = vcg::Color4b(
-							(acc_red[buff_ind] / weights[buff_ind]) * 255.0,
-							(acc_grn[buff_ind] / weights[buff_ind]) * 255.0,
-							(acc_blu[buff_ind] / weights[buff_ind]) * 255.0,
+						v.C() = vcg::Color4b(
+							(acc_red[i] / weights[i]) * 255.0,
+							(acc_grn[i] / weights[i]) * 255.0,
+							(acc_blu[i] / weights[i]) * 255.0,
 							255);
 					}
 					else {
 						if ((blank.red() != 0) || (blank.green() != 0) || (blank.blue() != 0) ||
 							(blank.alpha() != 0))
-							(*vi).C() = vcg::Color4b(
+							v.C() = vcg::Color4b(
 								blank.red(), blank.green(), blank.blue(), blank.alpha());
 					}
 				}
-				buff_ind++;
 			}
 
 			// the mesh has to return to its original position
 			tri::UpdatePosition<CMeshO>::Matrix(model->cm, Inverse(model->cm.Tr), true);
 			tri::UpdateBounding<CMeshO>::Box(model->cm);
-
-			// delete rendermanager
-			if (rendermanager != NULL)
-				delete rendermanager;
-
-			// delete accumulation buffers
-			delete[] weights;
-			delete[] acc_red;
-			delete[] acc_grn;
-			delete[] acc_blu;
-
 		} break;
 
 		case FP_MULTIIMAGETRIVIALPROJTEXTURE: {
@@ -690,35 +737,23 @@ std::map<std::string, QVariant> FilterColorProjectionPlugin::applyFilter(
 			}
 
 			// bool onselection = par.getBool("onselection");
-			int     texsize        = par.getInt("texsize");
-			bool    dorefill       = par.getBool("dorefill");
-			Scalarm eta            = par.getFloat("deptheta");
-			bool    useangle       = par.getBool("useangle");
-			bool    usedistance    = par.getBool("usedistance");
-			bool    useborders     = par.getBool("useborders");
-			bool    usesilhouettes = par.getBool("usesilhouettes");
-			bool    usealphamask   = par.getBool("usealpha");
-			QString textName       = par.getString("textName");
+			int     texsize     = par.getInt("texsize");
+			bool    dorefill    = par.getBool("dorefill");
+			bool    usecpudepth = par.getBool("usecpudepth");
+			QString textName    = par.getString("textName");
+			ProjectionWeighting pw;
+			pw.eta            = par.getFloat("deptheta");
+			pw.useangle       = par.getBool("useangle");
+			pw.usedistance    = par.getBool("usedistance");
+			pw.useborders     = par.getBool("useborders");
+			pw.usesilhouettes = par.getBool("usesilhouettes");
+			pw.usealphamask   = par.getBool("usealpha");
 
 			int textW = texsize;
 			int textH = texsize;
 
-			Scalarm    depth  = 0; // depth of point (distance from camera)
-			Scalarm    pdepth = 0; // depth value of projected point (from depth map)
-			double     pweight;    // pixel weight
-			MeshModel* model;
-			bool       do_project;
-			int        cam_ind;
-
-			// min max depth for depth weight normalization
-			float allcammaxdepth;
-			float allcammindepth;
-
-			// max image size for border weight normalization
-			float allcammaximagesize;
-
 			// get the working model
-			model = md.mm();
+			MeshModel* model = md.mm();
 
 			// the mesh has to be correctly transformed before mapping
 			tri::UpdatePosition<CMeshO>::Matrix(model->cm, model->cm.Tr, true);
@@ -784,190 +819,56 @@ std::map<std::string, QVariant> FilterColorProjectionPlugin::applyFilter(
 			std::vector<float> my_far;
 			calculateNearFarAccurate(md, &my_near, &my_far);
 
-			allcammaxdepth     = -1000000;
-			allcammindepth     = 1000000;
-			allcammaximagesize = -1000000;
-			cam_ind            = 0;
-			for (const RasterModel& rm : md.rasterIterator()) {
-				if (my_far[cam_ind] > allcammaxdepth)
-					allcammaxdepth = my_far[cam_ind];
-				if (my_near[cam_ind] < allcammindepth)
-					allcammindepth = my_near[cam_ind];
-
-				float imgdiag = sqrt(
-					double(rm.shot.Intrinsics.ViewportPx[0] * rm.shot.Intrinsics.ViewportPx[1]));
-				if (imgdiag > allcammaximagesize)
-					allcammaximagesize = imgdiag;
-				cam_ind++;
+			pw.allcammaxdepth = -1000000;
+			pw.allcammindepth = 1000000;
+			for (size_t cam_ind = 0; cam_ind < my_near.size(); cam_ind++) {
+				if (my_far[cam_ind] > pw.allcammaxdepth)
+					pw.allcammaxdepth = my_far[cam_ind];
+				if (my_near[cam_ind] < pw.allcammindepth)
+					pw.allcammindepth = my_near[cam_ind];
 			}
 
 			//-- cycle all cameras
-			cam_ind = 0;
-			for (const RasterModel& raster : md.rasterIterator()) {
-				if (raster.isVisible()) {
-					do_project = true;
-
-					// no drawing if camera not valid
-					if (!raster.shot.IsValid())
-						do_project = false;
-
-					// no drawing if raster is not active
-					// if(!raster->shot.IsValid())
-					//  do_project = false;
-
-					if (do_project) {
-						// making context current
-						glContext->makeCurrent();
-
-						// delete & reinit rendermanager
-						if (rendermanager != NULL)
-							delete rendermanager;
-						rendermanager = new RenderHelper();
-						if (rendermanager->initializeGL(cb) != 0) {
-							delete rendermanager;
-							throw MLException("Failed on initializing GL rendermanager.");
-						}
-						log("init GL");
-						/*if( rendermanager->initializeMeshBuffers(model, cb) != 0 )
-							return false;
-						Log("init Buffers");*/
-
-						// render normal & depth
-						rendermanager->renderScene(
-							raster.shot,
-							model,
-							RenderHelper::NORMAL,
-							glContext,
-							my_near[cam_ind] * 0.5,
-							my_far[cam_ind] * 1.25);
-
-						// unmaking context current
-						glContext->doneCurrent();
-
-						// If should be used silhouette weighting, it is needed to compute depth
-						// discontinuities and per-pixel distance from detected borders on the
-						// entire image here the weight is then applied later, per-vertex, when
-						// needed
-						floatbuffer* silhouette_buff = NULL;
-						float maxsildist = rendermanager->depth->sx + rendermanager->depth->sy;
-						if (usesilhouettes) {
-							silhouette_buff = new floatbuffer();
-							silhouette_buff->init(
-								rendermanager->depth->sx, rendermanager->depth->sy);
-
-							silhouette_buff->applysobel(rendermanager->depth);
-							// sprintf(dumpFileName,"Abord%i.bmp",cam_ind);
-							// silhouette_buff->dumpbmp(dumpFileName);
-
-							silhouette_buff->initborder(rendermanager->depth);
-							// sprintf(dumpFileName,"Bbord%i.bmp",cam_ind);
-							// silhouette_buff->dumpbmp(dumpFileName);
-
-							maxsildist = silhouette_buff->distancefield();
-							// sprintf(dumpFileName,"Cbord%i.bmp",cam_ind);
-							// silhouette_buff->dumpbmp(dumpFileName);
-						}
-
-						for (size_t texcount = 0; texcount < texels.size(); texcount++) {
-							Point2m pp = raster.shot.Project(texels[texcount].meshpoint);
-							// pray is the vector from the point-to-be-colored to the camera center
-							Point3m pray = (raster.shot.GetViewPoint() - texels[texcount].meshpoint)
-											   .Normalize();
-
-							// if inside image
-							if (pp[0] > 0 && pp[1] > 0 &&
-								pp[0] < raster.shot.Intrinsics.ViewportPx[0] &&
-								pp[1] < raster.shot.Intrinsics.ViewportPx[1]) {
-								if ((pray.dot(-raster.shot.Axis(2))) <= 0.0) {
-									depth  = raster.shot.Depth(texels[texcount].meshpoint);
-									pdepth = rendermanager->depth->getval(
-										int(pp[0]),
-										int(pp[1])); //  rendermanager->depth[(int(pp[1]) *
-													 //  raster->shot.Intrinsics.ViewportPx[0]) +
-													 //  int(pp[0])];
-
-									if (depth <= (pdepth + eta)) {
-										// determine color
-										QRgb pcolor = raster.currentPlane->image.pixel(
-											pp[0], raster.shot.Intrinsics.ViewportPx[1] - pp[1]);
-										// determine weight
-										pweight = 1.0;
-
-										if (useangle) {
-											Point3m pixnorm = texels[texcount].meshnormal;
-											pixnorm.Normalize();
-
-											Point3m viewaxis = raster.shot.GetViewPoint() -
-															   texels[texcount].meshpoint;
-											viewaxis.Normalize();
-
-											float ang = abs(pixnorm * viewaxis);
-											ang       = min(1.0f, ang);
-
-											pweight *= ang;
-										}
-
-										if (usedistance) {
-											float distw = depth;
-											distw       = 1.0 - (distw - (allcammindepth * 0.99)) /
-															  ((allcammaxdepth * 1.01) -
-															   (allcammindepth * 0.99));
-
-											pweight *= distw;
-											pweight *= distw;
-										}
-
-										if (useborders) {
-											double xdist =
-												1.0 -
-												(abs(pp[0] -
-													 (raster.shot.Intrinsics.ViewportPx[0] / 2.0)) /
-												 (raster.shot.Intrinsics.ViewportPx[0] / 2.0));
-											double ydist =
-												1.0 -
-												(abs(pp[1] -
-													 (raster.shot.Intrinsics.ViewportPx[1] / 2.0)) /
-												 (raster.shot.Intrinsics.ViewportPx[1] / 2.0));
-											double borderw = min(xdist, ydist);
-
-											pweight *= borderw;
-										}
-
-										if (usesilhouettes) {
-											// here the silhouette weight is applied, but it is
-											// calculated before, on a per-image basis
-											float silw = 1.0;
-											silw = silhouette_buff->getval(int(pp[0]), int(pp[1])) /
-												   maxsildist;
-											pweight *= silw;
-										}
-
-										if (usealphamask) { // alpha channel of image is an
-															// additional mask
-											pweight *= (qAlpha(pcolor) / 255.0);
-										}
-
-										accums[texcount].weights += pweight;
-										accums[texcount].acc_red +=
-											(qRed(pcolor) * pweight / 255.0);
-										accums[texcount].acc_grn +=
-											(qGreen(pcolor) * pweight / 255.0);
-										accums[texcount].acc_blu +=
-											(qBlue(pcolor) * pweight / 255.0);
-									}
-								}
-							}
-
-						} // end foreach texel
-						cam_ind++;
-
-						if (usesilhouettes) {
-							delete silhouette_buff;
+			std::vector<RasterProjection> rasters  = projectableRasters(md);
+			const int                     texelNum = texels.size();
+			projectRasters(
+				rasters,
+				model->cm,
+				my_near,
+				my_far,
+				usecpudepth,
+				pw.usesilhouettes,
+				[&](const RasterProjection& rp) {
+					return renderDepthGL(
+						rp.raster->shot,
+						model,
+						my_near[rp.cam_ind] * 0.5,
+						my_far[rp.cam_ind] * 1.25,
+						cb);
+				},
+				[&](const RasterProjection& rp) {
+					// each texel only touches its own accumulator
+#pragma omp parallel for schedule(static)
+					for (int texcount = 0; texcount < texelNum; texcount++) {
+						QRgb   pcolor;
+						double pweight;
+						if (projectSample(
+								rp,
+								pw,
+								texels[texcount].meshpoint,
+								texels[texcount].meshnormal,
+								pcolor,
+								pweight)) {
+							accums[texcount].weights += pweight;
+							accums[texcount].acc_red += (qRed(pcolor) * pweight / 255.0);
+							accums[texcount].acc_grn += (qGreen(pcolor) * pweight / 255.0);
+							accums[texcount].acc_blu += (qBlue(pcolor) * pweight / 255.0);
 						}
-
-					} // end if(do_project)
-				}
-			} // end foreach camera
+					}
+				},
+				cb,
+				82,
+				3);
 
 			// for each texel.... divide accumulated values by weight and write to texture
 			for (size_t texcount = 0; texcount < texels.size(); texcount++) {
@@ -998,7 +899,7 @@ std::map<std::string, QVariant> FilterColorProjectionPlugin::applyFilter(
 			if (dorefill) {
 				cb(85, "Filling texture holes...");
 
-				PullPush(img, qRgba(0, 0, 0, 0)); // atlas gaps
+				meshlab::pullPush(img, qRgba(0, 0, 0, 0)); // atlas gaps
 			}
 
 			// Undo topology changes
@@ -1021,7 +922,11 @@ std::map<std::string, QVariant> FilterColorProjectionPlugin::applyFilter(
 		return std::map<std::string, QVariant>();
 	}
 	else {
-		throw MLException("Fatal error: glContext not initialized");
+		if (ID(filter) == FP_SINGLEIMAGEPROJ)
+			throw MLException("Fatal error: glContext not initialized");
+		throw MLException(
+			"Fatal error: glContext not initialized; enable \"Compute depth maps on CPU\" to run this "
+			"filter without OpenGL");
 	}
 }
 
@@ -1046,6 +951,39 @@ int FilterColorProjectionPlugin::postCondition(const QAction* a) const
 	}
 }
 
+// renders the depth map of the given shot with OpenGL; the returned buffer is owned by the caller
+floatbuffer* FilterColorProjectionPlugin::renderDepthGL(
+	const Shotm&      shot,
+	MeshModel*        model,
+	float             camNear,
+	float             camFar,
+	vcg::CallBackPos* cb)
+{
+	if (glContext == nullptr)
+		throw MLException("Fatal error: glContext not initialized");
+
+	// making context current
+	glContext->makeCurrent();
+
+	RenderHelper* rendermanager = new RenderHelper();
+	if (rendermanager->initializeGL(cb) != 0) {
+		delete rendermanager;
+		glContext->doneCurrent();
+		throw MLException("Failed on initializing GL rendermanager.");
+	}
+	log("init GL");
+
+	// render normal & depth
+	rendermanager->renderScene(shot, model, RenderHelper::NORMAL, glContext, camNear, camFar);
+	floatbuffer* depth = new floatbuffer(rendermanager->depth);
+	delete rendermanager;
+
+	// unmaking context current
+	glContext->doneCurrent();
+
+	return depth;
+}
+
 //--- this function calculates the near and far values
 int FilterColorProjectionPlugin::calculateNearFarAccurate(
 	MeshDocument&       md,
@@ -27,6 +27,8 @@
 #include <QObject>
 #include <common/plugins/interfaces/filter_plugin.h>
 
+class floatbuffer;
+
 class FilterColorProjectionPlugin : public QObject, public FilterPlugin
 {
 	Q_OBJECT
@@ -53,6 +55,7 @@ class FilterColorProjectionPlugin : public QObject, public FilterPlugin
 	FilterArity filterArity(const QAction *) const {return SINGLE_MESH;}
 private:
 	int calculateNearFarAccurate(MeshDocument &md, std::vector<float> *near, std::vector<float> *far);
+	floatbuffer* renderDepthGL(const Shotm& shot, MeshModel* model, float camNear, float camFar, vcg::CallBackPos* cb);
 };
 
 #endif
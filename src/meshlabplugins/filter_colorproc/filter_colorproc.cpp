@@ -25,6 +25,8 @@
 #include <vcg/space/colormap.h>
 #include "filter_colorproc.h"
 
+#include <common/utilities/parallel_reductions.h>
+
 #include <vcg/complex/algorithms/clean.h>
 #include <vcg/complex/algorithms/stat.h>
 #include <vcg/complex/algorithms/smooth.h>
@@ -36,6 +38,7 @@
 
 #include <stdlib.h>
 #include <time.h>
+#include <tuple>
 
 // ERROR CHECKING UTILITY
 #define CheckError(x,y); if ((x)) {throw MLException((y));}
@@ -387,7 +390,7 @@ RichParameterList FilterColorProc::initParameterList(const QAction *a, const Mes
 	case CP_CLAMP_QUALITY:
 	{
 		pair<float, float> minmax;
-		minmax = tri::Stat<CMeshO>::ComputePerVertexQualityMinMax(md.mm()->cm);
+		minmax = meshlab::perVertexQualityMinMax(md.mm()->cm);
 		par.addParam(RichFloat("minVal", minmax.first, "Min", "The value that will be mapped with the lower end of the scale (red)"));
 		par.addParam(RichFloat("maxVal", minmax.second, "Max", "The value that will be mapped with the upper end of the scale (blue)"));
 		par.addParam(RichDynamicFloat("perc", 0, 0, 100, "Percentile Crop [0..100]", "If not zero this value will be used for a percentile cropping of the quality values.<br> If this parameter is set to a value <i>P</i> then the two values <i>V_min,V_max</i> for which <i>P</i>% of the vertices have a quality <b>lower or greater</b> than <i>V_min,V_max</i> are used as min/max values for clamping.<br><br> The automated percentile cropping is very useful for automatically discarding outliers."));
@@ -397,7 +400,7 @@ RichParameterList FilterColorProc::initParameterList(const QAction *a, const Mes
 	case CP_MAP_VQUALITY_INTO_COLOR:
 	{
 		pair<float, float> minmax;
-		minmax = tri::Stat<CMeshO>::ComputePerVertexQualityMinMax(md.mm()->cm);
+		minmax = meshlab::perVertexQualityMinMax(md.mm()->cm);
 		par.addParam(RichFloat("minVal", minmax.first, "Min", "The value that will be mapped with the lower end of the scale (red)"));
 		par.addParam(RichFloat("maxVal", minmax.second, "Max", "The value that will be mapped with the upper end of the scale (blue)"));
 		par.addParam(RichDynamicFloat("perc", 0, 0, 100, "Percentile Crop [0..100]", "If not zero this value will be used for a percentile cropping of the quality values.<br> If this parameter is set to a value <i>P</i> then the two values <i>V_min,V_max</i> for which <i>P</i>% of the vertices have a quality <b>lower or greater</b> than <i>V_min,V_max</i> are used as min/max values for clamping.<br><br> The automated percentile cropping is very useful for automatically discarding outliers."));
@@ -410,7 +413,7 @@ RichParameterList FilterColorProc::initParameterList(const QAction *a, const Mes
 	case CP_MAP_FQUALITY_INTO_COLOR:
 	{
 		pair<float, float> minmax;
-		minmax = tri::Stat<CMeshO>::ComputePerFaceQualityMinMax(md.mm()->cm);
+		minmax = meshlab::perFaceQualityMinMax(md.mm()->cm);
 		par.addParam(RichFloat("minVal", minmax.first, "Min", "The value that will be mapped with the lower end of the scale (red)"));
 		par.addParam(RichFloat("maxVal", minmax.second, "Max", "The value that will be mapped with the upper end of the scale (blue)"));
 		par.addParam(RichDynamicFloat("perc", 0, 0, 100, "Percentile Crop [0..100]", "If not zero this value will be used for a percentile cropping of the quality values.<br> If this parameter is set to a value <i>P</i> then the two values <i>V_min,V_max</i> for which <i>P</i>% of the faces have a quality <b>lower or greater</b> than <i>V_min,V_max</i> are used as min/max values for clamping.<br><br> The automated percentile cropping is very useful for automatically discarding outliers."));
@@ -797,7 +800,7 @@ std::map<std::string, QVariant> FilterColorProc::applyFilter(const QAction *filt
 			case 3: { // Area of triangle
 						for (fi = m->cm.face.begin(); fi != m->cm.face.end(); ++fi) if (!(*fi).IsD())
 							(*fi).Q() = vcg::DoubleArea((*fi))*0.5f;
-						tri::Stat<CMeshO>::ComputePerFaceQualityMinMax(m->cm, minV, maxV);
+						std::tie(minV, maxV) = meshlab::perFaceQualityMinMax(m->cm);
 			} break;
 
 			case 4: { //TEXTURE Angle Distortion
@@ -999,6 +1002,7 @@ std::map<std::string, QVariant> FilterColorProc::applyFilter(const QAction *filt
 		default:
 			wrongActionCalled(filter);
 	}
+
 	return values;
 }
 
@@ -0,0 +1,400 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "embree_scene_cache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace {
+
+const unsigned int DEFAULT_CAPACITY = 4;
+
+inline unsigned long long mix(unsigned long long x)
+{
+    // splitmix64 finalizer
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+inline unsigned long long floatBits(Scalarm s)
+{
+    unsigned long long b = 0;
+    std::memcpy(&b, &s, sizeof(Scalarm));
+    return b;
+}
+
+inline RTCRay makeRay(const Point3m& origin, const Point3m& dir, Scalarm tnear, Scalarm tfar)
+{
+    Point3m d = dir;
+    d.Normalize();
+    RTCRay ray;
+    ray.org_x = origin[0];
+    ray.org_y = origin[1];
+    ray.org_z = origin[2];
+    ray.tnear = tnear;
+    ray.dir_x = d[0];
+    ray.dir_y = d[1];
+    ray.dir_z = d[2];
+    ray.time  = 0;
+    ray.tfar  = tfar;
+    ray.mask  = -1;
+    ray.id    = 0;
+    ray.flags = 0;
+    return ray;
+}
+
+} // namespace
+
+EmbreeSceneCache::EmbreeSceneCache() : maxEntries(DEFAULT_CAPACITY)
+{
+}
+
+EmbreeSceneCache& EmbreeSceneCache::instance()
+{
+    static EmbreeSceneCache cache;
+    return cache;
+}
+
+/**
+ * @brief Tracks the meshes of the given document, so that the scenes of the
+ * meshes removed from it (or of the whole document, when it is destroyed) are
+ * released immediately. Meshes of documents that are not watched are dropped
+ * at the first change of a watched document.
+ */
+void EmbreeSceneCache::watch(MeshDocument& md)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!documents.insert(&md).second)
+        return;
+
+    const MeshDocument* doc = &md;
+    QObject::connect(&md, &MeshDocument::meshSetChanged, &context, [this]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        dropRemovedMeshes();
+    });
+    // emitted when the meshes of the document have already been destroyed
+    QObject::connect(&md, &QObject::destroyed, &context, [this, doc]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        documents.erase(doc);
+        dropRemovedMeshes();
+    });
+}
+
+/**
+ * @brief Returns the Embree scene of the given mesh, building it only if the
+ * mesh has never been seen or its geometry changed since the last request.
+ * @param reused: if not null, set to true when a cached scene is returned
+ */
+std::shared_ptr<EmbreeSceneCache::Adaptor> EmbreeSceneCache::adaptor(MeshModel& m, bool* reused)
+{
+    const unsigned long long fp = fingerprint(m.cm);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->mesh == &m && it->meshId == m.id()) {
+                if (it->fingerprint == fp) {
+                    entries.splice(entries.begin(), entries, it);
+                    if (reused)
+                        *reused = true;
+                    return entries.front().adaptor;
+                }
+                entries.erase(it);
+                break;
+            }
+        }
+    }
+
+    // the BVH is built outside the lock, other meshes can be queried meanwhile
+    std::shared_ptr<Adaptor> a = std::make_shared<Adaptor>(m.cm);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry e;
+    e.mesh        = &m;
+    e.meshId      = m.id();
+    e.fingerprint = fp;
+    e.adaptor     = a;
+    entries.push_front(e);
+    shrink();
+    if (reused)
+        *reused = false;
+    return a;
+}
+
+void EmbreeSceneCache::invalidate(const MeshModel& m)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.remove_if([&](const Entry& e) { return e.mesh == &m; });
+}
+
+void EmbreeSceneCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+}
+
+unsigned int EmbreeSceneCache::capacity() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return maxEntries;
+}
+
+/**
+ * @brief Sets the maximum number of meshes whose scene is kept in memory;
+ * 0 disables the cache.
+ */
+void EmbreeSceneCache::setCapacity(unsigned int n)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    maxEntries = n;
+    shrink();
+}
+
+void EmbreeSceneCache::shrink()
+{
+    while (entries.size() > maxEntries)
+        entries.pop_back();
+}
+
+/* must be called with the mutex locked; the cached mesh pointers are only
+ * compared, never dereferenced */
+void EmbreeSceneCache::dropRemovedMeshes()
+{
+    entries.remove_if([&](const Entry& e) {
+        for (const MeshDocument* doc : documents)
+            for (const MeshModel& mm : doc->meshIterator())
+                if (&mm == e.mesh && mm.id() == e.meshId)
+                    return false;
+        return true;
+    });
+}
+
+/**
+ * @brief Order independent hash of the data used to build the scene: vertex
+ * positions and face-vertex indices.
+ */
+unsigned long long EmbreeSceneCache::fingerprint(const CMeshO& m)
+{
+    unsigned long long h = mix(m.vert.size()) ^ mix(m.face.size() + 0x9e3779b97f4a7c15ULL);
+
+    const int vertNum = m.vert.size();
+    const int faceNum = m.face.size();
+    // data() instead of &m.vert[0], that is undefined for an empty mesh
+    const CVertexO* const vertBase = m.vert.data();
+
+    unsigned long long vh = 0;
+#pragma omp parallel for reduction(+ : vh)
+    for (int i = 0; i < vertNum; ++i) {
+        const CVertexO& v = m.vert[i];
+        if (v.IsD())
+            continue;
+        unsigned long long k = mix(i);
+        for (int j = 0; j < 3; ++j)
+            k = mix(k ^ floatBits(v.cP()[j]));
+        vh += k;
+    }
+
+    unsigned long long fh = 0;
+#pragma omp parallel for reduction(+ : fh)
+    for (int i = 0; i < faceNum; ++i) {
+        const CFaceO& f = m.face[i];
+        if (f.IsD())
+            continue;
+        unsigned long long k = mix(~(unsigned long long) i);
+        for (int j = 0; j < 3; ++j)
+            k = mix(k ^ (unsigned long long) (f.cV(j) - vertBase));
+        fh += k;
+    }
+
+    return mix(h ^ vh) ^ fh;
+}
+
+const int EmbreeRayQuery::PACKET_SIZE;
+
+EmbreeRayQuery::EmbreeRayQuery(MeshModel& m) : adaptor(EmbreeSceneCache::instance().adaptor(m))
+{
+}
+
+EmbreeRayQuery::Hit EmbreeRayQuery::firstHit(
+    const Point3m& origin,
+    const Point3m& dir,
+    Scalarm        tnear,
+    Scalarm        tfar) const
+{
+    RTCRayHit rayhit;
+    rayhit.ray           = makeRay(origin, dir, tnear, tfar);
+    rayhit.hit.geomID    = RTC_INVALID_GEOMETRY_ID;
+    rayhit.hit.primID    = RTC_INVALID_GEOMETRY_ID;
+    rayhit.hit.instID[0] = RTC_INVALID_GEOMETRY_ID;
+    rtcIntersect1(adaptor->scene, &rayhit);
+
+    Hit hit;
+    if (rayhit.hit.geomID != RTC_INVALID_GEOMETRY_ID) {
+        hit.faceIndex = rayhit.hit.primID;
+        hit.t         = rayhit.ray.tfar;
+        hit.u         = rayhit.hit.u;
+        hit.v         = rayhit.hit.v;
+        hit.normal    = Point3m(rayhit.hit.Ng_x, rayhit.hit.Ng_y, rayhit.hit.Ng_z);
+    }
+    return hit;
+}
+
+bool EmbreeRayQuery::occluded(
+    const Point3m& origin,
+    const Point3m& dir,
+    Scalarm        tnear,
+    Scalarm        tfar) const
+{
+    RTCRay ray = makeRay(origin, dir, tnear, tfar);
+    rtcOccluded1(adaptor->scene, &ray);
+    // tfar is set to -inf when an occluder is found
+    return ray.tfar < 0;
+}
+
+namespace {
+
+struct alignas(32) RayPacket
+{
+    RTCRayHit8 rayhit;
+    int        valid[EmbreeRayQuery::PACKET_SIZE];
+
+    void init(const Point3m* origins, const Point3m* dirs, int n, Scalarm tnear, Scalarm tfar)
+    {
+        for (int i = 0; i < EmbreeRayQuery::PACKET_SIZE; ++i) {
+            valid[i] = i < n ? -1 : 0;
+            if (i >= n)
+                continue;
+            RTCRay ray = makeRay(origins[i], dirs[i], tnear, tfar);
+            rayhit.ray.org_x[i]     = ray.org_x;
+            rayhit.ray.org_y[i]     = ray.org_y;
+            rayhit.ray.org_z[i]     = ray.org_z;
+            rayhit.ray.tnear[i]     = ray.tnear;
+            rayhit.ray.dir_x[i]     = ray.dir_x;
+            rayhit.ray.dir_y[i]     = ray.dir_y;
+            rayhit.ray.dir_z[i]     = ray.dir_z;
+            rayhit.ray.time[i]      = 0;
+            rayhit.ray.tfar[i]      = ray.tfar;
+            rayhit.ray.mask[i]      = ray.mask;
+            rayhit.ray.id[i]        = i;
+            rayhit.ray.flags[i]     = 0;
+            rayhit.hit.geomID[i]    = RTC_INVALID_GEOMETRY_ID;
+            rayhit.hit.primID[i]    = RTC_INVALID_GEOMETRY_ID;
+            rayhit.hit.instID[0][i] = RTC_INVALID_GEOMETRY_ID;
+        }
+    }
+};
+
+} // namespace
+
+void EmbreeRayQuery::firstHitPacket(
+    const Point3m* origins,
+    const Point3m* dirs,
+    int            n,
+    Hit*           hits,
+    Scalarm        tnear,
+    Scalarm        tfar) const
+{
+    assert(n <= PACKET_SIZE);
+    RayPacket p;
+    p.init(origins, dirs, n, tnear, tfar);
+    rtcIntersect8(p.valid, adaptor->scene, &p.rayhit);
+    for (int i = 0; i < n; ++i) {
+        Hit& hit = hits[i];
+        hit = Hit();
+        if (p.rayhit.hit.geomID[i] != RTC_INVALID_GEOMETRY_ID) {
+            hit.faceIndex = p.rayhit.hit.primID[i];
+            hit.t         = p.rayhit.ray.tfar[i];
+            hit.u         = p.rayhit.hit.u[i];
+            hit.v         = p.rayhit.hit.v[i];
+            hit.normal    = Point3m(
+                p.rayhit.hit.Ng_x[i], p.rayhit.hit.Ng_y[i], p.rayhit.hit.Ng_z[i]);
+        }
+    }
+}
+
+void EmbreeRayQuery::occludedPacket(
+    const Point3m* origins,
+    const Point3m* dirs,
+    int            n,
+    char*          result,
+    Scalarm        tnear,
+    Scalarm        tfar) const
+{
+    assert(n <= PACKET_SIZE);
+    RayPacket p;
+    p.init(origins, dirs, n, tnear, tfar);
+    rtcOccluded8(p.valid, adaptor->scene, &p.rayhit.ray);
+    for (int i = 0; i < n; ++i)
+        result[i] = p.rayhit.ray.tfar[i] < 0 ? 1 : 0;
+}
+
+void EmbreeRayQuery::firstHits(
+    const std::vector<Point3m>& origins,
+    const std::vector<Point3m>& dirs,
+    std::vector<Hit>&           hits,
+    Scalarm                     tnear,
+    Scalarm                     tfar) const
+{
+    const int n = std::min(origins.size(), dirs.size());
+    hits.resize(n);
+    const int packets = (n + PACKET_SIZE - 1) / PACKET_SIZE;
+#pragma omp parallel for schedule(dynamic, 128)
+    for (int i = 0; i < packets; ++i) {
+        const int first = i * PACKET_SIZE;
+        firstHitPacket(
+            &origins[first],
+            &dirs[first],
+            std::min(PACKET_SIZE, n - first),
+            &hits[first],
+            tnear,
+            tfar);
+    }
+}
+
+void EmbreeRayQuery::occluded(
+    const std::vector<Point3m>& origins,
+    const std::vector<Point3m>& dirs,
+    std::vector<char>&          result,
+    Scalarm                     tnear,
+    Scalarm                     tfar) const
+{
+    const int n = std::min(origins.size(), dirs.size());
+    result.resize(n);
+    const int packets = (n + PACKET_SIZE - 1) / PACKET_SIZE;
+#pragma omp parallel for schedule(dynamic, 128)
+    for (int i = 0; i < packets; ++i) {
+        const int first = i * PACKET_SIZE;
+        occludedPacket(
+            &origins[first],
+            &dirs[first],
+            std::min(PACKET_SIZE, n - first),
+            &result[first],
+            tnear,
+            tfar);
+    }
+}
@@ -0,0 +1,166 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef EMBREE_SCENE_CACHE_H
+#define EMBREE_SCENE_CACHE_H
+
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include <QObject>
+
+#include <common/ml_document/mesh_document.h>
+#include <wrap/embree/EmbreeAdaptor.h>
+
+/**
+ * @brief The EmbreeSceneCache class keeps the Embree scene (and therefore its
+ * BVH) of the most recently used meshes, so that consecutive ray casting
+ * filters on the same mesh do not rebuild it every time.
+ *
+ * A cached scene is valid as long as the vertex positions and the face
+ * connectivity of the mesh do not change: they are checked through a
+ * fingerprint computed (in parallel) at every request, that is much cheaper
+ * than building the BVH and does not rely on the caller marking the changes.
+ *
+ * The scenes are shared pointers, so a scene evicted or invalidated while
+ * still in use stays alive until its last user releases it.
+ *
+ * The documents passed to watch() are tracked: when their mesh set changes or
+ * they are destroyed, the entries of the meshes that no longer exist are
+ * dropped, instead of keeping their BVH until they are evicted.
+ */
+class EmbreeSceneCache
+{
+public:
+    typedef EmbreeAdaptor<CMeshO> Adaptor;
+
+    static EmbreeSceneCache& instance();
+
+    void watch(MeshDocument& md);
+    std::shared_ptr<Adaptor> adaptor(MeshModel& m, bool* reused = nullptr);
+    void invalidate(const MeshModel& m);
+    void clear();
+
+    unsigned int capacity() const;
+    void setCapacity(unsigned int n);
+
+private:
+    struct Entry
+    {
+        const MeshModel*         mesh;
+        int                      meshId;
+        unsigned long long       fingerprint;
+        std::shared_ptr<Adaptor> adaptor;
+    };
+
+    EmbreeSceneCache();
+
+    static unsigned long long fingerprint(const CMeshO& m);
+    void shrink();
+    void dropRemovedMeshes();
+
+    mutable std::mutex            mutex;
+    std::list<Entry>              entries; // most recently used first
+    unsigned int                  maxEntries;
+    std::set<const MeshDocument*> documents; // documents passed to watch()
+    QObject                       context;   // disconnects them when the cache is destroyed
+};
+
+/**
+ * @brief The EmbreeRayQuery class is a small ray query interface on the
+ * cached scene of a mesh, for code that needs ray casting without
+ * the full EmbreeAdaptor algorithms (e.g. picking, visibility or distance
+ * along a direction).
+ *
+ * All the queries are const and thread safe. Face indices refer to the
+ * position in m.cm.face, so the mesh is expected to be compact, as for
+ * EmbreeAdaptor.
+ */
+class EmbreeRayQuery
+{
+public:
+    struct Hit
+    {
+        int     faceIndex = -1; // -1 if nothing has been hit
+        Scalarm t         = 0;  // distance along the (normalized) direction
+        Scalarm u         = 0;  // barycentric coords of the hit point
+        Scalarm v         = 0;  // w.r.t. the vertices 1 and 2 of the face
+        Point3m normal;         // unnormalized geometric normal
+
+        bool valid() const { return faceIndex >= 0; }
+    };
+
+    explicit EmbreeRayQuery(MeshModel& m);
+
+    Hit firstHit(
+        const Point3m& origin,
+        const Point3m& dir,
+        Scalarm        tnear = 0,
+        Scalarm        tfar  = std::numeric_limits<Scalarm>::infinity()) const;
+    bool occluded(
+        const Point3m& origin,
+        const Point3m& dir,
+        Scalarm        tnear = 0,
+        Scalarm        tfar  = std::numeric_limits<Scalarm>::infinity()) const;
+
+    // packets of up to PACKET_SIZE rays traced together, faster for coherent
+    // rays (e.g. sharing the origin)
+    static const int PACKET_SIZE = 8;
+    void firstHitPacket(
+        const Point3m* origins,
+        const Point3m* dirs,
+        int            n,
+        Hit*           hits,
+        Scalarm        tnear = 0,
+        Scalarm        tfar  = std::numeric_limits<Scalarm>::infinity()) const;
+    void occludedPacket(
+        const Point3m* origins,
+        const Point3m* dirs,
+        int            n,
+        char*          result, // 1 if occluded
+        Scalarm        tnear = 0,
+        Scalarm        tfar  = std::numeric_limits<Scalarm>::infinity()) const;
+
+    // batched versions, packets are traced in parallel
+    void firstHits(
+        const std::vector<Point3m>& origins,
+        const std::vector<Point3m>& dirs,
+        std::vector<Hit>&           hits,
+        Scalarm                     tnear = 0,
+        Scalarm                     tfar  = std::numeric_limits<Scalarm>::infinity()) const;
+    void occluded(
+        const std::vector<Point3m>& origins,
+        const std::vector<Point3m>& dirs,
+        std::vector<char>&          result, // 1 if occluded
+        Scalarm                     tnear = 0,
+        Scalarm                     tfar  = std::numeric_limits<Scalarm>::infinity()) const;
+
+private:
+    std::shared_ptr<EmbreeSceneCache::Adaptor> adaptor;
+};
+
+#endif // EMBREE_SCENE_CACHE_H
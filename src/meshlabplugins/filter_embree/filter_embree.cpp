@@ -22,7 +22,8 @@
 ****************************************************************************/
 
 #include "filter_embree.h"
-#include <wrap/embree/EmbreeAdaptor.h>
+#include "embree_scene_cache.h"
+#include "progressive_sampling.h"
 #include <QCoreApplication>
 /**
  * @brief Constructor usually performs only two simple tasks of filling the two lists
@@ -134,6 +135,7 @@ QString FilterEmbreePlugin::pythonFilterName(ActionIDType f) const
                             "The parameter for the number of rays is defined by the user; this parameter represents the number of rays that will be shot from the barycenter of each face."
                             "The higher the number of rays, the longer the time to compute, but the better the results."
                             "These results are saved into face quality and mapped into a gray shade on the mesh."
+                            "With progressive sampling, rays are shot in rounds and each face stops as soon as its estimate is accurate enough, so the number of rays becomes an upper bound."
                             "This filter uses the Embree3 library by INTEL.");
 
 
@@ -147,6 +149,7 @@ QString FilterEmbreePlugin::pythonFilterName(ActionIDType f) const
                            "	<li> the number of rays which will be shot from the barycenter of each face </li>"
                            "	<li> the cone amplitude (in degrees) of the cone which we value as valid for the shooting angle </li>"
                            "</ul>"
+                           "With progressive sampling, rays are shot in rounds and each face stops as soon as its average distance is accurate enough, so the number of rays becomes an upper bound. <br />"
                            " <br />"
                            "<b>For further details see the reference paper: Shapira Shamir Cohen-Or, Consistent Mesh Partitioning and Skeletonisation using the shaper diameter function, Visual Comput. J. (2008) </b> <br />"
                            "This filter uses Embree3 library by INTEL.");
@@ -250,10 +253,16 @@ RichParameterList FilterEmbreePlugin::initParameterList(const QAction *action,co
             break;
         case FP_AMBIENT_OCCLUSION:
             parlst.addParam(RichInt("Rays", 64, "Number of rays", "The number of rays shoot from the barycenter of the face. The higher the number the higher the definition of the ambient occlusion but at the cost of the calculation time "));
+            parlst.addParam(RichBool("progressive", false, "Progressive sampling", "If checked, rays are shot in rounds of 8 per face and a face stops being refined as soon as its estimate converged; the number of rays becomes the maximum per face"));
+            parlst.addParam(RichFloat("tolerance", 0.01f, "Convergence tolerance", "Only for progressive sampling: a face is converged when the standard error of its occlusion (in the 0..1 range) is below this value"));
+            parlst.addParam(RichFloat("time_budget", 0.0f, "Time budget (s)", "Only for progressive sampling: when this time (in seconds) is exhausted, no more rays are shot and each face keeps its current estimate. 0 means no limit"));
             break;
         case FP_SDF:
             parlst.addParam(RichInt("Rays", 64, "Number of rays", "The number of rays shoot from the barycenter of the face. The higher the number the higher the definition of the SDF but at the cost of the calculation time"));
             parlst.addParam(RichFloat("cone_amplitude",90.0f,"Cone amplitude ", "The value for the angle (in degrees) of the cone for which we consider a ray shooting direction as a valid direction"));
+            parlst.addParam(RichBool("progressive", false, "Progressive sampling", "If checked, rays are shot in rounds of 8 per face and a face stops being refined as soon as its estimate converged; the number of rays becomes the maximum per face"));
+            parlst.addParam(RichFloat("tolerance", 0.02f, "Convergence tolerance", "Only for progressive sampling: a face is converged when the standard error of its diameter, relative to the diameter itself, is below this value"));
+            parlst.addParam(RichFloat("time_budget", 0.0f, "Time budget (s)", "Only for progressive sampling: when this time (in seconds) is exhausted, no more rays are shot and each face keeps its current estimate. 0 means no limit"));
 
             break;
         case FP_SELECT_VISIBLE_FACES:
@@ -282,33 +291,65 @@ std::map<std::string, QVariant> FilterEmbreePlugin::applyFilter(const QAction *
 {
 
     MeshModel *m = md.mm();
-    EmbreeAdaptor<CMeshO> adaptor = EmbreeAdaptor<CMeshO>(m->cm);
+    EmbreeSceneCache::instance().watch(md);
+
+    // progressive AO and SDF only need ray queries on the cached scene
+    if ((ID(action) == FP_AMBIENT_OCCLUSION || ID(action) == FP_SDF) && parameters.getBool("progressive")) {
+        m->updateDataMask(MeshModel::MM_VERTCOLOR | MeshModel::MM_VERTQUALITY | MeshModel::MM_FACEQUALITY | MeshModel::MM_FACECOLOR);
+        ProgressiveSamplingParams params;
+        params.maxRays = parameters.getInt("Rays");
+        params.tolerance = parameters.getFloat("tolerance");
+        params.timeBudget = parameters.getFloat("time_budget");
+        ProgressiveSamplingStats stats;
+        if (ID(action) == FP_AMBIENT_OCCLUSION)
+            stats = progressiveAmbientOcclusion(*m, params, cb);
+        else
+            stats = progressiveSDF(*m, parameters.getFloat("cone_amplitude"), params, cb);
+        log("Shot %lld rays in %d rounds (%.1f per face), %d faces converged%s",
+            stats.rays, stats.rounds, double(stats.rays) / std::max(1, m->cm.fn), stats.convergedFaces,
+            stats.budgetExhausted ? ", time budget exhausted" : "");
+
+        tri::UpdateQuality<CMeshO>::VertexFromFace(m->cm);
+        if (ID(action) == FP_AMBIENT_OCCLUSION)
+            tri::UpdateColor<CMeshO>::PerVertexQualityGray(m->cm);
+        else
+            tri::UpdateColor<CMeshO>::PerVertexQualityRamp(m->cm);
+        return std::map<std::string, QVariant>();
+    }
+
+    // the scene is kept across filters, and rebuilt only if the geometry changed
+    bool reused = false;
+    std::shared_ptr<EmbreeSceneCache::Adaptor> adaptor = EmbreeSceneCache::instance().adaptor(*m, &reused);
+    if (reused)
+        log("Reusing the cached Embree scene");
 
     switch(ID(action)) {
     case FP_OBSCURANCE:
         m->updateDataMask(MeshModel::MM_VERTCOLOR | MeshModel::MM_VERTQUALITY | MeshModel::MM_FACEQUALITY | MeshModel::MM_FACECOLOR);
-        adaptor.computeObscurance(m->cm, parameters.getInt("Rays"), parameters.getFloat("TAU"));
+        adaptor->computeObscurance(m->cm, parameters.getInt("Rays"), parameters.getFloat("TAU"));
         tri::UpdateQuality<CMeshO>::VertexFromFace(m->cm);
         tri::UpdateColor<CMeshO>::PerVertexQualityGray(m->cm);
         break;
     case FP_AMBIENT_OCCLUSION:
         m->updateDataMask(MeshModel::MM_VERTCOLOR | MeshModel::MM_VERTQUALITY | MeshModel::MM_FACEQUALITY | MeshModel::MM_FACECOLOR);
-        adaptor.computeAmbientOcclusion(m->cm,parameters.getInt("Rays"));
+        adaptor->computeAmbientOcclusion(m->cm,parameters.getInt("Rays"));
         tri::UpdateQuality<CMeshO>::VertexFromFace(m->cm);
         tri::UpdateColor<CMeshO>::PerVertexQualityGray(m->cm);
         break;
     case FP_SDF:
         m->updateDataMask(MeshModel::MM_VERTCOLOR | MeshModel::MM_VERTQUALITY | MeshModel::MM_FACEQUALITY | MeshModel::MM_FACECOLOR);
-        adaptor.computeSDF(m->cm,parameters.getInt("Rays"), parameters.getFloat("cone_amplitude"));
+        adaptor->computeSDF(m->cm,parameters.getInt("Rays"), parameters.getFloat("cone_amplitude"));
         tri::UpdateQuality<CMeshO>::VertexFromFace(m->cm);
         tri::UpdateColor<CMeshO>::PerVertexQualityRamp(m->cm);
         break;
     case FP_SELECT_VISIBLE_FACES:
         m->updateDataMask(MeshModel::MM_VERTCOLOR | MeshModel::MM_VERTQUALITY | MeshModel::MM_FACEQUALITY | MeshModel::MM_FACECOLOR);
-        adaptor.selectVisibleFaces(m->cm,parameters.getPoint3m("dir"), parameters.getBool("incrementalSelection"));
+        adaptor->selectVisibleFaces(m->cm,parameters.getPoint3m("dir"), parameters.getBool("incrementalSelection"));
         break;
     case FP_ANALYZE_NORMALS:
-        adaptor.computeNormalAnalysis(m->cm,parameters.getInt("Rays"), parameters.getBool("parity_sampling"));
+        adaptor->computeNormalAnalysis(m->cm,parameters.getInt("Rays"), parameters.getBool("parity_sampling"));
+        // faces may have been flipped, the cached scene no longer matches the mesh
+        EmbreeSceneCache::instance().invalidate(*m);
         //tri::UpdateNormal<CMeshO>::PerVertexNormalizedPerFace(m->cm);
         m->updateBoxAndNormals();
         break;
@@ -0,0 +1,268 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "progressive_sampling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QElapsedTimer>
+
+namespace {
+
+const int    PACKET_SIZE = EmbreeRayQuery::PACKET_SIZE;
+const double PI          = 3.14159265358979323846;
+
+// per face accumulators, updated by one thread at a time
+struct FaceState
+{
+    int    rays  = 0;
+    int    hits  = 0;
+    double sum   = 0;
+    double sumSq = 0;
+};
+
+// random numbers depending only on the face and on the round
+class FaceRandom
+{
+public:
+    FaceRandom(int face, int round) :
+            state(
+                (unsigned long long) face * 0x9e3779b97f4a7c15ULL ^
+                ((unsigned long long) round << 32 | 0x632be59bU))
+    {
+    }
+
+    double uniform()
+    {
+        unsigned long long z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        z ^= z >> 31;
+        return (z >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+private:
+    unsigned long long state;
+};
+
+// orthonormal basis (t, b, n) from the unit vector n [Duff et al. 2017]
+void frame(const Point3m& n, Point3m& t, Point3m& b)
+{
+    const Scalarm sign = n[2] >= 0 ? 1 : -1;
+    const Scalarm a    = -1 / (sign + n[2]);
+    const Scalarm c    = n[0] * n[1] * a;
+    t = Point3m(1 + sign * n[0] * n[0] * a, sign * c, -sign * n[0]);
+    b = Point3m(c, sign + n[1] * n[1] * a, -n[1]);
+}
+
+// a packet of directions stratified over a 2x4 grid of the unit square,
+// mapped on the sphere by sampleDir(u1, u2) in the local frame of n
+template<class SampleDir>
+void stratifiedPacket(
+    const Point3m& n,
+    int            face,
+    int            round,
+    int            count,
+    SampleDir      sampleDir,
+    Point3m*       dirs)
+{
+    Point3m t, b;
+    frame(n, t, b);
+    FaceRandom rnd(face, round);
+    for (int i = 0; i < count; ++i) {
+        const double  u1 = ((i % 2) + rnd.uniform()) / 2.0;
+        const double  u2 = ((i / 2) + rnd.uniform()) / 4.0;
+        const Point3m l  = sampleDir(u1, u2);
+        dirs[i]          = t * l[0] + b * l[1] + n * l[2];
+    }
+}
+
+/*
+ * The common driver: rounds of one packet per active face, traced in
+ * parallel; shoot(face, round, count, state) traces the packet and updates
+ * the face state, converged(state) tells if the face can be dropped.
+ */
+template<class Shoot, class Converged>
+ProgressiveSamplingStats progressiveRounds(
+    CMeshO&                          m,
+    const ProgressiveSamplingParams& params,
+    std::vector<FaceState>&          states,
+    Shoot                            shoot,
+    Converged                        converged,
+    vcg::CallBackPos*                cb)
+{
+    ProgressiveSamplingStats stats;
+    QElapsedTimer            timer;
+    timer.start();
+
+    std::vector<int> active;
+    active.reserve(m.face.size());
+    for (size_t i = 0; i < m.face.size(); ++i)
+        if (!m.face[i].IsD() && m.face[i].cN().SquaredNorm() > 0)
+            active.push_back(i);
+    states.assign(m.face.size(), FaceState());
+
+    const int maxRays   = std::max(1, params.maxRays);
+    const int maxRounds = (maxRays + PACKET_SIZE - 1) / PACKET_SIZE;
+    const int faceNum   = active.size();
+    for (int round = 0; round < maxRounds && !active.empty(); ++round) {
+        if (cb)
+            cb(100 * (faceNum - (int) active.size()) / std::max(1, faceNum),
+               "Progressive ray casting...");
+        const int count     = std::min(PACKET_SIZE, maxRays - round * PACKET_SIZE);
+        const int activeNum = active.size();
+#pragma omp parallel for schedule(dynamic, 256)
+        for (int i = 0; i < activeNum; ++i)
+            shoot(active[i], round, count, states[active[i]]);
+        stats.rays += (long long) activeNum * count;
+        stats.rounds++;
+
+        active.erase(
+            std::remove_if(
+                active.begin(),
+                active.end(),
+                [&](int f) { return converged(states[f]); }),
+            active.end());
+
+        if (params.timeBudget > 0 && timer.elapsed() > params.timeBudget * 1000.0) {
+            stats.budgetExhausted = round + 1 < maxRounds && !active.empty();
+            break;
+        }
+    }
+    stats.convergedFaces = faceNum - active.size();
+    return stats;
+}
+
+} // namespace
+
+ProgressiveSamplingStats progressiveAmbientOcclusion(
+    MeshModel&                       m,
+    const ProgressiveSamplingParams& params,
+    vcg::CallBackPos*                cb)
+{
+    vcg::tri::UpdateNormal<CMeshO>::PerFaceNormalized(m.cm);
+    EmbreeRayQuery query(m);
+    const Scalarm  tnear = m.cm.bbox.Diag() * 1e-5;
+    const double   tol2  = double(params.tolerance) * params.tolerance;
+
+    // cosine weighted hemisphere: the average visibility estimates the
+    // cosine weighted unoccluded fraction
+    auto cosineDir = [](double u1, double u2) {
+        const double r   = std::sqrt(u1);
+        const double phi = 2.0 * PI * u2;
+        return Point3m(r * std::cos(phi), r * std::sin(phi), std::sqrt(std::max(0.0, 1.0 - u1)));
+    };
+
+    std::vector<FaceState> states;
+    ProgressiveSamplingStats stats = progressiveRounds(
+        m.cm,
+        params,
+        states,
+        [&](int f, int round, int count, FaceState& s) {
+            const CFaceO& face = m.cm.face[f];
+            Point3m       origins[PACKET_SIZE];
+            Point3m       dirs[PACKET_SIZE];
+            char          occluded[PACKET_SIZE];
+            std::fill(origins, origins + count, vcg::Barycenter(face));
+            stratifiedPacket(face.cN(), f, round, count, cosineDir, dirs);
+            query.occludedPacket(origins, dirs, count, occluded, tnear);
+            for (int i = 0; i < count; ++i)
+                s.hits += occluded[i] ? 0 : 1;
+            s.rays += count;
+        },
+        [&](const FaceState& s) {
+            if (s.rays < 2 * PACKET_SIZE)
+                return false;
+            // smoothed estimate, so that all-visible or all-occluded faces
+            // still need some rays to be considered converged
+            const double p = (s.hits + 1.0) / (s.rays + 2.0);
+            return p * (1.0 - p) / s.rays <= tol2;
+        },
+        cb);
+
+    for (size_t i = 0; i < m.cm.face.size(); ++i)
+        if (!m.cm.face[i].IsD())
+            m.cm.face[i].Q() = states[i].rays > 0 ? Scalarm(states[i].hits) / states[i].rays : 0;
+    return stats;
+}
+
+ProgressiveSamplingStats progressiveSDF(
+    MeshModel&                       m,
+    float                            coneAmplitude,
+    const ProgressiveSamplingParams& params,
+    vcg::CallBackPos*                cb)
+{
+    vcg::tri::UpdateNormal<CMeshO>::PerFaceNormalized(m.cm);
+    EmbreeRayQuery query(m);
+    const Scalarm  tnear  = m.cm.bbox.Diag() * 1e-5;
+    const double   cosMax = std::cos(vcg::math::ToRad(std::min(180.0f, coneAmplitude) / 2.0));
+
+    // uniform directions in the cone around the opposite of the normal
+    auto coneDir = [cosMax](double u1, double u2) {
+        const double cosT = 1.0 - u1 * (1.0 - cosMax);
+        const double sinT = std::sqrt(std::max(0.0, 1.0 - cosT * cosT));
+        const double phi  = 2.0 * PI * u2;
+        return Point3m(sinT * std::cos(phi), sinT * std::sin(phi), -cosT);
+    };
+
+    std::vector<FaceState> states;
+    ProgressiveSamplingStats stats = progressiveRounds(
+        m.cm,
+        params,
+        states,
+        [&](int f, int round, int count, FaceState& s) {
+            const CFaceO&       face = m.cm.face[f];
+            Point3m             origins[PACKET_SIZE];
+            Point3m             dirs[PACKET_SIZE];
+            EmbreeRayQuery::Hit hits[PACKET_SIZE];
+            std::fill(origins, origins + count, vcg::Barycenter(face));
+            stratifiedPacket(face.cN(), f, round, count, coneDir, dirs);
+            query.firstHitPacket(origins, dirs, count, hits, tnear);
+            for (int i = 0; i < count; ++i) {
+                if (hits[i].valid()) {
+                    s.hits++;
+                    s.sum += hits[i].t;
+                    s.sumSq += double(hits[i].t) * hits[i].t;
+                }
+            }
+            s.rays += count;
+        },
+        [&](const FaceState& s) {
+            // open borders: nothing in front of the face
+            if (s.hits == 0)
+                return s.rays >= 4 * PACKET_SIZE;
+            if (s.hits < PACKET_SIZE)
+                return false;
+            const double mean = s.sum / s.hits;
+            const double var  = std::max(0.0, s.sumSq / s.hits - mean * mean);
+            const double tol  = params.tolerance * mean;
+            return var / s.hits <= tol * tol;
+        },
+        cb);
+
+    for (size_t i = 0; i < m.cm.face.size(); ++i)
+        if (!m.cm.face[i].IsD())
+            m.cm.face[i].Q() = states[i].hits > 0 ? Scalarm(states[i].sum / states[i].hits) : 0;
+    return stats;
+}
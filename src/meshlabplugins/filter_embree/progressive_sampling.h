@@ -0,0 +1,75 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef PROGRESSIVE_SAMPLING_H
+#define PROGRESSIVE_SAMPLING_H
+
+#include <vcg/complex/algorithms/update/normal.h>
+
+#include "embree_scene_cache.h"
+
+/**
+ * @brief Progressive per-face ambient occlusion and shape diameter function.
+ *
+ * Instead of shooting a fixed number of rays from each face, rays are shot
+ * in rounds of one packet (EmbreeRayQuery::PACKET_SIZE rays) per face; after
+ * each round the faces whose estimate has a standard error below the
+ * tolerance stop being refined. maxRays bounds the number of rays per face,
+ * and timeBudget (in seconds, 0 for unlimited) the total time: when it is
+ * exhausted every face keeps the estimate reached so far.
+ *
+ * The directions of a face only depend on the face index and on the round,
+ * so the result does not depend on the number of threads.
+ */
+struct ProgressiveSamplingParams
+{
+    int   maxRays    = 64;
+    float tolerance  = 0.01f;
+    float timeBudget = 0;
+};
+
+struct ProgressiveSamplingStats
+{
+    long long rays            = 0;
+    int       rounds          = 0;
+    int       convergedFaces  = 0;
+    bool      budgetExhausted = false;
+};
+
+// fraction of the (cosine weighted) hemisphere around the face normal that is
+// not occluded; saved in the face quality
+ProgressiveSamplingStats progressiveAmbientOcclusion(
+    MeshModel&                       m,
+    const ProgressiveSamplingParams& params,
+    vcg::CallBackPos*                cb = nullptr);
+
+// average distance of the hits of the rays shot inward, inside a cone of the
+// given amplitude (in degrees) around the opposite of the face normal; saved
+// in the face quality. Here the tolerance is relative to the average.
+ProgressiveSamplingStats progressiveSDF(
+    MeshModel&                       m,
+    float                            coneAmplitude,
+    const ProgressiveSamplingParams& params,
+    vcg::CallBackPos*                cb = nullptr);
+
+#endif // PROGRESSIVE_SAMPLING_H
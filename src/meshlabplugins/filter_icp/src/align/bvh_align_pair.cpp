@@ -0,0 +1,469 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "bvh_align_pair.h"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+#include <vcg/space/point_matching.h>
+
+namespace {
+
+typedef vcg::Point3d Point3d;
+
+/*
+ * Closest point to p on the triangle abc (Ericson, Real-Time Collision
+ * Detection, 5.1.5). onEdges is set to the bitmask of the edges (0: ab,
+ * 1: bc, 2: ca) that contain the returned point.
+ */
+Point3d closestOnTriangle(
+    const Point3d& p,
+    const Point3d& a,
+    const Point3d& b,
+    const Point3d& c,
+    unsigned char& onEdges)
+{
+    const Point3d ab = b - a, ac = c - a, ap = p - a;
+    const double d1 = ab * ap, d2 = ac * ap;
+    if (d1 <= 0 && d2 <= 0) {
+        onEdges = 1 | 4;
+        return a;
+    }
+    const Point3d bp = p - b;
+    const double d3 = ab * bp, d4 = ac * bp;
+    if (d3 >= 0 && d4 <= d3) {
+        onEdges = 1 | 2;
+        return b;
+    }
+    const double vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+        onEdges = 1;
+        return a + ab * (d1 / (d1 - d3));
+    }
+    const Point3d cp = p - c;
+    const double d5 = ab * cp, d6 = ac * cp;
+    if (d6 >= 0 && d5 <= d6) {
+        onEdges = 2 | 4;
+        return c;
+    }
+    const double vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+        onEdges = 4;
+        return a + ac * (d2 / (d2 - d6));
+    }
+    const double va = d3 * d6 - d5 * d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+        onEdges = 2;
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+    const double sum = va + vb + vc;
+    if (sum <= 0) { // degenerate triangle
+        onEdges = 1 | 4;
+        return a;
+    }
+    onEdges = 0;
+    return a + ab * (vb / sum) + ac * (vc / sum);
+}
+
+double boxDistanceSquared(const double min[3], const double max[3], const Point3d& q)
+{
+    double d = 0;
+    for (int k = 0; k < 3; ++k) {
+        const double e = std::max(std::max(min[k] - q[k], q[k] - max[k]), 0.0);
+        d += e * e;
+    }
+    return d;
+}
+
+} // namespace
+
+const int BVHAlignPair::ClosestPointBVH::LEAF_SIZE;
+
+BVHAlignPair::ClosestPointBVH::ClosestPointBVH(const CMeshO& m, bool vertexOnly) :
+    points(vertexOnly || m.fn == 0)
+{
+    // primitives in mesh order
+    std::vector<Point3d> pa, pb, pc, pn;
+    std::vector<unsigned char> pborder;
+
+    if (points) {
+        for (const CMeshO::VertexType& v : m.vert) {
+            if (v.IsD())
+                continue;
+            const Point3d p = Point3d::Construct(v.cP());
+            pa.push_back(p);
+            pn.push_back(Point3d::Construct(v.cN()).Normalize());
+        }
+        pb = pa;
+        pc = pa;
+        pborder.assign(pa.size(), 0);
+    }
+    else {
+        // border edges are the ones shared by only one face
+        std::vector<std::tuple<size_t, size_t, size_t>> edges; // (v0, v1, 3 * face + edge)
+        for (const CMeshO::FaceType& f : m.face) {
+            if (f.IsD())
+                continue;
+            const size_t fi = pa.size();
+            const Point3d a = Point3d::Construct(f.cP(0));
+            const Point3d b = Point3d::Construct(f.cP(1));
+            const Point3d c = Point3d::Construct(f.cP(2));
+            pa.push_back(a);
+            pb.push_back(b);
+            pc.push_back(c);
+            Point3d n = (b - a) ^ (c - a);
+            pn.push_back(n.Normalize());
+            for (int e = 0; e < 3; ++e) {
+                size_t v0 = f.cV(e) - &m.vert[0];
+                size_t v1 = f.cV((e + 1) % 3) - &m.vert[0];
+                if (v0 > v1)
+                    std::swap(v0, v1);
+                edges.emplace_back(v0, v1, 3 * fi + e);
+            }
+        }
+        pborder.assign(pa.size(), 0);
+        std::sort(edges.begin(), edges.end());
+        for (size_t i = 0; i < edges.size();) {
+            size_t j = i + 1;
+            while (j < edges.size() && std::get<0>(edges[j]) == std::get<0>(edges[i]) &&
+                   std::get<1>(edges[j]) == std::get<1>(edges[i]))
+                ++j;
+            if (j - i == 1) {
+                const size_t fe = std::get<2>(edges[i]);
+                pborder[fe / 3] |= 1 << (fe % 3);
+            }
+            i = j;
+        }
+    }
+
+    const int primNum = (int) pa.size();
+    if (primNum == 0)
+        return;
+
+    std::vector<vcg::Box3d> boxes(primNum);
+    std::vector<Point3d> centroids(primNum);
+    std::vector<int> prims(primNum);
+    for (int i = 0; i < primNum; ++i) {
+        boxes[i].Set(pa[i]);
+        boxes[i].Add(pb[i]);
+        boxes[i].Add(pc[i]);
+        centroids[i] = (pa[i] + pb[i] + pc[i]) / 3.0;
+        prims[i] = i;
+    }
+    nodes.reserve(2 * (primNum / LEAF_SIZE + 1));
+    build(prims, 0, primNum, boxes, centroids);
+
+    // store the primitives in leaf order
+    ax.resize(primNum); ay.resize(primNum); az.resize(primNum);
+    bx.resize(primNum); by.resize(primNum); bz.resize(primNum);
+    cx.resize(primNum); cy.resize(primNum); cz.resize(primNum);
+    normals.resize(primNum);
+    borders.resize(primNum);
+    for (int i = 0; i < primNum; ++i) {
+        const int p = prims[i];
+        ax[i] = pa[p][0]; ay[i] = pa[p][1]; az[i] = pa[p][2];
+        bx[i] = pb[p][0]; by[i] = pb[p][1]; bz[i] = pb[p][2];
+        cx[i] = pc[p][0]; cy[i] = pc[p][1]; cz[i] = pc[p][2];
+        normals[i] = pn[p];
+        borders[i] = pborder[p];
+    }
+}
+
+int BVHAlignPair::ClosestPointBVH::build(
+    std::vector<int>& prims,
+    int begin,
+    int end,
+    const std::vector<vcg::Box3d>& boxes,
+    const std::vector<Point3d>& centroids)
+{
+    const int index = (int) nodes.size();
+    nodes.push_back(Node());
+
+    vcg::Box3d box, centroidBox;
+    for (int i = begin; i < end; ++i) {
+        box.Add(boxes[prims[i]]);
+        centroidBox.Add(centroids[prims[i]]);
+    }
+    for (int k = 0; k < 3; ++k) {
+        nodes[index].min[k] = box.min[k];
+        nodes[index].max[k] = box.max[k];
+    }
+
+    if (end - begin <= LEAF_SIZE) {
+        nodes[index].start = begin;
+        nodes[index].count = end - begin;
+        nodes[index].right = -1;
+        return index;
+    }
+
+    // median split along the largest extent of the centroids
+    const int axis = centroidBox.MaxDim();
+    const int mid = begin + (end - begin) / 2;
+    std::nth_element(
+        prims.begin() + begin, prims.begin() + mid, prims.begin() + end, [&](int a, int b) {
+            return centroids[a][axis] < centroids[b][axis];
+        });
+
+    build(prims, begin, mid, boxes, centroids);
+    const int right = build(prims, mid, end, boxes, centroids);
+    nodes[index].start = begin;
+    nodes[index].count = 0;
+    nodes[index].right = right;
+    return index;
+}
+
+bool BVHAlignPair::ClosestPointBVH::leafClosest(
+    const Node& node,
+    const Point3d& q,
+    double& bestSq,
+    Hit& hit) const
+{
+    bool found = false;
+    const int begin = node.start, end = node.start + node.count;
+    if (points) {
+        // squared distances of the whole leaf first, on contiguous arrays
+        double d[LEAF_SIZE];
+        for (int i = begin; i < end; ++i) {
+            const double dx = ax[i] - q[0], dy = ay[i] - q[1], dz = az[i] - q[2];
+            d[i - begin] = dx * dx + dy * dy + dz * dz;
+        }
+        for (int i = begin; i < end; ++i) {
+            if (d[i - begin] < bestSq) {
+                bestSq = d[i - begin];
+                hit.p = Point3d(ax[i], ay[i], az[i]);
+                hit.n = normals[i];
+                hit.border = false;
+                found = true;
+            }
+        }
+    }
+    else {
+        for (int i = begin; i < end; ++i) {
+            unsigned char onEdges;
+            const Point3d p = closestOnTriangle(
+                q,
+                Point3d(ax[i], ay[i], az[i]),
+                Point3d(bx[i], by[i], bz[i]),
+                Point3d(cx[i], cy[i], cz[i]),
+                onEdges);
+            const double dSq = (p - q).SquaredNorm();
+            if (dSq < bestSq) {
+                bestSq = dSq;
+                hit.p = p;
+                hit.n = normals[i];
+                hit.border = (onEdges & borders[i]) != 0;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief returns the closest point of the fixed mesh to q, if nearer than
+ * maxDist. The hierarchy is not modified, so this function can be called
+ * concurrently.
+ */
+bool BVHAlignPair::ClosestPointBVH::closest(const Point3d& q, double maxDist, Hit& hit) const
+{
+    if (nodes.empty())
+        return false;
+
+    double bestSq = maxDist * maxDist;
+    bool found = false;
+    int stack[64];
+    int size = 0;
+    stack[size++] = 0;
+    while (size > 0) {
+        const int index = stack[--size];
+        const Node& node = nodes[index];
+        if (boxDistanceSquared(node.min, node.max, q) >= bestSq)
+            continue;
+        if (node.count > 0) {
+            found |= leafClosest(node, q, bestSq, hit);
+            continue;
+        }
+        // visit the nearest child first
+        const int left = index + 1, right = node.right;
+        const double dl = boxDistanceSquared(nodes[left].min, nodes[left].max, q);
+        const double dr = boxDistanceSquared(nodes[right].min, nodes[right].max, q);
+        if (dl < dr) {
+            stack[size++] = right;
+            stack[size++] = left;
+        }
+        else {
+            stack[size++] = left;
+            stack[size++] = right;
+        }
+    }
+    if (found)
+        hit.dist = std::sqrt(bestSq);
+    return found;
+}
+
+/**
+ * @brief Executes the ICP between the fixed mesh and the samples of the moving
+ * one (in their local reference system), starting from the matrix in.
+ *
+ * At each iteration the samples are matched in parallel with their closest
+ * points on the fixed mesh; the matches farther than the current minimal
+ * distance, lying on a border of the fixed mesh or with incompatible normals
+ * are discarded. At most ap.MaxPointNum of the best matches are used to
+ * compute the new transformation.
+ *
+ * As in vcg::AlignPair::align, the minimal distance shrinks with the error but
+ * never below ap.MinMinDistPerc times the starting one, and the loop ends when
+ * the median error reaches ap.TrgDistAbs, after ap.MaxIterNum iterations or
+ * when the error did not improve over the last ap.EndStepNum iterations.
+ *
+ * @return true on success; on failure result.status tells the reason
+ */
+bool BVHAlignPair::align(
+    const CMeshO& fixed,
+    const std::vector<vcg::AlignPair::A2Vertex>& movingSamples,
+    const vcg::AlignPair::Param& ap,
+    const vcg::Matrix44d& in,
+    vcg::AlignPair::Result& result)
+{
+    typedef vcg::AlignPair::Stat::IterInfo IterInfo;
+    enum MatchState : char {USED, DISTANCE_DISCARDED, BORDER_DISCARDED, ANGLE_DISCARDED};
+
+    const ClosestPointBVH bvh(fixed, ap.UseVertexOnly);
+    const int n = (int) movingSamples.size();
+
+    result.as.I.clear();
+    result.Tr = in;
+    if (bvh.isEmpty() || n < ap.MinPointNum) {
+        result.status = vcg::AlignPair::TOO_FEW_POINTS;
+        return false;
+    }
+
+    const double cosMaxAngle = std::cos(ap.MaxAngleRad);
+    double minDist = ap.MinDistAbs;
+    const double minMinDist = ap.MinDistAbs * ap.MinMinDistPerc;
+    double pcl50 = 0;
+
+    std::vector<char> state(n);
+    std::vector<double> dist(n);
+    std::vector<Point3d> closestP(n);
+    std::vector<double> sortedDist;
+    std::vector<Point3d> pfix, pmov, nmov;
+
+    for (int iter = 0; iter < ap.MaxIterNum; ++iter) {
+        const vcg::Matrix44d tr = result.Tr;
+        const vcg::Matrix33d rot(tr, 3);
+
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; ++i) {
+            const Point3d p = tr * movingSamples[i].cP();
+            ClosestPointBVH::Hit hit;
+            if (!bvh.closest(p, minDist, hit)) {
+                state[i] = DISTANCE_DISCARDED;
+                continue;
+            }
+            dist[i] = hit.dist;
+            closestP[i] = hit.p;
+            if (hit.border) {
+                state[i] = BORDER_DISCARDED;
+                continue;
+            }
+            Point3d nm = rot * movingSamples[i].cN();
+            if (nm.Normalize() * hit.n < cosMaxAngle) {
+                state[i] = ANGLE_DISCARDED;
+                continue;
+            }
+            state[i] = USED;
+        }
+
+        IterInfo ii = IterInfo();
+        ii.MinDistAbs = minDist;
+        ii.SampleTested = n;
+        sortedDist.clear();
+        for (int i = 0; i < n; ++i) {
+            switch (state[i]) {
+            case USED: sortedDist.push_back(dist[i]); break;
+            case DISTANCE_DISCARDED: ++ii.DistanceDiscarded; break;
+            case BORDER_DISCARDED: ++ii.BorderDiscarded; break;
+            case ANGLE_DISCARDED: ++ii.AngleDiscarded; break;
+            }
+        }
+        if ((int) sortedDist.size() < ap.MinPointNum) {
+            result.as.I.push_back(ii);
+            result.status = vcg::AlignPair::TOO_FEW_POINTS;
+            return false;
+        }
+        std::sort(sortedDist.begin(), sortedDist.end());
+        const size_t last = sortedDist.size() - 1;
+        pcl50 = sortedDist[last / 2];
+        const double hiThr =
+            sortedDist[std::min(last, (size_t) (sortedDist.size() * ap.PassHiFilter))];
+
+        // only the <PassHiFilter> best matches are used
+        pfix.clear();
+        pmov.clear();
+        nmov.clear();
+        for (int i = 0; i < n; ++i) {
+            if ((int) pfix.size() >= ap.MaxPointNum)
+                break;
+            if (state[i] == USED && dist[i] <= hiThr) {
+                pfix.push_back(closestP[i]);
+                pmov.push_back(movingSamples[i].cP());
+                nmov.push_back(movingSamples[i].cN());
+            }
+        }
+        ii.SampleUsed = (int) pfix.size();
+        ii.pcl50 = pcl50;
+        result.as.I.push_back(ii);
+
+        vcg::Matrix44d newTr;
+        if (ap.MatchMode == vcg::AlignPair::Param::MMRigid)
+            vcg::ComputeRigidMatchMatrix(pfix, pmov, newTr);
+        else
+            vcg::ComputeSimilarityMatchMatrix(pfix, pmov, newTr);
+        result.Tr = newTr;
+
+        minDist = std::max(
+            minMinDist,
+            std::min(
+                minDist,
+                5.0 * sortedDist[std::min(last, (size_t) (sortedDist.size() * ap.ReduceFactorPerc))]));
+
+        if (pcl50 < ap.TrgDistAbs)
+            break;
+
+        // stop when the error did not improve over the last EndStepNum iterations
+        const int iterNum = (int) result.as.I.size();
+        if (iterNum > ap.EndStepNum &&
+            result.as.I.back().pcl50 >= result.as.I[iterNum - 1 - ap.EndStepNum].pcl50)
+            break;
+    }
+
+    result.err = pcl50;
+    result.Pfix = pfix;
+    result.Pmov = pmov;
+    result.Nmov = nmov;
+    result.status = vcg::AlignPair::SUCCESS;
+    return true;
+}
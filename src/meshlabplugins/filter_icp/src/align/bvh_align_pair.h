@@ -0,0 +1,101 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef BVH_ALIGN_PAIR_H
+#define BVH_ALIGN_PAIR_H
+
+#include <vector>
+
+#include <common/ml_document/cmesh.h>
+#include <vcg/complex/algorithms/align_pair.h>
+
+/**
+ * @brief Alternative closest-point backend for the pairwise ICP.
+ *
+ * The fixed mesh is stored in a flat bounding volume hierarchy (triangles, or
+ * points when the mesh has no faces or only vertices are used), with the
+ * primitives of each leaf stored in structure-of-arrays layout.
+ * Queries do not modify the hierarchy, so at each ICP iteration all the moving
+ * samples are matched in parallel.
+ *
+ * The ICP loop follows vcg::AlignPair::align: the same parameters are used and
+ * the same statistics (distance, border and angle discards) are stored in the
+ * result.
+ */
+class BVHAlignPair
+{
+public:
+    class ClosestPointBVH
+    {
+    public:
+        struct Hit
+        {
+            vcg::Point3d p;
+            vcg::Point3d n;
+            double dist = 0;
+            bool border = false; // the closest point lies on a border edge
+        };
+
+        ClosestPointBVH(const CMeshO& m, bool vertexOnly);
+
+        bool closest(const vcg::Point3d& q, double maxDist, Hit& hit) const;
+
+        bool isEmpty() const { return nodes.empty(); }
+
+    private:
+        static const int LEAF_SIZE = 8;
+
+        struct Node
+        {
+            double min[3], max[3];
+            int start, count; // primitive range, count > 0 only for leaves
+            int right;        // index of the right child (the left one is the next node)
+        };
+
+        int build(
+            std::vector<int>& prims,
+            int begin,
+            int end,
+            const std::vector<vcg::Box3d>& boxes,
+            const std::vector<vcg::Point3d>& centroids);
+        bool leafClosest(const Node& node, const vcg::Point3d& q, double& bestSq, Hit& hit) const;
+
+        bool points;
+        std::vector<Node> nodes;
+
+        // primitives in leaf order: vertices a, b, c (all equal for points),
+        // normals and border edges bitmask (bit i: edge from vertex i to i+1)
+        std::vector<double> ax, ay, az, bx, by, bz, cx, cy, cz;
+        std::vector<vcg::Point3d> normals;
+        std::vector<unsigned char> borders;
+    };
+
+    static bool align(
+        const CMeshO& fixed,
+        const std::vector<vcg::AlignPair::A2Vertex>& movingSamples,
+        const vcg::AlignPair::Param& ap,
+        const vcg::Matrix44d& in,
+        vcg::AlignPair::Result& result);
+};
+
+#endif // BVH_ALIGN_PAIR_H
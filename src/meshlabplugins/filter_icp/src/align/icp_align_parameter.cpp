@@ -90,5 +90,14 @@ void FilterIcpAlignParameter::MeshTreeParamToRichParameterSet(const MeshTreem::P
 
 }
 
+FilterIcpAlignParameter::CorrespondenceBackend FilterIcpAlignParameter::RichParameterSetToBackend(const RichParameterList &rps) {
+    return rps.getEnum("CorrespondenceBackend") == BVH_BACKEND ? BVH_BACKEND : GRID_BACKEND;
+}
 
-
+void FilterIcpAlignParameter::BackendToRichParameterSet(CorrespondenceBackend backend, RichParameterList &rps) {
+    rps.addParam(RichEnum("CorrespondenceBackend", backend, QStringList() << "Uniform grid" << "Parallel BVH", "Closest point search",
+                          "How the closest points of the samples are searched on the reference mesh at each ICP iteration. "
+                          "<i>Uniform grid</i> is the classic sequential search; <i>Parallel BVH</i> stores the reference mesh in a bounding volume hierarchy "
+                          "and matches all the samples of an iteration in parallel, it is usually faster with many samples.", false,
+                          CATEGORY_ICP_PARAMETERS));
+}
@@ -36,12 +36,18 @@ class FilterIcpAlignParameter {
 
 public:
 
+    /* Closest point search used by the ICP iterations of the two meshes alignment */
+    enum CorrespondenceBackend {GRID_BACKEND = 0, BVH_BACKEND = 1};
+
     static void RichParameterSetToAlignPairParam(const RichParameterList &rps, vcg::AlignPair::Param &app);
 	static void AlignPairParamToRichParameterSet(const vcg::AlignPair::Param &app, RichParameterList &rps);
 
 	static void RichParameterSetToMeshTreeParam(const RichParameterList &fps , MeshTreem::Param &mtp);
 	static void MeshTreeParamToRichParameterSet(const MeshTreem::Param &mtp, RichParameterList &rps);
 
+	static CorrespondenceBackend RichParameterSetToBackend(const RichParameterList &rps);
+	static void BackendToRichParameterSet(CorrespondenceBackend backend, RichParameterList &rps);
+
 private:
 	/* No need to have an instance of this class */
 	FilterIcpAlignParameter();
@@ -22,6 +22,9 @@
 ****************************************************************************/
 
 #include "filter_icp.h"
+#include "align/bvh_align_pair.h"
+
+#include <common/utilities/mesh_tree_align.h>
 
 #define PAR_SOURCE_MESH         "SourceMesh"
 #define PAR_BASE_MESH           "BaseMesh"
@@ -200,6 +203,8 @@ RichParameterList FilterIcpPlugin::initParameterList(const QAction *action, cons
             /* Add default ICP parameters to the parameters List */
             FilterIcpAlignParameter::AlignPairParamToRichParameterSet(this->alignParameters, parameterList);
 
+            /* Add the closest point search backend */
+            FilterIcpAlignParameter::BackendToRichParameterSet(FilterIcpAlignParameter::GRID_BACKEND, parameterList);
 
             /* Add a checkbox to toggle 'Save Last Iteration' */
             parameterList.addParam(RichBool(PAR_SAVE_LAST_ITERATION, false, "Save Last Iteration",
@@ -331,7 +336,7 @@ std::map<std::string, QVariant> FilterIcpPlugin::globalAlignment(MeshDocument& m
 
     // Start the global alignment
     log("Starting the global alignment filter...");
-    meshTree.Process(this->alignParameters, this->meshTreeParameters);
+    meshlab::processMeshTree(meshTree, this->alignParameters, this->meshTreeParameters);
     log("Global alignment completed!");
     meshTree.clear();
 
@@ -357,6 +362,7 @@ std::map<std::string, QVariant> FilterIcpPlugin::applyIcpTwoMeshes(MeshDocument&
     vcg::Matrix44d inputMatrix = vcg::Matrix44d::Identity();
 
     bool saveLastIterationFlag = par.getBool(PAR_SAVE_LAST_ITERATION);
+    bool useBVH = FilterIcpAlignParameter::RichParameterSetToBackend(par) == FilterIcpAlignParameter::BVH_BACKEND;
 
     if (fixedMesh == movingMesh) {
         throw MLException{"Cannot apply ICP on the same mesh!"};
@@ -365,16 +371,18 @@ std::map<std::string, QVariant> FilterIcpPlugin::applyIcpTwoMeshes(MeshDocument&
     qDebug("Fixed Mesh: %s\nMoving Mesh: %s\n",
            qUtf8Printable(fixedMesh->fullName()), qUtf8Printable(movingMesh->fullName()));
 
-    // 1) Convert fixed mesh and put it into the grid.
-    fixedMesh->updateDataMask(MeshModel::MM_FACEMARK);
-    aligner.convertMesh<CMeshO>(fixedMesh->cm, fix);
-
-    if (fixedMesh->cm.fn == 0 || this->alignParameters.UseVertexOnly) {
-        fix.initVert(vcg::Matrix44d::Identity());
-        vcg::AlignPair::InitFixVert(&fix, this->alignParameters, VG);
-    } else {
-        fix.init(vcg::Matrix44d::Identity());
-        vcg::AlignPair::initFix(&fix, this->alignParameters, UG);
+    // 1) Convert fixed mesh and put it into the grid (the BVH backend builds its own structure).
+    if (!useBVH) {
+        fixedMesh->updateDataMask(MeshModel::MM_FACEMARK);
+        aligner.convertMesh<CMeshO>(fixedMesh->cm, fix);
+
+        if (fixedMesh->cm.fn == 0 || this->alignParameters.UseVertexOnly) {
+            fix.initVert(vcg::Matrix44d::Identity());
+            vcg::AlignPair::InitFixVert(&fix, this->alignParameters, VG);
+        } else {
+            fix.init(vcg::Matrix44d::Identity());
+            vcg::AlignPair::initFix(&fix, this->alignParameters, UG);
+        }
     }
 
     // 2) Convert the second mesh and sample a <alignParameters.SampleNum> points on it.
@@ -390,7 +398,9 @@ std::map<std::string, QVariant> FilterIcpPlugin::applyIcpTwoMeshes(MeshDocument&
     aligner.ap = this->alignParameters;
 
     // 3) Execute the ICP algorithm
-    bool success = aligner.align(inputMatrix, UG, VG, alignerResult);
+    bool success = useBVH ?
+        BVHAlignPair::align(fixedMesh->cm, tempMoving, this->alignParameters, inputMatrix, alignerResult) :
+        aligner.align(inputMatrix, UG, VG, alignerResult);
     if (!success) {
         throw MLException{vcg::AlignPair::errorMsg(alignerResult.status)};
     }
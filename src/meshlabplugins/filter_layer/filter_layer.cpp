@@ -27,6 +27,8 @@
 
 #include "filter_layer.h"
 
+#include <common/utilities/connected_components.h>
+
 #include <QDir>
 #include <QImageReader>
 #include <QXmlStreamWriter>
@@ -164,6 +166,12 @@ FilterLayerPlugin::initParameterList(const QAction* action, const MeshDocument&
 			false,
 			"Delete source mesh",
 			"Deletes the source mesh after all the connected component meshes are generated."));
+		parlst.addParam(RichBool(
+			"store_component_id",
+			false,
+			"Store component index",
+			"Stores in the per face custom attribute 'ConnectedComponent' of the source mesh the "
+			"index of the connected component (and of the generated layer) of each face."));
 		break;
 	case FP_FLATTEN:
 		parlst.addParam(RichBool(
@@ -456,18 +464,23 @@ std::map<std::string, QVariant> FilterLayerPlugin::applyFilter(
 		MeshModel* currentModel = md.mm();
 		CMeshO&    cm           = md.mm()->cm;
 		bool removeSourceMesh = par.getBool("delete_source_mesh");
+		bool storeComponentId = par.getBool("store_component_id");
 		md.mm()->updateDataMask(MeshModel::MM_FACEFACETOPO);
-		std::vector<std::pair<int, CMeshO::FacePointer>> connectedCompVec;
-		int numCC = tri::Clean<CMeshO>::ConnectedComponents(cm, connectedCompVec);
+		meshlab::ConnectedComponents connectedComp(cm);
+		int numCC = connectedComp.size();
 		log("Found %i Connected Components", numCC);
+		if (storeComponentId)
+			connectedComp.storeFaceAttribute(cm, "ConnectedComponent");
 		tri::UpdateSelection<CMeshO>::FaceClear(cm);
 		tri::UpdateSelection<CMeshO>::VertexClear(cm);
 
-		for (size_t i = 0; i < connectedCompVec.size(); ++i) {
-			// select verts and faces of ith connected component
-			connectedCompVec[i].second->SetS();
-			tri::UpdateSelection<CMeshO>::FaceConnectedFF(cm /*,true*/);
-			tri::UpdateSelection<CMeshO>::VertexFromFaceLoose(cm);
+		for (int i = 0; i < numCC; ++i) {
+			// select verts and faces of ith connected component, from its list of faces
+			for (const int* fi = connectedComp.facesBegin(i); fi != connectedComp.facesEnd(i); ++fi) {
+				cm.face[*fi].SetS();
+				for (int k = 0; k < 3; ++k)
+					cm.face[*fi].V(k)->SetS();
+			}
 
 			// create a new mesh from the selection
 			MeshModel* destModel = md.addNewMesh("", QString("CC %1").arg(i), true);
@@ -475,8 +488,11 @@ std::map<std::string, QVariant> FilterLayerPlugin::applyFilter(
 			tri::Append<CMeshO, CMeshO>::Mesh(destModel->cm, cm, true);
 
 			// clear selection from source mesh and from newly created mesh
-			tri::UpdateSelection<CMeshO>::FaceClear(cm);
-			tri::UpdateSelection<CMeshO>::VertexClear(cm);
+			for (const int* fi = connectedComp.facesBegin(i); fi != connectedComp.facesEnd(i); ++fi) {
+				cm.face[*fi].ClearS();
+				for (int k = 0; k < 3; ++k)
+					cm.face[*fi].V(k)->ClearS();
+			}
 			tri::UpdateSelection<CMeshO>::FaceClear(destModel->cm);
 			tri::UpdateSelection<CMeshO>::VertexClear(destModel->cm);
 
@@ -36,10 +36,13 @@
 #include <vcg/complex/algorithms/mesh_to_matrix.h>
 #include <vcg/complex/algorithms/bitquad_optimization.h>
 
+#include <common/utilities/connected_components.h>
+#include <common/utilities/parallel_reductions.h>
+
 using namespace std;
 using namespace vcg;
 
-typedef Histogram<Scalarm> Histogramm;
+typedef meshlab::MergeableHistogram<Scalarm> Histogramm;
 
 FilterMeasurePlugin::FilterMeasurePlugin()
 { 
@@ -161,17 +164,23 @@ RichParameterList FilterMeasurePlugin::initParameterList(const QAction *action,
 	RichParameterList parlst;
 	switch (ID(action)) {
 	case PER_VERTEX_QUALITY_HISTOGRAM:
-		parlst.addParam(RichFloat("HistMin", vcg::tri::Stat<CMeshO>::ComputePerVertexQualityMinMax(m.cm).first, "Hist Min", "The vertex are displaced of a vector whose norm is bounded by this value"));
-		parlst.addParam(RichFloat("HistMax", vcg::tri::Stat<CMeshO>::ComputePerVertexQualityMinMax(m.cm).second, "Hist Max", "The vertex are displaced of a vector whose norm is bounded by this value"));
+	{
+		std::pair<Scalarm, Scalarm> minmax = meshlab::perVertexQualityMinMax(m.cm);
+		parlst.addParam(RichFloat("HistMin", minmax.first, "Hist Min", "The vertex are displaced of a vector whose norm is bounded by this value"));
+		parlst.addParam(RichFloat("HistMax", minmax.second, "Hist Max", "The vertex are displaced of a vector whose norm is bounded by this value"));
 		parlst.addParam(RichBool("areaWeighted", false, "Area Weighted", "If false, the histogram will report the number of vertices with quality values falling in each bin of the histogram. If true each bin of the histogram will report the approximate area of the mesh with that range of values. Area is computed by assigning to each vertex one third of the area all the incident triangles."));
 		parlst.addParam(RichInt("binNum", 20, "Bin number", "The number of bins of the histogram. E.g. the number of intervals in which the min..max range is subdivided into."));
 		break;
+	}
 	case PER_FACE_QUALITY_HISTOGRAM:
-		parlst.addParam(RichFloat("HistMin", vcg::tri::Stat<CMeshO>::ComputePerFaceQualityMinMax(m.cm).first, "Hist Min", "The faces are displaced of a vector whose norm is bounded by this value"));
-		parlst.addParam(RichFloat("HistMax", vcg::tri::Stat<CMeshO>::ComputePerFaceQualityMinMax(m.cm).second, "Hist Max", "The faces are displaced of a vector whose norm is bounded by this value"));
+	{
+		std::pair<Scalarm, Scalarm> minmax = meshlab::perFaceQualityMinMax(m.cm);
+		parlst.addParam(RichFloat("HistMin", minmax.first, "Hist Min", "The faces are displaced of a vector whose norm is bounded by this value"));
+		parlst.addParam(RichFloat("HistMax", minmax.second, "Hist Max", "The faces are displaced of a vector whose norm is bounded by this value"));
 		parlst.addParam(RichBool("areaWeighted", false, "Area Weighted", "If false, the histogram will report the number of faces with quality values falling in each bin of the histogram. If true each bin of the histogram will report the approximate area of the mesh with that range of values."));
 		parlst.addParam(RichInt("binNum", 20, "Bin number", "The number of bins of the histogram. E.g. the number of intervals in which the min..max range is subdivided into."));
 		break;
+	}
 	default:
 		break;
 	}
@@ -244,9 +253,20 @@ std::map<std::string, QVariant> FilterMeasurePlugin::computeTopologicalMeasures(
 	outputValues["unreferenced_vertices"] = unrefVertNum;
 	outputValues["boundary_edges"] = edgeBorderNum;
 
-	int connectedComponentsNum = tri::Clean<CMeshO>::CountConnectedComponents(m);
+	meshlab::ConnectedComponents connectedComp(m);
+	int connectedComponentsNum = connectedComp.size();
 	log("Mesh is composed by %i connected component(s)\n", connectedComponentsNum);
 	outputValues["connected_components_number"] = connectedComponentsNum;
+	if (connectedComponentsNum > 1) {
+		int largest = 0;
+		for (int i = 1; i < connectedComponentsNum; ++i)
+			if (connectedComp[i].faceNum > connectedComp[largest].faceNum)
+				largest = i;
+		log("The largest component has %i faces and area %f",
+			connectedComp[largest].faceNum, connectedComp[largest].area);
+		outputValues["largest_component_faces_number"] = connectedComp[largest].faceNum;
+		outputValues["largest_component_area"] = connectedComp[largest].area;
+	}
 
 	bool isTwoManifold = edgeNonManifFFNum == 0 && vertManifNum == 0;
 	if (isTwoManifold){
@@ -609,14 +629,14 @@ std::map<std::string, QVariant> FilterMeasurePlugin::perVertexQualityHistogram(
 	CMeshO &m = md.mm()->cm;
 	tri::Allocator<CMeshO>::CompactEveryVector(m);
 
-	Histogramm H;
-	H.SetRange(RangeMin, RangeMax, binNum);
 	vector<Scalarm> aVec(m.vn, 1.0);
 	if (areaFlag)
 		tri::MeshToMatrix<CMeshO>::PerVertexArea(m, aVec);
 
-	for (int i = 0; i<m.vn; ++i)
-		H.Add(m.vert[i].Q(), aVec[i]);
+	Histogramm H;
+	meshlab::parallelHistogram(H, RangeMin, RangeMax, binNum, m.vn, [&](Histogramm& partial, int i) {
+		partial.Add(m.vert[i].Q(), aVec[i]);
+	});
 
 	std::string formatter = areaFlag ? "%15.7f" : "%4.0f";
 	Eigen::VectorXd rmin(binNum+2), rmax(binNum+2), count(binNum+2);
@@ -653,15 +673,14 @@ std::map<std::string, QVariant> FilterMeasurePlugin::perFaceQualityHostogram(
 	CMeshO &m = md.mm()->cm;
 	tri::Allocator<CMeshO>::CompactEveryVector(m);
 
-	Histogramm H;
-	H.SetRange(RangeMin, RangeMax, binNum);
-
 	vector<Scalarm> aVec(m.fn, 1.0);
 	if (areaFlag)
 		tri::MeshToMatrix<CMeshO>::PerFaceArea(m, aVec);
 
-	for (int i = 0; i<m.fn; ++i)
-		H.Add(m.face[i].Q(), aVec[i]);
+	Histogramm H;
+	meshlab::parallelHistogram(H, RangeMin, RangeMax, binNum, m.fn, [&](Histogramm& partial, int i) {
+		partial.Add(m.face[i].Q(), aVec[i]);
+	});
 	
 	std::string formatter = areaFlag ? "%15.7f" : "%4.0f";
 	Eigen::VectorXd rmin(binNum+2), rmax(binNum+2), count(binNum+2);
@@ -1,4 +1,7 @@
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 #include <GL/glew.h>
 
@@ -28,6 +31,7 @@ using namespace std;
 
 AlignSet::AlignSet()
 	: mode(COMBINE)
+	, cpuRendering(false)
 	, target(NULL)
 	, render(NULL)
 	, vbo(0)
@@ -943,6 +947,11 @@ void AlignSet::resize(int max_side) {
 }
 
 void AlignSet::renderScene(vcg::Shot<Scalarm> &view, int component, bool save) {
+  if(cpuRendering) {
+    renderSceneCPU(view, component);
+    return;
+  }
+
   QSize fbosize(wt,ht);
   QGLFramebufferObjectFormat frmt;
   frmt.setInternalTextureFormat(GL_RGBA);
@@ -1251,6 +1260,234 @@ void AlignSet::readRender(int component) {
   fbo.release();
 }
 
+namespace {
+
+// per vertex output of the software "vertex shader"
+struct CpuVertex {
+  float x, y;     // window coordinates in the render buffer (origin bottom left, like GL)
+  float depth;    // distance from the camera along the view direction
+  float invz;     // 1/depth, 0 if the vertex is behind the near plane
+  float attr[7];  // color rgba and normal (or reflection) in eye space
+};
+
+// triangle to rasterize, indices of its CpuVertex
+struct CpuTriangle {
+  int v[3];
+};
+
+// same as the fragment shaders of initializeGL, for the single pass modes
+inline float shadeCPU(AlignSet::RenderingMode mode, const float *attr, int component)
+{
+  if(mode == AlignSet::COLOR || mode == AlignSet::SILHOUETTE)
+    return attr[component];
+
+  float n[4] = {attr[4], attr[5], attr[6], 1.0f};
+  float len = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+  if(len > 0) len = 1.0f/len;
+  for(int i = 0; i < 3; i++)
+    n[i] = n[i]*len*0.5f + 0.5f;
+  if(mode == AlignSet::NORMALMAP || mode == AlignSet::SPECULAR)
+    return n[component];
+
+  //COMBINE, SPECAMB
+  float t = attr[0]*attr[0];
+  return (1-t)*attr[component] + t*n[component];
+}
+
+}
+
+void AlignSet::renderSceneCPU(vcg::Shot<Scalarm> &view, int component) {
+  assert(mode <= SPECAMB);
+  const int npix = wt*ht;
+  memset(render, 0, npix);
+  if(component < 0 || component > 3) return;
+
+  const bool use_colors = (mode == COLOR || mode == COMBINE || mode == SPECAMB);
+  const bool use_reflection = (mode == SPECULAR || mode == SPECAMB);
+  const float sx = wt/(float)view.Intrinsics.ViewportPx[0];
+  const float sy = ht/(float)view.Intrinsics.ViewportPx[1];
+  const vcg::Matrix44<Scalarm> rot = view.Extrinsics.Rot();
+  const vcg::Point3<Scalarm> viewpoint = view.GetViewPoint();
+
+  //same near plane as renderScene
+  Scalarm _near, _far;
+  _near=0.1;
+  _far=10000;
+  GlShot< vcg::Shot<Scalarm> >::GetNearFarPlanes(view, mesh->bbox, _near, _far);
+  if(_near <= 0) _near = 0.1;
+  const Scalarm zNear = 0.5*_near;
+
+  auto project = [&](const vcg::Point3<Scalarm> &pos, CpuVertex &o) {
+    vcg::Point2<Scalarm> p = view.Project(pos);
+    o.x = float(p[0])*sx;
+    o.y = float(p[1])*sy;
+    o.invz = 1/o.depth;
+  };
+
+  //vertex stage, the attributes are computed also behind the near plane
+  //because the clipped faces interpolate them
+  std::vector<CpuVertex> verts(mesh->vn);
+#pragma omp parallel for schedule(static)
+  for(int i = 0; i < mesh->vn; i++) {
+    const CVertexO &v = mesh->vert[i];
+    CpuVertex &o = verts[i];
+    Scalarm depth = view.Depth(v.P());
+    o.depth = float(depth);
+    if(depth >= zNear)
+      project(v.P(), o);
+    else
+      o.invz = 0;
+
+    for(int k = 0; k < 4; k++)
+      o.attr[k] = use_colors ? v.C()[k]/255.0f : 1.0f;
+    vcg::Point3<Scalarm> normal = rot*v.N();
+    if(use_reflection) {
+      normal.Normalize();
+      vcg::Point3<Scalarm> position = rot*(v.P() - viewpoint);
+      normal = position - normal*(2*(normal*position));
+    }
+    for(int k = 0; k < 3; k++)
+      o.attr[4+k] = float(normal[k]);
+  }
+
+  //depth buffer stores 1/depth, 0 is the far plane
+  std::vector<float> zbuffer(npix, 0.0f);
+
+  if(mesh->fn == 0) {
+    for(int i = 0; i < mesh->vn; i++) {
+      const CpuVertex &o = verts[i];
+      if(o.invz <= 0) continue;
+      int x = int(std::floor(o.x));
+      int y = int(std::floor(o.y));
+      if(x < 0 || y < 0 || x >= wt || y >= ht) continue;
+      int offset = x + y*wt;
+      if(o.invz <= zbuffer[offset]) continue;
+      zbuffer[offset] = o.invz;
+      render[offset] = (unsigned char)(std::min(std::max(shadeCPU(mode, o.attr, component), 0.0f), 1.0f)*255 + 0.5f);
+    }
+    return;
+  }
+
+  //faces are clipped against the near plane, then the triangles are binned
+  //into horizontal bands, each band is rasterized by a single thread.
+  //As in renderScene there is no face culling.
+  const int bandHeight = 16;
+  const int nbands = (ht + bandHeight - 1)/bandHeight;
+  std::vector<std::vector<int> > bands(nbands);
+  std::vector<CpuTriangle> tris;
+  tris.reserve(mesh->fn);
+
+  auto addTriangle = [&](int i0, int i1, int i2) {
+    const CpuVertex &v0 = verts[i0], &v1 = verts[i1], &v2 = verts[i2];
+    float area = (v1.x - v0.x)*(v2.y - v0.y) - (v2.x - v0.x)*(v1.y - v0.y);
+    if(area == 0) return;
+    float ymin = std::min(v0.y, std::min(v1.y, v2.y));
+    float ymax = std::max(v0.y, std::max(v1.y, v2.y));
+    float xmin = std::min(v0.x, std::min(v1.x, v2.x));
+    float xmax = std::max(v0.x, std::max(v1.x, v2.x));
+    if(ymax < 0 || xmax < 0 || ymin >= ht || xmin >= wt) return;
+    CpuTriangle t = {{i0, i1, i2}};
+    int b0 = std::max(int(ymin), 0)/bandHeight;
+    int b1 = std::min(int(ymax), ht-1)/bandHeight;
+    for(int b = b0; b <= b1; b++)
+      bands[b].push_back(int(tris.size()));
+    tris.push_back(t);
+  };
+
+  //new vertex where the edge a-b (a in front, b behind) crosses the near plane;
+  //the attributes are interpolated linearly in 3D as GL does when clipping
+  auto clipVertex = [&](int a, int b) {
+    const CpuVertex va = verts[a], vb = verts[b];
+    float t = float((zNear - va.depth)/(vb.depth - va.depth));
+    CpuVertex o;
+    o.depth = float(zNear);
+    for(int k = 0; k < 7; k++)
+      o.attr[k] = va.attr[k] + (vb.attr[k] - va.attr[k])*t;
+    const vcg::Point3<Scalarm> &pa = mesh->vert[a].cP();
+    const vcg::Point3<Scalarm> &pb = mesh->vert[b].cP();
+    project(pa + (pb - pa)*Scalarm(t), o);
+    verts.push_back(o);
+    return int(verts.size()) - 1;
+  };
+
+  for(int i = 0; i < mesh->fn; i++) {
+    const CFaceO &f = mesh->face[i];
+    int vi[3];
+    int front = 0;
+    for(int k = 0; k < 3; k++) {
+      vi[k] = int(f.cV(k) - &*mesh->vert.begin());
+      if(verts[vi[k]].invz > 0) front++;
+    }
+    if(front == 3) {
+      addTriangle(vi[0], vi[1], vi[2]);
+    } else if(front > 0) {
+      //the clipped polygon keeps the winding of the face
+      int poly[4];
+      int np = 0;
+      for(int k = 0; k < 3; k++) {
+        int a = vi[k], b = vi[(k+1)%3];
+        bool ina = verts[a].invz > 0;
+        bool inb = verts[b].invz > 0;
+        if(ina) poly[np++] = a;
+        if(ina && !inb) poly[np++] = clipVertex(a, b);
+        else if(!ina && inb) poly[np++] = clipVertex(b, a);
+      }
+      for(int k = 1; k + 1 < np; k++)
+        addTriangle(poly[0], poly[k], poly[k+1]);
+    }
+  }
+
+#pragma omp parallel for schedule(dynamic)
+  for(int b = 0; b < nbands; b++) {
+    const int bandStart = b*bandHeight;
+    const int bandEnd = std::min(bandStart + bandHeight, ht);
+    float attr[7];
+    for(size_t j = 0; j < bands[b].size(); j++) {
+      const CpuTriangle &t = tris[bands[b][j]];
+      const CpuVertex *v[3];
+      for(int k = 0; k < 3; k++)
+        v[k] = &verts[t.v[k]];
+      //both windings are drawn: the edge functions are taken with the sign of the area
+      float area = (v[1]->x - v[0]->x)*(v[2]->y - v[0]->y) - (v[2]->x - v[0]->x)*(v[1]->y - v[0]->y);
+      const float sign = area < 0 ? -1.0f : 1.0f;
+
+      //sample at pixel centers
+      int x0 = std::max(int(std::floor(std::min(v[0]->x, std::min(v[1]->x, v[2]->x)))), 0);
+      int x1 = std::min(int(std::ceil(std::max(v[0]->x, std::max(v[1]->x, v[2]->x)))), wt-1);
+      int y0 = std::max(int(std::floor(std::min(v[0]->y, std::min(v[1]->y, v[2]->y)))), bandStart);
+      int y1 = std::min(int(std::ceil(std::max(v[0]->y, std::max(v[1]->y, v[2]->y)))), bandEnd-1);
+      for(int y = y0; y <= y1; y++) {
+        float cy = y + 0.5f;
+        for(int x = x0; x <= x1; x++) {
+          float cx = x + 0.5f;
+          float w[3];
+          for(int k = 0; k < 3; k++) {
+            const CpuVertex *a = v[(k+1)%3];
+            const CpuVertex *c = v[(k+2)%3];
+            w[k] = (c->x - a->x)*(cy - a->y) - (cx - a->x)*(c->y - a->y);
+          }
+          if(w[0]*sign < 0 || w[1]*sign < 0 || w[2]*sign < 0) continue;
+
+          float invz = 0;
+          for(int k = 0; k < 3; k++) {
+            w[k] = w[k]/area*v[k]->invz;
+            invz += w[k];
+          }
+          int offset = x + y*wt;
+          if(invz <= zbuffer[offset]) continue;
+          zbuffer[offset] = invz;
+
+          //perspective correct interpolation
+          for(int a = 0; a < 7; a++)
+            attr[a] = (w[0]*v[0]->attr[a] + w[1]*v[1]->attr[a] + w[2]*v[2]->attr[a])/invz;
+          float value = shadeCPU(mode, attr, component);
+          render[offset] = (unsigned char)(std::min(std::max(value, 0.0f), 1.0f)*255 + 0.5f);
+        }
+      }
+    }
+  }
+}
+
 GLuint AlignSet::createShaderFromFiles(QString name) {
   QString vert = "shaders/" + name + ".vert";
   QString frag = "shaders/" + name + ".frag";
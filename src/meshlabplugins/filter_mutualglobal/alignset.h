@@ -66,6 +66,7 @@ class AlignSet {
 	};
 
   RenderingMode mode;
+  bool cpuRendering; //renderScene rasterizes in software, only single pass modes (up to SPECAMB)
 
   GLint programs[RENDERING_MODE_LAST];
 
@@ -84,6 +85,7 @@ class AlignSet {
   void setPixelSizeMm(double ccdWidth);
 
   void renderScene(vcg::Shot<Scalarm>& shot, int component, bool save=false);
+  void renderSceneCPU(vcg::Shot<Scalarm>& shot, int component); // fills only render, no GL context needed
   void readRender(int component);
 
   void drawMeshPoints();
@@ -158,6 +158,9 @@ RichParameterList FilterMutualGlobal::initParameterList(const QAction *action, c
 			parlst.addParam(RichBool("Pre-alignment",false,"Pre-alignment step","Pre-alignment step"));
 			parlst.addParam(RichBool("Estimate Focal",true,"Estimate focal length","Estimate focal length"));
 			parlst.addParam(RichBool("Fine",true,"Fine Alignment","Fine alignment"));
+			parlst.addParam(RichBool("CPU rendering",false,"CPU rendering",
+				"Render the mesh in software during the pre-alignment step and refine all the rasters concurrently, one per thread. "
+				"If the global refinement is disabled (zero refinement steps) the filter does not need an OpenGL context."));
 
 		  /*parlst.addParam(RichBool ("UpdateNormals",
 											true,
@@ -187,7 +190,10 @@ std::map<std::string, QVariant> FilterMutualGlobal::applyFilter(
 		unsigned int& /*postConditionMask*/,
 		vcg::CallBackPos *cb)
 {
-	if (glContext == nullptr){
+	// with CPU rendering only the global refinement needs GL
+	const bool cpuPreAlign = par.getBool("Pre-alignment") && par.getBool("CPU rendering");
+	const bool useGL = (par.getBool("Pre-alignment") && !cpuPreAlign) || par.getInt("Max number of refinement steps") != 0;
+	if (useGL && glContext == nullptr){
 		throw MLException("Fatal error: glContext not initialized");
 	}
 	QElapsedTimer filterTime;
@@ -220,9 +226,10 @@ std::map<std::string, QVariant> FilterMutualGlobal::applyFilter(
 
 			}
 
-			this->glContext->makeCurrent();
-
-			this->initGL();
+			if (useGL) {
+				this->glContext->makeCurrent();
+				this->initGL();
+			}
 
 			if (par.getBool("Pre-alignment")) {
 				preAlignment(md, par, cb);
@@ -244,7 +251,8 @@ std::map<std::string, QVariant> FilterMutualGlobal::applyFilter(
 				}
 			}
 
-			this->glContext->doneCurrent();
+			if (useGL)
+				this->glContext->doneCurrent();
 			log("Done!");
 			break;
 
@@ -357,6 +365,32 @@ QString FilterMutualGlobal::filterScriptFunctionName( ActionIDType filterID )
 	return QString();
 }
 
+// Refine the shot of a single raster against alignset.mesh with the classic MI
+static void alignRaster(AlignSet &alignset, Solver &solver, MutualInfo &mutual, RasterModel &rm)
+{
+	alignset.image=&rm.currentPlane->image;
+	alignset.shot=rm.shot;
+
+	alignset.resize(800);
+
+	alignset.shot.Intrinsics.ViewportPx[0]=int((double)alignset.shot.Intrinsics.ViewportPx[1]*alignset.image->width()/alignset.image->height());
+	alignset.shot.Intrinsics.CenterPx[0]=(int)(alignset.shot.Intrinsics.ViewportPx[0]/2);
+
+	if (solver.fine_alignment)
+		solver.optimize(&alignset, &mutual, alignset.shot);
+	else
+		solver.iterative(&alignset, &mutual, alignset.shot);
+
+	rm.shot=alignset.shot;
+	float ratio= (float) rm.currentPlane->image.height()/(float)alignset.shot.Intrinsics.ViewportPx[1];
+	rm.shot.Intrinsics.ViewportPx[0]=rm.currentPlane->image.width();
+	rm.shot.Intrinsics.ViewportPx[1]=rm.currentPlane->image.height();
+	rm.shot.Intrinsics.PixelSizeMm[1]/=ratio;
+	rm.shot.Intrinsics.PixelSizeMm[0]/=ratio;
+	rm.shot.Intrinsics.CenterPx[0]=(int)((float)rm.shot.Intrinsics.ViewportPx[0]/2.0);
+	rm.shot.Intrinsics.CenterPx[1]=(int)((float)rm.shot.Intrinsics.ViewportPx[1]/2.0);
+}
+
 bool FilterMutualGlobal::preAlignment(MeshDocument &md, const RichParameterList & par, vcg::CallBackPos *cb)
 {
 	Solver solver;
@@ -399,78 +433,87 @@ bool FilterMutualGlobal::preAlignment(MeshDocument &md, const RichParameterList
 			break;
 		}
 
-		vcg::Point3f *vertices = new vcg::Point3f[alignset.mesh->vn];
-		vcg::Point3f *normals = new vcg::Point3f[alignset.mesh->vn];
-		vcg::Color4b *colors = new vcg::Color4b[alignset.mesh->vn];
-		unsigned int *indices = new unsigned int[alignset.mesh->fn*3];
+		if (par.getBool("CPU rendering")) {
+			// every raster gets its own AlignSet, solver and histograms: the
+			// rasters are independent and the software renderer needs no context
+			std::vector<RasterModel*> rasters;
+			for (RasterModel& rm : md.rasterIterator())
+				rasters.push_back(&rm);
+
+#pragma omp parallel for schedule(dynamic)
+			for (int i = 0; i < (int) rasters.size(); i++) {
+				if (!rasters[i]->isVisible())
+					continue;
+				AlignSet set;
+				set.mesh = alignset.mesh;
+				set.mode = alignset.mode;
+				set.cpuRendering = true;
+				Solver rasterSolver;
+				rasterSolver.optimize_focal = solver.optimize_focal;
+				rasterSolver.fine_alignment = solver.fine_alignment;
+				MutualInfo rasterMutual;
+				alignRaster(set, rasterSolver, rasterMutual, *rasters[i]);
+			}
 
-		for(int i = 0; i < alignset.mesh->vn; i++) {
-			vertices[i] = alignset.mesh->vert[i].P();
-			normals[i] = alignset.mesh->vert[i].N();
-			colors[i] = alignset.mesh->vert[i].C();
+			for (unsigned int r = 0; r < rasters.size(); ++r) {
+				if (rasters[r]->isVisible())
+					log("Image %d completed",r);
+				else
+					log("Image %d skipped",r);
+			}
 		}
+		else {
+			vcg::Point3f *vertices = new vcg::Point3f[alignset.mesh->vn];
+			vcg::Point3f *normals = new vcg::Point3f[alignset.mesh->vn];
+			vcg::Color4b *colors = new vcg::Color4b[alignset.mesh->vn];
+			unsigned int *indices = new unsigned int[alignset.mesh->fn*3];
+
+			for(int i = 0; i < alignset.mesh->vn; i++) {
+				vertices[i] = alignset.mesh->vert[i].P();
+				normals[i] = alignset.mesh->vert[i].N();
+				colors[i] = alignset.mesh->vert[i].C();
+			}
 
-		for(int i = 0; i < alignset.mesh->fn; i++)
-			for(int k = 0; k < 3; k++)
-				indices[k+i*3] = alignset.mesh->face[i].V(k) - &*alignset.mesh->vert.begin();
-
-		glBindBufferARB(GL_ARRAY_BUFFER_ARB, alignset.vbo);
-		glBufferDataARB(GL_ARRAY_BUFFER_ARB, alignset.mesh->vn*sizeof(vcg::Point3f),
-						vertices, GL_STATIC_DRAW_ARB);
-		glBindBufferARB(GL_ARRAY_BUFFER_ARB, alignset.nbo);
-		glBufferDataARB(GL_ARRAY_BUFFER_ARB, alignset.mesh->vn*sizeof(vcg::Point3f),
-						normals, GL_STATIC_DRAW_ARB);
-		glBindBufferARB(GL_ARRAY_BUFFER_ARB, alignset.cbo);
-		glBufferDataARB(GL_ARRAY_BUFFER_ARB, alignset.mesh->vn*sizeof(vcg::Color4b),
-						colors, GL_STATIC_DRAW_ARB);
-		glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
-
-		glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, alignset.ibo);
-		glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, alignset.mesh->fn*3*sizeof(unsigned int),
-						indices, GL_STATIC_DRAW_ARB);
-		glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
-
-
-		// it is safe to delete after copying data to VBO
-		delete []vertices;
-		delete []normals;
-		delete []colors;
-		delete []indices;
-
-		unsigned int r = 0;
-		for (RasterModel& rm : md.rasterIterator()) {
-			if(rm.isVisible()) {
-				alignset.image=&rm.currentPlane->image;
-				alignset.shot=rm.shot;
-
-				alignset.resize(800);
-
-				alignset.shot.Intrinsics.ViewportPx[0]=int((double)alignset.shot.Intrinsics.ViewportPx[1]*alignset.image->width()/alignset.image->height());
-				alignset.shot.Intrinsics.CenterPx[0]=(int)(alignset.shot.Intrinsics.ViewportPx[0]/2);
-
-				if (solver.fine_alignment)
-					solver.optimize(&alignset, &mutual, alignset.shot);
-				else {
-					solver.iterative(&alignset, &mutual, alignset.shot);
-					log("Vado di rough",r);
+			for(int i = 0; i < alignset.mesh->fn; i++)
+				for(int k = 0; k < 3; k++)
+					indices[k+i*3] = alignset.mesh->face[i].V(k) - &*alignset.mesh->vert.begin();
+
+			glBindBufferARB(GL_ARRAY_BUFFER_ARB, alignset.vbo);
+			glBufferDataARB(GL_ARRAY_BUFFER_ARB, alignset.mesh->vn*sizeof(vcg::Point3f),
+							vertices, GL_STATIC_DRAW_ARB);
+			glBindBufferARB(GL_ARRAY_BUFFER_ARB, alignset.nbo);
+			glBufferDataARB(GL_ARRAY_BUFFER_ARB, alignset.mesh->vn*sizeof(vcg::Point3f),
+							normals, GL_STATIC_DRAW_ARB);
+			glBindBufferARB(GL_ARRAY_BUFFER_ARB, alignset.cbo);
+			glBufferDataARB(GL_ARRAY_BUFFER_ARB, alignset.mesh->vn*sizeof(vcg::Color4b),
+							colors, GL_STATIC_DRAW_ARB);
+			glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+
+			glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, alignset.ibo);
+			glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, alignset.mesh->fn*3*sizeof(unsigned int),
+							indices, GL_STATIC_DRAW_ARB);
+			glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+
+
+			// it is safe to delete after copying data to VBO
+			delete []vertices;
+			delete []normals;
+			delete []colors;
+			delete []indices;
+
+			unsigned int r = 0;
+			for (RasterModel& rm : md.rasterIterator()) {
+				if(rm.isVisible()) {
+					alignRaster(alignset, solver, mutual, rm);
+					if (!solver.fine_alignment)
+						log("Vado di rough",r);
+					log("Image %d completed",r);
 				}
-
-				rm.shot=alignset.shot;
-				float ratio= (float) rm.currentPlane->image.height()/(float)alignset.shot.Intrinsics.ViewportPx[1];
-				rm.shot.Intrinsics.ViewportPx[0]=rm.currentPlane->image.width();
-				rm.shot.Intrinsics.ViewportPx[1]=rm.currentPlane->image.height();
-				rm.shot.Intrinsics.PixelSizeMm[1]/=ratio;
-				rm.shot.Intrinsics.PixelSizeMm[0]/=ratio;
-				rm.shot.Intrinsics.CenterPx[0]=(int)((float)rm.shot.Intrinsics.ViewportPx[0]/2.0);
-				rm.shot.Intrinsics.CenterPx[1]=(int)((float)rm.shot.Intrinsics.ViewportPx[1]/2.0);
-
-				log("Image %d completed",r);
-
-			}
-			else{
-				log("Image %d skipped",r);
+				else{
+					log("Image %d skipped",r);
+				}
+				++r;
 			}
-			++r;
 		}
 	}
 
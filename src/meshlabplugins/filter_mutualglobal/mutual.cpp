@@ -7,7 +7,14 @@
 #include <QImage> /*debug*/
 #include "mutual.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace std;
+
+//below this many pixels the histogram is not worth splitting among threads
+static const int MIN_PARALLEL_PIXELS = 64*1024;
 MutualInfo::MutualInfo(unsigned int _nbins, int _bweight, bool _use_background):
   bweight(_bweight), use_background(_use_background),
   histo2D(NULL), histoA(NULL), histoB(NULL) {
@@ -24,6 +31,7 @@ MutualInfo::~MutualInfo() {
 void MutualInfo::setBins(unsigned int _nbins) {
   nbins = _nbins;
   assert(!(nbins & (nbins-1)));
+  assert(nbins <= 256);
 
   if(histo2D) delete []histo2D;
   if(histoA) delete []histoA;
@@ -31,6 +39,7 @@ void MutualInfo::setBins(unsigned int _nbins) {
   histo2D = new unsigned int[nbins*nbins];
   histoA = new unsigned int[nbins];
   histoB = new unsigned int[nbins];
+  partials.clear();
 }
 
 double MutualInfo::info(int width, int height, 
@@ -103,14 +112,46 @@ void MutualInfo::histogram(int width, int height,
   int s = 0; 
   while ( bins>>=1) { ++s; }
 
-  for(int y = starty; y < endy; y++) {
-    int offset = width*y + startx;
-    for(int x = startx; x < endx; x++, offset++) {
-      unsigned char a = target[offset]>>k; //instead of /side;
-      unsigned char b = render[offset]>>k; //instead of /side;
-      histo2D[a + (b<<s)] += 2;//bweight; //instead of nbins*s
+  //each thread fills its own joint histogram (thread 0 uses histo2D
+  //directly), the partial ones are summed at the end.
+  const int nbins2 = nbins*nbins;
+  const int row = endx - startx;
+  int nthreads = 1;
+#ifdef _OPENMP
+  if(row*(endy - starty) >= MIN_PARALLEL_PIXELS && !omp_in_parallel())
+    nthreads = omp_get_max_threads();
+#endif
+  if(partials.size() < (size_t)(nthreads-1)*nbins2)
+    partials.resize((size_t)(nthreads-1)*nbins2);
+  if(nthreads > 1)
+    memset(partials.data(), 0, (size_t)(nthreads-1)*nbins2*sizeof(int));
+
+#pragma omp parallel num_threads(nthreads) if(nthreads > 1)
+  {
+    int tid = 0;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+#endif
+    unsigned int *histo = (tid == 0) ? histo2D : partials.data() + (size_t)(tid-1)*nbins2;
+    std::vector<unsigned short> index(row > 0 ? row : 0);
+
+#pragma omp for schedule(static)
+    for(int y = starty; y < endy; y++) {
+      const unsigned char *t = target + width*y + startx;
+      const unsigned char *r = render + width*y + startx;
+      //bin indices of the whole row first: no dependencies, this loop vectorizes
+      for(int x = 0; x < row; x++)
+        index[x] = (unsigned short)((t[x]>>k) + ((r[x]>>k)<<s)); //instead of /side and nbins*s
+      for(int x = 0; x < row; x++)
+        histo[index[x]] += 2;//bweight;
     }
   }
+
+  for(int t = 0; t < nthreads-1; t++) {
+    const unsigned int *histo = partials.data() + (size_t)t*nbins2;
+    for(int i = 0; i < nbins2; i++)
+      histo2D[i] += histo[i];
+  }
   //weight of background is divided.
   //background is when b = 0 -> first row of histo2D
   if(bweight != 0) {
@@ -1,6 +1,8 @@
 #ifndef MUTUAL_INFORMATION_H
 #define MUTUAL_INFORMATION_H
 
+#include <vector>
+
 class MutualInfo {
  public:
   int bweight;
@@ -20,6 +22,7 @@ class MutualInfo {
   unsigned int *histo2D; //matrix nbisXnbins
   unsigned int *histoA;  //vector nbins
   unsigned int *histoB;
+  std::vector<unsigned int> partials; //per thread joint histograms, (threads-1)*nbins*nbins
 };
 
 
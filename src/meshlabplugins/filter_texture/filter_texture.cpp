@@ -27,12 +27,12 @@
 #include <float.h>
 #include <stdlib.h>
 #include "filter_texture.h"
-#include "pushpull.h"
 #include "rastering.h"
 #include <vcg/complex/algorithms/update/texture.h>
 #include<wrap/io_trimesh/export_ply.h>
 #include <vcg/complex/algorithms/parametrization/voronoi_atlas.h>
 #include <common/utilities/load_save.h>
+#include <common/utilities/pull_push.h>
 #include <QStandardPaths>
 
 using namespace vcg;
@@ -41,6 +41,27 @@ using namespace vcg;
 #define CheckError(x,y); if ((x)) {throw MLException((y));}
 ///////////////////////////////////////////////////////
 
+// Reverts to 255 the alpha of the border texels (the ones with alpha 0 are
+// left to the pull push hole filling, if requested)
+static void revertBorderAlpha(QImage &img, bool pullPush)
+{
+	QRgb *bits = reinterpret_cast<QRgb*>(img.bits());
+	const int stride = img.bytesPerLine() / sizeof(QRgb);
+	const int w = img.width();
+	const int h = img.height();
+	#pragma omp parallel for schedule(static)
+	for (int y = 0; y < h; ++y)
+	{
+		QRgb *line = bits + y * stride;
+		for (int x = 0; x < w; ++x)
+		{
+			QRgb px = line[x];
+			if (qAlpha(px) < 255 && (!pullPush || qAlpha(px) > 0))
+				line[x] = px | 0xff000000;
+		}
+	}
+}
+
 FilterTexturePlugin::FilterTexturePlugin()
 {
 	typeList = {
@@ -779,8 +800,7 @@ std::map<std::string, QVariant> FilterTexturePlugin::applyFilter(
 
 		// Rasterizing triangles
 		RasterSampler rs(trgImgs);
-		rs.InitCallback(cb, m.cm.fn, 0, 80);
-		tri::SurfaceSampling<CMeshO,RasterSampler>::Texture(m.cm,rs,textW,textH,true);
+		ParallelTextureRaster(m.cm, rs, textW, textH, true, cb, 0, 80);
 
 		// Undo topology changes
 		tri::UpdateTopology<CMeshO>::FaceFace(m.cm);
@@ -790,19 +810,13 @@ std::map<std::string, QVariant> FilterTexturePlugin::applyFilter(
 		{
 			// Revert alpha values for border edge pixels to 255
 			cb(81, "Cleaning up texture ...");
-			for (int y = 0; y<textH; ++y)
-				for (int x = 0; x<textW; ++x)
-				{
-					QRgb px = trgImgs[texInd].pixel(x, y);
-					if (qAlpha(px) < 255 && (!pp || qAlpha(px) > 0))
-						trgImgs[texInd].setPixel(x, y, px | 0xff000000);
-				}
+			revertBorderAlpha(trgImgs[texInd], pp);
 
 			// PullPush
 			if (pp)
 			{
 				cb(85, "Filling texture holes...");
-				PullPush(trgImgs[texInd], qRgba(0, 0, 0, 0));
+				meshlab::pullPush(trgImgs[texInd], qRgba(0, 0, 0, 0));
 			}
 		}
 
@@ -1038,14 +1052,12 @@ void FilterTexturePlugin::transferToTexture(
 	if (vertexSampling)
 	{
 		TransferColorSampler sampler(srcMesh->cm, trgImgs, upperbound, vertexMode); // color sampling
-		sampler.InitCallback(cb, trgMesh->cm.fn, 0, 80);
-		tri::SurfaceSampling<CMeshO, TransferColorSampler>::Texture(trgMesh->cm, sampler, textW, textH, false);
+		ParallelTextureRaster(trgMesh->cm, sampler, textW, textH, false, cb, 0, 80);
 	}
 	else
 	{
 		TransferColorSampler sampler(srcMesh->cm, trgImgs, &srcImgs, upperbound); // texture sampling
-		sampler.InitCallback(cb, trgMesh->cm.fn, 0, 80);
-		tri::SurfaceSampling<CMeshO, TransferColorSampler>::Texture(trgMesh->cm, sampler, textW, textH, false);
+		ParallelTextureRaster(trgMesh->cm, sampler, textW, textH, false, cb, 0, 80);
 	}
 
 	// the meshes have to return to their original position
@@ -1066,19 +1078,13 @@ void FilterTexturePlugin::transferToTexture(
 	{
 		// Revert alpha values for border edge pixels to 255
 		cb(81, "Cleaning up texture ...");
-		for (int y = 0; y<textH; ++y)
-			for (int x = 0; x<textW; ++x)
-			{
-				QRgb px = trgImgs[trgTexInd].pixel(x, y);
-				if (qAlpha(px) < 255 && (!pp || qAlpha(px) > 0))
-					trgImgs[trgTexInd].setPixel(x, y, px | 0xff000000);
-			}
+		revertBorderAlpha(trgImgs[trgTexInd], pp);
 
 		// PullPush
 		if (pp)
 		{
 			cb(85, "Filling texture holes...");
-			PullPush(trgImgs[trgTexInd], qRgba(0, 0, 0, 0));
+			meshlab::pullPush(trgImgs[trgTexInd], qRgba(0, 0, 0, 0));
 		}
 	}
 
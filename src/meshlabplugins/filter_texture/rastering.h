@@ -28,6 +28,12 @@
 #include <vcg/complex/algorithms/point_sampling.h>
 #include <vcg/space/triangle2.h>
 
+#include <atomic>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 class VertexSampler
 {
     typedef vcg::GridStaticPtr<CMeshO::FaceType, CMeshO::ScalarType > MetroMeshGrid;
@@ -101,9 +107,55 @@ public:
     }
 };
 
+// Direct access to the scanlines of the ARGB32 target textures. Texels are
+// addressed in raster coordinates (y axis pointing up) and texels outside the
+// image are ignored.
+class TexelBuffer
+{
+    std::vector<QRgb*> bits;
+    std::vector<int> strides;
+    int width, height;
+
+public:
+    TexelBuffer(std::vector<QImage> &imgs) : width(0), height(0)
+    {
+        for (QImage &img : imgs)
+        {
+            if (img.format() != QImage::Format_ARGB32)
+                img = img.convertToFormat(QImage::Format_ARGB32);
+            bits.push_back(reinterpret_cast<QRgb*>(img.bits())); // detaches once, before any parallel access
+            strides.push_back(img.bytesPerLine() / sizeof(QRgb));
+        }
+        if (!imgs.empty())
+        {
+            width = imgs[0].width();
+            height = imgs[0].height();
+        }
+    }
+
+    int TextureNumber() const { return bits.size(); }
+
+    QRgb *Texel(int tex, const vcg::Point2i &tp) const
+    {
+        if (tex < 0 || tex >= (int)bits.size() || tp.X() < 0 || tp.X() >= width || tp.Y() < 0 || tp.Y() >= height)
+            return nullptr;
+        return bits[tex] + (height - 1 - tp.Y()) * strides[tex] + tp.X();
+    }
+};
+
+// Marker that never marks anything: it can be shared among threads, faces
+// spanning more grid cells are simply tested more than once.
+class NoFaceMarker
+{
+public:
+    void UnMarkAll() const {}
+    bool IsMarked(const CMeshO::FaceType *) const { return false; }
+    void Mark(const CMeshO::FaceType *) const {}
+};
+
 class RasterSampler
 {
-    std::vector<QImage> &trgImgs;
+    TexelBuffer trgBuf;
 
     // Callback stuff
     vcg::CallBackPos *cb;
@@ -111,7 +163,11 @@ class RasterSampler
     int faceNo, faceCnt, start, offset;
 
 public:
-	RasterSampler(std::vector<QImage> &_imgs) : trgImgs(_imgs) {}
+    struct QueryCache {};
+
+	RasterSampler(std::vector<QImage> &_imgs) : trgBuf(_imgs), cb(NULL) {}
+
+    int TextureNumber() const { return trgBuf.TextureNumber(); }
 
     void InitCallback(vcg::CallBackPos *_cb, int _faceNo, int _start=0, int _offset=100)
     {
@@ -126,28 +182,34 @@ public:
         currFace = NULL;
     }
 
-        // expects points outside face (affecting face color) with edge distance > 0
+    // expects points outside face (affecting face color) with edge distance > 0
     void AddTextureSample(const CMeshO::FaceType &f, const CMeshO::CoordType &p, const vcg::Point2i &tp, float edgeDist= 0.0)
     {
-        CMeshO::VertexType::ColorType c;
-        /*int alpha = 255;
-        if (fabs(p[0]+p[1]+p[2]-1)>=0.00001)
-            if (p[0] <.0) {alpha = 254+p[0]*128; bary[0] = 0.;} else
-                if (p[1] <.0) {alpha = 254+p[1]*128; bary[1] = 0.;} else
-                    if (p[2] <.0) {alpha = 254+p[2]*128; bary[2] = 0.;}*/
+        QueryCache cache;
+        AddTexel(f, p, tp, edgeDist, cache);
+        if (cb)
+        {
+            if (&f != currFace) {currFace = &f; ++faceCnt;}
+            cb(start + faceCnt*offset/faceNo, "Rasterizing faces ...");
+        }
+    }
+
+    // thread safe version, used by the parallel rasterization
+    void AddTexel(const CMeshO::FaceType &f, const CMeshO::CoordType &p, const vcg::Point2i &tp, float edgeDist, QueryCache &) const
+    {
+        QRgb *texel = trgBuf.Texel(f.cWT(0).N(), tp);
+        if (texel == nullptr)
+            return;
+
         int alpha = 255;
         if (edgeDist != 0.0)
             alpha=254-edgeDist*128;
 
-        if (alpha == 255 || qAlpha(trgImgs[f.cWT(0).N()].pixel(tp.X(), trgImgs[f.cWT(0).N()].height() - 1 - tp.Y())) < alpha)
+        if (alpha == 255 || qAlpha(*texel) < alpha)
         {
+            CMeshO::VertexType::ColorType c;
             c.lerp(f.cV(0)->cC(), f.cV(1)->cC(), f.cV(2)->cC(), p);
-			trgImgs[f.cWT(0).N()].setPixel(tp.X(), trgImgs[f.cWT(0).N()].height() - 1 - tp.Y(), qRgba(c[0], c[1], c[2], alpha));
-        }
-        if (cb)
-        {
-            if (&f != currFace) {currFace = &f; ++faceCnt;}
-            cb(start + faceCnt*offset/faceNo, "Rasterizing faces ...");
+            *texel = qRgba(c[0], c[1], c[2], alpha);
         }
     }
 };
@@ -157,9 +219,16 @@ class TransferColorSampler
     typedef vcg::GridStaticPtr<CMeshO::FaceType, CMeshO::ScalarType > MetroMeshGrid;
     typedef vcg::GridStaticPtr<CMeshO::VertexType, CMeshO::ScalarType > VertexMeshGrid;
 
-    std::vector <QImage> &trgImgs;
-    std::vector <QImage> *srcImgs;
+    struct SourceImage
+    {
+        const QRgb *bits;
+        int stride, width, height;
+    };
+
+    TexelBuffer trgBuf;
+    std::vector<SourceImage> srcBufs;
     float dist_upper_bound;
+    CMeshO::ScalarType cacheEps;
     bool fromTexture;
     MetroMeshGrid unifGridFace;
     VertexMeshGrid   unifGridVert;
@@ -172,48 +241,25 @@ class TransferColorSampler
     int faceNo, faceCnt, start, offset;
     int vertexMode;
     float minQ,maxQ;
-    typedef vcg::tri::FaceTmark<CMeshO> MarkerFace;
-    MarkerFace markerFunctor;
 
-    /*QRgb GetBilinearPixelColor(float _u, float _v, int alpha)
+public:
+    // last element found by the closest point queries of a thread: close
+    // texels have close nearest points, so its distance bounds the next query
+    struct QueryCache
     {
-        int w = srcImg->width();
-        int h = srcImg->height();
-        QRgb p00, p01, p10, p11;
-        float u = _u * w -0.5;
-        float v = _v * h -0.5;
-        int x = floor(u);
-        int y = floor(v);
-        float u_ratio = u - x;
-        float v_ratio = v - y;
-        x = (x%w + w)%w;
-        y = (y%h + h)%h;
-        float u_opposite = 1 - u_ratio;
-        float v_opposite = 1 - v_ratio;
-
-        p00 = srcImg->pixel(x,y);
-        p01 = srcImg->pixel(x, (y+1)%h);
-        p10 = srcImg->pixel((x+1)%w, y);
-        p11 = srcImg->pixel((x+1)%w, (y+1)%h);
-        int r,g,b;
-        r = (qRed(p00)*u_opposite+qRed(p01)*u_ratio)*v_opposite +
-            (qRed(p01)*u_opposite+qRed(p11)*u_ratio)*v_ratio;
-        g = (qGreen(p00)*u_opposite+qGreen(p01)*u_ratio)*v_opposite +
-            (qGreen(p01)*u_opposite+qGreen(p11)*u_ratio)*v_ratio;
-        b = (qBlue(p00)*u_opposite+qBlue(p01)*u_ratio)*v_opposite +
-            (qBlue(p01)*u_opposite+qBlue(p11)*u_ratio)*v_ratio;
-        return qRgba(r,g,b, alpha);
-    }*/
+        QueryCache() : face(NULL), vert(NULL) {}
+        const CMeshO::FaceType *face;
+        const CMeshO::VertexType *vert;
+    };
 
-public:
     TransferColorSampler(CMeshO &_srcMesh, std::vector <QImage> &_trgImgs, float upperBound, int _vertexMode)
-    : trgImgs(_trgImgs), dist_upper_bound(upperBound)
+    : trgBuf(_trgImgs), dist_upper_bound(upperBound), cb(NULL)
     {
         srcMesh=&_srcMesh;
+        cacheEps = _srcMesh.bbox.Diag() * 1e-6;
         usePointCloudSampling = _srcMesh.face.empty();
         if(usePointCloudSampling) unifGridVert.Set(_srcMesh.vert.begin(),_srcMesh.vert.end());
                         else  unifGridFace.Set(_srcMesh.face.begin(),_srcMesh.face.end());
-        markerFunctor.SetMesh(&_srcMesh);
         fromTexture = false;
         vertexMode=_vertexMode;
         if(vertexMode==2)
@@ -225,15 +271,29 @@ public:
     }
 
 	TransferColorSampler(CMeshO &_srcMesh, std::vector <QImage> &_trgImgs, std::vector <QImage> *_srcImgs, float upperBound)
-		: trgImgs(_trgImgs), srcImgs(_srcImgs), dist_upper_bound(upperBound)
+		: trgBuf(_trgImgs), dist_upper_bound(upperBound), cb(NULL)
     {
         srcMesh=&_srcMesh;
+        cacheEps = _srcMesh.bbox.Diag() * 1e-6;
         unifGridFace.Set(_srcMesh.face.begin(),_srcMesh.face.end());
-        markerFunctor.SetMesh(&_srcMesh);
         fromTexture = true;
         usePointCloudSampling=false;
         vertexMode=-1;
+        for (QImage &img : *_srcImgs)
+        {
+            if (img.format() != QImage::Format_ARGB32)
+                img = img.convertToFormat(QImage::Format_ARGB32);
+            SourceImage si;
+            si.bits = reinterpret_cast<const QRgb*>(img.constBits());
+            si.stride = img.bytesPerLine() / sizeof(QRgb);
+            si.width = img.width();
+            si.height = img.height();
+            srcBufs.push_back(si);
+        }
     }
+
+    int TextureNumber() const { return trgBuf.TextureNumber(); }
+
     void InitCallback(vcg::CallBackPos *_cb, int _faceNo, int _start=0, int _offset=100)
     {
         assert(_faceNo > 0);
@@ -249,13 +309,22 @@ public:
 
     void AddTextureSample(const CMeshO::FaceType &f, const CMeshO::CoordType &p, const vcg::Point2i &tp, float edgeDist=0.0)
     {
-        // Calculate correct barycentric coords
-        /*CMeshO::CoordType bary = p;
-        int alpha = 255;
-        if (fabs(p[0]+p[1]+p[2]-1)>=0.00001)
-            if (p[0] <.0) {alpha = 254+p[0]*128; bary[0] = 0.;} else
-                if (p[1] <.0) {alpha = 254+p[1]*128; bary[1] = 0.;} else
-                    if (p[2] <.0) {alpha = 254+p[2]*128; bary[2] = 0.;}*/
+        QueryCache cache;
+        AddTexel(f, p, tp, edgeDist, cache);
+        if (cb)
+        {
+            if (&f != currFace) {currFace = &f; ++faceCnt;}
+            cb(start + faceCnt*offset/faceNo, "Rasterizing faces ...");
+        }
+    }
+
+    // thread safe version, used by the parallel rasterization
+    void AddTexel(const CMeshO::FaceType &f, const CMeshO::CoordType &p, const vcg::Point2i &tp, float edgeDist, QueryCache &cache)
+    {
+        QRgb *texel = trgBuf.Texel(f.cWT(0).N(), tp);
+        if (texel == nullptr)
+            return;
+
         int rr=0,gg=0,bb=0;
         CMeshO::CoordType bary = p;
         int alpha = 255;
@@ -274,57 +343,73 @@ public:
 
         if(usePointCloudSampling)
         {
-            CMeshO::VertexType   *nearestV=0;
-            CMeshO::ScalarType dist=dist_upper_bound;
-            nearestV =  vcg::tri::GetClosestVertex<CMeshO,VertexMeshGrid>(*srcMesh,unifGridVert,startPt,dist_upper_bound,dist); //(PDistFunct,markerFunctor,startPt,dist_upper_bound,dist,closestPt);
-            //if(cb) cb(sampleCnt++*100/sampleNum,"Resampling Vertex attributes");
-            //if(storeDistanceAsQualityFlag)  p.Q() = dist;
-            if(dist == dist_upper_bound) return ;
+            CMeshO::ScalarType maxDist = dist_upper_bound;
+            CMeshO::ScalarType cachedDist = dist_upper_bound;
+            if (cache.vert != NULL)
+            {
+                cachedDist = vcg::Distance(startPt, cache.vert->cP());
+                maxDist = std::min<CMeshO::ScalarType>(dist_upper_bound, cachedDist * 1.0001 + cacheEps);
+            }
+            CMeshO::ScalarType dist=maxDist;
+            const CMeshO::VertexType *nearestV = vcg::tri::GetClosestVertex<CMeshO,VertexMeshGrid>(*srcMesh,unifGridVert,startPt,maxDist,dist);
+            if (nearestV == NULL || dist == maxDist)
+            {
+                if (cache.vert == NULL || cachedDist >= dist_upper_bound) return;
+                nearestV = cache.vert;
+            }
+            cache.vert = nearestV;
 
             switch(vertexMode)
             {
                 case 0 : // Color
                 {
-                    rr = nearestV->C()[0];
-                    gg = nearestV->C()[1];
-                    bb = nearestV->C()[2];
+                    rr = nearestV->cC()[0];
+                    gg = nearestV->cC()[1];
+                    bb = nearestV->cC()[2];
                 } break;
                 case 1: // normal
                 {
-                    rr = ((nearestV->N()[0]) * 128.0) + 128;
-                    gg = ((nearestV->N()[1]) * 128.0) + 128;
-                    bb = ((nearestV->N()[2]) * 128.0) + 128;
+                    rr = ((nearestV->cN()[0]) * 128.0) + 128;
+                    gg = ((nearestV->cN()[1]) * 128.0) + 128;
+                    bb = ((nearestV->cN()[2]) * 128.0) + 128;
                 } break;
                 case 2: // quality
                 {
-                    float q= ((nearestV->Q()-minQ)/(maxQ-minQ))*255.0f;
+                    float q= ((nearestV->cQ()-minQ)/(maxQ-minQ))*255.0f;
                     rr = gg = bb = q;
                 } break;
             }
-            int cx = tp.X();
-            int cy = trgImgs[f.cWT(0).N()].height() - 1 - tp.Y();
-            if (cx >= 0 && cx < trgImgs[f.cWT(0).N()].size().width()) {
-                if (cy >= 0 && cy < trgImgs[f.cWT(0).N()].size().height()){
-                    trgImgs[f.cWT(0).N()].setPixel(cx, cy, qRgba(rr, gg, bb, 255));
-                }
-            }
+            *texel = qRgba(rr, gg, bb, 255);
         }
         else // sampling from a mesh
         {
             CMeshO::CoordType closestPt;
             vcg::face::PointDistanceBaseFunctor<CMeshO::ScalarType> PDistFunct;
-            CMeshO::ScalarType dist=dist_upper_bound;
-            CMeshO::FaceType *nearestF;
-            nearestF =  unifGridFace.GetClosest(PDistFunct, markerFunctor, startPt, dist_upper_bound, dist, closestPt);
-            if (dist == dist_upper_bound) return;
+            NoFaceMarker marker;
+
+            CMeshO::ScalarType maxDist = dist_upper_bound;
+            CMeshO::ScalarType cachedDist = dist_upper_bound;
+            CMeshO::CoordType cachedPt;
+            if (cache.face != NULL && PDistFunct(*cache.face, startPt, cachedDist, cachedPt))
+                maxDist = std::min<CMeshO::ScalarType>(dist_upper_bound, cachedDist * 1.0001 + cacheEps);
+
+            CMeshO::ScalarType dist=maxDist;
+            CMeshO::FaceType *nearestF = unifGridFace.GetClosest(PDistFunct, marker, startPt, maxDist, dist, closestPt);
+            if (nearestF == NULL || dist == maxDist)
+            {
+                if (cachedDist >= dist_upper_bound) return;
+                nearestF = const_cast<CMeshO::FaceType*>(cache.face);
+                closestPt = cachedPt;
+            }
+            cache.face = nearestF;
 
             // Convert point to barycentric coords
             CMeshO::CoordType interp;
-            bool ret = vcg::InterpolationParameters(*nearestF, nearestF->N(), closestPt, interp);
-                        // if the point is outside the nearest face,
+            bool ret = vcg::InterpolationParameters(*nearestF, nearestF->cN(), closestPt, interp);
+            // if the point is outside the nearest face,
             // then let's clamp it inside:
-                        if(!ret)
-                        {
+            if(!ret)
+            {
               assert(fabs((interp[0]+interp[1]+interp[2])-1.0f)<0.00001);
               int nonZeroCnt=3;
               if(interp[0]<0) {interp[0]=0; nonZeroCnt--;}
@@ -339,55 +424,151 @@ public:
               interp[2]=1.0-interp[1]-interp[0];
             }
 
-		if (alpha == 255 || qAlpha(trgImgs[f.cWT(0).N()].pixel(tp.X(), trgImgs[f.cWT(0).N()].height() - 1 - tp.Y())) < alpha)
-        {
-            if (fromTexture)
+            if (alpha == 255 || qAlpha(*texel) < alpha)
             {
-				int w = (*srcImgs)[nearestF->cWT(0).N()].width(), h = (*srcImgs)[nearestF->cWT(0).N()].height();
-                int x, y;
-                x = w * (interp[0]*nearestF->cWT(0).U()+interp[1]*nearestF->cWT(1).U()+interp[2]*nearestF->cWT(2).U());
-                y = h * (1.0 - (interp[0]*nearestF->cWT(0).V()+interp[1]*nearestF->cWT(1).V()+interp[2]*nearestF->cWT(2).V()));
-                // texture repeat mode
-                x = (x%w + w)%w;
-                y = (y%h + h)%h;
-				QRgb px = (*srcImgs)[nearestF->cWT(0).N()].pixel(x, y);
-				trgImgs[f.cWT(0).N()].setPixel(tp.X(), trgImgs[f.cWT(0).N()].height() - 1 - tp.Y(), qRgba(qRed(px), qGreen(px), qBlue(px), alpha));
-            }
-            else
-            {
-                // Calculate and set color
-                CMeshO::VertexType::ColorType c(0);
-                switch(vertexMode)
+                if (fromTexture)
                 {
-                case 0 : // Color
-                    c.lerp(nearestF->V(0)->cC(), nearestF->V(1)->cC(), nearestF->V(2)->cC(), interp);
-                    break;
-                case 1 : { // Normal
-                    CMeshO::CoordType nn = nearestF->V(0)->cN()*interp[0]+
-                                           nearestF->V(1)->cN()*interp[1]+
-                                           nearestF->V(2)->cN()*interp[2];
-                    nn.Normalize();
-                    nn= ((nn+CMeshO::CoordType(1.0,1.0,1.0))/2.0f)*255.0f;
-                    c=vcg::Color4b(nn[0],nn[1],nn[2],255);
-                } break;
-                case 2 : { // Quality
-                    float q = nearestF->V(0)->cQ()*interp[0]+
-                            nearestF->V(1)->cQ()*interp[1]+
-                            nearestF->V(2)->cQ()*interp[2];
-                    c=vcg::Color4b::GrayShade(255.0*(q-minQ)/(maxQ-minQ));
-                } break;
-                default: assert(0);
+                    int srcTex = nearestF->cWT(0).N();
+                    if (srcTex < 0 || srcTex >= (int)srcBufs.size())
+                        return;
+                    const SourceImage &src = srcBufs[srcTex];
+                    int w = src.width, h = src.height;
+                    int x, y;
+                    x = w * (interp[0]*nearestF->cWT(0).U()+interp[1]*nearestF->cWT(1).U()+interp[2]*nearestF->cWT(2).U());
+                    y = h * (1.0 - (interp[0]*nearestF->cWT(0).V()+interp[1]*nearestF->cWT(1).V()+interp[2]*nearestF->cWT(2).V()));
+                    // texture repeat mode
+                    x = (x%w + w)%w;
+                    y = (y%h + h)%h;
+                    QRgb px = src.bits[y * src.stride + x];
+                    *texel = qRgba(qRed(px), qGreen(px), qBlue(px), alpha);
+                }
+                else
+                {
+                    // Calculate and set color
+                    CMeshO::VertexType::ColorType c(0);
+                    switch(vertexMode)
+                    {
+                    case 0 : // Color
+                        c.lerp(nearestF->V(0)->cC(), nearestF->V(1)->cC(), nearestF->V(2)->cC(), interp);
+                        break;
+                    case 1 : { // Normal
+                        CMeshO::CoordType nn = nearestF->V(0)->cN()*interp[0]+
+                                               nearestF->V(1)->cN()*interp[1]+
+                                               nearestF->V(2)->cN()*interp[2];
+                        nn.Normalize();
+                        nn= ((nn+CMeshO::CoordType(1.0,1.0,1.0))/2.0f)*255.0f;
+                        c=vcg::Color4b(nn[0],nn[1],nn[2],255);
+                    } break;
+                    case 2 : { // Quality
+                        float q = nearestF->V(0)->cQ()*interp[0]+
+                                nearestF->V(1)->cQ()*interp[1]+
+                                nearestF->V(2)->cQ()*interp[2];
+                        c=vcg::Color4b::GrayShade(255.0*(q-minQ)/(maxQ-minQ));
+                    } break;
+                    default: assert(0);
+                    }
+                    *texel = qRgba(c[0], c[1], c[2], alpha);
                 }
-				trgImgs[f.cWT(0).N()].setPixel(tp.X(), trgImgs[f.cWT(0).N()].height() - 1 - tp.Y(), qRgba(c[0], c[1], c[2], alpha));
-            }
-        }
-            if (cb)
-            {
-                if (&f != currFace) {currFace = &f; ++faceCnt;}
-                cb(start + faceCnt*offset/faceNo, "Rasterizing faces ...");
             }
         }
     }
 };
 
+// Forwards to the sampler only the texels of a tile of the texture space,
+// with the query cache of the thread that is rasterizing the tile.
+template <class Sampler>
+class TileSampler
+{
+    Sampler &sampler;
+    typename Sampler::QueryCache cache;
+    int x0, y0, x1, y1;
+
+public:
+    TileSampler(Sampler &_sampler, int _x0, int _y0, int _x1, int _y1)
+        : sampler(_sampler), x0(_x0), y0(_y0), x1(_x1), y1(_y1) {}
+
+    void AddTextureSample(const CMeshO::FaceType &f, const CMeshO::CoordType &p, const vcg::Point2i &tp, float edgeDist=0.0)
+    {
+        if (tp.X() >= x0 && tp.X() < x1 && tp.Y() >= y0 && tp.Y() < y1)
+            sampler.AddTexel(f, p, tp, edgeDist, cache);
+    }
+};
+
+/*
+ * Parallel version of SurfaceSampling::Texture.
+ * The texture space is split in square tiles; each face is assigned to the
+ * tiles covered by its texel footprint and the tiles are rasterized in
+ * parallel, each one writing only its own texels. Faces are rasterized in
+ * mesh order inside each tile, so every texel sees the same sequence of
+ * writes of the serial rasterization and the result does not change.
+ */
+template <class Sampler>
+void ParallelTextureRaster(CMeshO &m, Sampler &sampler, int textureWidth, int textureHeight, bool correctSafePointsBaryCoords,
+                           vcg::CallBackPos *cb=0, int start=0, int offset=100, int tileSize=128)
+{
+    typedef vcg::Point2<CMeshO::ScalarType> Point2x;
+    typedef TileSampler<Sampler> TileSamplerType;
+
+    const int texNum = sampler.TextureNumber();
+    const int tilesX = (textureWidth + tileSize - 1) / tileSize;
+    const int tilesY = (textureHeight + tileSize - 1) / tileSize;
+    std::vector<std::vector<int> > tileFaces(size_t(texNum) * tilesX * tilesY);
+
+    for (size_t i = 0; i < m.face.size(); ++i)
+    {
+        const CMeshO::FaceType &f = m.face[i];
+        if (f.IsD())
+            continue;
+        int tex = f.cWT(0).N();
+        if (tex < 0 || tex >= texNum)
+            continue;
+
+        // same texel range scanned by SingleFaceRaster
+        vcg::Box2<CMeshO::ScalarType> bb;
+        for (int k = 0; k < 3; ++k)
+            bb.Add(Point2x(f.cWT(k).U() * textureWidth - 0.5, f.cWT(k).V() * textureHeight - 0.5));
+        int xMin = std::max<int>(floor(bb.min[0]) - 1, 0);
+        int yMin = std::max<int>(floor(bb.min[1]) - 1, 0);
+        int xMax = std::min<int>(ceil(bb.max[0]) + 1, textureWidth - 1);
+        int yMax = std::min<int>(ceil(bb.max[1]) + 1, textureHeight - 1);
+        if (xMin > xMax || yMin > yMax)
+            continue;
+
+        for (int ty = yMin / tileSize; ty <= yMax / tileSize; ++ty)
+            for (int tx = xMin / tileSize; tx <= xMax / tileSize; ++tx)
+                tileFaces[(size_t(tex) * tilesY + ty) * tilesX + tx].push_back(i);
+    }
+
+    std::vector<int> tiles;
+    for (size_t t = 0; t < tileFaces.size(); ++t)
+        if (!tileFaces[t].empty())
+            tiles.push_back(t);
+
+    std::atomic<int> tilesDone(0);
+    #pragma omp parallel for schedule(dynamic)
+    for (int k = 0; k < (int)tiles.size(); ++k)
+    {
+        const int t = tiles[k];
+        const int tx = t % tilesX;
+        const int ty = (t / tilesX) % tilesY;
+        TileSamplerType ts(sampler, tx * tileSize, ty * tileSize,
+                           std::min((tx + 1) * tileSize, textureWidth), std::min((ty + 1) * tileSize, textureHeight));
+        for (int fi : tileFaces[t])
+        {
+            CMeshO::FaceType &f = m.face[fi];
+            Point2x ti[3];
+            for (int i = 0; i < 3; ++i)
+                ti[i] = Point2x(f.WT(i).U() * textureWidth - 0.5, f.WT(i).V() * textureHeight - 0.5);
+            vcg::tri::SurfaceSampling<CMeshO, TileSamplerType>::SingleFaceRaster(f, ts, ti[0], ti[1], ti[2], correctSafePointsBaryCoords);
+        }
+
+        int done = ++tilesDone;
+#ifdef _OPENMP
+        if (omp_get_thread_num() == 0)
+#endif
+        if (cb)
+            cb(start + done * offset / tiles.size(), "Rasterizing faces ...");
+    }
+}
+
 #endif
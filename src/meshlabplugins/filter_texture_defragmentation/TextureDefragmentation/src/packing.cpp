@@ -25,13 +25,9 @@
 #include "logging.h"
 #include "utils.h"
 #include "mesh_attribute.h"
+#include "raster_packer.h"
 
 #include <vcg/complex/algorithms/outline_support.h>
-#include <vcg/space/rasterized_outline2_packer.h>
-#include <wrap/qt/outline2_rasterizer.h>
-//#include <wrap/qt/Outline2ToQImage.h>
-
-typedef vcg::RasterizedOutline2Packer<float, QtOutline2Rasterizer> RasterizationBasedPacker;
 
 
 int Pack(const std::vector<ChartHandle>& charts, TextureObjectHandle textureObject, std::vector<TextureSize>& texszVec)
@@ -40,13 +36,13 @@ int Pack(const std::vector<ChartHandle>& charts, TextureObjectHandle textureObje
 
     texszVec.clear();
 
-    std::vector<Outline2f> outlines;
+    std::vector<Outline2f> outlines(charts.size());
 
-    for (auto c : charts) {
-        // Save the outline of the parameterization for this portion of the mesh
-        Outline2f outline = ExtractOutline2f(*c);
-        outlines.push_back(outline);
-    }
+    // Save the outline of the parameterization for each chart (charts do not
+    // share faces, so the visited flags used by the extraction do not clash)
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < (int) charts.size(); ++i)
+        outlines[i] = ExtractOutline2f(*charts[i]);
 
     int packingSize = 4096;
     std::vector<std::pair<double,double>> trs = textureObject->ComputeRelativeSizes();
@@ -66,15 +62,14 @@ int Pack(const std::vector<ChartHandle>& charts, TextureObjectHandle textureObje
     }
     double packingScale = std::sqrt(packingArea / (double) textureArea);
 
-    RasterizationBasedPacker::Parameters packingParams;
-    packingParams.costFunction = RasterizationBasedPacker::Parameters::LowestHorizon;
-    packingParams.doubleHorizon = false;
-    packingParams.innerHorizon = true;
-    //packingParams.permutations = false;
+    RasterPacker::Parameters packingParams;
+    packingParams.leftHorizon = true;
     packingParams.permutations = (charts.size() < 50);
     packingParams.rotationNum = 4;
     packingParams.gutterWidth = 4;
-    packingParams.minmax = false; // not used
+
+    // the outlines are rasterized once and reused by every packing attempt
+    RasterPacker packer(outlines, packingScale, packingParams);
 
     int totPacked = 0;
 
@@ -88,11 +83,9 @@ int Pack(const std::vector<ChartHandle>& charts, TextureObjectHandle textureObje
             containerVec.push_back(vcg::Point2i(packingSize, packingSize));
 
         std::vector<unsigned> outlineIndex_iter;
-        std::vector<Outline2f> outlines_iter;
         for (unsigned i = 0; i < containerIndices.size(); ++i) {
             if (containerIndices[i] == -1) {
                 outlineIndex_iter.push_back(i);
-                outlines_iter.push_back(outlines[i]);
             }
         }
 
@@ -104,7 +97,7 @@ int Pack(const std::vector<ChartHandle>& charts, TextureObjectHandle textureObje
             transforms.clear();
             polyToContainer.clear();
             LOG_INFO << "Packing into grid of size " << containerVec[nc].X() << " " << containerVec[nc].Y();
-            n = RasterizationBasedPacker::PackBestEffortAtScale(outlines_iter, {containerVec[nc]}, transforms, polyToContainer, packingParams, packingScale);
+            n = packer.Pack(outlineIndex_iter, containerVec[nc], transforms, polyToContainer);
             if (n == 0) {
                 containerVec[nc].X() *= 1.1;
                 containerVec[nc].Y() *= 1.1;
@@ -118,7 +111,7 @@ int Pack(const std::vector<ChartHandle>& charts, TextureObjectHandle textureObje
         else {
             double textureScale = 1.0 / packingScale;
             texszVec.push_back({(int) (containerVec[nc].X() * textureScale), (int) (containerVec[nc].Y() * textureScale)});
-            for (unsigned i = 0; i < outlines_iter.size(); ++i) {
+            for (unsigned i = 0; i < outlineIndex_iter.size(); ++i) {
                 if (polyToContainer[i] != -1) {
                     ensure(polyToContainer[i] == 0); // We only use a single container
                     int outlineInd = outlineIndex_iter[i];
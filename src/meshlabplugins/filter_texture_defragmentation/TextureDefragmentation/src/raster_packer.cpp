@@ -0,0 +1,342 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#include "raster_packer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+#include <vcg/space/box2.h>
+
+constexpr int RasterPacker::EMPTY;
+
+namespace {
+
+struct Candidate {
+    double cost;
+    int rotation;
+    int side; // 0 bottom horizon, 1 left horizon
+    int x;
+    int y;
+};
+
+constexpr Candidate NO_CANDIDATE = { std::numeric_limits<double>::max(), -1, -1, 0, 0 };
+
+// lexicographic order, so that the chosen placement does not depend on the
+// order in which the threads evaluate the candidates
+inline bool Better(const Candidate& a, const Candidate& b)
+{
+    if (a.cost != b.cost) return a.cost < b.cost;
+    if (a.rotation != b.rotation) return a.rotation < b.rotation;
+    if (a.side != b.side) return a.side < b.side;
+    if (a.x != b.x) return a.x < b.x;
+    return a.y < b.y;
+}
+
+// Lowest offset at which a profile can be dropped onto a horizon. Plain loop
+// so that the compiler vectorizes the max reduction
+inline int Drop(const int *horizon, const int *profile, int n)
+{
+    int d = 0;
+    for (int i = 0; i < n; ++i)
+        d = std::max(d, horizon[i] - profile[i]);
+    return d;
+}
+
+// separable square dilation of a binary w*h grid by g cells
+void Dilate(std::vector<char>& grid, int w, int h, int g)
+{
+    std::vector<char> tmp(grid.size(), 0);
+    for (int j = 0; j < h; ++j)
+        for (int i = 0; i < w; ++i)
+            if (grid[j * w + i])
+                for (int k = std::max(0, i - g); k <= std::min(w - 1, i + g); ++k)
+                    tmp[j * w + k] = 1;
+    std::fill(grid.begin(), grid.end(), 0);
+    for (int j = 0; j < h; ++j)
+        for (int i = 0; i < w; ++i)
+            if (tmp[j * w + i])
+                for (int k = std::max(0, j - g); k <= std::min(h - 1, j + g); ++k)
+                    grid[k * w + i] = 1;
+}
+
+} // namespace
+
+RasterPacker::RasterPacker(const std::vector<Outline2f>& outlines, float packingScale, const Parameters& packingParams)
+    : params(packingParams),
+      scale(packingScale),
+      rasters(outlines.size())
+{
+    int nrot = std::max(1, params.rotationNum);
+    int n = (int) outlines.size();
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < n; ++i) {
+        rasters[i].reserve(nrot);
+        for (int r = 0; r < nrot; ++r)
+            rasters[i].push_back(Rasterize(outlines[i], scale, (float) (r * 2.0 * M_PI / nrot), params.gutterWidth));
+    }
+}
+
+int RasterPacker::Pack(const std::vector<unsigned>& outlineIndices,
+                       const vcg::Point2i& containerSize,
+                       std::vector<vcg::Similarity2f>& transforms,
+                       std::vector<int>& polyToContainer) const
+{
+    auto SortedBy = [&] (std::function<int(const Raster&)> key) -> std::vector<unsigned> {
+        std::vector<unsigned> order = outlineIndices;
+        std::stable_sort(order.begin(), order.end(), [&] (unsigned a, unsigned b) {
+            return key(rasters[a][0]) > key(rasters[b][0]);
+        });
+        return order;
+    };
+
+    std::vector<std::vector<unsigned>> orders;
+    orders.push_back(SortedBy([] (const Raster& r) { return r.w * r.h; }));
+    if (params.permutations) {
+        orders.push_back(SortedBy([] (const Raster& r) { return r.h; }));
+        orders.push_back(SortedBy([] (const Raster& r) { return r.w; }));
+        orders.push_back(SortedBy([] (const Raster& r) { return std::max(r.w, r.h); }));
+    }
+
+    int bestCount = -1;
+    int bestHorizon = 0;
+    unsigned bestOrder = 0;
+    std::vector<Placement> bestPlacements;
+    for (unsigned k = 0; k < orders.size(); ++k) {
+        std::vector<Placement> placements;
+        int maxHorizon = 0;
+        int count = PackInOrder(orders[k], containerSize, placements, &maxHorizon);
+        if (count > bestCount || (count == bestCount && maxHorizon < bestHorizon)) {
+            bestCount = count;
+            bestHorizon = maxHorizon;
+            bestOrder = k;
+            bestPlacements = placements;
+        }
+    }
+
+    std::vector<int> position(rasters.size(), -1);
+    for (unsigned i = 0; i < outlineIndices.size(); ++i)
+        position[outlineIndices[i]] = i;
+
+    transforms.assign(outlineIndices.size(), vcg::Similarity2f());
+    polyToContainer.assign(outlineIndices.size(), -1);
+
+    const std::vector<unsigned>& order = orders[bestOrder];
+    for (unsigned k = 0; k < order.size(); ++k) {
+        const Placement& p = bestPlacements[k];
+        if (p.rotation >= 0) {
+            const Raster& raster = rasters[order[k]][p.rotation];
+            vcg::Similarity2f& tr = transforms[position[order[k]]];
+            tr.rotRad = raster.angle;
+            tr.sca = scale;
+            tr.tra = vcg::Point2f(p.x + raster.offset.X(), p.y + raster.offset.Y());
+            polyToContainer[position[order[k]]] = 0;
+        }
+    }
+
+    return std::max(bestCount, 0);
+}
+
+int RasterPacker::PackInOrder(const std::vector<unsigned>& order,
+                              const vcg::Point2i& containerSize,
+                              std::vector<Placement>& placements,
+                              int *maxHorizon) const
+{
+    const int W = containerSize.X();
+    const int H = containerSize.Y();
+
+    // every occupied cell of column x is below bottomHorizon[x], and every
+    // occupied cell of row y is left of leftHorizon[y]
+    std::vector<int> bottomHorizon(std::max(W, 0), 0);
+    std::vector<int> leftHorizon(std::max(H, 0), 0);
+
+    placements.assign(order.size(), Placement{-1, 0, 0});
+
+    int count = 0;
+    for (unsigned k = 0; k < order.size(); ++k) {
+        const std::vector<Raster>& rv = rasters[order[k]];
+
+        Candidate best = NO_CANDIDATE;
+        for (int r = 0; r < (int) rv.size(); ++r) {
+            const Raster& raster = rv[r];
+            if (raster.w > W || raster.h > H)
+                continue;
+
+            // drop onto the bottom horizon, one candidate per column
+            int nx = W - raster.w + 1;
+            #pragma omp parallel if (nx * raster.w > 65536)
+            {
+                Candidate local = NO_CANDIDATE;
+                #pragma omp for nowait
+                for (int x = 0; x < nx; ++x) {
+                    int y = Drop(&bottomHorizon[x], raster.bottom.data(), raster.w);
+                    if (y + raster.h <= H) {
+                        Candidate c = { (y + raster.h) / (double) H, r, 0, x, y };
+                        if (Better(c, local))
+                            local = c;
+                    }
+                }
+                #pragma omp critical
+                {
+                    if (Better(local, best))
+                        best = local;
+                }
+            }
+
+            if (!params.leftHorizon)
+                continue;
+
+            // drop against the left horizon, one candidate per row
+            int ny = H - raster.h + 1;
+            #pragma omp parallel if (ny * raster.h > 65536)
+            {
+                Candidate local = NO_CANDIDATE;
+                #pragma omp for nowait
+                for (int y = 0; y < ny; ++y) {
+                    int x = Drop(&leftHorizon[y], raster.left.data(), raster.h);
+                    if (x + raster.w <= W) {
+                        Candidate c = { (x + raster.w) / (double) W, r, 1, x, y };
+                        if (Better(c, local))
+                            local = c;
+                    }
+                }
+                #pragma omp critical
+                {
+                    if (Better(local, best))
+                        best = local;
+                }
+            }
+        }
+
+        if (best.rotation < 0)
+            continue;
+
+        const Raster& raster = rv[best.rotation];
+        for (int i = 0; i < raster.w; ++i)
+            if (raster.top[i] > 0)
+                bottomHorizon[best.x + i] = std::max(bottomHorizon[best.x + i], best.y + raster.top[i]);
+        for (int j = 0; j < raster.h; ++j)
+            if (raster.right[j] > 0)
+                leftHorizon[best.y + j] = std::max(leftHorizon[best.y + j], best.x + raster.right[j]);
+
+        placements[k] = Placement{best.rotation, best.x, best.y};
+        count++;
+    }
+
+    *maxHorizon = 0;
+    for (int h : bottomHorizon)
+        *maxHorizon = std::max(*maxHorizon, h);
+
+    return count;
+}
+
+RasterPacker::Raster RasterPacker::Rasterize(const Outline2f& outline, float scale, float angle, int gutter)
+{
+    const float c = std::cos(angle);
+    const float s = std::sin(angle);
+
+    std::vector<vcg::Point2f> pts;
+    pts.reserve(outline.size());
+    vcg::Box2f box;
+    for (const vcg::Point2f& p : outline) {
+        vcg::Point2f q((c * p.X() - s * p.Y()) * scale, (s * p.X() + c * p.Y()) * scale);
+        pts.push_back(q);
+        box.Add(q);
+    }
+    if (pts.empty()) {
+        pts.push_back(vcg::Point2f(0, 0));
+        box.Add(pts.back());
+    }
+
+    Raster raster;
+    raster.angle = angle;
+    raster.offset = vcg::Point2f(gutter - box.min.X(), gutter - box.min.Y());
+    raster.w = (int) std::ceil(box.DimX()) + 1 + 2 * gutter;
+    raster.h = (int) std::ceil(box.DimY()) + 1 + 2 * gutter;
+
+    for (vcg::Point2f& p : pts)
+        p += raster.offset;
+
+    const int w = raster.w;
+    const int h = raster.h;
+    std::vector<char> grid(w * h, 0);
+
+    auto Mark = [&] (const vcg::Point2f& p) {
+        int i = std::min(std::max((int) std::floor(p.X()), 0), w - 1);
+        int j = std::min(std::max((int) std::floor(p.Y()), 0), h - 1);
+        grid[j * w + i] = 1;
+    };
+
+    // boundary, sampled densely enough to touch the cells crossed by each edge
+    for (unsigned k = 0; k < pts.size(); ++k) {
+        const vcg::Point2f& p0 = pts[k];
+        const vcg::Point2f& p1 = pts[(k + 1) % pts.size()];
+        int steps = (int) std::ceil(2 * std::max(std::abs(p1.X() - p0.X()), std::abs(p1.Y() - p0.Y()))) + 1;
+        for (int t = 0; t <= steps; ++t)
+            Mark(p0 + (p1 - p0) * (t / (float) steps));
+    }
+
+    // interior, even-odd scanline fill at the cell centers
+    std::vector<float> xs;
+    for (int j = 0; j < h; ++j) {
+        float yc = j + 0.5f;
+        xs.clear();
+        for (unsigned k = 0; k < pts.size(); ++k) {
+            const vcg::Point2f& p0 = pts[k];
+            const vcg::Point2f& p1 = pts[(k + 1) % pts.size()];
+            if ((p0.Y() <= yc) != (p1.Y() <= yc))
+                xs.push_back(p0.X() + (yc - p0.Y()) * (p1.X() - p0.X()) / (p1.Y() - p0.Y()));
+        }
+        std::sort(xs.begin(), xs.end());
+        for (unsigned k = 0; k + 1 < xs.size(); k += 2) {
+            int i0 = std::max(0, (int) std::ceil(xs[k] - 0.5f));
+            int i1 = std::min(w - 1, (int) std::floor(xs[k + 1] - 0.5f));
+            for (int i = i0; i <= i1; ++i)
+                grid[j * w + i] = 1;
+        }
+    }
+
+    if (gutter > 0)
+        Dilate(grid, w, h, gutter);
+
+    raster.bottom.assign(w, EMPTY);
+    raster.top.assign(w, 0);
+    raster.left.assign(h, EMPTY);
+    raster.right.assign(h, 0);
+    for (int j = 0; j < h; ++j) {
+        for (int i = 0; i < w; ++i) {
+            if (grid[j * w + i]) {
+                raster.bottom[i] = std::min(raster.bottom[i], j);
+                raster.top[i] = std::max(raster.top[i], j + 1);
+                raster.left[j] = std::min(raster.left[j], i);
+                raster.right[j] = std::max(raster.right[j], i + 1);
+            }
+        }
+    }
+
+    return raster;
+}
@@ -0,0 +1,100 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#ifndef RASTER_PACKER_H
+#define RASTER_PACKER_H
+
+#include "types.h"
+
+#include <vector>
+
+#include <vcg/math/similarity2.h>
+
+/* Rasterization based packer of chart outlines.
+ * It follows the strategy of vcg::RasterizedOutline2Packer with the lowest
+ * horizon cost: each outline is rasterized (with a gutter) at a few rotations
+ * and dropped either onto the bottom horizon of the container or, if
+ * leftHorizon is set, against its left horizon, at the position that keeps
+ * the horizon lowest.
+ * The outlines are rasterized once, in parallel, when the packer is built, and
+ * the rasters are reused by every call to Pack(), so repacking the same charts
+ * into a larger container or into the next container does not rasterize them
+ * again. The candidate placements of each outline are evaluated in parallel. */
+class RasterPacker {
+
+public:
+
+    struct Parameters {
+        int rotationNum = 4;
+        int gutterWidth = 4;
+        bool leftHorizon = true; // also try to drop the outlines against the left horizon
+        bool permutations = false; // also try a few outline orderings and keep the best packing
+    };
+
+    RasterPacker(const std::vector<Outline2f>& outlines, float scale, const Parameters& params);
+
+    /* Packs the outlines with the given indices into a container of the given
+     * size (in raster cells), placing as many outlines as possible.
+     * On return, transforms[i] maps the outline outlineIndices[i] to container
+     * coordinates, and polyToContainer[i] is 0 if the outline was packed or -1
+     * if it did not fit. Returns the number of packed outlines */
+    int Pack(const std::vector<unsigned>& outlineIndices,
+             const vcg::Point2i& containerSize,
+             std::vector<vcg::Similarity2f>& transforms,
+             std::vector<int>& polyToContainer) const;
+
+private:
+
+    static constexpr int EMPTY = 1 << 29;
+
+    struct Raster {
+        int w;
+        int h;
+        float angle;
+        vcg::Point2f offset; // translation from the rotated and scaled outline to the raster cells
+        std::vector<int> bottom; // per column, lowest occupied cell (EMPTY if the column is empty)
+        std::vector<int> top; // per column, one past the highest occupied cell (0 if empty)
+        std::vector<int> left; // per row, leftmost occupied cell (EMPTY if the row is empty)
+        std::vector<int> right; // per row, one past the rightmost occupied cell (0 if empty)
+    };
+
+    struct Placement {
+        int rotation;
+        int x;
+        int y;
+    };
+
+    static Raster Rasterize(const Outline2f& outline, float scale, float angle, int gutter);
+
+    int PackInOrder(const std::vector<unsigned>& order,
+                    const vcg::Point2i& containerSize,
+                    std::vector<Placement>& placements,
+                    int *maxHorizon) const;
+
+    Parameters params;
+    float scale;
+    std::vector<std::vector<Raster>> rasters; // rasters[i][r] is the outline i at rotation r
+};
+
+#endif // RASTER_PACKER_H
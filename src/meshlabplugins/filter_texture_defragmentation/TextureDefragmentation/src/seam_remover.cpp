@@ -37,6 +37,10 @@
 
 #include <vcg/complex/algorithms/clean.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 
 constexpr double PENALTY_MULTIPLIER = 2.0;
 
@@ -53,6 +57,7 @@ struct Perf {
     double t_check_after;
     double t_accept;
     double t_reject;
+    double t_batch;
     Timer timer;
 };
 
@@ -75,14 +80,25 @@ static void EraseSeam(ClusteredSeamHandle csh, AlgoStateHandle state, GraphHandl
 static void InvalidateCluster(ClusteredSeamHandle csh, AlgoStateHandle state, GraphHandle graph, CheckStatus status, double penaltyMultiplier);
 static void RestoreChartAttributes(ChartHandle c, Mesh& m, std::vector<int>::const_iterator itvi,  std::vector<vcg::Point2d>::const_iterator ittc);
 static CostInfo ReduceSeam(ClusteredSeamHandle csh, AlgoStateHandle state, GraphHandle graph, const AlgoParameters& params);
+static CheckStatus EvaluateMove(SeamData& sd, const MatchingTransform& mi, AlgoStateHandle state, GraphHandle graph, const AlgoParameters& params);
+static void CommitMove(const SeamData& sd, CheckStatus status, AlgoStateHandle state, GraphHandle graph, const AlgoParameters& params);
+static std::vector<ClusteredSeamHandle> ExtractBatch(AlgoStateHandle state, GraphHandle graph, int maxSize);
+static void ProcessBatch(const std::vector<ClusteredSeamHandle>& batch, AlgoStateHandle state, GraphHandle graph, const AlgoParameters& params);
 
 
 Perf perf = {};
 
+// the timer is not thread safe, moves evaluated in parallel are only timed as a whole (t_batch)
+#ifdef _OPENMP
+#define PERF_TIMER_ENABLED (!omp_in_parallel())
+#else
+#define PERF_TIMER_ENABLED true
+#endif
+
 #define PERF_TIMER_RESET (perf = {}, perf.timer.Reset())
-#define PERF_TIMER_START double perf_timer_t0 = perf.timer.TimeElapsed()
-#define PERF_TIMER_ACCUMULATE(field) perf.field += perf.timer.TimeElapsed() - perf_timer_t0
-#define PERF_TIMER_ACCUMULATE_FROM_PREVIOUS(field) perf.field += perf.timer.TimeSinceLastCheck()
+#define PERF_TIMER_START double perf_timer_t0 = PERF_TIMER_ENABLED ? perf.timer.TimeElapsed() : 0
+#define PERF_TIMER_ACCUMULATE(field) (PERF_TIMER_ENABLED ? (void) (perf.field += perf.timer.TimeElapsed() - perf_timer_t0) : (void) 0)
+#define PERF_TIMER_ACCUMULATE_FROM_PREVIOUS(field) (PERF_TIMER_ENABLED ? (void) (perf.field += perf.timer.TimeSinceLastCheck()) : (void) 0)
 
 //static int statsCheck[10] = {};
 //static int feasibility[6] = {};
@@ -149,6 +165,7 @@ void LogExecutionStats()
     LOG_INFO    << "CHECK      " << std::fixed << std::setprecision(3) << (perf.t_check_before + perf.t_check_after) / perf.timer.TimeElapsed() << " , " << std::defaultfloat << std::setprecision(6)<< (perf.t_check_before + perf.t_check_after) << " secs";
     LOG_VERBOSE << "  BEFORE   " << std::fixed << std::setprecision(3) << perf.t_check_before / perf.timer.TimeElapsed()                        << " , " << std::defaultfloat << std::setprecision(6)<< perf.t_check_before << " secs";
     LOG_VERBOSE << "  AFTER    " << std::fixed << std::setprecision(3) << perf.t_check_after / perf.timer.TimeElapsed()                         << " , " << std::defaultfloat << std::setprecision(6)<< perf.t_check_after << " secs";
+    LOG_VERBOSE << "  BATCH    " << std::fixed << std::setprecision(3) << perf.t_batch / perf.timer.TimeElapsed()                               << " , " << std::defaultfloat << std::setprecision(6)<< perf.t_batch << " secs";
     LOG_INFO    << "ACCEPT     " << std::fixed << std::setprecision(3) << perf.t_accept / perf.timer.TimeElapsed()                              << " , " << std::defaultfloat << std::setprecision(6)<< perf.t_accept << " secs";
     LOG_INFO    << "  count:                    " << accept;
     LOG_INFO    << "  with retry:               " << retry_success;
@@ -314,6 +331,12 @@ void GreedyOptimization(GraphHandle graph, AlgoStateHandle state, const AlgoPara
 
     LOG_INFO << "Atlas energy before optimization is " << ARAP::ComputeEnergyFromStoredWedgeTC(graph->mesh, nullptr, nullptr);
 
+#ifdef _OPENMP
+    int maxThreads = omp_get_max_threads();
+#else
+    int maxThreads = 1;
+#endif
+
     int k = 0;
     while (state->queue.size() > 0) {
 
@@ -335,6 +358,24 @@ void GreedyOptimization(GraphHandle graph, AlgoStateHandle state, const AlgoPara
             break;
         }
 
+        if (params.parallel) {
+            std::vector<ClusteredSeamHandle> batch = ExtractBatch(state, graph, 2 * maxThreads);
+            if (batch.size() > 0) {
+                int kprev = k;
+                k += (int) batch.size();
+                if ((k / 200) > (kprev / 200)) {
+                    LOG_INFO << "Logging execution stats after " << k << " iterations";
+                    LogExecutionStats();
+                }
+                ProcessBatch(batch, state, graph, params);
+                continue;
+            } else if (state->queue.size() == 0) {
+                LOG_INFO << "Queue is empty, interrupting.";
+                break;
+            }
+            // no feasible seam left, the sequential step below handles the termination
+        }
+
         WeightedSeam ws = state->queue.top();
         state->queue.pop();
         if (Valid(ws, state)) {
@@ -354,41 +395,8 @@ void GreedyOptimization(GraphHandle graph, AlgoStateHandle state, const AlgoPara
                 ComputeSeamData(sd, ws.first, graph, state);
                 LOG_DEBUG << "  Chart ids are " << sd.a->id << " " << sd.b->id << " (areas = " << sd.a->AreaUV() << ", " << sd.b->AreaUV() << ")";
 
-                OffsetMap om = AlignAndMerge(ws.first, sd, state->transform[ws.first], params);
-
-                ComputeOptimizationArea(sd, graph->mesh, om);
-
-                // when merging two charts, check if they collide outside the optimization area
-
-                CheckStatus status = (sd.a != sd.b) ? CheckBoundaryAfterAlignment(sd) : PASS;
-
-                if (status == PASS)
-                    status = OptimizeChart(sd, graph, false);
-
-                if (status == PASS)
-                    status = CheckAfterLocalOptimization(sd, state, params);
-
-                while (status == FAIL_GLOBAL_OVERLAP_AFTER_OPT || status == FAIL_GLOBAL_OVERLAP_AFTER_BND) {
-                    LOG_DEBUG << "Global overlaps detected after ARAP optimization, fixing edges";
-                    CheckStatus iterStatus = OptimizeChart(sd, graph, true);
-                    if (iterStatus == _END)
-                        break;
-                    else
-                        status = CheckAfterLocalOptimization(sd, state, params);
-                }
-
-                statsCheck[status]++;
-
-                if (status == PASS) {
-                    AcceptMove(sd, state, graph, params);
-                    ColorizeSeam(sd.csh, vcg::Color4b(255, 69, 0, 255));
-                    accept++;
-                    LOG_DEBUG << "Accepted operation";
-                } else {
-                    RejectMove(sd, state, graph, status);
-                    reject++;
-                    LOG_DEBUG << "Rejected operation";
-                }
+                CheckStatus status = EvaluateMove(sd, state->transform[ws.first], state, graph, params);
+                CommitMove(sd, status, state, graph, params);
             }
         }
     }
@@ -413,6 +421,149 @@ void Finalize(GraphHandle graph, int *vndup)
 
 // -- static functions ---------------------------------------------------------
 
+/* Applies the merge of the seam to the mesh and optimizes the merged area,
+ * returning the outcome of the safety checks. The move only modifies the
+ * faces and vertices of the charts sd.a and sd.b, and reads the state without
+ * modifying it, so moves on disjoint charts can be evaluated concurrently. */
+static CheckStatus EvaluateMove(SeamData& sd, const MatchingTransform& mi, AlgoStateHandle state, GraphHandle graph, const AlgoParameters& params)
+{
+    OffsetMap om = AlignAndMerge(sd.csh, sd, mi, params);
+
+    ComputeOptimizationArea(sd, graph->mesh, om);
+
+    // when merging two charts, check if they collide outside the optimization area
+
+    CheckStatus status = (sd.a != sd.b) ? CheckBoundaryAfterAlignment(sd) : PASS;
+
+    if (status == PASS)
+        status = OptimizeChart(sd, graph, false);
+
+    if (status == PASS)
+        status = CheckAfterLocalOptimization(sd, state, params);
+
+    while (status == FAIL_GLOBAL_OVERLAP_AFTER_OPT || status == FAIL_GLOBAL_OVERLAP_AFTER_BND) {
+        LOG_DEBUG << "Global overlaps detected after ARAP optimization, fixing edges";
+        CheckStatus iterStatus = OptimizeChart(sd, graph, true);
+        if (iterStatus == _END)
+            break;
+        else
+            status = CheckAfterLocalOptimization(sd, state, params);
+    }
+
+    return status;
+}
+
+static void CommitMove(const SeamData& sd, CheckStatus status, AlgoStateHandle state, GraphHandle graph, const AlgoParameters& params)
+{
+    statsCheck[status]++;
+
+    if (status == PASS) {
+        AcceptMove(sd, state, graph, params);
+        ColorizeSeam(sd.csh, vcg::Color4b(255, 69, 0, 255));
+        accept++;
+        LOG_DEBUG << "Accepted operation";
+    } else {
+        RejectMove(sd, state, graph, status);
+        reject++;
+        LOG_DEBUG << "Rejected operation";
+    }
+}
+
+/* Pops from the queue up to maxSize valid seams with finite cost such that no
+ * two seams of the batch share or touch a chart. Accepting a move recomputes
+ * the costs of the seams between the merged chart and its neighbors, so the
+ * charts of a move must not be adjacent to the charts of another move of the
+ * same batch, otherwise the costs would be computed on a chart that was merged
+ * speculatively but not committed yet. Valid seams that conflict with the
+ * batch are pushed back in the queue, and at most 4*maxSize of them are
+ * skipped to keep the batch close to the greedy order. The returned batch is
+ * empty if the queue is empty or if the best valid seam has infinite cost. */
+static std::vector<ClusteredSeamHandle> ExtractBatch(AlgoStateHandle state, GraphHandle graph, int maxSize)
+{
+    std::vector<ClusteredSeamHandle> batch;
+    std::vector<WeightedSeam> deferred;
+    std::unordered_set<ChartHandle> busy;
+
+    while (state->queue.size() > 0 && (int) batch.size() < maxSize && (int) deferred.size() < 4 * maxSize) {
+        WeightedSeam ws = state->queue.top();
+        if (!Valid(ws, state)) {
+            state->queue.pop();
+            continue;
+        }
+        if (ws.second == Infinity())
+            break;
+
+        state->queue.pop();
+        ChartPair charts = GetCharts(ws.first, graph);
+        if (busy.count(charts.first) > 0 || busy.count(charts.second) > 0) {
+            deferred.push_back(ws);
+        } else {
+            // the charts of the seam and their neighbors
+            for (ChartHandle c : {charts.first, charts.second}) {
+                busy.insert(c);
+                busy.insert(c->adj.begin(), c->adj.end());
+            }
+            batch.push_back(ws.first);
+        }
+    }
+
+    for (const WeightedSeam& ws : deferred)
+        state->queue.push(ws);
+
+    return batch;
+}
+
+/* Evaluates a batch of seams on disjoint and non adjacent charts speculatively
+ * and in parallel, then commits the outcomes in queue order. */
+static void ProcessBatch(const std::vector<ClusteredSeamHandle>& batch, AlgoStateHandle state, GraphHandle graph, const AlgoParameters& params)
+{
+    int n = (int) batch.size();
+    std::vector<SeamData> sdvec(n);
+    std::vector<MatchingTransform> mivec(n);
+    std::vector<CheckStatus> statusvec(n, UNKNOWN);
+
+    for (int i = 0; i < n; ++i) {
+        ComputeSeamData(sdvec[i], batch[i], graph, state);
+        mivec[i] = state->transform.at(batch[i]);
+        LOG_DEBUG << "  Chart ids are " << sdvec[i].a->id << " " << sdvec[i].b->id << " (areas = " << sdvec[i].a->AreaUV() << ", " << sdvec[i].b->AreaUV() << ")";
+    }
+
+    PERF_TIMER_START;
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < n; ++i)
+        statusvec[i] = EvaluateMove(sdvec[i], mivec[i], state, graph, params);
+
+    PERF_TIMER_ACCUMULATE(t_batch);
+
+    // the moves were checked against the atlas energy before the batch, repeat
+    // the global distortion check as if the moves were committed one at a time
+    double arapNum = state->arapNum;
+    double arapDenom = state->arapDenom;
+    for (int i = 0; i < n; ++i) {
+        if (statusvec[i] == PASS) {
+            const SeamData& sd = sdvec[i];
+            if ((arapNum + (sd.outputArapNum - sd.inputArapNum)) / arapDenom > params.globalDistortionThreshold) {
+                statusvec[i] = FAIL_DISTORTION_GLOBAL;
+            } else {
+                arapNum += (sd.outputArapNum - sd.inputArapNum);
+                arapDenom += (sd.outputArapDenom - sd.inputArapDenom);
+            }
+        }
+    }
+
+    // rejected moves restore their charts before any accepted move updates the
+    // costs of the neighboring seams; since the charts of the batch are not
+    // adjacent, those costs never read the charts of another move of the batch
+    for (int i = 0; i < n; ++i)
+        if (statusvec[i] != PASS)
+            CommitMove(sdvec[i], statusvec[i], state, graph, params);
+
+    for (int i = 0; i < n; ++i)
+        if (statusvec[i] == PASS)
+            CommitMove(sdvec[i], statusvec[i], state, graph, params);
+}
+
 static void InsertNewClusterInQueue(ClusteredSeamHandle csh, AlgoStateHandle state, GraphHandle graph, const AlgoParameters& params)
 {
     ColorizeSeam(csh, vcg::Color4b::White);
@@ -52,6 +52,7 @@ struct AlgoParameters {
     double expb                      = 1.0;
     double UVBorderLengthReduction   = 0.0;
     bool   ignoreOnReject            = false;
+    bool   parallel                  = false; // evaluate batches of seams on disjoint charts concurrently
 };
 
 struct SeamData {
@@ -28,7 +28,6 @@
 #include "mesh.h"
 #include "texture_rendering.h"
 #include "gl_utils.h"
-#include "pushpull.h"
 #include "mesh_attribute.h"
 #include "logging.h"
 
@@ -37,6 +36,8 @@
 
 #include <QImage>
 
+#include <common/utilities/pull_push.h>
+
 
 
 static const char *vs_text[] = {
@@ -331,7 +332,7 @@ static std::shared_ptr<QImage> RenderTexture(std::vector<Mesh::FacePointer>& fve
     glDrawBuffer(drawBuffer);
 
     if (filter)
-        vcg::PullPush(*textureImage, qRgba(0, 255, 0, 128));
+        meshlab::pullPush(*textureImage, qRgba(0, 255, 0, 128));
 
     Mirror(*textureImage);
 
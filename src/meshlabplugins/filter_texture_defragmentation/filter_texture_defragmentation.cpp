@@ -201,6 +201,12 @@ RichParameterList FilterTextureDefragPlugin::initParameterList(const QAction *ac
 		                    0.0,
 		                    "Time limit (seconds)",
 		                    "Time limit for the defragmentation process (zero means unlimited)."));
+		parlst.addParam(RichBool(
+		                    "parallel",
+		                    false,
+		                    "Parallel seam merging",
+		                    "Evaluate batches of seams that involve disjoint charts concurrently. Much faster on atlases with many charts, "
+		                    "but the order of the merge operations differs from the sequential greedy order, so the result may differ slightly."));
 		break;
 	default:
 		break;
@@ -280,6 +286,7 @@ std::map<std::string, QVariant> FilterTextureDefragPlugin::applyFilter(
 		ap.UVBorderLengthReduction = par.getFloat("uvReductionLimit") / 100.0f;
 		ap.offsetFactor = par.getFloat("offsetFactor");
 		ap.timelimit = par.getFloat("timelimit");
+		ap.parallel = par.getBool("parallel");
 
 		tri::UpdateTopology<Mesh>::FaceFace(defragMesh);
 		tri::UpdateNormal<Mesh>::PerFaceNormalized(defragMesh);
@@ -22,8 +22,16 @@
 ****************************************************************************/
 #include <QUuid>
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <limits>
 #include <memory>
+#include <mutex>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "io_e57.h"
 
@@ -37,6 +45,11 @@
 #define LOADING_MESH        "Loading mesh..."
 #define DONE_LOADING        "Done!"
 
+/**
+ * Number of points read from the compressed vectors at each read call
+ */
+#define E57_READ_BLOCK_SIZE (1 << 20)
+
 /**
  * [Macro] Throw MLException in case of failure using E57 functions.
  */
@@ -65,7 +78,21 @@ static inline std::string filenameToString(const QString& fileName) noexcept;
  */
 static inline QString formatImageFilename(const std::string& fileName, const char* format) noexcept;
 
-unsigned int E57IOPlugin::numberMeshesContainedInFile(const QString& format, const QString& fileName, const RichParameterList&) const {
+RichParameterList E57IOPlugin::initPreOpenParameter(const QString& format) const {
+
+    RichParameterList parameters;
+
+    if (format.toUpper() == tr(E57_FILE_EXTENSION)) {
+        parameters.addParam(RichBool(
+                "load_in_a_single_layer", false, "Load in a single layer",
+                "E57 files may contain more than one scan. If this parameter is set to true, all the scans "
+                "contained in the file will be merged in a single layer, applying the pose of each scan to its points."));
+    }
+
+    return parameters;
+}
+
+unsigned int E57IOPlugin::numberMeshesContainedInFile(const QString& format, const QString& fileName, const RichParameterList& preParams) const {
 
     unsigned int count;
 
@@ -82,6 +109,11 @@ unsigned int E57IOPlugin::numberMeshesContainedInFile(const QString& format, con
     // close the file to free the resources
     E57_WRAPPER(fileReader.Close(), "Error while closing the E57 file!");
 
+    // all the scans will be merged in a single layer
+    if (count > 1 && preParams.hasParameter("load_in_a_single_layer") && preParams.getBool("load_in_a_single_layer")) {
+        count = 1;
+    }
+
     return count;
 }
 
@@ -97,82 +129,170 @@ void E57IOPlugin::open(const QString &formatName, const QString &fileName, const
         wrongOpenFormat(formatName);
     }
 
-    e57::E57Root e57FileInfo{ };
-    e57::Reader  e57FileReader{filenameToString(fileName) };
+    const std::string filePath = filenameToString(fileName);
+    std::vector<ScanInfo> scans;
 
-    // check if the file is opened
-    E57_WRAPPER(e57FileReader.IsOpen(), "Error while opening E57 file!");
-    // read E57 root to explore the tree
-    E57_WRAPPER(e57FileReader.GetE57Root(e57FileInfo), "Error while reading E57 root info!");
+    {
+        e57::E57Root e57FileInfo{ };
+        e57::Reader  e57FileReader{filePath};
 
-    int64_t data3DCount = e57FileReader.GetData3DCount();
+        // check if the file is opened
+        E57_WRAPPER(e57FileReader.IsOpen(), "Error while opening E57 file!");
+        // read E57 root to explore the tree
+        E57_WRAPPER(e57FileReader.GetE57Root(e57FileInfo), "Error while reading E57 root info!");
 
-    // If there are no meshes inside the file warn the user!
-    if (data3DCount == 0) {
-        E57_WRAPPER(e57FileReader.Close(), "Error while closing the E57 file!");
-        throw MLException{"No points cloud were found inside the E57 file!"};
-    }
+        int64_t data3DCount = e57FileReader.GetData3DCount();
 
-    UPDATE_PROGRESS(cb, 1, START_LOADING);
+        // If there are no meshes inside the file warn the user!
+        if (data3DCount == 0) {
+            E57_WRAPPER(e57FileReader.Close(), "Error while closing the E57 file!");
+            throw MLException{"No points cloud were found inside the E57 file!"};
+        }
 
-    // Read clouds...
-    int scanIndex = 0;
-    bool columnIndex = false;
+        UPDATE_PROGRESS(cb, 1, START_LOADING);
 
-    for (auto meshModel: meshModelList) {
+        // Read the header and the number of points of every scan: they are used to pre-size the vertex containers.
+        scans.resize(data3DCount);
+        for (int64_t scanIndex = 0; scanIndex < data3DCount; scanIndex++) {
 
-        int mask = 0;
-        e57::Data3D scanHeader{};
+            int64_t rows = 0, cols = 0, numberGroupSize = 0, numberCountSize = 0;
+            bool columnIndex = false;
 
-        int64_t rows = 0, cols = 0;
-        int64_t numberPointSize = 0, numberGroupSize = 0, numberCountSize = 0;
+            E57_WRAPPER(e57FileReader.ReadData3D(scanIndex, scans[scanIndex].header), "Error while reading 3D from file!");
+            E57_WRAPPER(e57FileReader.GetData3DSizes(
+                    scanIndex, rows, cols, scans[scanIndex].pointCount, numberGroupSize, numberCountSize, columnIndex
+            ), "Error while reading scan information!");
+        }
 
-        UPDATE_PROGRESS(cb, (scanIndex * data3DCount) / 100, LOADING_MESH);
+        E57_WRAPPER(e57FileReader.Close(), "Error while closing the E57 file!");
+    }
 
-        // read 3D data
-        E57_WRAPPER(e57FileReader.ReadData3D(scanIndex, scanHeader), "Error while reading 3D from file!");
+    const bool mergeScans = meshModelList.size() == 1 && scans.size() > 1;
+    std::vector<MeshModel*> meshes(meshModelList.begin(), meshModelList.end());
 
-        // read scan's size information
-        E57_WRAPPER(e57FileReader.GetData3DSizes(
-                scanIndex, rows, cols, numberPointSize, numberGroupSize, numberCountSize, columnIndex
-        ), "Error while reading scan information!");
+    if (!mergeScans && meshes.size() != scans.size()) {
+        throw MLException{"Unexpected number of layers for the scans of the E57 file!"};
+    }
 
-        // If the name is not empty then set a name for the mesh.
-        if (!scanHeader.name.empty()) {
-            meshModel->setLabel(QString::fromStdString(scanHeader.name));
+    // Every scan is written in its own range of vertices: a whole mesh when each scan has its own layer,
+    // or a contiguous sub-range of the single layer when the scans are merged.
+    std::vector<size_t> offsets(scans.size(), 0);
+    if (mergeScans) {
+        size_t total = 0;
+        for (size_t i = 0; i < scans.size(); i++) {
+            offsets[i] = total;
+            total += static_cast<size_t>(scans[i].pointCount);
         }
+        vcg::tri::Allocator<CMeshO>::AddVertices(meshes[0]->cm, total);
+    }
+    else {
+        for (size_t i = 0; i < scans.size(); i++) {
+            // If the name is not empty then set a name for the mesh.
+            if (!scans[i].header.name.empty()) {
+                meshes[i]->setLabel(QString::fromStdString(scans[i].header.name));
+            }
+            vcg::tri::Allocator<CMeshO>::AddVertices(meshes[i]->cm, static_cast<size_t>(scans[i].pointCount));
+        }
+    }
+
+    std::vector<int> masks(scans.size(), 0);
+    std::vector<size_t> loaded(scans.size(), 0);
+    std::vector<std::string> errors(scans.size());
+    std::mutex readerMutex;
+    std::atomic<int> scansDone{0};
+    const int scanCount = static_cast<int>(scans.size());
+
+    // Decode the scans concurrently; each thread uses its own reader on the file.
+    #pragma omp parallel for schedule(dynamic, 1) if (scanCount > 1)
+    for (int scanIndex = 0; scanIndex < scanCount; scanIndex++) {
+
+        // declared outside the try block, so that on errors it is destroyed under the lock
+        std::unique_ptr<e57::Reader> e57FileReader;
 
         try {
 
-            if (numberPointSize != 0) {
+            if (scans[scanIndex].pointCount != 0) {
 
-                // Does the mesh have an imageMetaAndImage from which to extract colors?
-                std::pair<e57::Image2D, QImage> imageMetaAndImage = extractMeshImage(e57FileReader, scanIndex, false);
+                MeshModel* meshModel = mergeScans ? meshes[0] : meshes[scanIndex];
+                Matrix44m pose = poseMatrix(scans[scanIndex].header);
+
+                {
+                    // the opening and closing of the file (xml parsing) is not thread safe
+                    std::lock_guard<std::mutex> lock(readerMutex);
+                    e57FileReader.reset(new e57::Reader{filePath});
+                }
+                E57_WRAPPER(e57FileReader->IsOpen(), "Error while opening E57 file!");
 
                 // Read points from file and load them inside the MeshLab's mesh.
-                loadMesh(*meshModel, mask, scanIndex, numberPointSize, e57FileReader, scanHeader, imageMetaAndImage, par);
+                loaded[scanIndex] = loadMesh(
+                        meshModel->cm, offsets[scanIndex], masks[scanIndex], scanIndex, scans[scanIndex].pointCount,
+                        *e57FileReader, scans[scanIndex].header, mergeScans ? &pose : nullptr);
+
+                {
+                    std::lock_guard<std::mutex> lock(readerMutex);
+                    E57_WRAPPER(e57FileReader->Close(), "Error while closing the E57 file!");
+                    e57FileReader.reset();
+                }
 
-                // Once the mesh is loaded apply a transformation matrix to translate and rotate the points.
-                translatedAndRotateMesh(meshModel, scanHeader);
+                // When each scan has its own layer the pose becomes the transformation matrix of the layer.
+                if (!mergeScans) {
+                    meshModel->cm.Tr = pose;
+                }
             }
+        }
+        catch (const std::exception& e) {
+            errors[scanIndex] = e.what();
+            std::lock_guard<std::mutex> lock(readerMutex);
+            e57FileReader.reset();
+        }
 
-            // Put the modified mask into the mask list.
-            maskList.push_back(mask);
+        int done = ++scansDone;
+#ifdef _OPENMP
+        if (omp_get_thread_num() == 0)
+#endif
+        UPDATE_PROGRESS(cb, 1 + (98 * done) / scanCount, LOADING_MESH);
+    }
 
-            // Increase the scanIndex to get info about the next mesh to parse from the file.
-            scanIndex++;
+    for (const std::string& error : errors) {
+        if (!error.empty()) {
+            throw MLException{QString::fromStdString(error)};
         }
-        catch (const std::exception& e) {
-            E57_WRAPPER(e57FileReader.Close(), "Error while closing the E57 file!");
-            throw MLException{e.what()};
+    }
+
+    // Remove the pre-allocated vertices that were not filled because of invalid points.
+    for (size_t i = 0; i < scans.size(); i++) {
+        CMeshO& cm = mergeScans ? meshes[0]->cm : meshes[i]->cm;
+        size_t end = mergeScans ? offsets[i] + static_cast<size_t>(scans[i].pointCount) : cm.vert.size();
+        for (size_t v = offsets[i] + loaded[i]; v < end; v++) {
+            vcg::tri::Allocator<CMeshO>::DeleteVertex(cm, cm.vert[v]);
+        }
+    }
+
+    if (mergeScans) {
+        int mask = 0;
+        for (int m : masks) {
+            mask |= m;
+        }
+        // normals and quality are kept only if all the scans provide them
+        for (int m : masks) {
+            mask &= (m | ~(vcg::tri::io::Mask::IOM_VERTNORMAL | vcg::tri::io::Mask::IOM_VERTQUALITY));
+        }
+        meshes[0]->enable(mask);
+        vcg::tri::Allocator<CMeshO>::CompactVertexVector(meshes[0]->cm);
+        maskList.push_back(mask);
+    }
+    else {
+        for (size_t i = 0; i < scans.size(); i++) {
+            meshes[i]->enable(masks[i]);
+            vcg::tri::Allocator<CMeshO>::CompactVertexVector(meshes[i]->cm);
+            maskList.push_back(masks[i]);
         }
     }
 
     UPDATE_PROGRESS(cb, 100, DONE_LOADING);
-    E57_WRAPPER(e57FileReader.Close(), "Error while closing the E57 file!");
 }
 
-void E57IOPlugin::translatedAndRotateMesh(MeshModel *meshModel, const e57::Data3D &scanHeader) const {
+Matrix44m E57IOPlugin::poseMatrix(const e57::Data3D &scanHeader) const {
 
     auto rotationMatrix = Matrix44m::Identity();
     auto translateMatrix = Matrix44m::Identity();
@@ -190,7 +310,7 @@ void E57IOPlugin::translatedAndRotateMesh(MeshModel *meshModel, const e57::Data3
     translateMatrix.ElementAt(1, 3) = static_cast<Scalarm>(scanHeader.pose.translation.y);
     translateMatrix.ElementAt(2, 3) = static_cast<Scalarm>(scanHeader.pose.translation.z);
 
-    meshModel->cm.Tr = translateMatrix * rotationMatrix;
+    return translateMatrix * rotationMatrix;
 }
 
 std::pair<e57::Image2D, QImage> E57IOPlugin::extractMeshImage(const e57::Reader &fileReader, int scanIndex, bool saveToDisk) {
@@ -328,27 +448,32 @@ void E57IOPlugin::save(const QString& formatName, const QString& fileName, MeshM
 
     try {
 
-        CMeshO::VertContainer& vertices = m.cm.vert;
+        const CMeshO::VertContainer& vertices = m.cm.vert;
+        const bool colors = data3DPoints.areColorsAvailable();
+        const bool normals = data3DPoints.areNormalsAvailable();
+        const bool quality = data3DPoints.isQualityAvailable();
+        const int pointCount = static_cast<int>(totalPoints);
 
-        for (std::size_t i = 0; i < totalPoints; i++) {
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < pointCount; i++) {
 
             pointsData.cartesianX[i] = vertices[i].P().X();
             pointsData.cartesianY[i] = vertices[i].P().Y();
             pointsData.cartesianZ[i] = vertices[i].P().Z();
 
-            if (data3DPoints.areColorsAvailable()) {
+            if (colors) {
                 pointsData.colorRed[i] = static_cast<uint8_t>(vertices[i].C().X());
                 pointsData.colorGreen[i] = static_cast<uint8_t>(vertices[i].C().Y());
                 pointsData.colorBlue[i] = static_cast<uint8_t>(vertices[i].C().Z());
             }
 
-            if (data3DPoints.areNormalsAvailable()) {
+            if (normals) {
                 pointsData.normalX[i] = vertices[i].N().X();
                 pointsData.normalY[i] = vertices[i].N().Y();
                 pointsData.normalZ[i] = vertices[i].N().Z();
             }
 
-            if (data3DPoints.isQualityAvailable()) {
+            if (quality) {
                 pointsData.intensity[i] = vertices[i].Q();
             }
         }
@@ -407,19 +532,17 @@ void E57IOPlugin::exportMaskCapability(const QString& format, int &capability, i
     capability = defaultBits = mask;
 }
 
-void E57IOPlugin::loadMesh(MeshModel &m, int &mask, int scanIndex, size_t buffSize,
-                           const e57::Reader &fileReader, e57::Data3D &scanHeader,
-                           std::pair<e57::Image2D, QImage> image, const RichParameterList &par) {
+size_t E57IOPlugin::loadMesh(CMeshO &cm, size_t offset, int &mask, int scanIndex, int64_t pointCount,
+                             const e57::Reader &fileReader, e57::Data3D &scanHeader, const Matrix44m* pose) {
 
     using Mask = vcg::tri::io::Mask;
 
-    e57::Image2D meshImageHeader = image.first;
-    QImage meshImage = image.second;
+    // points are read in blocks, to bound the memory used by the reading buffers
+    const size_t buffSize = static_cast<size_t>(std::min<int64_t>(pointCount, E57_READ_BLOCK_SIZE));
 
     // object holding data read from E57 file
     vcg::tri::io::E57Data3DPoints data3DPoints{buffSize, scanHeader};
 
-    size_t size = 0;
     auto dataReader = fileReader.SetUpData3DPointsData(scanIndex, buffSize, data3DPoints.points());
 
     // to enable colors, quality and normals inside the mesh
@@ -432,91 +555,120 @@ void E57IOPlugin::loadMesh(MeshModel &m, int &mask, int scanIndex, size_t buffSi
         mask |= Mask::IOM_VERTQUALITY;
     }
 
-    // set the mask
-    m.enable(mask);
+    const bool cartesian = data3DPoints.areCoordinatesAvailable();
+    const bool spherical = !cartesian && data3DPoints.areSphericalCoordinatesAvailable();
+    const bool normals = data3DPoints.areNormalsAvailable();
+    const bool quality = data3DPoints.isQualityAvailable();
+    const bool colors = data3DPoints.areColorsAvailable();
+
+    // normals are only rotated
+    Matrix44m normalMatrix = Matrix44m::Identity();
+    if (pose != nullptr) {
+        normalMatrix = *pose;
+        normalMatrix.ElementAt(0, 3) = normalMatrix.ElementAt(1, 3) = normalMatrix.ElementAt(2, 3) = 0;
+    }
+
+    size_t written = 0;
+    std::vector<int> validIndices;
+    validIndices.reserve(buffSize);
 
     // read the data from the E57 file
     try {
 
-        e57::Data3DPointsData_t<Scalarm>& pointsData = data3DPoints.points();
+        const e57::Data3DPointsData_t<Scalarm>& pointsData = data3DPoints.points();
+        size_t size = 0;
 
         while ((size = dataReader.read()) > 0) {
 
-            for (std::size_t i = 0; i < size; i++) {
-
-                Point3m coordinates;
-
-                if (data3DPoints.areCoordinatesAvailable()) {
+            if (!cartesian && !spherical) {
+                continue;
+            }
 
-                    if (pointsData.cartesianInvalidState == nullptr || pointsData.cartesianInvalidState[i] == 0) {
-                        coordinates[0] = pointsData.cartesianX[i];
-                        coordinates[1] = pointsData.cartesianY[i];
-                        coordinates[2] = pointsData.cartesianZ[i];
-                    }
-                    else {
-                        continue;
-                    }
+            // compact the indices of the valid points of the block; the block is then converted in parallel
+            const int8_t* invalidState = cartesian ? pointsData.cartesianInvalidState : pointsData.sphericalInvalidState;
+            validIndices.clear();
+            for (size_t i = 0; i < size; i++) {
+                if (invalidState == nullptr || invalidState[i] == 0) {
+                    validIndices.push_back(static_cast<int>(i));
                 }
-                else if (data3DPoints.areSphericalCoordinatesAvailable()) {
-                    if (pointsData.sphericalInvalidState == nullptr || pointsData.sphericalInvalidState[i] == 0) {
+            }
 
-                        auto range = pointsData.sphericalRange[i];
-                        auto phi = pointsData.sphericalElevation[i];
-                        auto theta = pointsData.sphericalAzimuth[i];
+            const int validCount = static_cast<int>(validIndices.size());
+            CMeshO::VertexIterator base = cm.vert.begin() + offset + written;
 
-                        coordinates[0] = range * std::cos(phi) * std::cos(theta);
-                        coordinates[1] = range * std::cos(phi) * std::sin(theta);
-                        coordinates[2] = range * std::sin(phi);
+            #pragma omp parallel for schedule(static)
+            for (int k = 0; k < validCount; k++) {
 
-                    }
-                    else {
-                        continue;
-                    }
+                const int i = validIndices[k];
+                CVertexO& vertex = *(base + k);
+
+                if (cartesian) {
+                    vertex.P() = Point3m(pointsData.cartesianX[i], pointsData.cartesianY[i], pointsData.cartesianZ[i]);
                 }
                 else {
-                    continue;
+                    const Scalarm range = pointsData.sphericalRange[i];
+                    const Scalarm phi = pointsData.sphericalElevation[i];
+                    const Scalarm theta = pointsData.sphericalAzimuth[i];
+                    const Scalarm cosPhi = std::cos(phi);
+                    vertex.P() = Point3m(range * cosPhi * std::cos(theta), range * cosPhi * std::sin(theta), range * std::sin(phi));
                 }
 
-                auto vertex = vcg::tri::Allocator<CMeshO>::AddVertex(m.cm, coordinates);
-
                 // Set the normals.
-                if (data3DPoints.areNormalsAvailable()) {
-                    vertex->N()[0] = pointsData.normalX[i];
-                    vertex->N()[1] = pointsData.normalY[i];
-                    vertex->N()[2] = pointsData.normalZ[i];
+                if (normals) {
+                    vertex.N() = Point3m(pointsData.normalX[i], pointsData.normalY[i], pointsData.normalZ[i]);
+                }
+
+                // When the scans are merged, the pose is applied to the points.
+                if (pose != nullptr) {
+                    vertex.P() = (*pose) * vertex.P();
+                    if (normals) {
+                        vertex.N() = normalMatrix * vertex.N();
+                    }
                 }
 
                 // Set the quality.
-                if (data3DPoints.isQualityAvailable()) {
-                    vertex->Q() = pointsData.intensity[i];
+                if (quality) {
+                    vertex.Q() = pointsData.intensity[i];
                 }
 
                 // Set the point color.
-                if (data3DPoints.areColorsAvailable()) {
-                    vertex->C()[0] = pointsData.colorRed[i];
-                    vertex->C()[1] = pointsData.colorGreen[i];
-                    vertex->C()[2] = pointsData.colorBlue[i];
-                    vertex->C()[3] = 0xFF;
-                }
-                else {
-                    // TODO: extract colors from the image?
+                if (colors) {
+                    vertex.C() = vcg::Color4b(pointsData.colorRed[i], pointsData.colorGreen[i], pointsData.colorBlue[i], 0xFF);
                 }
-
             }
+
+            written += validIndices.size();
         }
 
-        /* If the colors are not available for the mesh use a gray scale */
-        if (!data3DPoints.areColorsAvailable()) {
+        /* If the colors are not available for the scan use a gray scale */
+        if (!colors && written > 0) {
 
             const float percentile = 5.0f;
-            vcg::Histogram<Scalarm> histogram{};
-            vcg::tri::Stat<CMeshO>::ComputePerVertexQualityHistogram(m.cm, histogram);
-
-            const Scalarm minPercentile = histogram.Percentile(percentile / 100.0);
-            const Scalarm maxPercentile = histogram.Percentile(1.0 - (percentile / 100));
+            Scalarm minQ = std::numeric_limits<Scalarm>::max();
+            Scalarm maxQ = std::numeric_limits<Scalarm>::lowest();
+            for (size_t v = offset; v < offset + written; v++) {
+                minQ = std::min(minQ, cm.vert[v].Q());
+                maxQ = std::max(maxQ, cm.vert[v].Q());
+            }
 
-            vcg::tri::UpdateColor<CMeshO>::PerVertexQualityGray(m.cm, minPercentile, maxPercentile);
+            Scalarm minPercentile = minQ, maxPercentile = maxQ;
+            if (maxQ > minQ) {
+                vcg::Histogram<Scalarm> histogram{};
+                histogram.SetRange(minQ, maxQ, 10000);
+                for (size_t v = offset; v < offset + written; v++) {
+                    histogram.Add(cm.vert[v].Q());
+                }
+                minPercentile = histogram.Percentile(percentile / 100.0);
+                maxPercentile = histogram.Percentile(1.0 - (percentile / 100));
+            }
+            const Scalarm rangeQ = maxPercentile > minPercentile ? maxPercentile - minPercentile : Scalarm(1);
+            const int end = static_cast<int>(offset + written);
 
+            #pragma omp parallel for schedule(static)
+            for (int v = static_cast<int>(offset); v < end; v++) {
+                Scalarm shade = std::min(Scalarm(1), std::max(Scalarm(0), (cm.vert[v].Q() - minPercentile) / rangeQ));
+                cm.vert[v].C().SetGrayShade(shade);
+            }
         }
 
     }
@@ -526,6 +678,8 @@ void E57IOPlugin::loadMesh(MeshModel &m, int &mask, int scanIndex, size_t buffSi
     }
 
     dataReader.close();
+
+    return written;
 }
 
 static inline std::string filenameToString(const QString& fileName) noexcept {
@@ -191,6 +191,7 @@ public:
 
 	virtual void exportMaskCapability(const QString &format, int &capability, int &defaultBits) const;
 
+	RichParameterList initPreOpenParameter(const QString& format) const;
 	unsigned int numberMeshesContainedInFile(const QString& format, const QString& fileName, const RichParameterList& preParams) const;
 
 	void open(const QString &formatName, const QString &fileName, MeshModel &m,
@@ -213,24 +214,36 @@ private:
     std::pair<e57::Image2D, QImage> extractMeshImage(const e57::Reader &fileReader, int scanIndex, bool saveToDisk);
 
     /***
-     * Load the cloud points read from the E57 file, inside the mesh to display.
-     * @param m The mesh to display
+     * Header and number of points of a scan contained in the E57 file.
+     */
+    struct ScanInfo {
+        e57::Data3D header{};
+        int64_t pointCount = 0;
+    };
+
+    /***
+     * Load the cloud points of a scan read from the E57 file inside the vertices of the mesh, starting from
+     * the vertex at the given offset. The vertices must be already allocated (pointCount vertices starting
+     * from offset); invalid points are skipped, therefore the number of written vertices is returned.
+     * Points are read in blocks and each block is converted in parallel.
+     * @param cm The mesh where the points are stored
+     * @param offset Index of the first vertex of the scan
      * @param mask
      * @param scanIndex Data block index given by the NewData3D
-     * @param buffSize Dimension for buffer size
+     * @param pointCount Number of points contained in the scan
      * @param fileReader The file reader object used to scan the file
-     * @param cb Callback to update the progressbar contained in MeshLab
+     * @param scanHeader The meta information about the e57 scan
+     * @param pose If not null, the transformation applied to the points and normals
+     * @return the number of vertices written
      */
-    void loadMesh(MeshModel &m, int &mask, int scanIndex, size_t buffSize,
-                  const e57::Reader &fileReader, e57::Data3D &scanHeader,
-                  std::pair<e57::Image2D, QImage> image, const RichParameterList &par);
+    size_t loadMesh(CMeshO &cm, size_t offset, int &mask, int scanIndex, int64_t pointCount,
+                    const e57::Reader &fileReader, e57::Data3D &scanHeader, const Matrix44m* pose);
 
     /***
-     * Read the transform matrix inside the e57::Data3D and apply it to the mesh
-     * @param meshModel The mesh to apply the transform matrix
+     * Compute the transform matrix stored inside the e57::Data3D
      * @param scanHeader The meta information about the e57 mesh, from which extract the transformation matrix
      */
-    void translatedAndRotateMesh(MeshModel *meshModel, const e57::Data3D &scanHeader) const;
+    Matrix44m poseMatrix(const e57::Data3D &scanHeader) const;
 };
 
 #endif
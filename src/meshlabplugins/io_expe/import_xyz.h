@@ -36,6 +36,7 @@
 #include <vcg/space/color4.h>
 #include <wrap/callback.h>
 #include <wrap/io_trimesh/io_mask.h>
+#include <common/utilities/ascii_point_cloud_reader.h>
 
 namespace vcg
 {
@@ -138,7 +139,7 @@ class ImporterXYZ
 		}
 
 		static int Open(MESH_TYPE &mesh, const char *filename, int &loadmask,
-			const Options& options, CallBackPos * /*cb*/)
+			const Options& options, CallBackPos *cb)
 		{
 			QFile device(filename);
 			if ( (!device.open(QFile::ReadOnly)) )
@@ -170,53 +171,24 @@ class ImporterXYZ
 				return 0;
       }
 
-      std::vector<CoordType> pos,normals;
-      CoordType p,n;
-      while(!stream.atEnd())
-      {
-        buf = stream.readLine(0);
-        buf = buf.trimmed();
-		line = buf.split(QRegExp("[ |\t]"), QString::SkipEmptyParts);
-
-        if (line.size()==6)
-        {
-          loadmask |= Mask::IOM_VERTCOORD;
-          loadmask |= Mask::IOM_VERTNORMAL;
-          for (int k=0; k<3; ++k)
-          {
-            p[k] = line[k].toDouble();
-            n[k] = line[3+k].toDouble();
-          }
-          pos.push_back(p);
-          normals.push_back(n);
-        }
-        else if (line.size()==3)
-        {
-          loadmask |= Mask::IOM_VERTCOORD;
-          // there is no normal information
-          for (int k=0; k<3; ++k)
-          {
-            p[k] = line[k].toDouble();
-            n[k] = 0;
-          }
-          pos.push_back(p);
-          normals.push_back(n);
-        }
-        else
-        {
-          std::cerr << "error: skip line " << buf.toUtf8().data() << "\n";
-          for (int i=0; i<line.size(); ++i)
-            std::cerr << line[i].toUtf8().data() << " $ ";
-          std::cerr << "\n";
-        }
-      }
-      VertexIterator v_iter = Allocator<MESH_TYPE>::AddVertices(mesh,pos.size());
-      for (size_t i=0; i<pos.size(); ++i)
-      {
-        v_iter->P() = pos[i];
-        v_iter->N() = normals[i];
-        ++v_iter;
-      }
+      device.close();
+
+      // the points are parsed in parallel directly into the mesh
+      typedef meshlab::AsciiPointCloudReader Reader;
+      Reader reader({Reader::X, Reader::Y, Reader::Z, Reader::NX, Reader::NY, Reader::NZ});
+      reader.setSeparators(" |\t");
+      reader.setMinimumFieldNumber(3);
+      reader.setStrictFieldNumber(true); // lines with 3 or 6 values only
+      Reader::Result res = reader.read(QString(filename), mesh, cb);
+      if (!res.opened)
+        return CantOpen;
+
+      if (res.pointNumber > 0)
+        loadmask |= Mask::IOM_VERTCOORD;
+      if (res.completeLines > 0)
+        loadmask |= Mask::IOM_VERTNORMAL;
+      if (res.skippedLines > 0)
+        std::cerr << "error: skipped " << res.skippedLines << " lines\n";
 
 			return 0;
 		} // end Open
@@ -1,41 +0,0 @@
-/****************************************************************************
-* MeshLab                                                           o o     *
-* A versatile mesh processing toolbox                             o     o   *
-*                                                                _   O  _   *
-* Copyright(C) 2005-2021                                           \/)\/    *
-* Visual Computing Lab                                            /\/|      *
-* ISTI - Italian National Research Council                           |      *
-*                                                                    \      *
-* All rights reserved.                                                      *
-*                                                                           *
-* This program is free software; you can redistribute it and/or modify      *
-* it under the terms of the GNU General Public License as published by      *
-* the Free Software Foundation; either version 2 of the License, or         *
-* (at your option) any later version.                                       *
-*                                                                           *
-* This program is distributed in the hope that it will be useful,           *
-* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
-* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
-* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
-* for more details.                                                         *
-*                                                                           *
-****************************************************************************/
-
-#ifndef CALLBACK_PROGRESS_H
-#define CALLBACK_PROGRESS_H
-
-class CallBackProgress {
-public:
-	CallBackProgress(double step = 1) : p(0), s(step) {}
-	double progress() const {return p;}
-	double step() const {return s;}
-	void reset() {p = 0;}
-	void setStep(double step) {s = step;}
-	void increment() {p += s;}
-
-private:
-	double p;
-	double s;
-};
-
-#endif // CALLBACK_PROGRESS_H
@@ -29,9 +29,15 @@
 
 #include "gltf_loader.h"
 
+#include <atomic>
+#include <cstring>
 #include <regex>
 #include <common/mlexception.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace gltf {
 
 /**
@@ -64,6 +70,14 @@ unsigned int getNumberMeshes(
  * @brief Loads all the meshes referred in the scene of the gltf file into
  * the list of meshes.
  *
+ * Loading is done in three steps:
+ * - the node hierarchy is traversed, and for each primitive its material is
+ *   loaded and the accessors it needs are collected;
+ * - every accessor is decoded once (in parallel) in a tightly packed array,
+ *   even if it is shared among primitives or node instances;
+ * - vertices and faces of all the primitives of a mesh are allocated at once,
+ *   and each primitive fills its own range of the mesh (in parallel).
+ *
  * @param meshModelList
  * @param maskList
  * @param model
@@ -75,24 +89,96 @@ void loadMeshes(
 		bool loadInSingleLayer,
 		vcg::CallBackPos* cb)
 {
-	CallBackProgress progress(100.0/meshModelList.size());
 	maskList.resize(meshModelList.size(), 0);
 	std::list<MeshModel*>::const_iterator meshit = meshModelList.begin();
 	std::list<int>::iterator maskit = maskList.begin();
+
+	std::vector<internal::PrimitiveLoad> primitives;
 	for (unsigned int s = 0; s < model.scenes.size(); ++s){
 		const tinygltf::Scene& scene = model.scenes[s];
 		for (unsigned int n = 0; n < scene.nodes.size(); ++n){
-			internal::loadMeshesWhileTraversingNodes(
+			internal::collectMeshesWhileTraversingNodes(
 						model,
 						meshit,
 						maskit,
 						Matrix44m::Identity(),
 						scene.nodes[n],
 						loadInSingleLayer,
-						cb,
-						progress);
+						primitives);
+		}
+	}
+
+	//all the accessors referred by the primitives, each one decoded once
+	std::map<int, internal::DecodedAccessor> accessors;
+	for (const internal::PrimitiveLoad& pl : primitives) {
+		for (int a : {pl.position, pl.normal, pl.color, pl.texcoord}) {
+			if (a >= 0)
+				accessors[a].asValues = true;
 		}
+		if (pl.indices >= 0)
+			accessors[pl.indices].asIndices = true;
 	}
+	std::vector<std::pair<int, internal::DecodedAccessor*>> toDecode;
+	toDecode.reserve(accessors.size());
+	for (auto& a : accessors)
+		toDecode.emplace_back(a.first, &a.second);
+
+	if (cb)
+		cb(5, "Decoding accessors");
+	std::string error;
+#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < (int) toDecode.size(); ++i) {
+		try {
+			internal::decodeAccessor(model, toDecode[i].first, *toDecode[i].second);
+		}
+		catch (const MLException& e) {
+#pragma omp critical (gltf_decode_error)
+			error = e.what();
+		}
+	}
+	if (!error.empty())
+		throw MLException(QString::fromStdString(error));
+
+	if (cb)
+		cb(40, "Loading primitives");
+	internal::allocateMeshes(primitives);
+
+	std::atomic<int> loaded(0);
+	bool valid = true;
+#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < (int) primitives.size(); ++i) {
+		if (!internal::populatePrimitive(primitives[i], accessors)) {
+#pragma omp critical (gltf_populate_error)
+			valid = false;
+		}
+		int done = ++loaded;
+#ifdef _OPENMP
+		if (cb && omp_get_thread_num() == 0)
+#else
+		if (cb)
+#endif
+			cb(40 + (59 * done) / primitives.size(), "Loading primitives");
+	}
+	if (!valid)
+		throw MLException("File contains triangle indices that refer to non existing vertices");
+
+	// the texcoords of the primitives that have a texture have been transferred from vertex to
+	// wedges. Therefore, we can remove vertex texcoords and leave only wedges, which are the only
+	// that can be rendered with multiple textures in meshlab.
+	// Vertex texcoords are kept only if the last primitive with texcoords of the mesh has no
+	// texture.
+	// TODO: remove this mechanism whenever vertex texcoords allow to render multiple textures in
+	// vcg.
+	std::map<MeshModel*, bool> keepVertTex;
+	for (const internal::PrimitiveLoad& pl : primitives) {
+		if (pl.vTex || pl.texcoord >= 0)
+			keepVertTex[pl.m] = !pl.vTex;
+	}
+	for (const auto& k : keepVertTex) {
+		if (!k.second)
+			k.first->clearDataMask(MeshModel::MM_VERTTEXCOORD);
+	}
+
 	if (cb)
 		cb(100, "GLTF File loaded");
 }
@@ -128,38 +214,37 @@ unsigned int getNumberMeshes(
 }
 
 /**
- * @brief Recursive function that loads a mesh if the current node contains one,
- * and then calls itself on the children of the node.
+ * @brief Recursive function that collects the primitives of a mesh if the
+ * current node contains one, and then calls itself on the children of the node.
  *
  * @param model
  * @param currentMesh
  * @param currentMask
  * @param currentMatrix
  * @param currentNode
+ * @param primitives: the collected primitives are appended here
  */
-void loadMeshesWhileTraversingNodes(
+void collectMeshesWhileTraversingNodes(
 		const tinygltf::Model& model,
 		std::list<MeshModel*>::const_iterator& currentMesh,
 		std::list<int>::iterator& currentMask,
 		Matrix44m currentMatrix,
 		unsigned int currentNode,
 		bool loadInSingleLayer,
-		vcg::CallBackPos* cb,
-		CallBackProgress& progress)
+		std::vector<PrimitiveLoad>& primitives)
 {
 	currentMatrix = currentMatrix * getCurrentNodeTrMatrix(model, currentNode);
 	if (model.nodes[currentNode].mesh >= 0) {
 
 		int meshid = model.nodes[currentNode].mesh;
-		loadMesh(
+		collectMesh(
 				**currentMesh,
 				*currentMask,
 				model.meshes[meshid],
 				model,
 				loadInSingleLayer,
 				currentMatrix,
-				cb,
-				progress);
+				primitives);
 		if (!loadInSingleLayer) {
 			(*currentMesh)->cm.Tr = currentMatrix;
 			++currentMesh;
@@ -171,15 +256,14 @@ void loadMeshesWhileTraversingNodes(
 	for (int c : model.nodes[currentNode].children){
 		if (c>=0){ //if it is valid
 			//visit child
-			loadMeshesWhileTraversingNodes(
+			collectMeshesWhileTraversingNodes(
 						model,
 						currentMesh,
 						currentMask,
 						currentMatrix,
 						c,
 						loadInSingleLayer,
-						cb,
-						progress);
+						primitives);
 		}
 	}
 }
@@ -246,69 +330,59 @@ Matrix44m getCurrentNodeTrMatrix(
 }
 
 /**
- * @brief loads a mesh from gltf file.
- * It merges all the primitives in the loaded mesh.
+ * @brief collects the primitives of a mesh from gltf file.
+ * All the primitives will be merged in the loaded mesh.
  *
  * @param m: the mesh that will contain the loaded mesh
  * @param tm: tinygltf structure of the mesh to load
  * @param model: tinygltf file
+ * @param primitives: the collected primitives are appended here
  */
-void loadMesh(
+void collectMesh(
 		MeshModel& m,
 		int& mask,
 		const tinygltf::Mesh& tm,
 		const tinygltf::Model& model,
 		bool loadInSingleLayer,
 		const Matrix44m& transf,
-		vcg::CallBackPos* cb,
-		CallBackProgress& progress)
+		std::vector<PrimitiveLoad>& primitives)
 {
 	if (!tm.name.empty())
 		m.setLabel(QString::fromStdString(tm.name));
 
-	double oldStep = progress.step();
-	progress.setStep(oldStep / tm.primitives.size());
-
-	//for each primitive, load it into the mesh
 	for (const tinygltf::Primitive& p : tm.primitives){
-		internal::loadMeshPrimitive(
-					m,
-					mask,
-					model,
-					p,
-					loadInSingleLayer,
-					transf,
-					cb,
-					progress);
+		primitives.push_back(internal::collectMeshPrimitive(
+			m, mask, model, p, loadInSingleLayer, transf));
 	}
-	if (cb)
-		cb(progress.progress(), "Loaded all primitives for current mesh.");
-	progress.setStep(oldStep);
 }
 
 /**
- * @brief loads the given primitive into the mesh
+ * @brief loads the material of the given primitive into the mesh, and returns
+ * the description of the primitive that will be used to load its attributes.
+ *
+ * If the primitive does not have a POSITION attribute, a MLException will be
+ * thrown.
+ *
  * @param m
  * @param model
  * @param p
  */
-void loadMeshPrimitive(
+PrimitiveLoad collectMeshPrimitive(
 		MeshModel& m,
 		int& mask,
 		const tinygltf::Model& model,
 		const tinygltf::Primitive& p,
 		bool loadInSingleLayer,
-		const Matrix44m& transf,
-		vcg::CallBackPos* cb,
-		CallBackProgress& progress)
+		const Matrix44m& transf)
 {
-	double oldStep = progress.step();
-	progress.setStep(oldStep/GLTF_ATTR_STR.size()+1);
+	PrimitiveLoad pl;
+	pl.m = &m;
+	pl.transf = transf;
+	//if all the meshes are loaded in a single layer, I need to apply
+	//the transformation matrix to the loaded coordinates
+	pl.applyTransf = loadInSingleLayer;
 
 	int textureImg = -1; //id of the texture associated to the material
-	bool vCol = false; // used if a material has a base color for all the primitive
-	bool vTex = false; // used if a material has a texture
-	vcg::Color4b col; //the base color, to be set to all the vertices
 
 	if (p.material >= 0) { //if the primitive has a material
 		const tinygltf::Material& mat = model.materials[p.material];
@@ -321,14 +395,14 @@ void loadMeshPrimitive(
 		}
 		it = mat.values.find("baseColorFactor");
 		if (it != mat.values.end()) { //vertex base color, the same for a primitive
-			vCol = true;
+			pl.vCol = true;
 			const std::vector<double>& vc = it->second.number_array;
 			for (unsigned int i = 0; i < 4; i++)
-				col[i] = vc[i] * 255.0;
+				pl.col[i] = vc[i] * 255.0;
 		}
 	}
 	if (textureImg != -1) { //if we found a texture
-		vTex = true;
+		pl.vTex = true;
 		const tinygltf::Image& img = model.images[model.textures[textureImg].source];
 		//add the path of the texture to the mesh
 		std::string uri = img.uri;
@@ -376,370 +450,390 @@ void loadMeshPrimitive(
 			textureImg = m.cm.textures.size() - 1;
 		}
 	}
-	//vector of vertex pointers added to the mesh
-	//this vector is modified only when adding vertex position attributes
-	std::vector<CMeshO::VertexPointer> ivp;
-
-	//load vertex position attribute, sets also the ivp vector
-	if (cb)
-		cb(progress.progress(), "Loading vertex coordinates");
-	loadAttribute(m, ivp, model, p, POSITION);
-	progress.increment();
-
-	//if all the meshes are loaded in a single layer, I need to apply
-	//the transformation matrix to the loaded coordinates
-	if (loadInSingleLayer){
-		for (CMeshO::VertexPointer p : ivp){
-			p->P() = transf * p->P();
-		}
-	}
-
-	//if the mesh has a base color, set it to vertex colors
-	if (vCol) {
-		mask |= vcg::tri::io::Mask::IOM_VERTCOLOR;
-		m.updateDataMask(MeshModel::MM_VERTCOLOR);
-		for (auto v : ivp)
-			v->C() = col;
+	pl.textureImg = textureImg;
+
+	pl.position = attributeAccessor(model, p, POSITION);
+	if (pl.position < 0)
+		throw MLException("File has not 'Position' attribute");
+	pl.normal = attributeAccessor(model, p, NORMAL);
+	pl.color = attributeAccessor(model, p, COLOR_0);
+	pl.texcoord = attributeAccessor(model, p, TEXCOORD_0);
+	pl.indices = attributeAccessor(model, p, INDICES);
+	pl.vertCount = model.accessors[pl.position].count;
+
+	if (pl.indices >= 0) {
+		pl.triangles = true;
+		pl.faceCount = model.accessors[pl.indices].count / 3;
 	}
-
-	// if the mesh has a texture or texcoords, enable texcoords to the mesh
-	if (vTex || p.attributes.find(GLTF_ATTR_STR[TEXCOORD_0]) != p.attributes.end()) {
-		m.updateDataMask(MeshModel::MM_VERTTEXCOORD);
-		m.updateDataMask(MeshModel::MM_WEDGTEXCOORD);
+	//if there are no indices, the mesh is not indexed, and triplets of
+	//contiguous vertices generate triangles (avoid explicitly the point clouds)
+	else if (p.mode != TINYGLTF_MODE_POINTS) {
+		pl.triangles = true;
+		pl.faceCount = pl.vertCount / 3;
 	}
 
-	if (cb)
-		cb(progress.progress(), "Loading vertex normals");
-	//load all the other vertex attributes (ivp is not modified by these calls)
-	bool res = loadAttribute(m, ivp, model, p, NORMAL);
-	if (res) {
+	if (pl.normal >= 0)
 		mask |= vcg::tri::io::Mask::IOM_VERTNORMAL;
-		//if all the meshes are loaded in a single layer, I need to apply
-		//the transformation matrix to the loaded coordinates
-		if (loadInSingleLayer){
-			Matrix33m mat33(transf,3);
-			for (CMeshO::VertexPointer p : ivp){
-				p->N() = mat33 * p->N();
-			}
-		}
-	}
-	progress.increment();
-
-	if (cb)
-		cb(progress.progress(), "Loading vertex colors");
-	res = loadAttribute(m, ivp, model, p, COLOR_0);
-	if (res) {
+	if (pl.vCol || pl.color >= 0)
 		mask |= vcg::tri::io::Mask::IOM_VERTCOLOR;
-		m.updateDataMask(MeshModel::MM_VERTCOLOR);
-	}
-	progress.increment();
-	if (cb)
-		cb(progress.progress(), "Loading vertex texcoords");
-	res = loadAttribute(m, ivp, model, p, TEXCOORD_0, textureImg);
-	if (res) {
+	if (pl.texcoord >= 0)
 		mask |= vcg::tri::io::Mask::IOM_WEDGTEXCOORD;
-		m.updateDataMask(MeshModel::MM_WEDGTEXCOORD);
-	}
-	progress.increment();
-
-
-	//load triangles
-	if (cb)
-		cb(progress.progress(), "Loading triangle indices");
-	loadAttribute(m, ivp, model, p, INDICES);
-	progress.increment();
-
-	// if vTex was true, it means that we loaded texcoords, that have been transferred from vertex to
-	// wedges when loading triangle indices. Therefore, we can remove vertex texcoords and leave
-	// only wedges, which are the only that can be rendered with multiple textures in meshlab
-	// TODO: remove this mechanism whenever vertex texcoords allow to render multiple textures in
-	// vcg.
-	if (vTex) {
-		m.clearDataMask(MeshModel::MM_VERTTEXCOORD);
-	}
-
-	if (cb)
-		cb(progress.progress(), "Loaded all attributes of current mesh");
 
-	progress.setStep(oldStep);
+	return pl;
 }
 
 /**
- * @brief loads the attribute attr from the primitive p contained in the
- * gltf model. If the attribute is vertex position, sets also vertex pointers
- * vector ivp. For all the other parameters, ivp is a const input.
+ * @brief returns the index of the accessor of the attribute attr of the
+ * primitive p, or -1 if the primitive does not contain the attribute.
  *
- * If the primitive does not contain the attribute attr, nothing is done.
- * However, if the attribute is POSITION, then a MLException will be thrown.
- *
- *
- * @param m
- * @param ivp
- * @param model
- * @param p
- * @param attr
- * @param textID: id of the texture in case of the attr is TEXCOORD_0
- * @return true if the attribute has been loaded
+ * Triangle indices are returned only if the mode of the primitive is
+ * GL_TRIANGLES.
  */
-bool loadAttribute(
-		MeshModel& m,
-		std::vector<CMeshO::VertexPointer>& ivp,
+int attributeAccessor(
 		const tinygltf::Model& model,
 		const tinygltf::Primitive& p,
-		GLTF_ATTR_TYPE attr,
-		int textID)
+		GLTF_ATTR_TYPE attr)
 {
-	bool attrLoaded = false;
-	const tinygltf::Accessor* accessor = nullptr;
-
-	//get the accessor associated to the attribute
+	int accessor = -1;
 	if (attr != INDICES) {
 		auto it = p.attributes.find(GLTF_ATTR_STR[attr]);
-
-		if (it != p.attributes.end()) { //accessor found
-			accessor = &model.accessors[it->second];
-		}
-		else if (attr == POSITION) { //if we were looking for POSITION and didn't find any
-			throw MLException("File has not 'Position' attribute");
-		}
+		if (it != p.attributes.end()) //accessor found
+			accessor = it->second;
+	}
+	else if (p.mode == TINYGLTF_MODE_TRIANGLES) {
+		accessor = p.indices;
 	}
-	else { //if the attribute is triangle indices
+	if (accessor >= 0 && (unsigned int) accessor < model.accessors.size())
+		return accessor;
+	return -1;
+}
 
-		//if the mode is GL_TRIANGLES and we have triangle indices
-		if (p.mode == TINYGLTF_MODE_TRIANGLES && p.indices >= 0 &&
-				(unsigned int)p.indices < model.accessors.size()) {
-			accessor = &model.accessors[p.indices];
-		}
+/**
+ * @brief enables the required components and allocates, with a single call for
+ * each mesh, the vertices and the faces of all the primitives. Then sets to
+ * each primitive the range of vertices and faces it has to fill.
+ *
+ * Must be called before populatePrimitive, that does not modify the containers
+ * of the mesh.
+ */
+void allocateMeshes(std::vector<PrimitiveLoad>& primitives)
+{
+	//meshes, in order of first appearance
+	std::vector<MeshModel*> meshes;
+	std::map<MeshModel*, std::vector<PrimitiveLoad*>> meshPrimitives;
+	for (PrimitiveLoad& pl : primitives) {
+		std::vector<PrimitiveLoad*>& mp = meshPrimitives[pl.m];
+		if (mp.empty())
+			meshes.push_back(pl.m);
+		mp.push_back(&pl);
 	}
 
-	//if we found an accessor of the attribute
-	if (accessor) {
-		//bufferview: contains infos on how to access buffer with the accessor
-		const tinygltf::BufferView& posbw = model.bufferViews[accessor->bufferView];
-
-		//data of the whole buffer (vector of bytes);
-		//may contain also other data not associated to our attribute
-		const std::vector<unsigned char>& posdata = model.buffers[posbw.buffer].data;
-
-		//offset where the data of the attribute starts
-		unsigned int posOffset = posbw.byteOffset + accessor->byteOffset;
-		//hack:
-		//if the attribute is a color, textid is used to tell the size of the
-		//color (3 or 4 components)
-		if (attr == COLOR_0){
-			if (accessor->type == TINYGLTF_TYPE_VEC3)
-				textID = 3;
-			else if (accessor->type == TINYGLTF_TYPE_VEC4)
-				textID = 4;
+	for (MeshModel* m : meshes) {
+		const std::vector<PrimitiveLoad*>& mp = meshPrimitives[m];
+		bool hasColor = false;
+		bool hasTexcoord = false;
+		size_t nVerts = 0, nFaces = 0;
+		for (const PrimitiveLoad* pl : mp) {
+			hasColor |= pl->vCol || pl->color >= 0;
+			hasTexcoord |= pl->vTex || pl->texcoord >= 0;
+			nVerts += pl->vertCount;
+			nFaces += pl->faceCount;
 		}
 
-		const unsigned int elementSize =
-				tinygltf::GetNumComponentsInType(accessor->type) *
-				tinygltf::GetComponentSizeInBytes(accessor->componentType);
-		const unsigned int stride =
-				(posbw.byteStride > elementSize) ? posbw.byteStride : elementSize;
-
-		//if data is float
-		if (accessor->componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
-			//get the starting point of the data as float pointer
-			const float* posArray = (const float*) (posdata.data() + posOffset);
-			populateAttr(attr, m, ivp, posArray, stride, accessor->count, textID);
-			attrLoaded = true;
-		}
-		//if data is double
-		else if (accessor->componentType == TINYGLTF_COMPONENT_TYPE_DOUBLE) {
-			//get the starting point of the data as double pointer
-			const double* posArray = (const double*) (posdata.data() + posOffset);
-			populateAttr(attr, m, ivp, posArray, stride, accessor->count, textID);
-			attrLoaded = true;
+		if (hasColor)
+			m->updateDataMask(MeshModel::MM_VERTCOLOR);
+		// if the mesh has a texture or texcoords, enable texcoords to the mesh
+		if (hasTexcoord) {
+			m->updateDataMask(MeshModel::MM_VERTTEXCOORD);
+			m->updateDataMask(MeshModel::MM_WEDGTEXCOORD);
 		}
-		//if data is ubyte
-		else if (accessor->componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
-			//get the starting point of the data as uchar pointer
-			const unsigned char* triArray = (const unsigned char*) (posdata.data() + posOffset);
-			populateAttr(attr, m, ivp, triArray, stride, accessor->count, textID);
-			attrLoaded = true;
-		}
-		//if data is ushort
-		else if (accessor->componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
-			//get the starting point of the data as ushort pointer
-			const unsigned short* triArray = (const unsigned short*) (posdata.data() + posOffset);
-			populateAttr(attr, m, ivp, triArray, stride, accessor->count, textID);
-			attrLoaded = true;
-		}
-		//if data is uint
-		else if (accessor->componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT) {
-			//get the starting point of the data as uint pointer
-			const unsigned int* triArray = (const unsigned int*) (posdata.data() + posOffset);
-			populateAttr(attr, m, ivp, triArray, stride, accessor->count, textID);
-			attrLoaded = true;
-		}
-	}
-	//if accessor not found and attribute is indices, it means that
-	//the mesh is not indexed, and triplets of contiguous vertices
-	//generate triangles
-	else if (attr == INDICES) {
-		// avoid explicitly the point clouds
-		if (p.mode != TINYGLTF_MODE_POINTS) {
-			//this case is managed when passing nullptr as data
-			populateAttr<unsigned char>(attr, m, ivp, nullptr, 0, 0);
-			attrLoaded = true;
+
+		size_t vertOffset = m->cm.vert.size();
+		size_t faceOffset = m->cm.face.size();
+		if (nVerts > 0)
+			vcg::tri::Allocator<CMeshO>::AddVertices(m->cm, nVerts);
+		if (nFaces > 0)
+			vcg::tri::Allocator<CMeshO>::AddFaces(m->cm, nFaces);
+
+		for (PrimitiveLoad* pl : mp) {
+			pl->vertOffset = vertOffset;
+			pl->faceOffset = faceOffset;
+			pl->vertTex = hasTexcoord;
+			pl->wedgeTex = hasTexcoord;
+			vertOffset += pl->vertCount;
+			faceOffset += pl->faceCount;
 		}
 	}
-	return attrLoaded;
 }
 
 /**
- * @brief given the attribute and the pointer to the data,
- * it calls the appropriate functions that put the data into the mesh
- * appropriately
- * @param attr
- * @param m
- * @param ivp: modified only if attr
- * @param array: vector containing the data
- * @param stride:
- *     number of bytes between consecutive elements in the vector
- *     (only applies to vertex attributes; indices are always tightly packed)
- * @param number: number of elements contained in the data
- * @param textID:
- *     if attr is texcoord, it is the texture id
- *     if attr is color, tells if color has 3 or 4 components
+ * @brief decodes the content of the given accessor in the tightly packed
+ * arrays of decoded (values and/or indices, depending on how the accessor is
+ * used by the primitives).
+ *
+ * Accessors without a buffer view are zero-initialized, as specified by the
+ * gltf docs.
+ *
+ * Throws a MLException if the accessor refers to data outside its buffer, or
+ * if it has an unsupported component type.
  */
-template <typename Scalar>
-void populateAttr(
-		GLTF_ATTR_TYPE attr,
-		MeshModel&m,
-		std::vector<CMeshO::VertexPointer>& ivp,
-		const Scalar* array,
-		unsigned int stride,
-		unsigned int number,
-		int textID)
+void decodeAccessor(
+		const tinygltf::Model& model,
+		int accessorId,
+		DecodedAccessor& decoded)
 {
-	switch (attr) {
-	case POSITION:
-		populateVertices(m, ivp, array, stride, number); break;
-	case NORMAL:
-		populateVNormals(ivp, array, stride, number); break;
-	case COLOR_0:
-		populateVColors(ivp, array, stride, number, textID); break;
-	case TEXCOORD_0:
-		populateVTextCoords(ivp, array, stride, number, textID); break;
-	case INDICES:
-		populateTriangles(m, ivp, array, number/3); break;
+	const tinygltf::Accessor& accessor = model.accessors[accessorId];
+	decoded.count = accessor.count;
+	decoded.components = tinygltf::GetNumComponentsInType(accessor.type);
+	decoded.integer =
+			accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT &&
+			accessor.componentType != TINYGLTF_COMPONENT_TYPE_DOUBLE;
+
+	const size_t nValues = decoded.count * decoded.components;
+	if (decoded.asValues)
+		decoded.values.assign(nValues, 0);
+	if (decoded.asIndices)
+		decoded.indices.assign(nValues, 0);
+
+	if (accessor.bufferView < 0 || decoded.count == 0)
+		return;
+
+	//bufferview: contains infos on how to access buffer with the accessor
+	const tinygltf::BufferView& bw = model.bufferViews[accessor.bufferView];
+
+	//data of the whole buffer (vector of bytes);
+	//may contain also other data not associated to our attribute
+	const std::vector<unsigned char>& data = model.buffers[bw.buffer].data;
+
+	//offset where the data of the attribute starts
+	const size_t offset = bw.byteOffset + accessor.byteOffset;
+
+	const size_t elementSize =
+			decoded.components *
+			tinygltf::GetComponentSizeInBytes(accessor.componentType);
+	const size_t stride =
+			(bw.byteStride > elementSize) ? bw.byteStride : elementSize;
+
+	if (offset + (decoded.count - 1) * stride + elementSize > data.size())
+		throw MLException("File contains an accessor that exceeds the size of its buffer");
+
+	bool supported = true;
+	if (decoded.asValues) {
+		supported &= decodeComponents(
+			accessor.componentType, data.data() + offset, stride,
+			decoded.count, decoded.components, decoded.values.data());
 	}
+	if (decoded.asIndices) {
+		supported &= decodeComponents(
+			accessor.componentType, data.data() + offset, stride,
+			decoded.count, decoded.components, decoded.indices.data());
+	}
+	if (!supported)
+		throw MLException("File contains an accessor with an unsupported component type");
 }
 
-template <typename Scalar>
-void populateVertices(
-		MeshModel&m,
-		std::vector<CMeshO::VertexPointer>& ivp,
-		const Scalar* posArray,
-		unsigned int stride,
-		unsigned int vertNumber)
+namespace {
+
+template <typename Scalar, typename Out>
+void decodeTypedComponents(
+		const unsigned char* data,
+		size_t stride,
+		size_t count,
+		unsigned int nComponents,
+		Out* out)
 {
-	ivp.clear();
-	ivp.resize(vertNumber);
-	CMeshO::VertexIterator vi =
-			vcg::tri::Allocator<CMeshO>::AddVertices(m.cm, vertNumber);
-	for (unsigned int i = 0; i < vertNumber*3; i+= 3, ++vi){
-		ivp[i/3] = &*vi;
-		const Scalar* posBase =
-				reinterpret_cast<const Scalar*>(reinterpret_cast<const char*>(posArray) + (i/3) * stride);
-		vi->P() = CMeshO::CoordType(posBase[0], posBase[1], posBase[2]);
+	//tightly packed data of the same type: bulk copy of the whole range
+	if (std::is_same<Scalar, Out>::value && stride == nComponents * sizeof(Scalar)) {
+		std::memcpy(out, data, count * stride);
+		return;
+	}
+	for (size_t i = 0; i < count; ++i) {
+		const Scalar* base = reinterpret_cast<const Scalar*>(data + i * stride);
+		for (unsigned int c = 0; c < nComponents; ++c)
+			out[i * nComponents + c] = static_cast<Out>(base[c]);
 	}
 }
 
-template <typename Scalar>
-void populateVNormals(
-		const std::vector<CMeshO::VertexPointer>& ivp,
-		const Scalar* normArray,
-		unsigned int stride,
-		unsigned int vertNumber)
+} // namespace
+
+/**
+ * @brief converts count elements of nComponents components of the given gltf
+ * component type, stored in data with the given stride, to the tightly
+ * packed array out.
+ *
+ * @return false if the component type is not supported
+ */
+template <typename Out>
+bool decodeComponents(
+		int componentType,
+		const unsigned char* data,
+		size_t stride,
+		size_t count,
+		unsigned int nComponents,
+		Out* out)
 {
-	for (unsigned int i = 0; i < vertNumber*3; i+= 3) {
-		const Scalar* normBase =
-				reinterpret_cast<const Scalar*>(reinterpret_cast<const char*>(normArray) + (i/3) * stride);
-		ivp[i/3]->N() = CMeshO::CoordType(normBase[0], normBase[1], normBase[2]);
+	switch (componentType) {
+	case TINYGLTF_COMPONENT_TYPE_FLOAT:
+		decodeTypedComponents<float>(data, stride, count, nComponents, out); break;
+	case TINYGLTF_COMPONENT_TYPE_DOUBLE:
+		decodeTypedComponents<double>(data, stride, count, nComponents, out); break;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+		decodeTypedComponents<unsigned char>(data, stride, count, nComponents, out); break;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+		decodeTypedComponents<unsigned short>(data, stride, count, nComponents, out); break;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+		decodeTypedComponents<unsigned int>(data, stride, count, nComponents, out); break;
+	default:
+		return false;
 	}
+	return true;
 }
 
-template <typename Scalar>
-void populateVColors(
-		const std::vector<CMeshO::VertexPointer>& ivp,
-		const Scalar* colorArray,
-		unsigned int stride,
-		unsigned int vertNumber,
-		int nElemns)
+/**
+ * @brief applies the transformation matrix to the tightly packed array of
+ * count 3D coordinates in, writing the result in out.
+ * If linearOnly is true, only the upper-left 3x3 part of the matrix is applied
+ * (used for normals).
+ *
+ * The matrix coefficients are hoisted out of a branch-free loop over
+ * contiguous coordinates, so that the compiler can vectorize it.
+ */
+void transformCoords(
+		const Matrix44m& transf,
+		bool linearOnly,
+		const Scalarm* in,
+		size_t count,
+		Scalarm* out)
 {
-	for (unsigned int i = 0; i < vertNumber*nElemns; i+= nElemns) {
-		const Scalar* colorBase =
-				reinterpret_cast<const Scalar*>(reinterpret_cast<const char*>(colorArray) + (i/nElemns) * stride);
-		if (!std::is_floating_point<Scalar>::value) {
-			int alpha = nElemns == 4 ? colorBase[3] : 255;
-			ivp[i/nElemns]->C() = vcg::Color4b(colorBase[0], colorBase[1], colorBase[2], alpha);
-		}
-		else {
-			int alpha = nElemns == 4 ? colorBase[3] * 255 : 255;
-			ivp[i/nElemns]->C() = vcg::Color4b(colorBase[0] * 255, colorBase[1]*255, colorBase[2]*255, alpha);
-		}
+	const Scalarm m00 = transf[0][0], m01 = transf[0][1], m02 = transf[0][2];
+	const Scalarm m10 = transf[1][0], m11 = transf[1][1], m12 = transf[1][2];
+	const Scalarm m20 = transf[2][0], m21 = transf[2][1], m22 = transf[2][2];
+	const Scalarm t0 = linearOnly ? 0 : transf[0][3];
+	const Scalarm t1 = linearOnly ? 0 : transf[1][3];
+	const Scalarm t2 = linearOnly ? 0 : transf[2][3];
+	const Scalarm w0 = linearOnly ? 0 : transf[3][0];
+	const Scalarm w1 = linearOnly ? 0 : transf[3][1];
+	const Scalarm w2 = linearOnly ? 0 : transf[3][2];
+	const Scalarm w3 = linearOnly ? 1 : transf[3][3];
+
+	for (size_t i = 0; i < count; ++i) {
+		const Scalarm x = in[3*i], y = in[3*i+1], z = in[3*i+2];
+		const Scalarm w = w0 * x + w1 * y + w2 * z + w3;
+		out[3*i]   = (m00 * x + m01 * y + m02 * z + t0) / w;
+		out[3*i+1] = (m10 * x + m11 * y + m12 * z + t1) / w;
+		out[3*i+2] = (m20 * x + m21 * y + m22 * z + t2) / w;
 	}
 }
 
-template <typename Scalar>
-void populateVTextCoords(
-		const std::vector<CMeshO::VertexPointer>& ivp,
-		const Scalar* textCoordArray,
-		unsigned int stride,
-		unsigned int vertNumber,
-		int textID)
+/**
+ * @brief fills the range of vertices and faces of the mesh assigned to the
+ * primitive (see allocateMeshes) with the decoded attributes.
+ *
+ * Different primitives write disjoint ranges of the mesh, therefore this
+ * function can be called concurrently on different primitives.
+ *
+ * @return false if the primitive contains triangle indices that refer to non
+ * existing vertices
+ */
+bool populatePrimitive(
+		const PrimitiveLoad& pl,
+		const std::map<int, DecodedAccessor>& accessors)
 {
-	for (unsigned int i = 0; i < vertNumber*2; i+= 2) {
-		const Scalar* textCoordBase =
-				reinterpret_cast<const Scalar*>(reinterpret_cast<const char*>(textCoordArray) + (i/2) * stride);
-		ivp[i/2]->T() = CMeshO::VertexType::TexCoordType(textCoordBase[0], 1-textCoordBase[1]);
-		ivp[i/2]->T().N() = textID;
+	CMeshO& cm = pl.m->cm;
+	const size_t n = pl.vertCount;
+	if (n == 0)
+		return true;
+	CMeshO::VertexType* vb = &cm.vert[pl.vertOffset];
+
+	std::vector<Scalarm> transformed;
+
+	//positions
+	const Scalarm* pos = accessors.at(pl.position).values.data();
+	if (pl.applyTransf) {
+		transformed.resize(n * 3);
+		transformCoords(pl.transf, false, pos, n, transformed.data());
+		pos = transformed.data();
+	}
+	for (size_t i = 0; i < n; ++i)
+		vb[i].P() = CMeshO::CoordType(pos[3*i], pos[3*i+1], pos[3*i+2]);
+
+	//normals
+	if (pl.normal >= 0) {
+		const DecodedAccessor& na = accessors.at(pl.normal);
+		const size_t nn = std::min(n, na.count);
+		const Scalarm* nor = na.values.data();
+		if (pl.applyTransf) {
+			transformed.resize(nn * 3);
+			transformCoords(pl.transf, true, nor, nn, transformed.data());
+			nor = transformed.data();
+		}
+		for (size_t i = 0; i < nn; ++i)
+			vb[i].N() = CMeshO::CoordType(nor[3*i], nor[3*i+1], nor[3*i+2]);
 	}
-}
 
-template <typename Scalar>
-void populateTriangles(
-		MeshModel&m,
-		const std::vector<CMeshO::VertexPointer>& ivp,
-		const Scalar* triArray,
-		unsigned int triNumber)
-{
-	const bool hasTexcoord = m.hasPerVertexTexCoord();
-
-	if (triArray != nullptr) {
-		CMeshO::FaceIterator fi =
-				vcg::tri::Allocator<CMeshO>::AddFaces(m.cm, triNumber);
-		for (unsigned int i = 0; i < triNumber*3; i+=3, ++fi) {
-			for (int j = 0; j < 3; ++j) {
-				fi->V(j) = ivp[triArray[i+j]];
-
-				if (hasTexcoord) {
-					fi->WT(j).u() = fi->V(j)->T().u();
-					fi->WT(j).v() = fi->V(j)->T().v();
-					fi->WT(j).n() = fi->V(j)->T().N();
-				}
-			}
+	//colors: base color of the material, replaced by vertex colors if present
+	if (pl.vCol) {
+		for (size_t i = 0; i < n; ++i)
+			vb[i].C() = pl.col;
+	}
+	if (pl.color >= 0) {
+		const DecodedAccessor& ca = accessors.at(pl.color);
+		const unsigned int nc = ca.components;
+		const size_t cn = std::min(n, ca.count);
+		const Scalarm* col = ca.values.data();
+		const Scalarm scale = ca.integer ? 1 : 255;
+		for (size_t i = 0; i < cn; ++i) {
+			const Scalarm* c = col + i * nc;
+			int alpha = nc == 4 ? c[3] * scale : 255;
+			vb[i].C() = vcg::Color4b(c[0] * scale, c[1] * scale, c[2] * scale, alpha);
 		}
 	}
-	else {
-		CMeshO::FaceIterator fi =
-				vcg::tri::Allocator<CMeshO>::AddFaces(m.cm, ivp.size()/3);
-		for (unsigned int i = 0; i < ivp.size(); i+=3, ++fi) {
-			for (int j = 0; j < 3; ++j) {
-				fi->V(j) = ivp[i+j];
-
-				if (hasTexcoord) {
-					fi->WT(j).u() = fi->V(j)->T().u();
-					fi->WT(j).v() = fi->V(j)->T().v();
-					fi->WT(j).n() = fi->V(j)->T().N();
+
+	//texcoords
+	const DecodedAccessor* ta = pl.texcoord >= 0 ? &accessors.at(pl.texcoord) : nullptr;
+	const size_t tn = ta ? std::min(n, ta->count) : 0;
+	if (ta && pl.vertTex) {
+		const Scalarm* tex = ta->values.data();
+		for (size_t i = 0; i < tn; ++i) {
+			vb[i].T() = CMeshO::VertexType::TexCoordType(tex[2*i], 1-tex[2*i+1]);
+			vb[i].T().N() = pl.textureImg;
+		}
+	}
+
+	//triangles
+	if (!pl.triangles || pl.faceCount == 0)
+		return true;
+	CMeshO::FaceType* fb = &cm.face[pl.faceOffset];
+	const unsigned int* idx =
+			pl.indices >= 0 ? accessors.at(pl.indices).indices.data() : nullptr;
+	bool valid = true;
+	for (size_t f = 0; f < pl.faceCount; ++f) {
+		for (int j = 0; j < 3; ++j) {
+			size_t vi = idx ? idx[3*f+j] : 3*f+j;
+			if (vi >= n) {
+				valid = false;
+				vi = 0;
+			}
+			fb[f].V(j) = &vb[vi];
+
+			//texcoords are stored in wedges, the only that can be rendered
+			//with multiple textures in meshlab
+			if (pl.wedgeTex) {
+				if (vi < tn) {
+					const Scalarm* tex = ta->values.data() + 2*vi;
+					fb[f].WT(j).u() = tex[0];
+					fb[f].WT(j).v() = 1-tex[1];
+					fb[f].WT(j).n() = pl.textureImg;
+				}
+				else {
+					fb[f].WT(j).u() = 0;
+					fb[f].WT(j).v() = 0;
+					fb[f].WT(j).n() = -1;
 				}
 			}
 		}
 	}
+	return valid;
 }
 
 } //namespace gltf::internal
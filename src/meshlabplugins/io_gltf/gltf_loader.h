@@ -24,7 +24,8 @@
 #ifndef GLTF_LOADER_H
 #define GLTF_LOADER_H
 
-#include "callback_progress.h"
+#include <map>
+#include <vector>
 
 #include <common/ml_document/mesh_model.h>
 
@@ -47,99 +48,120 @@ namespace internal {
 enum GLTF_ATTR_TYPE {POSITION, NORMAL, COLOR_0, TEXCOORD_0, INDICES};
 const std::array<std::string, 4> GLTF_ATTR_STR {"POSITION", "NORMAL", "COLOR_0", "TEXCOORD_0"};
 
+/**
+ * @brief A primitive that has to be loaded into a mesh.
+ *
+ * Primitives are collected while traversing the nodes, together with the
+ * accessors they refer to and the range of vertices and faces they will occupy
+ * in the mesh, so that the actual loading can be done in parallel.
+ */
+struct PrimitiveLoad
+{
+	MeshModel* m = nullptr;
+	Matrix44m transf;
+	bool applyTransf = false;
+
+	int textureImg = -1; // id of the texture in m->cm.textures, -1 if none
+	bool vCol = false;   // the material has a base color for all the primitive
+	bool vTex = false;   // the material has a texture
+	vcg::Color4b col;
+
+	// accessors of the attributes, -1 if missing
+	int position = -1;
+	int normal = -1;
+	int color = -1;
+	int texcoord = -1;
+	int indices = -1;
+
+	bool triangles = false; // faces are generated from the vertices
+	bool wedgeTex = false;  // the mesh has wedge texcoords that must be set
+	bool vertTex = false;   // the mesh has vertex texcoords that must be set
+
+	size_t vertOffset = 0, vertCount = 0;
+	size_t faceOffset = 0, faceCount = 0;
+};
+
+/**
+ * @brief The content of an accessor, decoded once in a tightly packed array
+ * and shared by all the primitives that refer to it.
+ */
+struct DecodedAccessor
+{
+	bool asValues = false;  // decode in values (vertex attributes)
+	bool asIndices = false; // decode in indices (triangle indices)
+
+	size_t count = 0;
+	unsigned int components = 0;
+	bool integer = false; // the component type is not a floating point type
+	std::vector<Scalarm> values;
+	std::vector<unsigned int> indices;
+};
+
 unsigned int getNumberMeshes(
 		const tinygltf::Model& model,
 		unsigned int node);
 
-void loadMeshesWhileTraversingNodes(
+void collectMeshesWhileTraversingNodes(
 		const tinygltf::Model& model,
 		std::list<MeshModel*>::const_iterator& currentMesh,
 		std::list<int>::iterator& currentMask,
 		Matrix44m currentMatrix,
 		unsigned int currentNode,
 		bool loadInSingleLayer,
-		vcg::CallBackPos* cb,
-		CallBackProgress& progress);
+		std::vector<PrimitiveLoad>& primitives);
 
 Matrix44m getCurrentNodeTrMatrix(
 		const tinygltf::Model& model,
 		unsigned int currentNode);
 
-void loadMesh(
+void collectMesh(
 		MeshModel& m,
 		int& mask,
 		const tinygltf::Mesh& tm,
 		const tinygltf::Model& model,
 		bool loadInSingleLayer,
 		const Matrix44m& transf,
-		vcg::CallBackPos* cb,
-		CallBackProgress& progress);
+		std::vector<PrimitiveLoad>& primitives);
 
-void loadMeshPrimitive(
+PrimitiveLoad collectMeshPrimitive(
 		MeshModel& m,
 		int& mask,
 		const tinygltf::Model& model,
 		const tinygltf::Primitive& p,
 		bool loadInSingleLayer,
-		const Matrix44m& transf,
-		vcg::CallBackPos* cb,
-		CallBackProgress& progress);
+		const Matrix44m& transf);
 
-bool loadAttribute(
-		MeshModel& m,
-		std::vector<CMeshO::VertexPointer>& ivp,
+int attributeAccessor(
 		const tinygltf::Model& model,
 		const tinygltf::Primitive& p,
-		GLTF_ATTR_TYPE attr,
-		int textID = -1);
-
-template <typename Scalar>
-void populateAttr(
-		GLTF_ATTR_TYPE attr,
-		MeshModel&m,
-		std::vector<CMeshO::VertexPointer>& ivp,
-		const Scalar* array,
-		unsigned int stride,
-		unsigned int number,
-		int textID = -1);
-
-template <typename Scalar>
-void populateVertices(
-		MeshModel& m,
-		std::vector<CMeshO::VertexPointer>& ivp,
-		const Scalar* posArray,
-		unsigned int stride,
-		unsigned int vertNumber);
-
-template <typename Scalar>
-void populateVNormals(
-		const std::vector<CMeshO::VertexPointer>& ivp,
-		const Scalar* normArray,
-		unsigned int stride,
-		unsigned int vertNumber);
-
-template <typename Scalar>
-void populateVColors(
-		const std::vector<CMeshO::VertexPointer>& ivp,
-		const Scalar* colorArray,
-		unsigned int stride,
-		unsigned int vertNumber,
-		int nElemns);
-
-template <typename Scalar>
-void populateVTextCoords(
-		const std::vector<CMeshO::VertexPointer>& ivp,
-		const Scalar* textCoordArray,
-		unsigned int stride,
-		unsigned int vertNumber,
-		int textID);
-
-template <typename Scalar>
-void populateTriangles(
-		MeshModel&m,
-		const std::vector<CMeshO::VertexPointer>& ivp,
-		const Scalar* triArray,
-		unsigned int triNumber);
+		GLTF_ATTR_TYPE attr);
+
+void allocateMeshes(std::vector<PrimitiveLoad>& primitives);
+
+void decodeAccessor(
+		const tinygltf::Model& model,
+		int accessorId,
+		DecodedAccessor& decoded);
+
+template <typename Out>
+bool decodeComponents(
+		int componentType,
+		const unsigned char* data,
+		size_t stride,
+		size_t count,
+		unsigned int nComponents,
+		Out* out);
+
+void transformCoords(
+		const Matrix44m& transf,
+		bool linearOnly,
+		const Scalarm* in,
+		size_t count,
+		Scalarm* out);
+
+bool populatePrimitive(
+		const PrimitiveLoad& pl,
+		const std::map<int, DecodedAccessor>& accessors);
 }
 
 }
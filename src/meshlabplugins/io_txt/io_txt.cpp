@@ -24,11 +24,13 @@
 
 #include "io_txt.h"
 
+#include <common/utilities/ascii_point_cloud_reader.h>
+
 //#include <wrap/io_trimesh/export.h>
 
 using namespace vcg;
 
-bool parseTXT(QString filename, CMeshO &m, int rowToSkip, int dataSeparator, int dataFormat, int rgbMode, int onError);
+bool parseTXT(QString filename, CMeshO &m, int rowToSkip, int dataSeparator, int dataFormat, int rgbMode, int onError, CallBackPos *cb);
 
 RichParameterList TxtIOPlugin::initPreOpenParameter(const QString &format) const
 {
@@ -61,7 +63,7 @@ RichParameterList TxtIOPlugin::initPreOpenParameter(const QString &format) const
     return parlst;
 }
 
-void TxtIOPlugin::open(const QString &formatName, const QString &fileName, MeshModel &m, int& mask, const RichParameterList &parlst, CallBackPos * /*cb*/)
+void TxtIOPlugin::open(const QString &formatName, const QString &fileName, MeshModel &m, int& mask, const RichParameterList &parlst, CallBackPos *cb)
 {
 	if(formatName.toUpper() == tr("TXT")) {
 		int rowToSkip = parlst.getInt("rowToSkip");
@@ -79,7 +81,7 @@ void TxtIOPlugin::open(const QString &formatName, const QString &fileName, MeshM
 
 		m.enable(mask);
 
-		if (!parseTXT(fileName, m.cm, rowToSkip, dataSeparator, dataFormat, rgbMode, onError))
+		if (!parseTXT(fileName, m.cm, rowToSkip, dataSeparator, dataFormat, rgbMode, onError, cb))
 			throw MLException("Error while opening TXT file.");
 	}
 	else {
@@ -124,496 +126,41 @@ void TxtIOPlugin::exportMaskCapability(const QString & /*format*/, int &capabili
 }
  
 
-bool parseTXT(QString filename, CMeshO &m, int rowToSkip, int dataSeparator, int dataFormat, int rgbMode, int onError)
+bool parseTXT(QString filename, CMeshO &m, int rowToSkip, int dataSeparator, int dataFormat, int rgbMode, int onError, CallBackPos *cb)
 {
-    QFile impFile(filename);
-    int ii;
-
-    if(impFile.open(QIODevice::ReadOnly))
-    {
-        QString freshLine;
-        QStringList tokenizedLine;
-        QString separator;
-        float XX,YY,ZZ;
-        float NX,NY,NZ;
-        float RR,GG,BB;
-        float Qual;
-        bool parseOK[10];
-
-        //skipping first rowToSkip lines,because it's the header
-        for(ii=0; ii<rowToSkip; ii++)
-        {
-            if(!impFile.atEnd())
-                freshLine = QString(impFile.readLine()).simplified();
-            else
-            {
-                impFile.close();
-                return false;
-            }
-        }
-
-        switch(dataSeparator)
-        {
-            case 0: separator = ";"; break;
-            case 1: separator = ","; break;
-            case 2: separator = " "; break;
-        }
-
-        //now, the data
-        while(!impFile.atEnd())
-        {
-            // reading and tokenizing
-            freshLine = QString(impFile.readLine()).simplified();
-            tokenizedLine = freshLine.split(separator, Qt::SkipEmptyParts);
-
-            switch(dataFormat)
-            {
-                case 0: // X Y Z
-                    {
-                        // number of token mismatch
-						if (tokenizedLine.size()<3)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							if (parseOK[0] && parseOK[1] && parseOK[2])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 1: // X Y Z Reflectance
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<4)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							Qual = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 2: // X Y Z Reflectance R G B
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<7)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							Qual = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							RR = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							GG = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							BB = tokenizedLine.at(6).toFloat(&(parseOK[6]));
-							if (rgbMode == 1) //[0.0-1.0]
-							{
-								RR *= 255; GG *= 255; BB *= 255;
-							}
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4] && parseOK[5] && parseOK[6])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-								(*vi).C() = Color4b(RR, GG, BB, 255);
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 3: // X Y Z Reflectance Nx Ny Nz
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<7)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							Qual = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							NX = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							NY = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							NZ = tokenizedLine.at(6).toFloat(&(parseOK[6]));
-
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4] && parseOK[5] && parseOK[6])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-								(*vi).N().Import(Point3f(NX, NY, NZ));
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 4: // X Y Z Reflectance R G B Nx Ny Nz
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<10)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							Qual = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							RR = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							GG = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							BB = tokenizedLine.at(6).toFloat(&(parseOK[6]));
-							NX = tokenizedLine.at(7).toFloat(&(parseOK[7]));
-							NY = tokenizedLine.at(8).toFloat(&(parseOK[8]));
-							NZ = tokenizedLine.at(9).toFloat(&(parseOK[9]));
-							if (rgbMode == 1) //[0.0-1.0]
-							{
-								RR *= 255; GG *= 255; BB *= 255;
-							}
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4]
-								&& parseOK[5] && parseOK[6] && parseOK[7] && parseOK[8] && parseOK[9])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-								(*vi).C() = Color4b(RR, GG, BB, 255);
-								(*vi).N().Import(Point3f(NX, NY, NZ));
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 5: // X Y Z Reflectance Nx Ny Nz R G B
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<10)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							Qual = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							NX = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							NY = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							NZ = tokenizedLine.at(6).toFloat(&(parseOK[6]));
-							RR = tokenizedLine.at(7).toFloat(&(parseOK[7]));
-							GG = tokenizedLine.at(8).toFloat(&(parseOK[8]));
-							BB = tokenizedLine.at(9).toFloat(&(parseOK[9]));
-							if (rgbMode == 1) //[0.0-1.0]
-							{
-								RR *= 255; GG *= 255; BB *= 255;
-							}
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4]
-								&& parseOK[5] && parseOK[6] && parseOK[7] && parseOK[8] && parseOK[9])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-								(*vi).C() = Color4b(RR, GG, BB, 255);
-								(*vi).N().Import(Point3f(NX, NY, NZ));
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 6: // X Y Z R G B
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<6)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							RR = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							GG = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							BB = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							if (rgbMode == 1) //[0.0-1.0]
-							{
-								RR *= 255; GG *= 255; BB *= 255;
-							}
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4] && parseOK[5])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).C() = Color4b(RR, GG, BB, 255);
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 7: // X Y Z R G B Reflectance
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<7)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							RR = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							GG = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							BB = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							Qual = tokenizedLine.at(6).toFloat(&(parseOK[6]));
-							if (rgbMode == 1) //[0.0-1.0]
-							{
-								RR *= 255; GG *= 255; BB *= 255;
-							}
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4] && parseOK[5] && parseOK[6])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-								(*vi).C() = Color4b(RR, GG, BB, 255);
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 8: // X Y Z R G B Reflectance Nx Ny Nz
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<10)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							RR = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							GG = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							BB = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							Qual = tokenizedLine.at(6).toFloat(&(parseOK[6]));
-							NX = tokenizedLine.at(7).toFloat(&(parseOK[7]));
-							NY = tokenizedLine.at(8).toFloat(&(parseOK[8]));
-							NZ = tokenizedLine.at(9).toFloat(&(parseOK[9]));
-							if (rgbMode == 1) //[0.0-1.0]
-							{
-								RR *= 255; GG *= 255; BB *= 255;
-							}
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4]
-								&& parseOK[5] && parseOK[6] && parseOK[7] && parseOK[8] && parseOK[9])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-								(*vi).C() = Color4b(RR, GG, BB, 255);
-								(*vi).N().Import(Point3f(NX, NY, NZ));
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 9: // X Y Z R G B Nx Ny Nz Reflectance
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<10)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							RR = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							GG = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							BB = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							NX = tokenizedLine.at(6).toFloat(&(parseOK[6]));
-							NY = tokenizedLine.at(7).toFloat(&(parseOK[7]));
-							NZ = tokenizedLine.at(8).toFloat(&(parseOK[8]));
-							Qual = tokenizedLine.at(9).toFloat(&(parseOK[9]));
-							if (rgbMode == 1) //[0.0-1.0]
-							{
-								RR *= 255; GG *= 255; BB *= 255;
-							}
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4]
-								&& parseOK[5] && parseOK[6] && parseOK[7] && parseOK[8] && parseOK[9])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-								(*vi).C() = Color4b(RR, GG, BB, 255);
-								(*vi).N().Import(Point3f(NX, NY, NZ));
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 10: // X Y Z Nx Ny Nz
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<6)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							NX = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							NY = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							NZ = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4] && parseOK[5])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).N().Import(Point3f(NX, NY, NZ));
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 11: // X Y Z Nx Ny Nz R G B Reflectance
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<10)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							NX = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							NY = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							NZ = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							RR = tokenizedLine.at(6).toFloat(&(parseOK[6]));
-							GG = tokenizedLine.at(7).toFloat(&(parseOK[7]));
-							BB = tokenizedLine.at(8).toFloat(&(parseOK[8]));
-							Qual = tokenizedLine.at(9).toFloat(&(parseOK[9]));
-							if (rgbMode == 1) //[0.0-1.0]
-							{
-								RR *= 255; GG *= 255; BB *= 255;
-							}
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4]
-								&& parseOK[5] && parseOK[6] && parseOK[7] && parseOK[8] && parseOK[9])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-								(*vi).C() = Color4b(RR, GG, BB, 255);
-								(*vi).N().Import(Point3f(NX, NY, NZ));
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 12: // X Y Z Nx Ny Nz Reflectance R G B
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<10)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							NX = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							NY = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							NZ = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							Qual = tokenizedLine.at(6).toFloat(&(parseOK[6]));
-							RR = tokenizedLine.at(7).toFloat(&(parseOK[7]));
-							GG = tokenizedLine.at(8).toFloat(&(parseOK[8]));
-							BB = tokenizedLine.at(9).toFloat(&(parseOK[9]));
-
-							if (rgbMode == 1) //[0.0-1.0]
-							{
-								RR *= 255; GG *= 255; BB *= 255;
-							}
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4]
-								&& parseOK[5] && parseOK[6] && parseOK[7] && parseOK[8] && parseOK[9])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-								(*vi).C() = Color4b(RR, GG, BB, 255);
-								(*vi).N().Import(Point3f(NX, NY, NZ));
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-            }
-
-
-        }
-
-        impFile.close();
-        return true;
-    }
-    else
-        return false;
+	typedef meshlab::AsciiPointCloudReader Reader;
+	static const std::vector<std::vector<Reader::Field>> formats = {
+		{Reader::X, Reader::Y, Reader::Z},
+		{Reader::X, Reader::Y, Reader::Z, Reader::QUALITY},
+		{Reader::X, Reader::Y, Reader::Z, Reader::QUALITY, Reader::RED, Reader::GREEN, Reader::BLUE},
+		{Reader::X, Reader::Y, Reader::Z, Reader::QUALITY, Reader::NX, Reader::NY, Reader::NZ},
+		{Reader::X, Reader::Y, Reader::Z, Reader::QUALITY, Reader::RED, Reader::GREEN, Reader::BLUE, Reader::NX, Reader::NY, Reader::NZ},
+		{Reader::X, Reader::Y, Reader::Z, Reader::QUALITY, Reader::NX, Reader::NY, Reader::NZ, Reader::RED, Reader::GREEN, Reader::BLUE},
+		{Reader::X, Reader::Y, Reader::Z, Reader::RED, Reader::GREEN, Reader::BLUE},
+		{Reader::X, Reader::Y, Reader::Z, Reader::RED, Reader::GREEN, Reader::BLUE, Reader::QUALITY},
+		{Reader::X, Reader::Y, Reader::Z, Reader::RED, Reader::GREEN, Reader::BLUE, Reader::QUALITY, Reader::NX, Reader::NY, Reader::NZ},
+		{Reader::X, Reader::Y, Reader::Z, Reader::RED, Reader::GREEN, Reader::BLUE, Reader::NX, Reader::NY, Reader::NZ, Reader::QUALITY},
+		{Reader::X, Reader::Y, Reader::Z, Reader::NX, Reader::NY, Reader::NZ},
+		{Reader::X, Reader::Y, Reader::Z, Reader::NX, Reader::NY, Reader::NZ, Reader::RED, Reader::GREEN, Reader::BLUE, Reader::QUALITY},
+		{Reader::X, Reader::Y, Reader::Z, Reader::NX, Reader::NY, Reader::NZ, Reader::QUALITY, Reader::RED, Reader::GREEN, Reader::BLUE}};
+
+	if (dataFormat < 0 || dataFormat >= (int) formats.size())
+		return false;
+
+	Reader reader(formats[dataFormat]);
+	switch(dataSeparator)
+	{
+		case 0: reader.setSeparators(";"); break;
+		case 1: reader.setSeparators(","); break;
+		case 2: reader.setSeparators(" \t\r\v\f"); break;
+	}
+	reader.setRowsToSkip(std::max(rowToSkip, 0));
+	reader.setColorScale(rgbMode == 1 ? 255.0f : 1.0f); // [0.0-1.0] or [0-255]
+	reader.setErrorPolicy(onError == 1 ? Reader::STOP : Reader::SKIP_LINE);
 
+	// the points read before a parsing error are kept also when stopping
+	Reader::Result res = reader.read(filename, m, cb);
+	return res.opened;
 }
 
-
- 
- 
 MESHLAB_PLUGIN_NAME_EXPORTER(TxtIOPlugin)